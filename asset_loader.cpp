@@ -0,0 +1,403 @@
+#include "asset_loader.h"
+#include "mapped_file.h"
+#include <io.h>
+
+asset_loader::asset_loader()
+	{
+	device = NULL;
+	next_job = 0;
+	pending = 0;
+	quit = false;
+	parallel = true;
+	failed = 0;
+	reloads = 0;
+	}
+asset_loader::~asset_loader()
+	{
+	stop();
+	}
+//***************************************************************
+void asset_loader::start(ID3D11Device *pd3dDevice, bool parallel_loading, int threads)
+	{
+	device = pd3dDevice;
+	parallel = parallel_loading;
+	quit = false;
+	if (!parallel) return;
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency() - 1;//the main thread has the device work
+	if (threads < 1) threads = 1;
+	for (int ii = 0; ii < threads; ii++)
+		workers.push_back(std::thread(&asset_loader::worker_loop, this));
+	}
+void asset_loader::stop()
+	{
+	watcher.stop();
+		{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+		}
+	wake.notify_all();
+	for (size_t ii = 0; ii < workers.size(); ii++)
+		workers[ii].join();
+	workers.clear();
+	for (size_t ii = 0; ii < jobs.size(); ii++)
+		{
+		asset_job *job = jobs[ii];
+		if (job->processor) job->processor->Destroy();
+		if (job->dataloader) job->dataloader->Destroy();
+		delete job;
+		}
+	jobs.clear();
+	next_job = 0;
+	pending = 0;
+	}
+//***************************************************************
+asset_handle asset_loader::submit(asset_job *job)
+	{
+	asset_handle handle;
+		{
+		std::lock_guard<std::mutex> guard(lock);
+		handle = (asset_handle)jobs.size();
+		jobs.push_back(job);
+		pending++;
+		}
+	if (parallel)
+		wake.notify_one();
+	else
+		{
+		//serial: like the old InitDevice, the asset is there when this returns
+		job->state = STATE_RUNNING;
+		load(job);
+		job->state = STATE_LOADED;
+		finish(job);
+		}
+	return handle;
+	}
+asset_handle asset_loader::load_model(const char *filename, model *target, bool packed)
+	{
+	asset_job *job = new asset_job;
+	job->type = JOB_MODEL;
+	job->filename = filename;
+	job->target_model = target;
+	job->packed = packed;
+	char cooked[1024];
+	cooked_mesh_name(filename, cooked, sizeof(cooked));
+	job->in_pack = pack.find(cooked) != NULL;
+	return submit(job);
+	}
+asset_handle asset_loader::load_texture(LPCWSTR filename, ID3D11ShaderResourceView **target)
+	{
+	//a reload hands over the new one, the old one goes
+	return load_texture(filename, [target](ID3D11ShaderResourceView *texture)
+		{
+		if (*target && *target != texture) (*target)->Release();
+		*target = texture;
+		});
+	}
+asset_handle asset_loader::load_texture(LPCWSTR filename, std::function<void(ID3D11ShaderResourceView*)> on_texture)
+	{
+	asset_job *job = new asset_job;
+	job->type = JOB_TEXTURE;
+	job->wfilename = filename;
+	job->on_texture = on_texture;
+	job->filename.assign(filename, filename + wcslen(filename));		//the pack has ascii names
+	char cooked[1024];
+	cooked_texture_name(job->filename.c_str(), cooked, sizeof(cooked));
+	job->pack_entry = pack.find(cooked) ? cooked : job->filename;
+	job->in_pack = pack.find(job->pack_entry.c_str()) != NULL;
+	prepare_texture(job);
+	return submit(job);
+	}
+void asset_loader::prepare_texture(asset_job *job)
+	{
+	//d3dx splits its own async loading the same way: Load/Decompress/Process anywhere, CreateDeviceObject on the device thread.
+	//the data loader is made by the worker: a memory loader on the pack mapping or on the cooked .dds, a file loader otherwise.
+	//no load info: the mips come from the file, d3dx makes none
+	if (FAILED(D3DX11CreateAsyncShaderResourceViewProcessor(device, NULL, &job->processor)))
+		job->processor = NULL;
+	}
+asset_handle asset_loader::load_file(const char *filename, std::function<bool(const asset_span&)> parse, std::function<void()> apply,
+	void (*cooked_name)(const char*, char*, size_t), bool (*cached)(const char*, char*, size_t))
+	{
+	asset_job *job = new asset_job;
+	job->type = JOB_FILE;
+	job->filename = filename;
+	job->parse = parse;
+	job->apply = apply;
+	job->cached = cached;
+	job->pack_entry = filename;
+	if (cooked_name)
+		{
+		//the pack holds the cooked file, not the source
+		char cooked[1024];
+		cooked_name(filename, cooked, sizeof(cooked));
+		if (pack.find(cooked)) job->pack_entry = cooked;
+		}
+	job->in_pack = pack.find(job->pack_entry.c_str()) != NULL;
+	return submit(job);
+	}
+asset_handle asset_loader::run(std::function<bool()> work)
+	{
+	asset_job *job = new asset_job;
+	job->type = JOB_CPU;
+	job->work = work;
+	return submit(job);
+	}
+//***************************************************************
+void asset_loader::worker_loop()
+	{
+	for (;;)
+		{
+		asset_job *job;
+			{
+			std::unique_lock<std::mutex> guard(lock);
+			while (!quit && next_job >= jobs.size())
+				wake.wait(guard);
+			if (quit) return;
+			job = jobs[next_job++];
+			job->state = STATE_RUNNING;
+			}
+		load(job);
+			{
+			std::lock_guard<std::mutex> guard(lock);
+			job->state = STATE_LOADED;
+			}
+		loaded.notify_all();
+		}
+	}
+void asset_loader::load(asset_job *job)
+	{
+	switch (job->type)
+		{
+		case JOB_MODEL:
+			if (job->in_pack)
+				{
+				//the cooked mesh is used right in the mapping
+				char cooked[1024];
+				asset_span span;
+				cooked_mesh_name(job->filename.c_str(), cooked, sizeof(cooked));
+				job->ok = pack.span(cooked, span, job->scratch) && job->mesh.open(span.data, span.size);
+				}
+			else
+				job->ok = load_mesh_cached(job->filename.c_str(), job->mesh);
+			break;
+		case JOB_TEXTURE:
+			{
+			void *data = NULL;
+			SIZE_T bytes = 0;
+			asset_span span;
+			char cooked[1024];
+			if (!job->processor)
+				;
+			else if (job->in_pack)
+				{
+				if (pack.span(job->pack_entry.c_str(), span, job->scratch))
+					D3DX11CreateAsyncMemoryLoader(span.data, span.size, &job->dataloader);
+				}
+			else if (is_texture_source(job->filename.c_str()) && texture_cached(job->filename.c_str(), cooked, sizeof(cooked)))
+				{
+				//the .dds is copied, d3dx reads it after the mapping would be gone
+				mapped_file file;
+				if (file.open(cooked) && file.size())
+					{
+					job->scratch.assign(file.data(), file.data() + file.size());
+					D3DX11CreateAsyncMemoryLoader(&job->scratch[0], job->scratch.size(), &job->dataloader);
+					}
+				}
+			else
+				D3DX11CreateAsyncFileLoaderW(job->wfilename.c_str(), &job->dataloader);	//.dds sources, or the image could not be decoded here
+			job->ok = job->processor != NULL && job->dataloader != NULL &&
+				SUCCEEDED(job->dataloader->Load()) &&
+				SUCCEEDED(job->dataloader->Decompress(&data, &bytes)) &&
+				SUCCEEDED(job->processor->Process(data, bytes));
+			break;
+			}
+		case JOB_FILE:
+			{
+			asset_span span;
+			mapped_file file;
+			char cooked[1024];
+			if (job->in_pack)
+				job->ok = pack.span(job->pack_entry.c_str(), span, job->scratch);
+			else if (job->cached)
+				{
+				if ((job->ok = job->cached(job->filename.c_str(), cooked, sizeof(cooked)) && file.open(cooked)))
+					{
+					span.data = file.data();
+					span.size = file.size();
+					}
+				}
+			else if ((job->ok = file.open(job->filename.c_str())))
+				{
+				span.data = file.data();
+				span.size = file.size();
+				}
+			job->ok = job->ok && job->parse(span);
+			break;
+			}
+		case JOB_CPU:
+			job->ok = job->work();
+			break;
+		}
+	}
+void asset_loader::finish(asset_job *job)
+	{
+	if (job->ok && job->type == JOB_MODEL)
+		{
+		if (job->reload)
+			{
+			//made next to the old one, a broken file leaves the old model
+			model fresh;
+			job->ok = CreateModel(device, job->mesh, &fresh, job->packed);
+			if (job->ok)
+				{
+				for (size_t ii = 0; ii < jobs.size(); ii++)
+					if (jobs[ii]->owner == job->target_model)
+						jobs[ii]->retired = true;
+				job->target_model->release();
+				*job->target_model = fresh;
+				}
+			}
+		else
+			job->ok = CreateModel(device, job->mesh, job->target_model, job->packed);
+		if (job->ok) load_material_textures(job);
+		}
+	if (job->ok && job->type == JOB_TEXTURE)
+		{
+		ID3D11ShaderResourceView *texture = NULL;
+		job->ok = SUCCEEDED(job->processor->CreateDeviceObject((void**)&texture));
+		if (job->ok && job->retired && job->owner)
+			texture->Release();		//its model was reloaded meanwhile
+		else if (job->ok)
+			job->on_texture(texture);
+		}
+	if (job->ok && job->type == JOB_FILE && job->apply)
+		job->apply();
+	job->mesh.close();
+	if (job->processor) job->processor->Destroy();
+	if (job->dataloader) job->dataloader->Destroy();
+	job->processor = NULL;
+	job->dataloader = NULL;
+	vector<unsigned char>().swap(job->scratch);
+	if (!job->ok && !job->reload) failed++;
+	job->state = STATE_DONE;
+	pending--;
+	if (job->reload)
+		{
+		char report[512];
+		if (job->ok)
+			{
+			reloads++;
+			sprintf_s(report, "reload: %s in %d ms\n", job->filename.c_str(), (int)(watch_clock_ms() - job->started));
+			}
+		else
+			sprintf_s(report, "reload: %s failed, the old one stays\n", job->filename.c_str());
+		OutputDebugStringA(report);
+		}
+	if (job->stale && !job->retired)
+		reload(job);
+	}
+//the material textures of a 3ds model as jobs of their own, the ones that are neither in the pack nor on disk are left NULL
+void asset_loader::load_material_textures(asset_job *job)
+	{
+	model *target = job->target_model;
+	target->textures.assign(target->materials.size(), NULL);
+	int groups = 0, found = 0;
+	for (size_t ii = 0; ii < target->materials.size(); ii++)
+		{
+		const mesh_material &material = target->materials[ii];
+		groups += material.face_groups;
+		if (!material.texture[0]) continue;
+		if (!pack.find(material.texture) && _access(material.texture, 0) != 0) continue;
+		std::wstring name(material.texture, material.texture + strlen(material.texture));
+		asset_handle texture = load_texture(name.c_str(), [target, ii](ID3D11ShaderResourceView *t) { target->set_texture(ii, t); });
+		jobs[texture]->owner = target;
+		found++;
+		}
+	if (target->materials.size() > 1)
+		{
+		char report[512];
+		sprintf_s(report, "%s: %d materials from %d face groups, %d textures\n", job->filename.c_str(), (int)target->materials.size(), groups, found);
+		OutputDebugStringA(report);
+		}
+	}
+//***************************************************************
+//		hot reload
+//***************************************************************
+bool asset_loader::watch(const char *directory)
+	{
+	return watcher.start(directory);
+	}
+//a copy of the job that reads the loose file, it takes over the watching
+void asset_loader::reload(asset_job *job)
+	{
+	asset_job *next = new asset_job;
+	next->type = job->type;
+	next->filename = job->filename;
+	next->wfilename = job->wfilename;
+	next->target_model = job->target_model;
+	next->packed = job->packed;
+	next->on_texture = job->on_texture;
+	next->work = job->work;
+	next->parse = job->parse;
+	next->apply = job->apply;
+	next->cached = job->cached;
+	next->owner = job->owner;
+	next->reload = true;
+	next->started = watch_clock_ms();
+	job->retired = true;
+	if (next->type == JOB_TEXTURE)
+		prepare_texture(next);
+	submit(next);
+	}
+void asset_loader::file_changed(const char *name)
+	{
+	std::string changed = pack_name(name);
+	size_t count = jobs.size();		//not the reloads that get added
+	for (size_t ii = 0; ii < count; ii++)
+		{
+		asset_job *job = jobs[ii];
+		if (job->retired || job->type == JOB_CPU || pack_name(job->filename.c_str()) != changed)
+			continue;
+		if (job->state == STATE_DONE)
+			reload(job);
+		else
+			job->stale = true;		//once more when it is through
+		}
+	}
+//***************************************************************
+bool asset_loader::wait(asset_handle handle)
+	{
+	if (handle < 0 || handle >= (asset_handle)jobs.size()) return false;
+	asset_job *job = jobs[handle];
+		{
+		std::unique_lock<std::mutex> guard(lock);
+		while (job->state < STATE_LOADED)
+			loaded.wait(guard);
+		}
+	if (job->state == STATE_LOADED)
+		finish(job);
+	return job->ok;
+	}
+void asset_loader::wait_all()
+	{
+	for (size_t ii = 0; ii < jobs.size(); ii++)
+		wait((asset_handle)ii);
+	}
+int asset_loader::update()
+	{
+	vector<std::string> changed;
+	if (watcher.poll(changed))
+		for (size_t ii = 0; ii < changed.size(); ii++)
+			file_changed(changed[ii].c_str());
+	vector<asset_job*> ready;
+		{
+		std::lock_guard<std::mutex> guard(lock);
+		for (size_t ii = 0; ii < jobs.size(); ii++)
+			if (jobs[ii]->state == STATE_LOADED)
+				ready.push_back(jobs[ii]);
+		}
+	for (size_t ii = 0; ii < ready.size(); ii++)
+		finish(ready[ii]);
+	return pending;
+	}
@@ -0,0 +1,142 @@
+#pragma once
+#include "groundwork.h"
+#include "asset_pack.h"
+#include "file_watch.h"
+#include "texture.h"
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+//**********************************************************************************************************************************************
+//
+//			USAGE:
+//
+//			loads models and textures on a few worker threads. a worker reads the file, decodes the image or
+//			cooks/maps the mesh, the device object (texture, vertex/index buffer) is made on the main thread.
+//			png/jpg/bmp/tga are cooked to a .dds with all mips first (texture.h), only that is uploaded.
+//
+//			STEP 1: global
+//				asset_loader loader;
+//
+//			STEP 2: in InitDevice, after the device exists
+//				loader.pack.open("assets.pak");									<- optional: models/textures from the archive, loose files otherwise
+//				loader.start(g_pd3dDevice, TRUE);								<- FALSE: everything loads right away on the main thread
+//				asset_handle sky = loader.load_model("ccsphere.cmp", &model_sky);
+//				loader.load_model("asteroid.3ds", &model_asteroids, TRUE);			<- packed_vertex, draw with VS_packed
+//				loader.load_texture(L"space.png", &g_pTexture_sky);
+//				loader.load_texture(L"exp1.dds", [](ID3D11ShaderResourceView *t) { ... });	<- called on the main thread
+//				loader.run([]() { level1.init("level.bmp"); return true; });				<- any cpu work
+//				loader.load_file("readme.txt", [](const asset_span &text) { ... }, []() { ... });	<- read from the pack or the file,
+//																				   the 2nd one runs on the main thread after it
+//				loader.load_file("level.bmp", parse, apply, cooked_level_name, level_cached);	<- parse gets the cooked file: the one in the
+//																				   pack, or the loose source cooked (again) first
+//				loader.watch(".");												<- optional: hot reload, see below
+//				loader.wait(sky);												<- blocks until this one is usable
+//
+//			STEP 3: at the beginning of the render function
+//				loader.update();			<- makes the device objects of everything that finished, returns how many are left
+//				loader.done()				<- TRUE when all assets are there
+//
+//			hot reload: after watch(), update() also looks for changed files in that directory. the asset that came
+//			from a changed file (model source, texture, load_file) is loaded again from the loose file,
+//			on the workers like the first time. update() swaps it in between two frames: the model is made new and
+//			replaces the old one in the same model object, a texture goes through the same target/callback (the
+//			**target version releases the old one). reloads counts the swaps, for things made out of the assets.
+//			if the new file does not load the old asset stays. sounds are opened at every play, they need nothing.
+//
+//			a 3ds model with materials gets its texture files loaded into model::textures, see model::draw_materials.
+//			the targets (model, texture pointer) stay empty/NULL until their job is finished, drawing them
+//			before that draws nothing.
+//
+//**********************************************************************************************************************************************
+typedef int asset_handle;
+
+class asset_loader
+	{
+	private:
+		enum { JOB_MODEL, JOB_TEXTURE, JOB_FILE, JOB_CPU };
+		enum { STATE_QUEUED, STATE_RUNNING, STATE_LOADED, STATE_DONE };
+		class asset_job
+			{
+			public:
+				int type;
+				int state;
+				bool ok;
+				std::string filename;
+				std::wstring wfilename;
+				bool in_pack;							//read from the asset pack instead of the file
+				std::string pack_entry;					//JOB_TEXTURE/JOB_FILE: its name in the pack, the cooked file or the file itself
+				vector<unsigned char> scratch;			//lz4 entries of the pack are unpacked into this
+				model *target_model;
+				bool packed;							//JOB_MODEL: packed_vertex buffer
+				cooked_mesh mesh;						//JOB_MODEL: mapped by the worker
+				ID3DX11DataLoader *dataloader;			//JOB_TEXTURE: file read and decode by the worker
+				ID3DX11DataProcessor *processor;
+				std::function<void(ID3D11ShaderResourceView*)> on_texture;
+				std::function<bool()> work;				//JOB_CPU
+				std::function<bool(const asset_span&)> parse;	//JOB_FILE: worker
+				std::function<void()> apply;			//JOB_FILE: main thread, after parse
+				bool (*cached)(const char*, char*, size_t);	//JOB_FILE: cooks the loose file if needed and names the cooked one
+				model *owner;							//JOB_TEXTURE: material texture of this model
+				bool reload;							//a new version of an asset that is already there
+				bool retired;							//replaced by a reload, not watched anymore
+				bool stale;								//the file changed again while this was loading
+				uint64_t started;						//reload: ms when the change was seen
+				asset_job()
+					{
+					type = JOB_CPU;
+					state = STATE_QUEUED;
+					ok = false;
+					target_model = NULL;
+					packed = false;
+					in_pack = false;
+					dataloader = NULL;
+					processor = NULL;
+					owner = NULL;
+					cached = NULL;
+					reload = false;
+					retired = false;
+					stale = false;
+					started = 0;
+					}
+			};
+		ID3D11Device *device;
+		vector<asset_job*> jobs;
+		vector<std::thread> workers;
+		std::mutex lock;
+		std::condition_variable wake;			//workers: there is a new job
+		std::condition_variable loaded;			//main thread: a job is finished on the worker side
+		size_t next_job;
+		int pending;							//jobs that are not STATE_DONE
+		bool quit;
+		file_watch watcher;
+		asset_handle submit(asset_job *job);
+		void worker_loop();
+		void load(asset_job *job);				//worker side
+		void finish(asset_job *job);			//main thread side
+		void load_material_textures(asset_job *job);
+		void prepare_texture(asset_job *job);
+		void reload(asset_job *job);
+		void file_changed(const char *name);
+	public:
+		bool parallel;
+		int failed;
+		int reloads;							//assets swapped by the hot reload so far
+		asset_pack pack;						//open it before the first load
+		asset_loader();
+		~asset_loader();
+		void start(ID3D11Device *pd3dDevice, bool parallel_loading, int threads = 0);
+		void stop();
+		asset_handle load_model(const char *filename, model *target, bool packed = false);	//packed: see CreateModel
+		asset_handle load_texture(LPCWSTR filename, ID3D11ShaderResourceView **target);
+		asset_handle load_texture(LPCWSTR filename, std::function<void(ID3D11ShaderResourceView*)> on_texture);
+		asset_handle run(std::function<bool()> work);
+		asset_handle load_file(const char *filename, std::function<bool(const asset_span&)> parse, std::function<void()> apply = nullptr,
+			void (*cooked_name)(const char*, char*, size_t) = NULL, bool (*cached)(const char*, char*, size_t) = NULL);
+		bool watch(const char *directory);		//hot reload of what comes from there
+		bool wait(asset_handle handle);		//FALSE if loading failed
+		void wait_all();
+		int update();
+		bool done()			{ return pending == 0; }
+	};
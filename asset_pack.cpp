@@ -0,0 +1,331 @@
+#include "asset_pack.h"
+#include "mesh.h"
+#include <stdio.h>
+#include <string.h>
+
+//***************************************************************
+//		lz4 block format: token (literal length << 4 | match length - 4), literals, 2 byte offset, longer lengths
+//		in extra bytes of 255. greedy matches from a hash table of the last position of every 4 bytes, the last
+//		5 bytes are always literals and the last match starts 12 bytes before the end, like the reference.
+//***************************************************************
+#define LZ4_MINMATCH		4
+#define LZ4_LASTLITERALS	5
+#define LZ4_MFLIMIT			12
+#define LZ4_HASHLOG			16
+
+static uint32_t read32(const unsigned char *p)
+	{
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+	}
+static uint32_t lz4_hash(uint32_t v)
+	{
+	return (v * 2654435761u) >> (32 - LZ4_HASHLOG);
+	}
+static unsigned char *write_length(unsigned char *op, size_t length)
+	{
+	for (; length >= 255; length -= 255)
+		*op++ = 255;
+	*op++ = (unsigned char)length;
+	return op;
+	}
+static unsigned char *write_literals(unsigned char *op, const unsigned char *literals, size_t count, size_t match_length, bool has_match)
+	{
+	unsigned char *token = op++;
+	*token = (unsigned char)((count >= 15 ? 15 : count) << 4);
+	if (count >= 15) op = write_length(op, count - 15);
+	memcpy(op, literals, count);
+	op += count;
+	if (has_match)
+		*token |= (unsigned char)(match_length >= 15 ? 15 : match_length);
+	return op;
+	}
+size_t lz4_bound(size_t size)
+	{
+	return size + size / 255 + 16;
+	}
+size_t lz4_compress(const unsigned char *source, size_t size, unsigned char *destination, size_t capacity)
+	{
+	if (capacity < lz4_bound(size)) return 0;
+	vector<uint32_t> table((size_t)1 << LZ4_HASHLOG, 0);
+	const unsigned char *ip = source, *anchor = source, *end = source + size;
+	unsigned char *op = destination;
+	if (size > LZ4_MFLIMIT)
+		{
+		const unsigned char *match_limit = end - LZ4_MFLIMIT;
+		const unsigned char *match_end = end - LZ4_LASTLITERALS;
+		while (ip < match_limit)
+			{
+			uint32_t h = lz4_hash(read32(ip));
+			const unsigned char *ref = source + table[h];
+			table[h] = (uint32_t)(ip - source);
+			if (ref >= ip || ip - ref > 65535 || read32(ref) != read32(ip))
+				{
+				ip += 1 + ((ip - anchor) >> 6);		//incompressible data (png, mp3) gets skipped faster
+				continue;
+				}
+			while (ip > anchor && ref > source && ip[-1] == ref[-1])
+				{
+				ip--;
+				ref--;
+				}
+			const unsigned char *mp = ip + LZ4_MINMATCH, *rp = ref + LZ4_MINMATCH;
+			while (mp < match_end && *mp == *rp)
+				{
+				mp++;
+				rp++;
+				}
+			size_t match_length = mp - ip - LZ4_MINMATCH;
+			op = write_literals(op, anchor, ip - anchor, match_length, true);
+			size_t offset = ip - ref;
+			*op++ = (unsigned char)(offset & 255);
+			*op++ = (unsigned char)(offset >> 8);
+			if (match_length >= 15) op = write_length(op, match_length - 15);
+			ip = anchor = mp;
+			if (ip < match_limit)
+				table[lz4_hash(read32(ip - 2))] = (uint32_t)(ip - 2 - source);
+			}
+		}
+	op = write_literals(op, anchor, end - anchor, 0, false);
+	return op - destination;
+	}
+static bool read_length(const unsigned char *&ip, const unsigned char *end, size_t &length)
+	{
+	unsigned b;
+	do
+		{
+		if (ip >= end) return false;
+		b = *ip++;
+		length += b;
+		}
+	while (b == 255);
+	return true;
+	}
+bool lz4_decompress(const unsigned char *source, size_t size, unsigned char *destination, size_t destination_size)
+	{
+	const unsigned char *ip = source, *end = source + size;
+	unsigned char *op = destination, *out_end = destination + destination_size;
+	while (ip < end)
+		{
+		unsigned token = *ip++;
+		size_t literals = token >> 4;
+		if (literals == 15 && !read_length(ip, end, literals)) return false;
+		if ((size_t)(end - ip) < literals || (size_t)(out_end - op) < literals) return false;
+		memcpy(op, ip, literals);
+		op += literals;
+		ip += literals;
+		if (ip == end) break;						//the last sequence has no match
+		if (end - ip < 2) return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - destination)) return false;
+		size_t match = token & 15;
+		if (match == 15 && !read_length(ip, end, match)) return false;
+		match += LZ4_MINMATCH;
+		if ((size_t)(out_end - op) < match) return false;
+		const unsigned char *ref = op - offset;
+		if (offset >= match)
+			memcpy(op, ref, match);
+		else
+			for (size_t ii = 0; ii < match; ii++)	//overlapping: repeats the last offset bytes
+				op[ii] = ref[ii];
+		op += match;
+		}
+	return op == out_end;
+	}
+//***************************************************************
+std::string pack_name(const char *name)
+	{
+	std::string result(name);
+	for (size_t ii = 0; ii < result.size(); ii++)
+		{
+		char c = result[ii];
+		if (c == '\\') c = '/';
+		if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+		result[ii] = c;
+		}
+	if (result.compare(0, 2, "./") == 0) result.erase(0, 2);
+	return result;
+	}
+uint64_t pack_name_hash(const char *name)
+	{
+	std::string normalized = pack_name(name);
+	return hash_bytes(normalized.data(), normalized.size());
+	}
+//***************************************************************
+asset_pack::asset_pack()
+	{
+	header = NULL;
+	entries = NULL;
+	slots = NULL;
+	names = NULL;
+	}
+bool asset_pack::open(const char *filename)
+	{
+	close();
+	if (!file.open(filename) || file.size() < sizeof(pack_header)) return false;
+	const pack_header *h = (const pack_header*)file.data();
+	uint64_t size = file.size();
+	uint64_t table_bytes = (uint64_t)h->entry_count * sizeof(pack_entry) + (uint64_t)h->slot_count * sizeof(uint32_t);
+	if (h->magic != PACK_MAGIC || h->version != PACK_VERSION || h->slot_count == 0 || (h->slot_count & (h->slot_count - 1)) ||
+		h->slot_count < h->entry_count || h->table_offset % 8 || h->table_offset > size || table_bytes > size - h->table_offset ||
+		h->names_offset > size || h->names_size > size - h->names_offset || h->names_size == 0 || file.data()[size - 1] != 0)
+		{
+		close();
+		return false;
+		}
+	entries = (const pack_entry*)(file.data() + h->table_offset);
+	for (uint32_t ii = 0; ii < h->entry_count; ii++)
+		if (entries[ii].offset > size || entries[ii].stored_size > size - entries[ii].offset || entries[ii].name_offset >= h->names_size)
+			{
+			close();
+			return false;
+			}
+	header = h;
+	slots = (const uint32_t*)(entries + h->entry_count);
+	names = (const char*)file.data() + h->names_offset;
+	return true;
+	}
+void asset_pack::close()
+	{
+	file.close();
+	header = NULL;
+	entries = NULL;
+	slots = NULL;
+	names = NULL;
+	}
+const pack_entry *asset_pack::find(const char *name) const
+	{
+	if (!header) return NULL;
+	std::string normalized = pack_name(name);
+	uint64_t h = hash_bytes(normalized.data(), normalized.size());
+	uint32_t mask = header->slot_count - 1;
+	for (uint32_t ii = 0, slot = (uint32_t)h & mask; ii < header->slot_count; ii++, slot = (slot + 1) & mask)
+		{
+		uint32_t index = slots[slot];
+		if (index == 0 || index > header->entry_count) return NULL;
+		const pack_entry &e = entries[index - 1];
+		if (e.name_hash == h && normalized == names + e.name_offset)
+			return &e;
+		}
+	return NULL;
+	}
+bool asset_pack::get(const char *name, asset_span &span) const
+	{
+	const pack_entry *e = find(name);
+	if (!e || (e->flags & PACK_LZ4)) return false;
+	span.data = file.data() + e->offset;
+	span.size = (size_t)e->size;
+	return true;
+	}
+bool asset_pack::span(const char *name, asset_span &result, vector<unsigned char> &scratch) const
+	{
+	const pack_entry *e = find(name);
+	if (!e) return false;
+	if (!(e->flags & PACK_LZ4))
+		return get(name, result);
+	scratch.resize((size_t)e->size);
+	if (e->size && !lz4_decompress(file.data() + e->offset, (size_t)e->stored_size, &scratch[0], (size_t)e->size))
+		return false;
+	result.data = scratch.empty() ? NULL : &scratch[0];
+	result.size = scratch.size();
+	return true;
+	}
+//***************************************************************
+static bool write_all(FILE *file, const void *data, size_t size)
+	{
+	return size == 0 || fwrite(data, size, 1, file) == 1;
+	}
+static bool write_padding(FILE *file, uint64_t &position, uint64_t alignment)
+	{
+	static const unsigned char zeros[PACK_ALIGN] = { 0 };
+	size_t pad = (size_t)((alignment - position % alignment) % alignment);
+	position += pad;
+	return write_all(file, zeros, pad);
+	}
+bool write_pack(const char *archive, const vector<pack_source> &sources, pack_stats *stats)
+	{
+	pack_stats st;
+	memset(&st, 0, sizeof(st));
+	vector<pack_entry> entries(sources.size());
+	std::string names;
+	uint32_t slot_count = 16;
+	while (slot_count < sources.size() * 2)
+		slot_count *= 2;
+	vector<uint32_t> slots(slot_count, 0);
+
+	char temp[1024];
+	snprintf(temp, sizeof(temp), "%s.tmp", archive);
+	FILE *file = fopen(temp, "wb");
+	if (!file) return false;
+	pack_header header;
+	memset(&header, 0, sizeof(header));
+	bool written = write_all(file, &header, sizeof(header));
+	uint64_t position = sizeof(header);
+	vector<unsigned char> compressed;
+	for (size_t ii = 0; ii < sources.size() && written; ii++)
+		{
+		std::string name = pack_name(sources[ii].name.c_str());
+		pack_entry &e = entries[ii];
+		memset(&e, 0, sizeof(e));
+		e.name_hash = hash_bytes(name.data(), name.size());
+		e.name_offset = (uint32_t)names.size();
+		names.append(name.c_str(), name.size() + 1);
+		uint32_t slot = (uint32_t)e.name_hash & (slot_count - 1);
+		for (; slots[slot]; slot = (slot + 1) & (slot_count - 1))
+			if (name == names.c_str() + entries[slots[slot] - 1].name_offset)
+				written = false;				//the same name twice
+		slots[slot] = (uint32_t)ii + 1;
+
+		mapped_file in;
+		if (!written || !in.open(sources[ii].path.c_str()))
+			{
+			written = false;
+			break;
+			}
+		const unsigned char *data = in.data();
+		e.size = e.stored_size = in.size();
+		if (sources[ii].compress && in.size() > 0)
+			{
+			compressed.resize(lz4_bound(in.size()));
+			size_t c = lz4_compress(in.data(), in.size(), &compressed[0], compressed.size());
+			if (c > 0 && c <= in.size() - in.size() / PACK_MIN_SAVING)
+				{
+				data = &compressed[0];
+				e.stored_size = c;
+				e.flags |= PACK_LZ4;
+				st.compressed++;
+				}
+			}
+		written = write_padding(file, position, PACK_ALIGN) && write_all(file, data, (size_t)e.stored_size);
+		e.offset = position;
+		position += e.stored_size;
+		st.bytes += e.size;
+		st.stored_bytes += e.stored_size;
+		}
+	header.magic = PACK_MAGIC;
+	header.version = PACK_VERSION;
+	header.entry_count = (uint32_t)entries.size();
+	header.slot_count = slot_count;
+	if (names.empty()) names.push_back(0);
+	written = written && write_padding(file, position, 8);
+	header.table_offset = position;
+	header.names_offset = position + entries.size() * sizeof(pack_entry) + slots.size() * sizeof(uint32_t);
+	header.names_size = names.size();
+	if (written && !entries.empty()) written = write_all(file, &entries[0], entries.size() * sizeof(pack_entry));
+	written = written && write_all(file, &slots[0], slots.size() * sizeof(uint32_t)) && write_all(file, names.data(), names.size());
+	written = written && fseek(file, 0, SEEK_SET) == 0 && write_all(file, &header, sizeof(header));
+	written = (fclose(file) == 0) && written;
+	if (!written)
+		{
+		remove(temp);
+		return false;
+		}
+	remove(archive);
+	if (rename(temp, archive) != 0) return false;
+	st.entries = (uint32_t)entries.size();
+	st.archive_bytes = header.names_offset + header.names_size;
+	if (stats) *stats = st;
+	return true;
+	}
@@ -0,0 +1,108 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			one archive instead of the loose asset files
+//
+//			the packer (assettool pack) puts every file into one archive: entries aligned to PACK_ALIGN, the ones that
+//			get noticeably smaller with lz4 compressed, models as their cooked .mesh. a hash table over the names
+//			(lower case, '/' as separator) finds an entry without a string search.
+//
+//			USAGE:
+//				asset_pack pack;
+//				pack.open("assets.pak");						<- mapped once, stays mapped
+//				asset_span span;
+//				if (pack.get("level.bmp", span))				<- stored entries: points into the mapping, no copy
+//					use(span.data, span.size);
+//				vector<unsigned char> scratch;
+//				pack.span("exp1.dds", span, scratch);			<- any entry, compressed ones are unpacked into scratch
+//
+//			no windows.h in here, assettool builds it headless
+//
+//**********************************************************************************************************************************************
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+using std::vector;
+
+#define PACK_MAGIC			0x4B434150	//"PACK"
+#define PACK_VERSION		1
+#define PACK_ALIGN			64			//every entry starts on a cache line, cooked meshes can be used in place
+#define PACK_LZ4			1			//pack_entry flags
+#define PACK_MIN_SAVING		8			//compressed only if that saves at least 1/8
+
+//file layout: header | entries (aligned) | pack_entry table | hash slots | names
+struct pack_header
+	{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t slot_count;			//power of two, at least twice the entries
+	uint64_t table_offset;
+	uint64_t names_offset;
+	uint64_t names_size;
+	};
+struct pack_entry
+	{
+	uint64_t name_hash;
+	uint64_t offset;
+	uint64_t stored_size;			//in the archive
+	uint64_t size;					//unpacked
+	uint32_t flags;
+	uint32_t name_offset;			//into the names, zero terminated
+	};
+
+struct asset_span
+	{
+	const unsigned char *data;
+	size_t size;
+	};
+
+class asset_pack
+	{
+	private:
+		mapped_file file;
+		const pack_header *header;
+		const pack_entry *entries;
+		const uint32_t *slots;			//entry index + 1, 0 is empty
+		const char *names;
+		asset_pack(const asset_pack&);
+		asset_pack &operator=(const asset_pack&);
+	public:
+		asset_pack();
+		bool open(const char *filename);
+		void close();
+		bool is_open() const		{ return header != NULL; }
+		const pack_entry *find(const char *name) const;
+		bool get(const char *name, asset_span &span) const;							//stored entries only
+		bool span(const char *name, asset_span &span, vector<unsigned char> &scratch) const;
+		int count() const			{ return header ? (int)header->entry_count : 0; }
+		const pack_entry &entry(int ii) const	{ return entries[ii]; }
+		const char *entry_name(int ii) const	{ return names + entries[ii].name_offset; }
+	};
+
+//lower case and '/', the same for the packer and the lookup
+std::string pack_name(const char *name);
+uint64_t pack_name_hash(const char *name);
+
+//---------------------------------------------- packer ----------------------------------------------
+struct pack_source
+	{
+	std::string name;				//in the archive
+	std::string path;				//on disk
+	bool compress;					//try lz4
+	};
+struct pack_stats
+	{
+	uint32_t entries;
+	uint32_t compressed;
+	uint64_t bytes;					//all files
+	uint64_t stored_bytes;			//their entries
+	uint64_t archive_bytes;			//with alignment and table
+	};
+bool write_pack(const char *archive, const vector<pack_source> &sources, pack_stats *stats = NULL);
+
+//---------------------------------------------- lz4 block format ----------------------------------------------
+size_t lz4_bound(size_t size);
+size_t lz4_compress(const unsigned char *source, size_t size, unsigned char *destination, size_t capacity);	//0: did not fit
+bool lz4_decompress(const unsigned char *source, size_t size, unsigned char *destination, size_t destination_size);
@@ -0,0 +1,2281 @@
+//--------------------------------------------------------------------------------------
+// File: assettool.cpp
+//
+// Headless command line tool for the asset pipeline, no D3D device and no windows.h.
+// It is not part of the game project, build it next to it:
+//
+//		cl /O2 /EHsc assettool.cpp mesh.cpp mesh_optimize.cpp mesh_normals.cpp mesh_obj.cpp mesh_simplify.cpp mesh_meshlet.cpp mesh_quantize.cpp asset_pack.cpp atlas.cpp mapped_file.cpp file_watch.cpp texture.cpp texture_png.cpp texture_jpeg.cpp texture_mips.cpp texture_bc.cpp level_mesh.cpp level_cook.cpp level_stream.cpp level_grid.cpp level_pvs.cpp
+//		g++ -O2 -std=c++11 assettool.cpp mesh.cpp mesh_optimize.cpp mesh_normals.cpp mesh_obj.cpp mesh_simplify.cpp mesh_meshlet.cpp mesh_quantize.cpp asset_pack.cpp atlas.cpp mapped_file.cpp file_watch.cpp texture.cpp texture_png.cpp texture_jpeg.cpp texture_mips.cpp texture_bc.cpp level_mesh.cpp level_cook.cpp level_stream.cpp level_grid.cpp level_pvs.cpp -pthread -o assettool
+//
+// Commands:
+//		assettool cook <model files...>		writes/refreshes the cooked .mesh next to each model,
+//											prints welding, ACMR and memory numbers per mesh
+//		assettool info <model files...>		loads through the cache and prints the header, the 3ds materials with
+//											their face groups, the bounding sphere and box center of the mesh and every range
+//		assettool bench3ds <.3ds files...>	the in-memory 3ds parser: the chunk walk in MB/s, the smooth normals
+//											after it on their own, then both
+//		assettool benchcmp <.cmp files...>	the same for the mapped cmp reader
+//		assettool lods <model files...>		LOD chain per mesh: triangles and error per level, then 1000 random
+//											instances (like the asteroid field) bucketed per LOD with the timing
+//		assettool normals <.3ds files...>	smooth normals: hash grid (1 thread and all cores) against the
+//											brute force reference, prints the timings and the largest difference
+//		assettool quantize <model files...>	packed vertices/instances: round trip checks of the half float, octahedral
+//											and instance encoding, then the largest error and the bytes saved per mesh
+//		assettool pack <archive> <files...>	one archive (asset_pack.h) with all files, models as their cooked .mesh, images as .dds, level*.bmp as .level,
+//											every entry is read back and compared
+//		assettool list <archive>			the entries with their sizes
+//		assettool benchpack <archive> <files...>	reads the same assets loose and from the archive, cold (page cache
+//											dropped, linux only) and warm
+//		assettool benchobj <quads> [file]	writes a synthetic obj (a torus, quads with v/vt/vn) and parses it
+//											single threaded and on all cores, prints MB/s and faces/s
+//		assettool meshlets <model files...>	meshlet sizes and coverage, then 1000 random views culled: the share of
+//											meshlets and triangles rejected, a per triangle check and the cull time
+//		assettool atlas [images...]			texture atlas layout of the images (sizes from the headers) with the
+//											uv rects and the efficiency, then random sets with timing and overlap checks
+//		assettool textures [images...]		decodes and cooks each image (.dds with the kaiser mip chain in linear light,
+//											block compressed by role), reads it back, prints the timings, how far the small
+//											mips drift in brightness and the psnr and speed of every compression preset
+//		assettool levelmesh [level bmps...]	greedy merge of the level walls/floors/ceilings on synthetic levels (maze,
+//											rooms, noise) and the given bitmaps: quads before and after, coverage check,
+//											then the static batches: checked against wall::get_matrix, draws and cpu per frame
+//		assettool levels [level bmps...]	the level compiler: bitmap layouts (padded rows, top down, 32 bit) and refused files,
+//											then 4096x4096 levels and the given ones cooked: sizes, and the load time of the
+//											bitmap (as every load was) against the mapped .level
+//		assettool stream [level bmp] [MB]	tile streaming: the tiles of synthetic levels against the whole level, then a fly through
+//											a 4096x4096 level (or the given one) with a small tile budget (4 MB): tile load latency,
+//											pop in, evictions and the peak memory
+//		assettool collide					level collision: grid raycasts and swept spheres against testing every box, the
+//											sliding camera, then queries a second on levels from 256x256 to 4096x4096
+//		assettool pvs [level bmps...]		potentially visible sets of synthetic mazes and rooms: build time, cells and blocks
+//											seen (checked against straight lines), the faces and draws a frame still submits
+//		assettool ticks [seconds]			the fixed simulation ticks (sim_clock.h): a scripted ship flown for 60 s (or seconds)
+//											at frame rates from 20 to 1000 fps and fast-forwarded, every run has to end bit identical
+//		assettool watch [dir] [seconds]		hot reload without the game: cooks every model that changes in dir again
+//											and prints the time until it is usable
+//--------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "mesh.h"
+#include "asset_pack.h"
+#include "atlas.h"
+#include "file_watch.h"
+#include "texture.h"
+#include "level_mesh.h"
+#include "level_stream.h"
+#include "level_grid.h"
+#include "level_pvs.h"
+#include "sim_clock.h"
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static double seconds_since(std::chrono::high_resolution_clock::time_point start)
+	{
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+static int cmd_cook(int argc, char **argv)
+	{
+	int failed = 0;
+	for (int ii = 0; ii < argc; ii++)
+		{
+		char cooked[1024];
+		cooked_mesh_name(argv[ii], cooked, sizeof(cooked));
+		mesh_stats st;
+		if (cook_mesh(argv[ii], cooked, &st))
+			{
+			printf("%-24s %7u tris %7u -> %7u vertices  ACMR %.3f -> %.3f (unindexed 3.0)  %7.1f KB -> %7.1f KB\n",
+				argv[ii], st.triangles, st.corners, st.unique_vertices, st.acmr_welded, st.acmr,
+				st.bytes_unindexed / 1024.0, st.bytes_indexed / 1024.0);
+			printf("%-24s LODs:", "");
+			for (uint32_t l = 0; l < st.lod_count; l++)
+				printf("  %u tris (error %.4g)", st.lod_triangles[l], st.lod_error[l]);
+			printf("  %u meshlets\n", st.meshlet_count);
+			}
+		else
+			{
+			printf("FAILED %s\n", argv[ii]);
+			failed++;
+			}
+		}
+	return failed ? 1 : 0;
+	}
+static int cmd_info(int argc, char **argv)
+	{
+	int failed = 0;
+	for (int ii = 0; ii < argc; ii++)
+		{
+		cooked_mesh mesh;
+		if (!load_mesh_cached(argv[ii], mesh))
+			{
+			printf("FAILED %s\n", argv[ii]);
+			failed++;
+			continue;
+			}
+		const cooked_mesh_header *h = mesh.header;
+		printf("%s: %u vertices, %u indices (%u byte), %u ranges, bounds (%g %g %g) - (%g %g %g), source hash %016llx\n",
+			argv[ii], h->vertex_count, h->index_count, h->index_size, h->range_count,
+			h->bbmin[0], h->bbmin[1], h->bbmin[2], h->bbmax[0], h->bbmax[1], h->bbmax[2], (unsigned long long)h->source_hash);
+		//3ds: a range (one draw) per material
+		uint32_t groups = 0;
+		for (uint32_t m = 0; m < h->material_count; m++)
+			groups += mesh.materials[m].face_groups;
+		if (h->material_count)
+			printf("  %u materials (draws) from %u face groups\n", h->material_count, groups);
+		for (uint32_t m = 0; m < h->material_count; m++)
+			{
+			const mesh_material &mat = mesh.materials[m];
+			printf("  material %-2u %-20s %7u triangles  %3u groups  diffuse %.2f %.2f %.2f  %s\n", m, mat.name[0] ? mat.name : "(none)",
+				mesh.ranges[m].index_count / 3, mat.face_groups, mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], mat.texture);
+			}
+		//the bounds CreateModel keeps: whole mesh (-1) and the submodels, every vertex has to be inside
+		for (int r = -1; r < (int)h->range_count; r++)
+			{
+			mesh_bounds b;
+			uint32_t first = r < 0 ? 0 : mesh.ranges[r].first_index, count = r < 0 ? 0 : mesh.ranges[r].index_count;
+			compute_bounds(mesh.vertices, h->vertex_count, r < 0 ? NULL : mesh.indices, h->index_size, first, count, b);
+			float outside = 0, box_radius = 0;
+			for (uint32_t ii = 0; ii < (r < 0 ? h->vertex_count : count); ii++)
+				{
+				uint32_t index = r < 0 ? ii : (h->index_size == 2 ? ((const uint16_t*)mesh.indices)[first + ii] : ((const uint32_t*)mesh.indices)[first + ii]);
+				outside = std::max(outside, length(mesh.vertices[index].pos - b.sphere_center) - b.radius);
+				}
+			box_radius = length(b.bbmax - b.bbmin) * 0.5f;
+			printf("  %-9s%d: sphere (%g %g %g) r %g (box diagonal/2 %g), center (%g %g %g)%s\n", r < 0 ? "mesh" : "range", r < 0 ? 0 : r,
+				b.sphere_center.x, b.sphere_center.y, b.sphere_center.z, b.radius, box_radius, b.center.x, b.center.y, b.center.z,
+				outside > b.radius * 1e-5f ? "  FAILED: vertex outside" : "");
+			if (outside > b.radius * 1e-5f) failed++;
+			}
+		}
+	return failed ? 1 : 0;
+	}
+//repeats f for at least half a second so the small files give a stable number, the seconds of one run
+template <class F> static double time_runs(F f)
+	{
+	int runs = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	double elapsed = 0;
+	do
+		{
+		f();
+		runs++;
+		elapsed = seconds_since(start);
+		}
+	while (elapsed < 0.5);
+	return elapsed / runs;
+	}
+typedef bool (*mesh_parser)(const unsigned char *data, size_t size, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges);
+static int bench_parser(int argc, char **argv, mesh_parser parse)
+	{
+	int failed = 0;
+	for (int ii = 0; ii < argc; ii++)
+		{
+		mapped_file file;
+		vector<mesh_vertex> vertices;
+		if (!file.open(argv[ii]) || !parse(file.data(), file.size(), vertices, NULL))
+			{
+			printf("FAILED %s\n", argv[ii]);
+			failed++;
+			continue;
+			}
+		double seconds = time_runs([&]() { parse(file.data(), file.size(), vertices, NULL); });
+		printf("%-24s %9u bytes %8u vertices %8.3f ms/parse %9.1f MB/s\n", argv[ii], (unsigned)file.size(),
+			(unsigned)vertices.size(), seconds * 1000.0, file.size() / (1024.0 * 1024.0) / seconds);
+		}
+	return failed ? 1 : 0;
+	}
+//the chunk walk and the copies into the vertex list on their own (MB/s of the file), then the smooth normals
+//Parse3DS runs after them (vertices/s). they only read the positions, the same list is smoothed again every run
+static int cmd_bench3ds(int argc, char **argv)
+	{
+	int failed = 0;
+	for (int ii = 0; ii < argc; ii++)
+		{
+		mapped_file file;
+		vector<mesh_vertex> vertices;
+		vector<mesh_material> materials;
+		if (!file.open(argv[ii]) || !Parse3DS(file.data(), file.size(), vertices, NULL, &materials, false))
+			{
+			printf("FAILED %s\n", argv[ii]);
+			failed++;
+			continue;
+			}
+		double parse = time_runs([&]() { Parse3DS(file.data(), file.size(), vertices, NULL, &materials, false); });
+		double normals = time_runs([&]() { if (!vertices.empty()) smooth_normals(&vertices[0], (int)vertices.size()); });
+		printf("%-24s %9u bytes %8u vertices  parse %8.3f ms %9.1f MB/s  normals %8.3f ms %6.2f Mvertices/s (%.0f%% of the load)\n",
+			argv[ii], (unsigned)file.size(), (unsigned)vertices.size(), parse * 1000.0, file.size() / (1024.0 * 1024.0) / parse,
+			normals * 1000.0, vertices.size() / 1e6 / normals, normals * 100.0 / (parse + normals));
+		}
+	return failed ? 1 : 0;
+	}
+static int cmd_benchcmp(int argc, char **argv)
+	{
+	return bench_parser(argc, argv, ParseCMP);
+	}
+static int cmd_normals(int argc, char **argv)
+	{
+	int failed = 0;
+	for (int ii = 0; ii < argc; ii++)
+		{
+		vector<mesh_vertex> source;
+		if (!Read3DS(argv[ii], source) || source.empty())
+			{
+			printf("FAILED %s\n", argv[ii]);
+			failed++;
+			continue;
+			}
+		int count = (int)source.size();
+		vector<mesh_vertex> grid1 = source, gridn = source, brute = source;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		smooth_normals(&grid1[0], count, SMOOTH_WELD_TOLERANCE, SMOOTH_CREASE_ANGLE, 1);
+		double t1 = seconds_since(start);
+		start = std::chrono::high_resolution_clock::now();
+		smooth_normals(&gridn[0], count, SMOOTH_WELD_TOLERANCE, SMOOTH_CREASE_ANGLE, 0);
+		double tn = seconds_since(start);
+		start = std::chrono::high_resolution_clock::now();
+		smooth_normals_reference(&brute[0], count);
+		double tb = seconds_since(start);
+		//the sums run in another order, so allow for rounding
+		float worst = 0;
+		for (int v = 0; v < count; v++)
+			{
+			float d1 = length(grid1[v].norm - brute[v].norm), dn = length(gridn[v].norm - brute[v].norm);
+			if (d1 > worst) worst = d1;
+			if (dn > worst) worst = dn;
+			}
+		bool ok = worst < 1e-4f;
+		if (!ok) failed++;
+		printf("%-24s %8d corners  grid %8.2f ms  grid mt %8.2f ms  brute force %10.2f ms  max diff %g %s\n",
+			argv[ii], count, t1 * 1000.0, tn * 1000.0, tb * 1000.0, worst, ok ? "ok" : "MISMATCH");
+		}
+	return failed ? 1 : 0;
+	}
+static int cmd_lods(int argc, char **argv)
+	{
+	int failed = 0;
+	for (int ii = 0; ii < argc; ii++)
+		{
+		mesh_data mesh;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		if (!build_mesh(argv[ii], mesh))
+			{
+			printf("FAILED %s\n", argv[ii]);
+			failed++;
+			continue;
+			}
+		double build = seconds_since(start);
+		float extent = 0;
+		for (size_t v = 0; v < mesh.vertices.size(); v++)
+			extent = std::max(extent, length(mesh.vertices[v].pos));
+		printf("%s: %u vertices, radius %g, cooked with LODs in %.1f ms\n", argv[ii], (unsigned)mesh.vertices.size(), extent, build * 1000.0);
+		for (size_t l = 0; l < mesh.lods.size(); l++)
+			printf("  LOD %u: %7u triangles  error %9.4g (%.3f%% of the radius)\n", (unsigned)l, mesh.lods[l].index_count / 3,
+				mesh.lods[l].error, extent > 0 ? mesh.lods[l].error / extent * 100.0f : 0.0f);
+
+		//the asteroid field: 1000 instances in a 1000 unit cube, camera in the middle, 1024 pixels over 45 degrees
+		const int instances = 1000;
+		vector<float> positions(instances * 8);
+		srand(1);
+		for (int i = 0; i < instances; i++)
+			for (int k = 0; k < 3; k++)
+				positions[i * 8 + k] = (float)(rand() % 1000 - 500);
+		float camera[3] = { 0, 0, 0 };
+		float pixel = 0.785398f / 1024.0f;
+		vector<uint32_t> order(instances);
+		uint32_t first[MESH_LOD_MAX], count[MESH_LOD_MAX];
+		int runs = 0;
+		start = std::chrono::high_resolution_clock::now();
+		do
+			{
+			bucket_instances_by_lod(&positions[0], 8 * sizeof(float), instances, camera, 1.0f, &mesh.lods[0], (int)mesh.lods.size(), pixel,
+									&order[0], first, count);
+			runs++;
+			}
+		while (seconds_since(start) < 0.2);
+		double bucket = seconds_since(start) / runs;
+		uint64_t drawn = 0, full = (uint64_t)instances * (mesh.lods[0].index_count / 3);
+		printf("  %d instances, 1 pixel error at 1024 px / 45 deg:", instances);
+		for (size_t l = 0; l < mesh.lods.size(); l++)
+			{
+			printf("  LOD %u: %u", (unsigned)l, count[l]);
+			drawn += (uint64_t)count[l] * (mesh.lods[l].index_count / 3);
+			}
+		printf("\n  triangles drawn %llu instead of %llu (%.1f%%), bucketing %.1f us\n", (unsigned long long)drawn,
+			(unsigned long long)full, drawn * 100.0 / full, bucket * 1e6);
+		}
+	return failed ? 1 : 0;
+	}
+static float random_float(float lo, float hi)
+	{
+	return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+	}
+static float angle_degrees(const vec3 &a, const vec3 &b)
+	{
+	//acos of a float dot product cannot see less than about 0.02 degrees
+	return (float)(atan2((double)length(cross(a, b)), (double)dot(a, b)) * 57.29578);
+	}
+static bool check(bool ok, const char *what)
+	{
+	if (!ok) printf("  FAILED: %s\n", what);
+	return ok;
+	}
+static int cmd_quantize(int argc, char **argv)
+	{
+	int failed = 0;
+	srand(1);
+	//every half that is not nan has to come back exactly, floats within half an ulp (2^-11 relative)
+	int half_mismatch = 0;
+	for (uint32_t h = 0; h < 0x10000; h++)
+		{
+		float f = half_to_float((uint16_t)h);
+		if (f == f && float_to_half(f) != h && !(f == 0 && (h & 0x7fff) == 0)) half_mismatch++;
+		}
+	float half_worst = 0;
+	for (int ii = 0; ii < 1000000; ii++)
+		{
+		float f = random_float(-4.0f, 4.0f);
+		float error = fabsf(half_to_float(float_to_half(f)) - f) / std::max(fabsf(f), 6.1035e-5f);
+		half_worst = std::max(half_worst, error);
+		}
+	printf("half float: %d of 65536 halves do not round trip, largest relative error %.3g (limit %.3g)\n", half_mismatch,
+		half_worst, 1.0 / 2048.0);
+	failed += !check(half_mismatch == 0 && half_worst <= 1.0f / 2048.0f, "half float round trip");
+
+	float oct_worst = 0;
+	for (int ii = 0; ii < 1000000; ii++)
+		{
+		vec3 n = normalize(make_vec3(random_float(-1, 1), random_float(-1, 1), random_float(-1, 1)));
+		int16_t e[2];
+		oct_encode(n, e);
+		oct_worst = std::max(oct_worst, angle_degrees(n, oct_decode(e)));
+		}
+	printf("octahedral normals: largest error %.4f degrees over 1M random directions\n", oct_worst);
+	failed += !check(oct_worst < 0.01f, "octahedral normals");
+
+	//the asteroid field from InitDevice
+	const int instances = 1000;
+	vector<float> field(instances * 8);
+	for (int ii = 0; ii < instances; ii++)
+		{
+		float *f = &field[ii * 8];
+		for (int k = 0; k < 3; k++) f[k] = (float)(rand() % 1000 - 500);
+		f[3] = (float)(rand() % 50 - 25);
+		for (int k = 4; k < 7; k++) f[k] = random_float(-1, 1) * PACKED_INSTANCE_ANGLE;
+		f[7] = random_float(-1, 1);
+		}
+	vector<packed_instance> packed_field(instances);
+	pack_instances(&field[0], instances, PACKED_INSTANCE_RANGE, &packed_field[0]);
+	float pos_worst = 0, angle_worst = 0, speed_worst = 0;
+	for (int ii = 0; ii < instances; ii++)
+		{
+		float f[8];
+		unpack_instance(packed_field[ii], PACKED_INSTANCE_RANGE, f);
+		for (int k = 0; k < 3; k++) pos_worst = std::max(pos_worst, fabsf(f[k] - field[ii * 8 + k]));
+		for (int k = 4; k < 7; k++) angle_worst = std::max(angle_worst, fabsf(f[k] - field[ii * 8 + k]));
+		speed_worst = std::max(speed_worst, fabsf(f[7] - field[ii * 8 + 7]));
+		}
+	printf("instances: position error %.4f (range %g), angle error %.4f rad, speed error %.4f\n", pos_worst, PACKED_INSTANCE_RANGE,
+		angle_worst, speed_worst);
+	printf("  instance buffer: %d x %d -> %d bytes, %d instead of %d bytes (%.1f%% saved)\n", instances, (int)(sizeof(float) * 8),
+		(int)sizeof(packed_instance), (int)(instances * sizeof(packed_instance)), (int)(instances * sizeof(float) * 8),
+		100.0 - 100.0 * sizeof(packed_instance) / (sizeof(float) * 8));
+	failed += !check(pos_worst <= PACKED_INSTANCE_RANGE / 32767.0f * 0.5f + 1e-3f && angle_worst <= PACKED_INSTANCE_ANGLE / 127.0f * 0.5f + 1e-5f &&
+		speed_worst <= 0.5f / 127.0f + 1e-6f, "instance round trip");
+
+	uint64_t all_full = 0, all_packed = 0;
+	for (int ii = 0; ii < argc; ii++)
+		{
+		cooked_mesh mesh;
+		if (!load_mesh_cached(argv[ii], mesh))
+			{
+			printf("FAILED %s\n", argv[ii]);
+			failed++;
+			continue;
+			}
+		const cooked_mesh_header *h = mesh.header;
+		vector<packed_vertex> packed(h->vertex_count);
+		pack_vertices(mesh.vertices, h->vertex_count, h->bbmin, h->bbmax, &packed[0]);
+		float pos_error[3] = { 0, 0, 0 }, normal_error = 0, tex_error = 0;
+		int tex_over = 0;
+		for (uint32_t v = 0; v < h->vertex_count; v++)
+			{
+			const mesh_vertex &a = mesh.vertices[v];
+			mesh_vertex b = unpack_vertex(packed[v], h->bbmin, h->bbmax);
+			const float *pa = &a.pos.x, *pb = &b.pos.x;
+			for (int k = 0; k < 3; k++)
+				pos_error[k] = std::max(pos_error[k], fabsf(pa[k] - pb[k]));
+			if (length(a.norm) > 0)
+				normal_error = std::max(normal_error, angle_degrees(a.norm, b.norm));
+			float du = fabsf(a.tex.x - b.tex.x), dv = fabsf(a.tex.y - b.tex.y);
+			tex_error = std::max(tex_error, std::max(du, dv));
+			if (du > fabsf(a.tex.x) / 2048.0f + 3e-8f || dv > fabsf(a.tex.y) / 2048.0f + 3e-8f) tex_over++;
+			}
+		bool pos_ok = true;
+		float pos_relative = 0;
+		for (int k = 0; k < 3; k++)
+			{
+			float extent = h->bbmax[k] - h->bbmin[k];
+			pos_ok = pos_ok && pos_error[k] <= extent / 65535.0f * 0.51f;	//half a step and a few float ulps
+			if (extent > 0) pos_relative = std::max(pos_relative, pos_error[k] / extent);
+			}
+		uint64_t full = (uint64_t)h->vertex_count * sizeof(mesh_vertex), small = (uint64_t)h->vertex_count * sizeof(packed_vertex);
+		all_full += full;
+		all_packed += small;
+		printf("%-24s %7u vertices  position error %.3g of the box  normal %.4f deg  uv %.3g   %8.1f KB -> %8.1f KB\n", argv[ii],
+			h->vertex_count, pos_relative, normal_error, tex_error, full / 1024.0, small / 1024.0);
+		failed += !check(pos_ok && normal_error < 0.01f && tex_over == 0, "mesh round trip");
+		}
+	if (argc > 0)
+		printf("vertex buffers: %.1f KB -> %.1f KB, %.1f KB saved\n", all_full / 1024.0, all_packed / 1024.0, (all_full - all_packed) / 1024.0);
+	return failed ? 1 : 0;
+	}
+//models go into the archive cooked, the way load_mesh_cached reads them
+static bool is_model_file(const char *filename)
+	{
+	size_t len = strlen(filename);
+	if (len < 4) return false;
+	const char *ext = filename + len - 4;
+	return is_cmp_file(filename) || is_obj_file(filename) ||
+		(ext[0] == '.' && ext[1] == '3' && (ext[2] | 32) == 'd' && (ext[3] | 32) == 's');
+	}
+static bool pack_sources(int argc, char **argv, vector<pack_source> &sources)
+	{
+	for (int ii = 0; ii < argc; ii++)
+		{
+		pack_source source;
+		source.name = source.path = argv[ii];
+		source.compress = true;
+		if (is_model_file(argv[ii]))
+			{
+			cooked_mesh mesh;
+			if (!load_mesh_cached(argv[ii], mesh))
+				{
+				printf("FAILED cooking %s\n", argv[ii]);
+				return false;
+				}
+			char cooked[1024];
+			cooked_mesh_name(argv[ii], cooked, sizeof(cooked));
+			source.name = source.path = cooked;
+			source.compress = false;		//used in place
+			}
+		else if (is_level_source(argv[ii]))
+			{
+			//compiled once here, the game maps the .level (a level bitmap is no texture)
+			char cooked[1024];
+			if (!level_cached(argv[ii], cooked, sizeof(cooked)))
+				{
+				printf("FAILED cooking %s\n", argv[ii]);
+				return false;
+				}
+			source.name = source.path = cooked;
+			}
+		else if (is_texture_source(argv[ii]))
+			{
+			//the mips are made once here, the game uploads the levels of the .dds
+			char cooked[1024];
+			if (!texture_cached(argv[ii], cooked, sizeof(cooked)))
+				{
+				printf("FAILED cooking %s\n", argv[ii]);
+				return false;
+				}
+			source.name = source.path = cooked;
+			}
+		sources.push_back(source);
+		}
+	return true;
+	}
+static int cmd_pack(int argc, char **argv)
+	{
+	vector<pack_source> sources;
+	if (!pack_sources(argc - 1, argv + 1, sources)) return 1;
+	pack_stats st;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	if (!write_pack(argv[0], sources, &st))
+		{
+		printf("FAILED writing %s\n", argv[0]);
+		return 1;
+		}
+	double elapsed = seconds_since(start);
+	printf("%s: %u entries (%u lz4) in %.1f ms, %.1f KB of files -> %.1f KB stored, archive %.1f KB\n", argv[0], st.entries,
+		st.compressed, elapsed * 1000.0, st.bytes / 1024.0, st.stored_bytes / 1024.0, st.archive_bytes / 1024.0);
+
+	asset_pack pack;
+	if (!pack.open(argv[0]))
+		{
+		printf("FAILED opening %s\n", argv[0]);
+		return 1;
+		}
+	int failed = 0;
+	vector<unsigned char> scratch;
+	for (size_t ii = 0; ii < sources.size(); ii++)
+		{
+		mapped_file file;
+		asset_span span;
+		if (!file.open(sources[ii].path.c_str()) || !pack.span(sources[ii].name.c_str(), span, scratch) || span.size != file.size() ||
+			(span.size && memcmp(span.data, file.data(), span.size) != 0) ||
+			(span.size && ((uintptr_t)span.data % PACK_ALIGN) && span.data != &scratch[0]))
+			{
+			printf("  MISMATCH %s\n", sources[ii].name.c_str());
+			failed++;
+			}
+		}
+	printf("read back: %s\n", failed ? "FAILED" : "all entries identical");
+	return failed ? 1 : 0;
+	}
+static int cmd_list(int argc, char **argv)
+	{
+	asset_pack pack;
+	if (!pack.open(argv[0]))
+		{
+		printf("FAILED opening %s\n", argv[0]);
+		return 1;
+		}
+	for (int ii = 0; ii < pack.count(); ii++)
+		{
+		const pack_entry &e = pack.entry(ii);
+		printf("%-32s %10llu bytes %10llu stored at %10llu%s\n", pack.entry_name(ii), (unsigned long long)e.size,
+			(unsigned long long)e.stored_size, (unsigned long long)e.offset, (e.flags & PACK_LZ4) ? "  lz4" : "");
+		}
+	return 0;
+	}
+//drops the file from the page cache, the next read comes from the disk
+static bool drop_cache(const char *filename)
+	{
+#ifdef __linux__
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) return false;
+	fdatasync(fd);
+	bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	::close(fd);
+	return ok;
+#else
+	return false;
+#endif
+	}
+//what the game does per asset without the archive: stat the model source, read the file (or the cooked mesh)
+static uint64_t read_loose(const vector<pack_source> &sources, char **files)
+	{
+	uint64_t sum = 0;
+	vector<unsigned char> buffer;
+	for (size_t ii = 0; ii < sources.size(); ii++)
+		{
+		uint64_t size, time;
+		file_stamp(files[ii], &size, &time);
+		FILE *file = fopen(sources[ii].path.c_str(), "rb");
+		if (!file) continue;
+		fseek(file, 0, SEEK_END);
+		buffer.resize((size_t)ftell(file) + 1);
+		fseek(file, 0, SEEK_SET);
+		size_t got = fread(&buffer[0], 1, buffer.size(), file);
+		fclose(file);
+		for (size_t b = 0; b < got; b += 64)
+			sum += buffer[b];
+		}
+	return sum;
+	}
+static uint64_t read_packed(const char *archive, const vector<pack_source> &sources)
+	{
+	asset_pack pack;
+	if (!pack.open(archive)) return 0;
+	uint64_t sum = 0;
+	vector<unsigned char> scratch;
+	for (size_t ii = 0; ii < sources.size(); ii++)
+		{
+		asset_span span;
+		if (!pack.span(sources[ii].name.c_str(), span, scratch)) continue;
+		for (size_t b = 0; b < span.size; b += 64)		//every cache line, the mapping has to fault in
+			sum += span.data[b];
+		}
+	return sum;
+	}
+static int cmd_benchpack(int argc, char **argv)
+	{
+	vector<pack_source> sources;
+	if (!pack_sources(argc - 1, argv + 1, sources)) return 1;
+	const char *archive = argv[0];
+	asset_pack check;
+	if (!check.open(archive))
+		{
+		printf("FAILED opening %s, run assettool pack first\n", archive);
+		return 1;
+		}
+	check.close();
+	bool can_drop = drop_cache(archive);
+	const int runs = 5;
+	for (int cold = 1; cold >= 0; cold--)
+		{
+		if (cold && !can_drop)
+			{
+			printf("cold: cannot drop the page cache here, warm only\n");
+			continue;
+			}
+		double loose_best = 1e9, pack_best = 1e9, loose_sum = 0, pack_sum = 0;
+		for (int r = 0; r < runs; r++)
+			{
+			if (cold)
+				for (size_t ii = 0; ii < sources.size(); ii++)
+					drop_cache(sources[ii].path.c_str());
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			read_loose(sources, argv + 1);
+			double t = seconds_since(start);
+			loose_best = std::min(loose_best, t);
+			loose_sum += t;
+
+			if (cold) drop_cache(archive);
+			start = std::chrono::high_resolution_clock::now();
+			read_packed(archive, sources);
+			t = seconds_since(start);
+			pack_best = std::min(pack_best, t);
+			pack_sum += t;
+			}
+		printf("%s: %d files  loose %8.2f ms (best %8.2f)   archive %8.2f ms (best %8.2f)\n", cold ? "cold" : "warm", (int)sources.size(),
+			loose_sum * 1000.0 / runs, loose_best * 1000.0, pack_sum * 1000.0 / runs, pack_best * 1000.0);
+		}
+	return 0;
+	}
+static bool write_synthetic_obj(const char *filename, int quads)
+	{
+	int rows = (int)sqrt((double)quads);
+	if (rows < 2) rows = 2;
+	int cols = (quads + rows - 1) / rows;
+	FILE *file = fopen(filename, "wb");
+	if (!file) return false;
+	fprintf(file, "# synthetic torus, %d x %d quads\n", rows, cols);
+	for (int r = 0; r <= rows; r++)
+		for (int c = 0; c <= cols; c++)
+			{
+			float u = r * 6.2831853f / rows, v = c * 6.2831853f / cols;
+			fprintf(file, "v %.6f %.6f %.6f\n", (3.0f + cosf(v)) * cosf(u), (3.0f + cosf(v)) * sinf(u), sinf(v));
+			fprintf(file, "vt %.6f %.6f\n", r / (float)rows, c / (float)cols);
+			fprintf(file, "vn %.6f %.6f %.6f\n", cosf(v) * cosf(u), cosf(v) * sinf(u), sinf(v));
+			}
+	for (int r = 0; r < rows; r++)
+		for (int c = 0; c < cols; c++)
+			{
+			int a = r * (cols + 1) + c + 1, b = a + cols + 1;
+			fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+			}
+	return fclose(file) == 0;
+	}
+static int cmd_benchobj(int argc, char **argv)
+	{
+	int quads = atoi(argv[0]);
+	const char *filename = argc > 1 ? argv[1] : "synthetic.obj";
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	if (quads <= 0 || !write_synthetic_obj(filename, quads))
+		{
+		printf("FAILED writing %s\n", filename);
+		return 1;
+		}
+	printf("wrote %s in %.2f s\n", filename, seconds_since(start));
+	mapped_file file;
+	if (!file.open(filename))
+		{
+		printf("FAILED %s\n", filename);
+		return 1;
+		}
+	int cores = (int)std::thread::hardware_concurrency();
+	if (cores < 1) cores = 1;
+	vector<mesh_vertex> single, multi;
+	int thread_counts[2] = { 1, cores };
+	for (int ii = 0; ii < 2; ii++)
+		{
+		vector<mesh_vertex> &vertices = ii == 0 ? single : multi;
+		start = std::chrono::high_resolution_clock::now();
+		if (!ParseOBJ(file.data(), file.size(), vertices, NULL, thread_counts[ii]))
+			{
+			printf("FAILED parsing %s\n", filename);
+			return 1;
+			}
+		double elapsed = seconds_since(start);
+		printf("%2d thread(s): %9.1f MB  %9u triangles  %8.1f ms  %8.1f MB/s  %7.2f M faces/s\n", thread_counts[ii],
+			file.size() / (1024.0 * 1024.0), (unsigned)(vertices.size() / 3), elapsed * 1000.0,
+			file.size() / (1024.0 * 1024.0) / elapsed, vertices.size() / 6 / elapsed / 1e6);
+		}
+	bool same = single.size() == multi.size() && memcmp(&single[0], &multi[0], single.size() * sizeof(mesh_vertex)) == 0;
+	printf("single and multi threaded result %s\n", same ? "identical" : "DIFFER");
+	return same ? 0 : 1;
+	}
+//--------------------------------------------------------------------------------------
+//the size from the header is all the layout needs: png, jpg, dds and bmp
+static bool image_size(const char *filename, int *width, int *height)
+	{
+	mapped_file file;
+	if (!file.open(filename) || file.size() < 26) return false;
+	const unsigned char *d = file.data();
+	size_t size = file.size();
+	if (memcmp(d, "\x89PNG", 4) == 0)
+		{
+		*width = (d[16] << 24) | (d[17] << 16) | (d[18] << 8) | d[19];
+		*height = (d[20] << 24) | (d[21] << 16) | (d[22] << 8) | d[23];
+		return true;
+		}
+	if (memcmp(d, "DDS ", 4) == 0)
+		{
+		*height = d[12] | (d[13] << 8) | (d[14] << 16) | (d[15] << 24);
+		*width = d[16] | (d[17] << 8) | (d[18] << 16) | (d[19] << 24);
+		return true;
+		}
+	if (d[0] == 'B' && d[1] == 'M')
+		{
+		*width = d[18] | (d[19] << 8) | (d[20] << 16) | (d[21] << 24);
+		*height = abs((int)(d[22] | (d[23] << 8) | (d[24] << 16) | ((unsigned)d[25] << 24)));
+		return true;
+		}
+	if (d[0] == 0xff && d[1] == 0xd8)
+		{
+		//walk the segments up to the first start of frame
+		size_t pos = 2;
+		while (pos + 9 < size && d[pos] == 0xff)
+			{
+			int marker = d[pos + 1];
+			size_t length = (d[pos + 2] << 8) | d[pos + 3];
+			if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+				{
+				*height = (d[pos + 5] << 8) | d[pos + 6];
+				*width = (d[pos + 7] << 8) | d[pos + 8];
+				return true;
+				}
+			pos += 2 + length;
+			}
+		}
+	return false;
+	}
+static void print_atlas(const vector<atlas_rect> &rects, char **names, int width, int height)
+	{
+	for (size_t ii = 0; ii < rects.size(); ii++)
+		{
+		float uv[4];
+		atlas_uv_rect(rects[ii], width, height, uv);
+		printf("  %-24s %5d x %-5d at %5d, %-5d  uv offset %.6f %.6f scale %.6f %.6f\n", names ? names[ii] : "",
+			rects[ii].width, rects[ii].height, rects[ii].x, rects[ii].y, uv[0], uv[1], uv[2], uv[3]);
+		}
+	}
+static int cmd_atlas(int argc, char **argv)
+	{
+	int failed = 0;
+	if (argc > 0)
+		{
+		vector<atlas_rect> rects(argc);
+		for (int ii = 0; ii < argc; ii++)
+			if (!image_size(argv[ii], &rects[ii].width, &rects[ii].height))
+				{
+				printf("FAILED %s: not a png/jpg/dds/bmp\n", argv[ii]);
+				return 1;
+				}
+		int width = 0, height = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		if (!pack_atlas(rects, ATLAS_PADDING, ATLAS_PADDING, ATLAS_MAX_SIZE, &width, &height))
+			{
+			printf("FAILED: does not fit into %d x %d\n", ATLAS_MAX_SIZE, ATLAS_MAX_SIZE);
+			return 1;
+			}
+		double elapsed = seconds_since(start);
+		printf("atlas %d x %d, %d images, efficiency %.1f%%, packed in %.2f ms\n", width, height, argc,
+			atlas_efficiency(rects, width, height) * 100.0f, elapsed * 1000.0);
+		print_atlas(rects, argv, width, height);
+		if (!check(atlas_valid(rects, ATLAS_PADDING, width, height), "images overlap or stick out")) failed++;
+		}
+	//random sets: square-ish tiles like the game's and mixed sprites
+	printf("random sets (padding %d):\n", ATLAS_PADDING);
+	srand(11);
+	int counts[4] = { 4, 16, 64, 200 };
+	for (int set = 0; set < 8; set++)
+		{
+		int count = counts[set & 3];
+		bool power_of_two = set < 4;
+		vector<atlas_rect> rects(count);
+		for (int ii = 0; ii < count; ii++)
+			{
+			if (power_of_two)
+				{
+				rects[ii].width = 32 << (rand() % 4);
+				rects[ii].height = rand() % 4 ? rects[ii].width : 32 << (rand() % 4);
+				}
+			else
+				{
+				rects[ii].width = 8 + rand() % 250;
+				rects[ii].height = 8 + rand() % 250;
+				}
+			}
+		int width = 0, height = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		bool ok = pack_atlas(rects, ATLAS_PADDING, ATLAS_PADDING, ATLAS_MAX_SIZE, &width, &height);
+		double elapsed = seconds_since(start);
+		if (!check(ok && atlas_valid(rects, ATLAS_PADDING, width, height), "random set")) failed++;
+		//without the gutters, how close the packer itself gets
+		vector<atlas_rect> tight = rects;
+		int tight_width = 0, tight_height = 0;
+		pack_atlas(tight, 0, 1, ATLAS_MAX_SIZE, &tight_width, &tight_height);
+		printf("  %3d %s: %5d x %-5d  efficiency %5.1f%%  (no padding %5.1f%%)  %8.2f ms\n", count,
+			power_of_two ? "pow2 tiles " : "any sprites", width, height, atlas_efficiency(rects, width, height) * 100.0f,
+			atlas_efficiency(tight, tight_width, tight_height) * 100.0f, elapsed * 1000.0);
+		}
+	return failed ? 1 : 0;
+	}
+//--------------------------------------------------------------------------------------
+//what XMMatrixLookAtLH * XMMatrixPerspectiveFovLH make, row major
+static void view_projection(const vec3 &eye, const vec3 &at, float fov, float aspect, float znear, float zfar, float result[16])
+	{
+	vec3 z = normalize(at - eye);
+	vec3 up = fabsf(z.y) > 0.99f ? make_vec3(1, 0, 0) : make_vec3(0, 1, 0);
+	vec3 x = normalize(cross(up, z)), y = cross(z, x);
+	float view[16] = { x.x, y.x, z.x, 0, x.y, y.y, z.y, 0, x.z, y.z, z.z, 0, -dot(x, eye), -dot(y, eye), -dot(z, eye), 1 };
+	float h = 1.0f / tanf(fov * 0.5f), w = h / aspect, q = zfar / (zfar - znear);
+	float projection[16] = { w, 0, 0, 0, 0, h, 0, 0, 0, 0, q, 1, 0, 0, -q * znear, 0 };
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			{
+			result[r * 4 + c] = 0;
+			for (int k = 0; k < 4; k++)
+				result[r * 4 + c] += view[r * 4 + k] * projection[k * 4 + c];
+			}
+	}
+static int cmd_meshlets(int argc, char **argv)
+	{
+	int failed = 0;
+	for (int ii = 0; ii < argc; ii++)
+		{
+		cooked_mesh mesh;
+		if (!load_mesh_cached(argv[ii], mesh) || mesh.header->meshlet_count == 0)
+			{
+			printf("FAILED %s\n", argv[ii]);
+			failed++;
+			continue;
+			}
+		const cooked_mesh_header *h = mesh.header;
+		vector<uint32_t> indices(h->index_count);
+		for (uint32_t i = 0; i < h->index_count; i++)
+			indices[i] = h->index_size == 2 ? ((const uint16_t*)mesh.indices)[i] : ((const uint32_t*)mesh.indices)[i];
+		//the meshlets have to cover lod 0 of every range exactly, within the limits
+		uint32_t lod0 = h->lod_count ? mesh.lods[0].index_count : h->index_count, covered = 0, max_vertices = 0, max_triangles = 0;
+		uint64_t vertex_sum = 0;
+		int cones = 0;
+		bool ok = true;
+		for (uint32_t m = 0; m < h->meshlet_count; m++)
+			{
+			const mesh_meshlet &ml = mesh.meshlets[m];
+			ok = ok && ml.first_index == covered && ml.index_count % 3 == 0;
+			covered += ml.index_count;
+			vector<uint32_t> unique(indices.begin() + ml.first_index, indices.begin() + ml.first_index + ml.index_count);
+			std::sort(unique.begin(), unique.end());
+			unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+			max_vertices = std::max(max_vertices, (uint32_t)unique.size());
+			max_triangles = std::max(max_triangles, ml.index_count / 3);
+			vertex_sum += unique.size();
+			if (ml.cone_cutoff < 1.0f) cones++;
+			}
+		if (!check(ok && covered == lod0, "meshlets do not cover lod 0")) failed++;
+		if (!check(max_vertices <= MESHLET_MAX_VERTICES && max_triangles <= MESHLET_MAX_TRIANGLES, "meshlet too big")) failed++;
+		printf("%s: %u triangles in %u meshlets, %.1f vertices / %.1f triangles each (max %u / %u), %d%% with a usable cone, ACMR %.3f\n",
+			argv[ii], lod0 / 3, h->meshlet_count, vertex_sum / (double)h->meshlet_count, lod0 / 3.0 / h->meshlet_count,
+			max_vertices, max_triangles, cones * 100 / (int)h->meshlet_count, acmr(&indices[0], lod0));
+
+		//random views at 1.2 to 6 radii, looking somewhere around the model, 60 degrees 16:9
+		mesh_bounds bounds;
+		compute_bounds(mesh.vertices, h->vertex_count, NULL, 0, 0, 0, bounds);
+		const int views = 1000;
+		vector<float> matrices(views * 16), eyes(views * 3);
+		srand(13);
+		for (int v = 0; v < views; v++)
+			{
+			vec3 dir = normalize(make_vec3(random_float(-1, 1), random_float(-1, 1), random_float(-1, 1)));
+			vec3 eye = bounds.sphere_center + dir * (bounds.radius * random_float(1.2f, 6.0f));
+			vec3 at = bounds.sphere_center + make_vec3(random_float(-1, 1), random_float(-1, 1), random_float(-1, 1)) * (bounds.radius * 0.7f);
+			view_projection(eye, at, 1.0472f, 16.0f / 9.0f, bounds.radius * 0.01f, bounds.radius * 100.0f, &matrices[v * 16]);
+			eyes[v * 3] = eye.x;
+			eyes[v * 3 + 1] = eye.y;
+			eyes[v * 3 + 2] = eye.z;
+			}
+		vector<mesh_range> visible(h->meshlet_count);
+		mesh_cull_stats stats;
+		memset(&stats, 0, sizeof(stats));
+		uint64_t backfacing = 0, wrong = 0, merged_triangles = 0;
+		for (int v = 0; v < views; v++)
+			{
+			float planes[6][4];
+			frustum_planes(&matrices[v * 16], planes);
+			size_t runs = cull_meshlets(mesh.meshlets, h->meshlet_count, &eyes[v * 3], planes, true, &visible[0], &stats);
+			runs = merge_runs(&visible[0], runs, MESHLET_MAX_DRAWS);
+			for (size_t r = 0; r < runs; r++)
+				merged_triangles += visible[r].index_count / 3;
+			//reference: per triangle back facing, and no triangle the rasterizer would keep may be culled
+			vector<unsigned char> drawn(lod0 / 3, 0);
+			for (size_t r = 0; r < runs; r++)
+				memset(&drawn[visible[r].first_index / 3], 1, visible[r].index_count / 3);
+			vec3 eye = make_vec3(eyes[v * 3], eyes[v * 3 + 1], eyes[v * 3 + 2]);
+			for (uint32_t t = 0; t < lod0 / 3; t++)
+				{
+				const vec3 &a = mesh.vertices[indices[t * 3]].pos, &b = mesh.vertices[indices[t * 3 + 1]].pos, &c = mesh.vertices[indices[t * 3 + 2]].pos;
+				bool back = dot(cross(b - a, c - a), a - eye) >= 0;
+				if (back) backfacing++;
+				if (drawn[t] || back) continue;
+				//front facing and culled: has to be outside one plane
+				bool outside = false;
+				for (int p = 0; p < 6 && !outside; p++)
+					outside = std::max(std::max(dot(make_vec3(planes[p][0], planes[p][1], planes[p][2]), a),
+						dot(make_vec3(planes[p][0], planes[p][1], planes[p][2]), b)), dot(make_vec3(planes[p][0], planes[p][1], planes[p][2]), c)) + planes[p][3] < bounds.radius * 1e-4f;
+				if (!outside) wrong++;
+				}
+			}
+		if (!check(wrong == 0, "visible triangles culled")) failed++;
+		printf("  %d views: %.1f%% of the meshlets out of the frustum, %.1f%% back facing, %.1f%% of the triangles culled\n"
+			"  (%.1f%% of the triangles face away), %.1f ranges per view, %.1f%% still culled with at most %d draws\n", views,
+			stats.frustum_culled * 100.0 / stats.meshlets, stats.backface_culled * 100.0 / stats.meshlets,
+			stats.triangles_culled * 100.0 / stats.triangles, backfacing * 100.0 / ((double)views * (lod0 / 3)), stats.runs / (double)views,
+			100.0 - merged_triangles * 100.0 / ((double)views * (lod0 / 3)), MESHLET_MAX_DRAWS);
+
+		//throughput without the checks
+		int passes = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		do
+			{
+			for (int v = 0; v < views; v++)
+				{
+				float planes[6][4];
+				frustum_planes(&matrices[v * 16], planes);
+				size_t runs = cull_meshlets(mesh.meshlets, h->meshlet_count, &eyes[v * 3], planes, true, &visible[0]);
+				merge_runs(&visible[0], runs, MESHLET_MAX_DRAWS);
+				}
+			passes++;
+			}
+		while (seconds_since(start) < 0.5);
+		double elapsed = seconds_since(start);
+		printf("  cull: %.2f us per view, %.1f M meshlets/s\n", elapsed * 1e6 / ((double)passes * views),
+			(double)passes * views * h->meshlet_count / elapsed / 1e6);
+		}
+	return failed ? 1 : 0;
+	}
+//mean of the light (not of the encoded values, weighted with alpha) over a level, to see how far the small mips drift
+static double mean_linear(const texture_image &level)
+	{
+	double sum = 0;
+	for (size_t ii = 0; ii < level.rgba.size(); ii += 4)
+		for (int c = 0; c < 3; c++)
+			{
+			double v = level.rgba[ii + c] / 255.0;
+			sum += (v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4)) * level.rgba[ii + 3] / 255.0;
+			}
+	return level.rgba.empty() ? 0 : sum / (level.rgba.size() / 4 * 3);
+	}
+static int cmd_textures(int argc, char **argv)
+	{
+	int failed = 0;
+	//a black and white checker: one level down it is 50% light, srgb 188, not the 128 of averaging the encoded values
+	texture_image checker;
+	checker.width = checker.height = 64;
+	checker.rgba.resize(64 * 64 * 4);
+	for (int ii = 0; ii < 64 * 64; ii++)
+		{
+		unsigned char v = ((ii & 1) ^ ((ii / 64) & 1)) ? 255 : 0;
+		checker.rgba[ii * 4] = checker.rgba[ii * 4 + 1] = checker.rgba[ii * 4 + 2] = v;
+		checker.rgba[ii * 4 + 3] = 255;
+		}
+	vector<texture_image> linear, naive;
+	build_mips(checker, TEXTURE_FILTER_BOX, true, linear);
+	build_mips(checker, TEXTURE_FILTER_BOX, false, naive);
+	printf("checker 64x64: %d levels, mip 1 = %d (linear light) / %d (srgb values averaged)\n", (int)linear.size(), linear[1].rgba[0], naive[1].rgba[0]);
+	if (!check((int)linear.size() == mip_count(64, 64) && linear[1].rgba[0] == 188 && linear.back().rgba[0] == 188, "checker mips")) failed++;
+	//black and white are both exact in 565, every preset has to get the checker back unchanged
+	for (int quality = TEXTURE_QUALITY_FAST; quality <= TEXTURE_QUALITY_HIGH; quality++)
+		{
+		vector<unsigned char> blocks;
+		texture_image back;
+		bool exact = compress_level(checker, TEXTURE_FORMAT_BC1, quality, blocks) && decompress_level(&blocks[0], blocks.size(), TEXTURE_FORMAT_BC1, 64, 64, back) && back.rgba == checker.rgba;
+		if (!check(exact, "bc1 checker")) failed++;
+		}
+
+	for (int ii = 0; ii < argc; ii++)
+		{
+		texture_image image;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		if (!read_image(argv[ii], image))
+			{
+			printf("%s: FAILED decoding\n", argv[ii]);
+			failed++;
+			continue;
+			}
+		double decode = seconds_since(start);
+		vector<texture_image> box, kaiser, gamma_unaware;
+		start = std::chrono::high_resolution_clock::now();
+		build_mips(image, TEXTURE_FILTER_BOX, true, box);
+		double box_time = seconds_since(start);
+		start = std::chrono::high_resolution_clock::now();
+		build_mips(image, TEXTURE_FILTER_KAISER, true, kaiser);
+		double kaiser_time = seconds_since(start);
+		build_mips(image, TEXTURE_FILTER_BOX, false, gamma_unaware);
+		int role = texture_role(argv[ii], image);
+		int format = texture_role_format(role, image.width, image.height);
+		if (role == TEXTURE_ROLE_NORMAL)
+			build_mips(image, TEXTURE_FILTER_KAISER, false, kaiser);
+
+		char cooked[1024];
+		cooked_texture_name(argv[ii], cooked, sizeof(cooked));
+		if (!cook_texture(argv[ii], cooked))
+			{
+			printf("%s: FAILED cooking\n", argv[ii]);
+			failed++;
+			continue;
+			}
+		mapped_file file;
+		vector<texture_image> back;
+		texture_stamp stamp;
+		bool same = file.open(cooked) && read_dds(file.data(), file.size(), back, &stamp) && back.size() == kaiser.size() && (int)stamp.format == format;
+		for (size_t level = 0; same && level < back.size(); level++)
+			same = back[level].width == kaiser[level].width && back[level].height == kaiser[level].height && (format != TEXTURE_FORMAT_RGBA || back[level].rgba == kaiser[level].rgba);
+		//how much the light of a 1/16 level moved away from the full image
+		size_t small = kaiser.size() > 4 ? 4 : kaiser.size() - 1;
+		double top = mean_linear(image);
+		printf("%-24s %5d x %-5d %2d levels  decode %6.1f ms  mips box %6.1f ms  kaiser %6.1f ms  -> %s %.1f KB\n", argv[ii], image.width, image.height,
+			(int)kaiser.size(), decode * 1000.0, box_time * 1000.0, kaiser_time * 1000.0, cooked, file.size() / 1024.0);
+		printf("  mean light of level %d vs level 0: box %+.2f%%  kaiser %+.2f%%  srgb values averaged %+.2f%%\n", (int)small,
+			(mean_linear(box[small]) / top - 1) * 100.0, (mean_linear(kaiser[small]) / top - 1) * 100.0, (mean_linear(gamma_unaware[small]) / top - 1) * 100.0);
+		if (!check(same, "dds read back differs")) failed++;
+		if (format != TEXTURE_FORMAT_RGBA)
+			{
+			//psnr of level 0 against the uncompressed texels, and how fast each preset encodes it
+			static const char *format_names[] = { "rgba", "bc1", "bc3", "bc5" };
+			static const char *quality_names[] = { "fast", "normal", "high" };
+			int channels = format == TEXTURE_FORMAT_BC5 ? 2 : 3;
+			printf("  %s, %.1f KB rgba -> %.1f KB:", format_names[format], texture_level_bytes(TEXTURE_FORMAT_RGBA, image.width, image.height) / 1024.0,
+				texture_level_bytes(format, image.width, image.height) / 1024.0);
+			double megapixels = image.width * (double)image.height / 1e6;
+			for (int quality = TEXTURE_QUALITY_FAST; quality <= TEXTURE_QUALITY_HIGH; quality++)
+				{
+				vector<unsigned char> blocks;
+				texture_image decoded;
+				start = std::chrono::high_resolution_clock::now();
+				compress_level(kaiser[0], format, quality, blocks);
+				double encode = seconds_since(start);
+				decompress_level(&blocks[0], blocks.size(), format, image.width, image.height, decoded);
+				printf("  %s %.2f dB", quality_names[quality], texture_psnr(kaiser[0], decoded, 0, channels));
+				if (format == TEXTURE_FORMAT_BC3)
+					printf(" (alpha %.2f)", texture_psnr(kaiser[0], decoded, 3, 1));
+				printf(" %.1f Mpix/s", megapixels / encode);
+				if (quality == (int)stamp.quality)
+					same = decoded.rgba == back[0].rgba;
+				}
+			printf("\n");
+			if (!check(same, "cooked level 0 is not the encoder output")) failed++;
+			//the same level on one thread, the blocks have to come out the same
+			vector<unsigned char> all, one;
+			start = std::chrono::high_resolution_clock::now();
+			compress_level(kaiser[0], format, TEXTURE_QUALITY_NORMAL, one, 1);
+			double single = seconds_since(start);
+			start = std::chrono::high_resolution_clock::now();
+			compress_level(kaiser[0], format, TEXTURE_QUALITY_NORMAL, all, 0);
+			double threaded = seconds_since(start);
+			printf("  normal on 1 thread %.1f ms, on %d %.1f ms\n", single * 1000.0, (int)std::thread::hardware_concurrency(), threaded * 1000.0);
+			if (!check(all == one, "threaded blocks differ")) failed++;
+			}
+		char again[1024];
+		if (!check(texture_cached(argv[ii], again, sizeof(again)) && stamp.source_size != 0, "cache stamp")) failed++;
+		}
+	return failed ? 1 : 0;
+	}
+//every cell face of the level as one key, merged faces expanded back to their cells
+static void level_cells(const vector<level_face> &faces, vector<uint64_t> &cells)
+	{
+	cells.clear();
+	for (size_t ii = 0; ii < faces.size(); ii++)
+		for (int y = 0; y < faces[ii].size_y; y++)
+			for (int x = 0; x < faces[ii].size_x; x++)
+				cells.push_back((uint64_t)faces[ii].rotation << 56 | (uint64_t)faces[ii].texture_no << 40 | (uint64_t)(faces[ii].y + y) << 20 | (faces[ii].x + x));
+	std::sort(cells.begin(), cells.end());
+	}
+//wall::get_matrix without xnamath: S * T_offset * R * T, row vectors like XMMATRIX
+class level_matrix
+	{
+	public:
+		float m[4][4];
+		level_matrix()
+			{
+			memset(m, 0, sizeof(m));
+			m[0][0] = m[1][1] = m[2][2] = m[3][3] = 1;
+			}
+		level_matrix operator*(const level_matrix &b) const
+			{
+			level_matrix r;
+			for (int i = 0; i < 4; i++)
+				for (int j = 0; j < 4; j++)
+					r.m[i][j] = m[i][0] * b.m[0][j] + m[i][1] * b.m[1][j] + m[i][2] * b.m[2][j] + m[i][3] * b.m[3][j];
+			return r;
+			}
+	};
+static level_matrix wall_matrix_reference(const level_face &f, float x_offset)
+	{
+	int size_u, size_v;
+	level_face_uv_size(f, &size_u, &size_v);
+	level_matrix S, T_offset, R, T;
+	S.m[0][0] = (float)size_u;
+	S.m[1][1] = (float)size_v;
+	float angle = 0, c, s;
+	bool around_x = false;
+	switch (f.rotation)
+		{
+		default:
+		case 0: angle = 3.14159265f; break;
+		case 1: angle = 3.14159265f / 2; break;
+		case 2: break;
+		case 3: angle = -3.14159265f / 2; break;
+		case 4: angle = 3.14159265f / 2; around_x = true; break;
+		case 5: angle = -3.14159265f / 2; around_x = true; break;
+		}
+	c = cosf(angle);
+	s = sinf(angle);
+	if (around_x)
+		{
+		R.m[1][1] = c; R.m[1][2] = s; R.m[2][1] = -s; R.m[2][2] = c;
+		}
+	else
+		{
+		R.m[0][0] = c; R.m[0][2] = -s; R.m[2][0] = s; R.m[2][2] = c;
+		}
+	T_offset.m[3][2] = f.rotation >= 4 ? -1.0f : 1.0f;		//HALFWALL
+	T.m[3][0] = (f.x + (f.size_x - 1) * 0.5f) * 2 - x_offset;	//FULLWALL
+	T.m[3][2] = (f.y + (f.size_y - 1) * 0.5f) * 2;
+	return S * T_offset * R * T;
+	}
+static bool face_texture_less(const level_face &a, const level_face &b)
+	{
+	return a.texture_no < b.texture_no;
+	}
+//the baked vertices are the wall quad through wall::get_matrix, and what a frame costs on the cpu both ways
+static int level_batch_report(const char *label, const vector<level_face> &merged, int width)
+	{
+	int failed = 0;
+	float x_offset = (float)((width / 2) * 2);
+	vector<mesh_vertex> vertices;
+	vector<level_batch> batches;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	bake_level_faces(merged, 2, x_offset, vertices, batches);
+	double bake = seconds_since(start);
+	vector<level_face> sorted(merged);
+	std::stable_sort(sorted.begin(), sorted.end(), face_texture_less);
+	static const float quad[6][5] = { { -1, 1, 0, 0, 0 }, { 1, 1, 0, 1, 0 }, { -1, -1, 0, 0, 1 }, { 1, 1, 0, 1, 0 }, { 1, -1, 0, 1, 1 }, { -1, -1, 0, 0, 1 } };
+	float worst = 0;
+	for (size_t ii = 0; ii < sorted.size(); ii++)
+		{
+		level_matrix M = wall_matrix_reference(sorted[ii], x_offset);
+		int size_u, size_v;
+		level_face_uv_size(sorted[ii], &size_u, &size_v);
+		for (int k = 0; k < 6; k++)
+			{
+			const mesh_vertex &v = vertices[ii * 6 + k];
+			float p[3], n[3];
+			for (int c = 0; c < 3; c++)
+				{
+				p[c] = quad[k][0] * M.m[0][c] + quad[k][1] * M.m[1][c] + quad[k][2] * M.m[2][c] + M.m[3][c];
+				n[c] = -M.m[2][c];		//normal 0 0 -1, the scale is 1 in z
+				}
+			worst = std::max(worst, std::max(fabsf(p[0] - v.pos.x), std::max(fabsf(p[1] - v.pos.y), fabsf(p[2] - v.pos.z))));
+			worst = std::max(worst, std::max(fabsf(n[0] - v.norm.x), std::max(fabsf(n[1] - v.norm.y), fabsf(n[2] - v.norm.z))));
+			worst = std::max(worst, std::max(fabsf(quad[k][3] * size_u - v.tex.x), fabsf(quad[k][4] * size_v - v.tex.y)));
+			}
+		}
+	//a frame on the cpu, without the driver: per wall the matrix, the constant buffer copy and 5 calls, against
+	//one copy and 4 calls, then 2 per texture
+	const int frames = 20;
+	unsigned char constants[304];	//sizeof(ConstantBuffer)
+	volatile unsigned char sink = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (int frame = 0; frame < frames; frame++)
+		for (size_t ii = 0; ii < merged.size(); ii++)
+			{
+			level_matrix M = wall_matrix_reference(merged[ii], x_offset);
+			memcpy(constants, M.m, sizeof(M.m));
+			sink = sink + constants[ii & 63];
+			}
+	double per_wall = seconds_since(start) / frames;
+	start = std::chrono::high_resolution_clock::now();
+	for (int frame = 0; frame < frames; frame++)
+		{
+		level_matrix M;
+		memcpy(constants, M.m, sizeof(M.m));
+		for (size_t ii = 0; ii < batches.size(); ii++)
+			sink = sink + (unsigned char)batches[ii].first_vertex;
+		}
+	double batched = seconds_since(start) / frames;
+	printf("  %-9s baked %d vertices in %d batches in %.2f ms (%.1f KB), largest difference to wall::get_matrix %g\n", label, (int)vertices.size(), (int)batches.size(),
+		bake * 1000.0, vertices.size() * sizeof(mesh_vertex) / 1024.0, worst);
+	printf("            per frame: per wall %d draws, %d calls, cpu %.3f ms  ->  batched %d draws, %d calls, cpu %.4f ms\n", (int)merged.size(), (int)merged.size() * 5,
+		per_wall * 1000.0, (int)batches.size(), 4 + (int)batches.size() * 2, batched * 1000.0);
+	if (!check(worst < 1e-4f, "baked vertices differ from wall::get_matrix")) failed++;
+	return failed;
+	}
+static int level_mesh_report(const char *name, const vector<uint8_t> &cells, const vector<level_material> &materials, int width, int height)
+	{
+	vector<level_face> faces, merged;
+	level_faces(&cells[0], &materials[0], width, height, faces);
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	merge_level_faces(faces, merged);
+	double merge = seconds_since(start);
+	int walls = 0, merged_walls = 0;
+	for (size_t ii = 0; ii < faces.size(); ii++) walls += faces[ii].rotation < LEVEL_FACE_FLOOR;
+	for (size_t ii = 0; ii < merged.size(); ii++) merged_walls += merged[ii].rotation < LEVEL_FACE_FLOOR;
+	printf("%-24s %4d x %-4d %7d quads -> %6d (%5.1f%%)  walls %6d -> %5d  floors/ceilings %6d -> %5d  %.2f ms\n", name, width, height,
+		(int)faces.size(), (int)merged.size(), faces.empty() ? 0.0 : 100.0 * merged.size() / faces.size(), walls, merged_walls,
+		(int)faces.size() - walls, (int)merged.size() - merged_walls, merge * 1000.0);
+	//the same cells, each one covered once
+	vector<uint64_t> before, after;
+	level_cells(faces, before);
+	level_cells(merged, after);
+	int failed = check(before == after, "merged faces cover other cells") ? 0 : 1;
+	//the per wall path drew the cell faces before they were merged
+	failed += level_batch_report("unmerged", faces, width);
+	return failed + level_batch_report("merged", merged, width);
+	}
+//the 24 bit pixel of a synthetic level: wall block, or floor and ceiling
+static void level_pixel(vector<unsigned char> &bgr, int width, int x, int y, bool wall, int texture)
+	{
+	unsigned char *p = &bgr[((size_t)y * width + x) * 3];
+	p[0] = wall ? (unsigned char)(255 - texture) : 0;
+	p[1] = p[2] = wall ? 0 : (unsigned char)(255 - texture);
+	}
+//maze: walls everywhere, corridors carved by a random walk with backtracking on the odd cells
+static void maze_level(vector<unsigned char> &bgr, int size)
+	{
+	bgr.resize((size_t)size * size * 3);
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+			level_pixel(bgr, size, x, y, true, (x / 64 + y / 64) & 1);
+	srand(1);
+	vector<int> stack(1, 1 * size + 1);
+	level_pixel(bgr, size, 1, 1, false, 2);
+	while (!stack.empty())
+		{
+		int x = stack.back() % size, y = stack.back() / size;
+		int dirs[4][2] = { { 2, 0 }, { -2, 0 }, { 0, 2 }, { 0, -2 } }, open[4], count = 0;
+		for (int d = 0; d < 4; d++)
+			{
+			int nx = x + dirs[d][0], ny = y + dirs[d][1];
+			if (nx > 0 && ny > 0 && nx < size - 1 && ny < size - 1 && bgr[((size_t)ny * size + nx) * 3] > 0) open[count++] = d;
+			}
+		if (!count)
+			{
+			stack.pop_back();
+			continue;
+			}
+		int d = open[rand() % count];
+		level_pixel(bgr, size, x + dirs[d][0] / 2, y + dirs[d][1] / 2, false, 2);
+		level_pixel(bgr, size, x + dirs[d][0], y + dirs[d][1], false, 2);
+		stack.push_back((y + dirs[d][1]) * size + x + dirs[d][0]);
+		}
+	}
+//rooms: open 30x30 halls with 2 floor textures, 2 cell walls and doors between them
+static void rooms_level(vector<unsigned char> &bgr, int width, int height)
+	{
+	bgr.resize((size_t)width * height * 3);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			{
+			bool wall = (x % 32) < 2 || (y % 32) < 2;
+			if (wall && ((x % 32) == 16 || (y % 32) == 16)) wall = false;
+			level_pixel(bgr, width, x, y, wall, wall ? 0 : 2 + ((x / 32 + y / 32) & 1));
+			}
+	}
+//a level bitmap in memory as paint programs write it: rows padded to 4 bytes, bottom up unless top_down
+static void level_bmp(const vector<unsigned char> &bgr, int width, int height, int bits, bool top_down, vector<unsigned char> &bmp)
+	{
+	size_t stride = ((size_t)width * (bits / 8) + 3) & ~(size_t)3;
+	bmp.assign(54 + stride * height, 0);
+	uint32_t file_size = (uint32_t)bmp.size(), offset = 54, info_size = 40, image_size = (uint32_t)(stride * height);
+	int32_t h = top_down ? -height : height;
+	uint16_t planes = 1, bit_count = (uint16_t)bits;
+	bmp[0] = 'B';
+	bmp[1] = 'M';
+	memcpy(&bmp[2], &file_size, 4);
+	memcpy(&bmp[10], &offset, 4);
+	memcpy(&bmp[14], &info_size, 4);
+	memcpy(&bmp[18], &width, 4);
+	memcpy(&bmp[22], &h, 4);
+	memcpy(&bmp[26], &planes, 2);
+	memcpy(&bmp[28], &bit_count, 2);
+	memcpy(&bmp[34], &image_size, 4);
+	for (int y = 0; y < height; y++)
+		{
+		unsigned char *row = &bmp[54 + stride * (top_down ? height - 1 - y : y)];
+		for (int x = 0; x < width; x++)
+			memcpy(row + x * (bits / 8), &bgr[((size_t)y * width + x) * 3], 3);
+		}
+	}
+//the synthetic level through the level compiler's reader, like a level.bmp
+static int level_mesh_report(const char *name, const vector<unsigned char> &bgr, int size)
+	{
+	vector<unsigned char> bmp;
+	level_bmp(bgr, size, size, 24, false, bmp);
+	vector<uint8_t> cells;
+	vector<level_material> materials;
+	int width, height;
+	if (!check(read_level_bitmap(&bmp[0], bmp.size(), &width, &height, cells, materials), "synthetic bitmap not read")) return 1;
+	return level_mesh_report(name, cells, materials, width, height);
+	}
+//synthetic levels (a maze of 1 cell corridors, rooms, noise) and level bitmaps: quads before and after merging
+static int cmd_levelmesh(int argc, char **argv)
+	{
+	int failed = 0;
+	const int size = 256;
+	vector<unsigned char> bgr;
+	maze_level(bgr, size);
+	failed += level_mesh_report("maze (synthetic)", bgr, size);
+	rooms_level(bgr, size, size);
+	failed += level_mesh_report("rooms (synthetic)", bgr, size);
+	//noise: every other cell a wall, the worst case, next to nothing merges
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+			level_pixel(bgr, size, x, y, rand() % 2 == 0, rand() % 2);
+	failed += level_mesh_report("noise (synthetic)", bgr, size);
+
+	for (int ii = 0; ii < argc; ii++)
+		{
+		mapped_file file;
+		vector<uint8_t> cells;
+		vector<level_material> materials;
+		int width, height;
+		const char *error = "can not read it";
+		if (!file.open(argv[ii]) || !read_level_bitmap(file.data(), file.size(), &width, &height, cells, materials, &error))
+			{
+			printf("%s: FAILED, %s\n", argv[ii], error);
+			failed++;
+			continue;
+			}
+		failed += level_mesh_report(argv[ii], cells, materials, width, height);
+		}
+	return failed ? 1 : 0;
+	}
+//every cell of a read bitmap has the textures of its pixel
+static bool level_cells_match(const vector<unsigned char> &bgr, const vector<uint8_t> &cells, const vector<level_material> &materials)
+	{
+	if (cells.size() * 3 != bgr.size()) return false;
+	for (size_t ii = 0; ii < cells.size(); ii++)
+		{
+		const unsigned char *p = &bgr[ii * 3];
+		const level_material &m = materials[cells[ii]];
+		if (m.wall != (p[0] ? 255 - p[0] : LEVEL_NONE) || m.floor != (p[1] ? 255 - p[1] : LEVEL_NONE) || m.ceiling != (p[2] ? 255 - p[2] : LEVEL_NONE))
+			return false;
+		}
+	return true;
+	}
+static bool write_file(const char *filename, const vector<unsigned char> &data)
+	{
+	FILE *file = fopen(filename, "wb");
+	if (!file) return false;
+	bool written = fwrite(&data[0], data.size(), 1, file) == 1;
+	return (fclose(file) == 0) && written;
+	}
+//what every level load did before the compiler: read the bitmap, decode it, find and merge the faces, write newpic.bmp back (timed into <input>.newpic.tmp)
+static double level_bitmap_load(const char *filename, vector<level_face> &merged, double times[4])
+	{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	vector<unsigned char> bmp;
+	FILE *file = fopen(filename, "rb");
+	if (!file) return 0;
+	fseek(file, 0, SEEK_END);
+	bmp.resize((size_t)ftell(file));
+	fseek(file, 0, SEEK_SET);
+	size_t got = fread(&bmp[0], 1, bmp.size(), file);
+	fclose(file);
+	times[0] = seconds_since(start);
+	vector<uint8_t> cells;
+	vector<level_material> materials;
+	int width, height;
+	if (got != bmp.size() || !read_level_bitmap(&bmp[0], bmp.size(), &width, &height, cells, materials)) return 0;
+	times[1] = seconds_since(start) - times[0];
+	vector<level_face> faces;
+	level_faces(&cells[0], &materials[0], width, height, faces);
+	merge_level_faces(faces, merged);
+	times[2] = seconds_since(start) - times[0] - times[1];
+	//the same write into a name the tool owns, the game's own newpic.bmp is left alone
+	std::string newpic = std::string(filename) + ".newpic.tmp";
+	write_file(newpic.c_str(), bmp);
+	times[3] = seconds_since(start) - times[0] - times[1] - times[2];
+	remove(newpic.c_str());
+	return seconds_since(start);
+	}
+//what the game does now: map the cooked file, take the faces (level::process_level before the walls)
+static double level_cooked_load(const char *cooked, bool cold, size_t *faces)
+	{
+	if (cold) drop_cache(cooked);
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	cooked_level level;
+	if (!level.open(cooked)) return 0;
+	vector<level_face> merged(level.faces, level.faces + level.header->face_count);
+	*faces = merged.size();
+	return seconds_since(start);
+	}
+static int level_cook_report(const char *name, vector<level_face> *expected)
+	{
+	int failed = 0;
+	char cooked[1024];
+	cooked_level_name(name, cooked, sizeof(cooked));
+	remove(cooked);
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	const char *error = "";
+	if (!cook_level(name, cooked, &error))
+		{
+		printf("%s: FAILED, %s\n", name, error);
+		return 1;
+		}
+	double cook = seconds_since(start);
+	cooked_level level;
+	if (!check(load_level_cached(name, level), "cooked level does not open")) return 1;
+	uint64_t bmp_size, level_size, time_before, time_after, unused;
+	file_stamp(name, &bmp_size, &unused);
+	file_stamp(cooked, &level_size, &time_before);
+	printf("%-24s %5d x %-5d %3d materials  %8d cell faces -> %7d  bmp %7.2f MB -> level %7.2f MB  cook %8.2f ms\n", name,
+		level.header->width, level.header->height, level.header->material_count, level.header->cell_face_count, level.header->face_count,
+		bmp_size / 1048576.0, level_size / 1048576.0, cook * 1000.0);
+	if (expected && !check(expected->size() == level.header->face_count &&
+		(expected->empty() || memcmp(&(*expected)[0], level.faces, expected->size() * sizeof(level_face)) == 0), "cooked faces are not the merged faces"))
+		failed++;
+	level.close();
+
+	vector<level_face> merged;
+	double times[4] = { 0, 0, 0, 0 };
+	double bitmap = level_bitmap_load(name, merged, times);
+	const int runs = 5;
+	double warm = 1e9, cold = 0;
+	size_t faces = 0;
+	for (int r = 0; r < runs; r++)
+		warm = std::min(warm, level_cooked_load(cooked, false, &faces));
+	bool can_drop = drop_cache(cooked);
+	if (can_drop)
+		cold = level_cooked_load(cooked, true, &faces);
+	printf("    bitmap every load %8.2f ms (read %.2f, decode %.2f, faces + merge %.2f, newpic.bmp %.2f)  ->  cooked: warm %.3f ms",
+		bitmap * 1000.0, times[0] * 1000.0, times[1] * 1000.0, times[2] * 1000.0, times[3] * 1000.0, warm * 1000.0);
+	if (can_drop) printf(", cold %.3f ms\n", cold * 1000.0);
+	else printf(", cold: cannot drop the page cache here\n");
+	if (!check(faces == merged.size(), "cooked load and bitmap load differ")) failed++;
+	//an untouched source is not cooked again
+	if (!check(load_level_cached(name, level), "cached level does not open")) failed++;
+	file_stamp(cooked, &unused, &time_after);
+	if (!check(time_before == time_after, "unchanged level was cooked again")) failed++;
+	return failed;
+	}
+//the level compiler: every bitmap layout reads the same, broken files are refused,
+//then large levels compiled and loaded the old way (bitmap at every load) and from the cooked file
+static int cmd_levels(int argc, char **argv)
+	{
+	int failed = 0;
+	//odd width: 24 bit rows are padded. a few random materials
+	const int w = 37, h = 29;
+	vector<unsigned char> bgr((size_t)w * h * 3), bmp;
+	srand(2);
+	for (size_t ii = 0; ii < bgr.size(); ii++)
+		bgr[ii] = rand() % 3 == 0 ? 0 : (unsigned char)(255 - rand() % 4);
+	vector<uint8_t> cells;
+	vector<level_material> materials;
+	int width, height;
+	const char *error = "";
+	for (int variant = 0; variant < 5; variant++)
+		{
+		static const char *names[5] = { "24 bit", "24 bit top down", "32 bit", "32 bit top down", "32 bit bitfields" };
+		level_bmp(bgr, w, h, variant < 2 ? 24 : 32, variant == 1 || variant == 3, bmp);
+		if (variant == 4)
+			{
+			//BI_BITFIELDS with the masks after the header
+			static const uint32_t masks[3] = { 0x00ff0000, 0x0000ff00, 0x000000ff };
+			uint32_t compression = 3, offset = 66;
+			bmp.insert(bmp.begin() + 54, (const unsigned char*)masks, (const unsigned char*)masks + 12);
+			memcpy(&bmp[10], &offset, 4);
+			memcpy(&bmp[30], &compression, 4);
+			}
+		bool ok = read_level_bitmap(&bmp[0], bmp.size(), &width, &height, cells, materials, &error);
+		printf("%-18s %s\n", names[variant], ok ? "ok" : error);
+		if (!check(ok && width == w && height == h && level_cells_match(bgr, cells, materials), "bitmap read wrong")) failed++;
+		}
+	//refused, each with its reason
+	for (int broken = 0; broken < 5; broken++)
+		{
+		static const char *names[5] = { "8 bit", "rle", "cut off", "no bmp", "empty" };
+		level_bmp(bgr, w, h, 24, false, bmp);
+		if (broken == 0) bmp[28] = 8;
+		if (broken == 1) bmp[30] = 1;
+		if (broken == 2) bmp.resize(bmp.size() - 5);
+		if (broken == 3) bmp[1] = 'X';
+		if (broken == 4) bmp.resize(20);
+		bool ok = read_level_bitmap(&bmp[0], bmp.size(), &width, &height, cells, materials, &error);
+		printf("%-18s %s\n", names[broken], ok ? "read" : error);
+		if (!check(!ok, "broken bitmap was read")) failed++;
+		}
+
+	//large levels: the rooms, square and with padded rows
+	const int sizes[2][2] = { { 4096, 4096 }, { 4095, 4093 } };
+	for (int ii = 0; ii < 2; ii++)
+		{
+		rooms_level(bgr, sizes[ii][0], sizes[ii][1]);
+		level_bmp(bgr, sizes[ii][0], sizes[ii][1], 24, false, bmp);
+		char name[64];
+		snprintf(name, sizeof(name), "level_rooms_%d.bmp", sizes[ii][0]);
+		if (!check(write_file(name, bmp), "cannot write the test level"))
+			{
+			failed++;
+			continue;
+			}
+		if (!check(read_level_bitmap(&bmp[0], bmp.size(), &width, &height, cells, materials), "test level not read"))
+			failed++;
+		vector<level_face> faces, merged;
+		level_faces(&cells[0], &materials[0], width, height, faces);
+		merge_level_faces(faces, merged);
+		failed += level_cook_report(name, &merged);
+		char cooked[1024];
+		cooked_level_name(name, cooked, sizeof(cooked));
+		remove(cooked);
+		remove(name);
+		}
+	for (int ii = 0; ii < argc; ii++)
+		failed += level_cook_report(argv[ii], NULL);
+	return failed ? 1 : 0;
+	}
+//every tile the stream bakes (from the tiled .level) has the faces of the whole level's cells in that tile, each once,
+//merged and baked like the same cells straight from the bitmap
+static int level_tile_check(const char *name, const vector<unsigned char> &bgr, int size)
+	{
+	vector<unsigned char> bmp;
+	level_bmp(bgr, size, size, 24, false, bmp);
+	vector<uint8_t> cells;
+	vector<level_material> materials;
+	int width, height;
+	const char *filename = "level_tile_check.bmp";
+	if (!check(read_level_bitmap(&bmp[0], bmp.size(), &width, &height, cells, materials) && write_file(filename, bmp), "synthetic level not written")) return 1;
+	level_stream stream;
+	if (!check(stream.open(filename), "stream does not open")) return 1;
+	stream.start(0);
+	stream.update(0, 0, 1e9f);		//every tile, baked right away
+	vector<level_face> all, faces, merged;
+	level_faces(&cells[0], &materials[0], width, height, all);
+	int tiles_x = (width + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE;
+	vector<vector<level_face> > per_tile(stream.get_resident().size());
+	for (size_t ii = 0; ii < all.size(); ii++)
+		per_tile[(all[ii].y / LEVEL_TILE_SIZE) * tiles_x + all[ii].x / LEVEL_TILE_SIZE].push_back(all[ii]);
+	int wrong = 0, tile_faces = 0;
+	vector<uint64_t> expected, got;
+	vector<mesh_vertex> vertices;
+	vector<level_batch> batches;
+	for (std::list<level_tile*>::const_iterator it = stream.get_resident().begin(); it != stream.get_resident().end(); ++it)
+		{
+		const level_tile *tile = *it;
+		int x0 = tile->tile_x * LEVEL_TILE_SIZE, y0 = tile->tile_y * LEVEL_TILE_SIZE;
+		level_faces(&cells[0], &materials[0], width, height, x0, y0, x0 + LEVEL_TILE_SIZE, y0 + LEVEL_TILE_SIZE, faces);
+		merge_level_faces(faces, merged);
+		bake_level_faces(merged, stream.cell_size, stream.x_offset, vertices, batches);
+		tile_faces += tile->face_count;
+		level_cells(per_tile[tile->tile_y * tiles_x + tile->tile_x], expected);
+		level_cells(merged, got);
+		wrong += expected != got || tile->face_count != (int)merged.size() || tile->vertices.size() != vertices.size() ||
+			(!vertices.empty() && memcmp(&tile->vertices[0], &vertices[0], vertices.size() * sizeof(mesh_vertex)) != 0);
+		}
+	vector<level_face> whole;
+	merge_level_faces(all, whole);
+	printf("%-24s %4d x %-4d %4d tiles  %7d cell faces -> merged whole %6d, in tiles %6d\n", name, width, height, (int)stream.get_resident().size(),
+		(int)all.size(), (int)whole.size(), tile_faces);
+	stream.close();
+	char cooked[1024];
+	cooked_level_name(filename, cooked, sizeof(cooked));
+	remove(cooked);
+	remove(filename);
+	return check(wrong == 0, "streamed tiles differ from the whole level") ? 0 : 1;
+	}
+//resident set size of the process in MB (linux), peak: the high water mark
+static double resident_mb(bool peak)
+	{
+#ifdef __linux__
+	FILE *file = fopen("/proc/self/status", "r");
+	if (!file) return 0;
+	char line[256];
+	double kb = 0;
+	while (fgets(line, sizeof(line), file))
+		if (strncmp(line, peak ? "VmHWM:" : "VmRSS:", 6) == 0) kb = atof(line + 6);
+	fclose(file);
+	return kb / 1024.0;
+#else
+	return 0;
+#endif
+	}
+static bool tile_in_view(int tx, int ty, float cx, float cy, float r)
+	{
+	float nx = std::min(std::max(cx, (float)tx * LEVEL_TILE_SIZE), (float)(tx + 1) * LEVEL_TILE_SIZE);
+	float ny = std::min(std::max(cy, (float)ty * LEVEL_TILE_SIZE), (float)(ty + 1) * LEVEL_TILE_SIZE);
+	return (nx - cx) * (nx - cx) + (ny - cy) * (ny - cy) <= r * r;
+	}
+//tile streaming: the tiles against the whole level, then a fly through a big level (4096x4096 rooms or the given
+//bitmap) at 250 frames a second, one cell a frame, with a small budget so the lru has to work
+static int cmd_stream(int argc, char **argv)
+	{
+	int failed = 0;
+	vector<unsigned char> bgr;
+	maze_level(bgr, 512);
+	failed += level_tile_check("maze (synthetic)", bgr, 512);
+	rooms_level(bgr, 500, 500);
+	failed += level_tile_check("rooms (synthetic)", bgr, 500);
+	for (int y = 0; y < 512; y++)
+		for (int x = 0; x < 512; x++)
+			level_pixel(bgr, 512, x, y, rand() % 2 == 0, rand() % 2);
+	failed += level_tile_check("noise (synthetic)", bgr, 512);
+
+	const char *name = argc > 0 ? argv[0] : "level_stream_4096.bmp";
+	size_t budget = (argc > 1 ? atoi(argv[1]) : 4) << 20;
+	if (argc == 0)
+		{
+		vector<unsigned char> bmp;
+		rooms_level(bgr, 4096, 4096);
+		level_bmp(bgr, 4096, 4096, 24, false, bmp);
+		if (!check(write_file(name, bmp), "cannot write the test level")) return 1;
+		}
+	vector<unsigned char>().swap(bgr);
+	char cooked[1024];
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	if (!check(level_cached(name, cooked, sizeof(cooked)), "level does not cook")) return 1;
+	double cook = seconds_since(start);
+
+	//what the game has at the start: a mapping, no faces
+#ifdef __linux__
+	FILE *refs = fopen("/proc/self/clear_refs", "w");		//5: reset the high water mark
+	if (refs)
+		{
+		fputs("5", refs);
+		fclose(refs);
+		}
+#endif
+	double rss_start = resident_mb(false);
+	start = std::chrono::high_resolution_clock::now();
+	level_stream stream;
+	if (!check(stream.open(name), "stream does not open")) return 1;
+	double open = seconds_since(start);
+	int width = stream.get_width(), height = stream.get_height();
+	stream.cell_size = 2;
+	stream.x_offset = (float)(width / 2) * 2;
+	stream.budget = budget;
+	stream.on_evict = [](level_tile *t) { t->user = NULL; };
+	stream.start(1);
+
+	//diagonal over the level, then back along x. the tiles are asked for a tile further out than the view
+	const float radius = 128, ask = radius + LEVEL_TILE_SIZE;		//cells
+	float path[3][2] = { { 64, 64 }, { width - 64.0f, height - 64.0f }, { 64, height - 64.0f } };
+	vector<double> latencies;
+	int frames = 0, popin = 0, first_view = -1;
+	double update_max = 0, update_sum = 0, first_view_ms = 0;
+	bool over_budget = false;
+	std::chrono::high_resolution_clock::time_point fly = std::chrono::high_resolution_clock::now(), next = fly;
+	for (int leg = 0; leg < 2; leg++)
+		{
+		float dx = path[leg + 1][0] - path[leg][0], dy = path[leg + 1][1] - path[leg][1];
+		int steps = (int)sqrtf(dx * dx + dy * dy);
+		for (int step = 0; step < steps; step++, frames++)
+			{
+			float cx = path[leg][0] + dx * step / steps, cy = path[leg][1] + dy * step / steps;
+			vector<level_tile*> ready;
+			start = std::chrono::high_resolution_clock::now();
+			stream.update(cx * 2 - stream.x_offset, cy * 2, ask * 2, &ready);
+			double t = seconds_since(start);
+			update_max = std::max(update_max, t);
+			update_sum += t;
+			//the upload: the vertices go, the bytes stay counted
+			for (size_t ii = 0; ii < ready.size(); ii++)
+				{
+				vector<mesh_vertex>().swap(ready[ii]->vertices);
+				ready[ii]->user = ready[ii];
+				latencies.push_back(ready[ii]->latency);
+				}
+			//pop in: a tile in view that is not there yet. the budget only gives way to what is in view
+			int tx0 = std::max(0, (int)((cx - radius) / LEVEL_TILE_SIZE)), tx1 = std::min((width - 1) / LEVEL_TILE_SIZE, (int)((cx + radius) / LEVEL_TILE_SIZE));
+			int ty0 = std::max(0, (int)((cy - radius) / LEVEL_TILE_SIZE)), ty1 = std::min((height - 1) / LEVEL_TILE_SIZE, (int)((cy + radius) / LEVEL_TILE_SIZE));
+			int in_view = 0, there = 0;
+			size_t asked_bytes = 0;
+			for (int ty = ty0; ty <= ty1; ty++)
+				for (int tx = tx0; tx <= tx1; tx++)
+					in_view += tile_in_view(tx, ty, cx + 0.5f, cy + 0.5f, radius);
+			for (std::list<level_tile*>::const_iterator it = stream.get_resident().begin(); it != stream.get_resident().end(); ++it)
+				{
+				there += tile_in_view((*it)->tile_x, (*it)->tile_y, cx + 0.5f, cy + 0.5f, radius);
+				if (tile_in_view((*it)->tile_x, (*it)->tile_y, cx + 0.5f, cy + 0.5f, ask)) asked_bytes += (*it)->bytes;
+				}
+			if (there < in_view) popin++;
+			else if (first_view < 0)
+				{
+				first_view = frames;
+				first_view_ms = seconds_since(fly) * 1000.0;
+				}
+			if (stream.resident_bytes > std::max(budget, asked_bytes)) over_budget = true;
+			next += std::chrono::microseconds(4000);
+			std::this_thread::sleep_until(next);
+			}
+		}
+	double fly_time = seconds_since(fly);
+	stream.stop();
+	std::sort(latencies.begin(), latencies.end());
+	double rss_peak = resident_mb(true);
+	printf("%s: %d x %d, %d x %d tiles of %d cells, cooked %.2f ms, stream open %.3f ms\n", name, width, height,
+		(width + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE, (height + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE, LEVEL_TILE_SIZE, cook * 1000.0, open * 1000.0);
+	printf("fly: %d frames in %.2f s, view radius %d cells (asked %d), first full view at frame %d (%.1f ms)\n", frames, fly_time, (int)radius, (int)ask, first_view, first_view_ms);
+	if (!latencies.empty())
+		printf("     %d tile loads, %d evictions, latency avg %.2f ms  p95 %.2f ms  max %.2f ms, %d frames with a tile missing in view\n",
+			stream.loads, stream.evictions, stream.latency_sum * 1000.0 / stream.loads, latencies[latencies.size() * 95 / 100] * 1000.0,
+			stream.latency_max * 1000.0, popin);
+	printf("     update avg %.3f ms  max %.3f ms, tiles peak %.2f MB (budget %.2f MB), process resident %.1f MB at open, peak %.1f MB\n",
+		update_sum * 1000.0 / std::max(frames, 1), update_max * 1000.0, stream.peak_bytes / 1048576.0, budget / 1048576.0, rss_start, rss_peak);
+	cooked_level whole;
+	if (whole.open(cooked))
+		printf("     the whole level at once: %u faces, %.1f MB of vertices and walls\n", whole.header->face_count,
+			whole.header->face_count * (6.0 * sizeof(mesh_vertex) + 48) / 1048576.0);
+	if (!check(stream.loads > 0 && first_view >= 0, "no tile came in")) failed++;
+	if (!check(stream.evictions > 0, "nothing was evicted")) failed++;
+	if (!check(!over_budget, "over the budget with tiles out of view")) failed++;
+	stream.close();
+	if (argc == 0)
+		{
+		remove(cooked);
+		remove(name);
+		}
+	return failed ? 1 : 0;
+	}
+//the level's boxes straight from the cells in world space, every one tested: what the grid is checked against
+struct collide_box
+	{
+	float lo[3], hi[3];
+	};
+static void collide_boxes(const level_grid &grid, vector<collide_box> &boxes)
+	{
+	boxes.clear();
+	float half = grid.cell_size * 0.5f, h = grid.half_height;
+	for (int y = 0; y < grid.get_height(); y++)
+		for (int x = 0; x < grid.get_width(); x++)
+			{
+			uint8_t f = grid.get(x, y);
+			float cx = x * grid.cell_size - grid.x_offset, cz = y * grid.cell_size;
+			collide_box b = { { cx - half, -h, cz - half }, { cx + half, h, cz + half } };
+			if (f & LEVEL_GRID_SOLID) boxes.push_back(b);
+			b.hi[1] = -h;
+			if (f & LEVEL_GRID_FLOOR) boxes.push_back(b);
+			b.lo[1] = b.hi[1] = h;
+			if (f & LEVEL_GRID_CEILING) boxes.push_back(b);
+			}
+	}
+static bool ray_box_reference(const float o[3], const float d[3], const collide_box &b, float *t)
+	{
+	double t0 = 0, t1 = 1;
+	for (int ii = 0; ii < 3; ii++)
+		{
+		if (d[ii] == 0)
+			{
+			if (o[ii] < b.lo[ii] || o[ii] > b.hi[ii]) return false;
+			continue;
+			}
+		double a = (b.lo[ii] - o[ii]) / (double)d[ii], c = (b.hi[ii] - o[ii]) / (double)d[ii];
+		if (a > c) std::swap(a, c);
+		t0 = std::max(t0, a);
+		t1 = std::min(t1, c);
+		if (t0 > t1) return false;
+		}
+	*t = (float)t0;
+	return true;
+	}
+static bool raycast_reference(const vector<collide_box> &boxes, const float from[3], const float to[3], float *t)
+	{
+	float d[3] = { to[0] - from[0], to[1] - from[1], to[2] - from[2] }, best = 2, s;
+	for (size_t ii = 0; ii < boxes.size(); ii++)
+		if (ray_box_reference(from, d, boxes[ii], &s)) best = std::min(best, s);
+	*t = best;
+	return best <= 1;
+	}
+static double box_distance(const double p[3], const collide_box &b)
+	{
+	double d2 = 0;
+	for (int ii = 0; ii < 3; ii++)
+		{
+		double e = std::max(std::max((double)b.lo[ii] - p[ii], p[ii] - (double)b.hi[ii]), 0.0);
+		d2 += e * e;
+		}
+	return sqrt(d2);
+	}
+//conservative advancement: step by the distance to the nearest box, no sweep math shared with the grid.
+//-1: it creeps past something without touching, no answer
+static int sweep_reference(const vector<collide_box> &boxes, const float from[3], const float to[3], float r, float *t)
+	{
+	double d[3] = { (double)to[0] - from[0], (double)to[1] - from[1], (double)to[2] - from[2] };
+	double length = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	vector<const collide_box*> near;
+	for (size_t ii = 0; ii < boxes.size(); ii++)
+		{
+		bool apart = false;
+		for (int jj = 0; jj < 3; jj++)
+			apart |= boxes[ii].lo[jj] - r > std::max(from[jj], to[jj]) || boxes[ii].hi[jj] + r < std::min(from[jj], to[jj]);
+		if (!apart) near.push_back(&boxes[ii]);
+		}
+	double s = 0;
+	for (int step = 0; step < 4000; step++)
+		{
+		double p[3] = { from[0] + d[0] * s, from[1] + d[1] * s, from[2] + d[2] * s }, gap = 1e30;
+		for (size_t ii = 0; ii < near.size(); ii++)
+			gap = std::min(gap, box_distance(p, *near[ii]) - r);
+		if (gap < 1e-5)
+			{
+			*t = (float)s;
+			return 1;
+			}
+		if (length == 0) return 0;
+		s += gap / length;
+		if (s > 1) return 0;
+		}
+	return -1;
+	}
+static void random_open_point(const level_grid &grid, float spread, float p[3])
+	{
+	int x, y;
+	do
+		{
+		x = 1 + rand() % (grid.get_width() - 2);
+		y = 1 + rand() % (grid.get_height() - 2);
+		} while (grid.get(x, y) & LEVEL_GRID_SOLID);
+	p[0] = x * grid.cell_size - grid.x_offset + random_float(-spread, spread) * grid.cell_size;
+	p[1] = random_float(-0.9f, 0.9f) * grid.half_height * spread * 2;
+	p[2] = y * grid.cell_size + random_float(-spread, spread) * grid.cell_size;
+	}
+static void random_segment(const level_grid &grid, float length, float pitch, float from[3], float to[3])
+	{
+	random_open_point(grid, 0.5f, from);
+	float a = random_float(0, 6.2831853f), b = random_float(-pitch, pitch);
+	to[0] = from[0] + cosf(a) * cosf(b) * length;
+	to[1] = from[1] + sinf(b) * length;
+	to[2] = from[2] + sinf(a) * cosf(b) * length;
+	}
+static void level_grid_cells(const vector<unsigned char> &bgr, int width, int height, level_grid &grid, vector<level_face> *merged = NULL)
+	{
+	vector<unsigned char> bmp;
+	level_bmp(bgr, width, height, 24, false, bmp);
+	vector<uint8_t> cells;
+	vector<level_material> materials;
+	int w, h;
+	read_level_bitmap(&bmp[0], bmp.size(), &w, &h, cells, materials);
+	grid.cell_size = 2;
+	grid.half_height = 1;
+	grid.x_offset = (float)(w / 2) * 2;
+	grid.build(&cells[0], &materials[0], w, h);
+	if (merged)
+		{
+		vector<level_face> faces;
+		level_faces(&cells[0], &materials[0], w, h, faces);
+		merge_level_faces(faces, *merged);
+		}
+	}
+//grid queries against every box of a small level: rays from anywhere (inside walls, above the ceilings), spheres
+//from open cells, and a camera pushed into the walls that must never end up inside one
+static int level_grid_check(const char *name, const vector<unsigned char> &bgr, int size)
+	{
+	level_grid grid;
+	level_grid_cells(bgr, size, size, grid);
+	vector<collide_box> boxes;
+	collide_boxes(grid, boxes);
+	int failed = 0, rays = 20000, ray_hits = 0, ray_wrong = 0, spheres = 4000, sphere_hits = 0, sphere_wrong = 0, skipped = 0, inside = 0;
+	float worst_ray = 0, worst_sphere = 0;
+	level_hit hit;
+	for (int ii = 0; ii < rays; ii++)
+		{
+		float from[3], to[3], t;
+		for (int jj = 0; jj < 3; jj++)
+			{
+			from[jj] = random_float(-4, size * 2.0f + 4);
+			to[jj] = from[jj] + random_float(-20, 20);
+			}
+		from[0] -= grid.x_offset;
+		to[0] -= grid.x_offset;
+		from[1] = random_float(-1.5f, 1.5f);
+		to[1] = random_float(-1.5f, 1.5f);
+		bool reference = raycast_reference(boxes, from, to, &t), found = grid.raycast(from, to, &hit);
+		ray_hits += reference;
+		//a ray that only grazes an edge may count either way
+		if (reference != found && (found ? hit.t : t) < 0.9999f) ray_wrong++;
+		if (reference && found)
+			{
+			worst_ray = std::max(worst_ray, fabsf(hit.t - t));
+			if (fabsf(hit.t - t) > 1e-4f) ray_wrong++;
+			}
+		}
+	for (int ii = 0; ii < spheres; ii++)
+		{
+		float from[3], to[3], t = 0, r = random_float(0.1f, 2.5f);
+		random_segment(grid, random_float(0.5f, 12), 0.3f, from, to);
+		int reference = sweep_reference(boxes, from, to, r, &t);
+		bool found = grid.sweep_sphere(from, to, r, &hit);
+		if (reference < 0)
+			{
+			skipped++;
+			continue;
+			}
+		sphere_hits += reference;
+		if ((reference != 0) != found && (found ? hit.t : t) < 0.999f) sphere_wrong++;
+		if (reference && found)
+			{
+			//advancement stops a little short
+			worst_sphere = std::max(worst_sphere, fabsf(hit.t - t));
+			if (fabsf(hit.t - t) > 1e-3f) sphere_wrong++;
+			}
+		}
+	//the camera: 20000 frames of random pushes, mostly into the walls of the neighbourhood
+	float camera[3], r = 0.4f;
+	random_open_point(grid, 0, camera);
+	for (int frame = 0; frame < 20000; frame++)
+		{
+		float to[3] = { camera[0] + random_float(-0.6f, 0.6f), camera[1] + random_float(-0.3f, 0.3f), camera[2] + random_float(-0.6f, 0.6f) };
+		grid.slide_sphere(camera, to, r, camera);
+		double p[3] = { camera[0], camera[1], camera[2] }, gap = 1e30;
+		for (size_t ii = 0; ii < boxes.size(); ii++)
+			gap = std::min(gap, box_distance(p, boxes[ii]));
+		if (gap < r - 1e-4) inside++;
+		}
+	printf("%-18s %d x %d, %d boxes: rays %d (%d hit) worst t error %.2g, spheres %d (%d hit, %d grazing skipped) worst t error %.2g, camera inside a wall %d of 20000 frames\n",
+		name, size, size, (int)boxes.size(), rays, ray_hits, worst_ray, spheres - skipped, sphere_hits, skipped, worst_sphere, inside);
+	if (!check(ray_wrong == 0, "raycast differs from testing every box")) failed++;
+	if (!check(sphere_wrong == 0, "sweep_sphere differs from advancing against every box")) failed++;
+	if (!check(inside == 0, "the sliding camera got into a wall")) failed++;
+	return failed;
+	}
+struct collide_query
+	{
+	float from[3], to[3];
+	};
+static double collide_rate(level_grid &grid, const vector<collide_query> &queries, float radius, double *cells, double *hits)
+	{
+	level_hit hit;
+	size_t visited = 0, hit_count = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (size_t ii = 0; ii < queries.size(); ii++)
+		{
+		bool found = radius > 0 ? grid.sweep_sphere(queries[ii].from, queries[ii].to, radius, &hit) : grid.raycast(queries[ii].from, queries[ii].to, &hit);
+		hit_count += found;
+		visited += grid.visited;
+		}
+	double t = seconds_since(start);
+	*cells = visited / (double)queries.size();
+	*hits = hit_count * 100.0 / queries.size();
+	return queries.size() / t;
+	}
+//the occupancy grid: checked against every box on small levels, then queries a second on rooms levels from
+//256x256 to 4096x4096: a query walks the cells on its way, the size of the level does not matter
+static int cmd_collide(int argc, char **argv)
+	{
+	int failed = 0;
+	vector<unsigned char> bgr;
+	maze_level(bgr, 64);
+	failed += level_grid_check("maze (synthetic)", bgr, 64);
+	rooms_level(bgr, 96, 96);
+	failed += level_grid_check("rooms (synthetic)", bgr, 96);
+	srand(2);
+	for (int y = 0; y < 64; y++)
+		for (int x = 0; x < 64; x++)
+			level_pixel(bgr, 64, x, y, rand() % 3 == 0, rand() % 2);
+	failed += level_grid_check("noise (synthetic)", bgr, 64);
+
+	const int sizes[] = { 256, 1024, 4096 }, count = 200000;
+	for (int ii = 0; ii < 3; ii++)
+		{
+		level_grid grid;
+		rooms_level(bgr, sizes[ii], sizes[ii]);
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		level_grid_cells(bgr, sizes[ii], sizes[ii], grid);
+		double build = seconds_since(start);
+		vector<unsigned char>().swap(bgr);
+		printf("rooms %d x %d: grid %.1f MB, built from the cells in %.1f ms\n", sizes[ii], sizes[ii], grid.get_width() * (double)grid.get_height() / 1048576.0, build * 1000.0);
+		//the camera a frame, a bullet a frame, then level rays and spheres along the floor, 100 cells far
+		struct
+			{
+			const char *what;
+			float length, radius, pitch;
+			} kinds[] = { { "camera sweep r 0.4", 0.3f, 0.4f, 0.3f }, { "bullet ray", 4, 0, 0.3f }, { "flat ray 100 cells", 200, 0, 0 },
+				{ "flat sphere r 0.8", 200, 0.8f, 0 } };
+		for (int kk = 0; kk < 4; kk++)
+			{
+			srand(3);
+			vector<collide_query> queries(count);
+			for (int jj = 0; jj < count; jj++)
+				random_segment(grid, kinds[kk].length, kinds[kk].pitch, queries[jj].from, queries[jj].to);
+			double cells, hits, rate = collide_rate(grid, queries, kinds[kk].radius, &cells, &hits);
+			printf("  %-22s %6.2f M queries/s, %5.1f cells walked, %4.1f%% hit\n", kinds[kk].what, rate / 1e6, cells, hits);
+			}
+		if (ii == 0)
+			{
+			//what it replaces: every wall box tested
+			vector<collide_box> boxes;
+			collide_boxes(grid, boxes);
+			srand(3);
+			int brute = 2000;
+			std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+			int hits = 0;
+			for (int jj = 0; jj < brute; jj++)
+				{
+				float from[3], to[3], t;
+				random_segment(grid, 4, 0.3f, from, to);
+				hits += raycast_reference(boxes, from, to, &t);
+				}
+			printf("  %-22s %6.4f M queries/s, %4.1f%% hit (every one of the %d boxes tested)\n", "bullet ray, no grid", brute / seconds_since(begin) / 1e6,
+				hits * 100.0 / brute, (int)boxes.size());
+			}
+		}
+	return failed ? 1 : 0;
+	}
+//the pvs of a synthetic level: built per cell to check it against lines of sight, then in blocks as the game
+//draws it: what share of the faces a camera cell still submits, and in how many draws
+static int level_pvs_report(const char *name, level_grid &grid, const vector<level_face> &merged)
+	{
+	int failed = 0;
+	//per cell: the one thing a set must never do is miss a cell a straight line reaches
+	level_pvs cells, pvs;
+	cells.build(grid, 1);
+	pvs.build(grid);
+	int lines = 20000, clear = 0, missed = 0, missed_blocks = 0;
+	vector<uint8_t> seen;
+	for (int ii = 0; ii < lines; ii++)
+		{
+		float from[3], to[3];
+		random_open_point(grid, 0.5f, from);
+		float a = random_float(0, 6.2831853f), length = random_float(0.5f, random_float(2, 60));
+		from[1] = to[1] = 0;
+		to[0] = from[0] + cosf(a) * length;
+		to[2] = from[2] + sinf(a) * length;
+		int fx, fy, tx, ty;
+		grid.cell_of(from, &fx, &fy);
+		grid.cell_of(to, &tx, &ty);
+		if (tx <= 0 || ty <= 0 || tx >= grid.get_width() - 1 || ty >= grid.get_height() - 1 || (grid.get(tx, ty) & LEVEL_GRID_SOLID)) continue;
+		if (grid.raycast(from, to, NULL)) continue;
+		clear++;
+		if (!cells.get_visible(fx, fy, seen) || !level_pvs::is_set(seen, ty * grid.get_width() + tx)) missed++;
+		if (!pvs.get_visible(fx, fy, seen) || !level_pvs::is_set(seen, (ty / LEVEL_PVS_BLOCK) * pvs.get_blocks_x() + tx / LEVEL_PVS_BLOCK)) missed_blocks++;
+		}
+	//in blocks, the draws of every open cell
+	vector<mesh_vertex> vertices;
+	vector<level_block_batch> batches;
+	bake_level_blocks(merged, pvs.get_blocks_x(), pvs.get_block_size(), 2, grid.x_offset, vertices, batches);
+	double drawn = 0, draws = 0;
+	int sources = 0, textures = 0;
+	for (size_t ii = 0; ii < batches.size(); ii++)
+		textures += ii == 0 || batches[ii].texture_no != batches[ii - 1].texture_no;
+	for (int y = 0; y < grid.get_height(); y++)
+		for (int x = 0; x < grid.get_width(); x++)
+			{
+			if (!pvs.get_visible(x, y, seen)) continue;
+			sources++;
+			int end = -1;
+			for (size_t ii = 0; ii < batches.size(); ii++)
+				if (level_pvs::is_set(seen, batches[ii].block))
+					{
+					drawn += batches[ii].vertex_count;
+					draws += batches[ii].first_vertex != end;
+					end = batches[ii].first_vertex + batches[ii].vertex_count;
+					}
+			}
+	int blocks = pvs.get_blocks_x() * pvs.get_blocks_y();
+	printf("%-18s %4d x %-4d %6d open cells: per cell %7.1f ms, %5.1f cells seen (%.2f%%), %d of %d straight lines missed\n", name,
+		grid.get_width(), grid.get_height(),
+		cells.open_cells, cells.build_seconds * 1000.0, cells.visible_cells, cells.visible_cells * 100.0 / cells.open_cells, missed, clear);
+	printf("%-18s %dx%d blocks %7.1f ms, %5.1f of %d blocks seen (%.1f%%), %d rows stored, %.1f KB (%.1f KB uncompressed), %d lines missed\n", "",
+		LEVEL_PVS_BLOCK, LEVEL_PVS_BLOCK, pvs.build_seconds * 1000.0, pvs.visible_blocks, blocks, pvs.visible_blocks * 100.0 / blocks, pvs.unique_rows,
+		pvs.get_bytes() / 1024.0, pvs.get_raw_bytes() / 1024.0, missed_blocks);
+	printf("%-18s drawn: %.1f%% of %d faces in %.1f draws a frame (%d without the pvs)\n", "", drawn * 100.0 / std::max(sources, 1) / std::max(vertices.size(), (size_t)1),
+		(int)vertices.size() / 6, draws / std::max(sources, 1), textures);
+	if (!check(missed == 0 && missed_blocks == 0, "a cell seen along a straight line is not in the set")) failed++;
+	if (!check(clear > lines / 20, "too few clear lines to check")) failed++;
+	return failed;
+	}
+//potentially visible sets: mazes of 64 to 256 cells, rooms and the given level bitmaps: build time, what is seen, what is drawn
+static int cmd_pvs(int argc, char **argv)
+	{
+	int failed = 0;
+	vector<unsigned char> bgr;
+	vector<level_face> merged;
+	const int sizes[] = { 64, 128, 256 };
+	for (int ii = 0; ii < 4; ii++)
+		{
+		level_grid grid;
+		if (ii < 3)	maze_level(bgr, sizes[ii]);
+		else		rooms_level(bgr, 128, 128);
+		level_grid_cells(bgr, ii < 3 ? sizes[ii] : 128, ii < 3 ? sizes[ii] : 128, grid, &merged);
+		failed += level_pvs_report(ii < 3 ? "maze (synthetic)" : "rooms (synthetic)", grid, merged);
+		}
+	for (int ii = 0; ii < argc; ii++)
+		{
+		mapped_file file;
+		vector<uint8_t> cells;
+		vector<level_material> materials;
+		vector<level_face> faces;
+		int width, height;
+		if (!check(file.open(argv[ii]) && read_level_bitmap(file.data(), file.size(), &width, &height, cells, materials), argv[ii])) continue;
+		level_grid grid;
+		grid.cell_size = 2;
+		grid.half_height = 1;
+		grid.x_offset = (float)(width / 2) * 2;
+		grid.build(&cells[0], &materials[0], width, height);
+		level_faces(&cells[0], &materials[0], width, height, faces);
+		merge_level_faces(faces, merged);
+		failed += level_pvs_report(argv[ii], grid, merged);
+		}
+	return failed ? 1 : 0;
+	}
+//a ship like camera::animation in plain floats: thrust along a turning heading, moved by its impulse, the impulse decays
+//by a fixed amount a tick. the script is (tick, event), like the game's input once it is in the clock
+struct tick_ship
+	{
+	float heading, x, z, ix, iz;
+	int thrust;
+	};
+static void tick_ship_step(tick_ship &s, const vector<sim_event> &events)
+	{
+	for (size_t ii = 0; ii < events.size(); ii++)
+		if (events[ii].type == SIM_TURN)			s.heading += events[ii].y;
+		else if (events[ii].type == SIM_KEY_DOWN)	s.thrust = 1;
+		else if (events[ii].type == SIM_KEY_UP)		s.thrust = 0;
+	float speed = SIM_TICK_MICRO / 100000.0f;
+	if (s.thrust)
+		{
+		s.ix -= sinf(s.heading) * speed / 4;
+		s.iz -= cosf(s.heading) * speed / 4;
+		}
+	s.x -= s.ix;
+	s.z -= s.iz;
+	s.ix += s.ix > 0.00001f ? -0.001f : 0.001f;
+	s.iz += s.iz > 0.00001f ? -0.001f : 0.001f;
+	}
+//runs seconds of frames (frame_micro each, jitter: up to that much more or less at random) through a clock
+static tick_ship tick_ship_run(double seconds, int frame_micro, int jitter, int speed, uint64_t *ticks, uint64_t *dropped, float *alpha_worst)
+	{
+	tick_ship s = { 0, 0, 0, 0, 0, 0 };
+	sim_clock clock;
+	clock.speed = speed;
+	srand(7);
+	int64_t left = (int64_t)(seconds * 1000000.0);
+	*alpha_worst = 0;
+	while (left > 0)
+		{
+		int64_t frame = frame_micro + (jitter ? rand() % (2 * jitter + 1) - jitter : 0);
+		if (frame > left) frame = left;
+		left -= frame;
+		int due = clock.advance(frame);
+		for (int ii = 0; ii < due; ii++)
+			{
+			//the script: turn every 50 ticks, thrust on for 30 ticks of every 200
+			if (clock.tick % 50 == 0)			clock.push(sim_event(SIM_TURN, 0, 0, 0.3f));
+			if (clock.tick % 200 == 0)		clock.push(sim_event(SIM_KEY_DOWN, 'W'));
+			if (clock.tick % 200 == 30)		clock.push(sim_event(SIM_KEY_UP, 'W'));
+			tick_ship_step(s, clock.take_events());
+			clock.tick++;
+			}
+		*alpha_worst = std::max(*alpha_worst, clock.alpha());
+		}
+	*ticks = clock.tick;
+	*dropped = clock.dropped;
+	return s;
+	}
+//fixed ticks: the same game from every frame rate, bit for bit, and fast-forward
+static int cmd_ticks(int argc, char **argv)
+	{
+	int failed = 0;
+	double seconds = argc > 0 ? atof(argv[0]) : 60;
+	struct
+		{
+		const char *name;
+		int frame_micro, jitter, speed;
+		} runs[] = { { "1000 fps", 1000, 0, 1 }, { "144 fps jittered", 6944, 3000, 1 }, { "60 fps", 16667, 0, 1 }, { "30 fps jittered", 33333, 20000, 1 },
+			{ "20 fps", 50000, 0, 1 }, { "60 fps, fast-forward", 16667, 0, SIM_FAST_FORWARD } };
+	tick_ship reference = { 0, 0, 0, 0, 0, 0 };
+	uint64_t reference_ticks = 0;
+	for (int ii = 0; ii < (int)(sizeof(runs) / sizeof(runs[0])); ii++)
+		{
+		uint64_t ticks, dropped;
+		float alpha_worst;
+		//fast-forward plays the same game time in a SIM_FAST_FORWARD th of the frames
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		tick_ship s = tick_ship_run(seconds / runs[ii].speed, runs[ii].frame_micro, runs[ii].jitter, runs[ii].speed, &ticks, &dropped, &alpha_worst);
+		double run_seconds = seconds_since(start);
+		if (ii == 0)
+			{
+			reference = s;
+			reference_ticks = ticks;
+			}
+		bool same = ticks == reference_ticks && memcmp(&s, &reference, sizeof(s)) == 0;
+		printf("%-22s %7llu ticks, %llu dropped, alpha up to %.4f, ship at (%.6f, %.6f) %s, %.2f ms\n", runs[ii].name, (unsigned long long)ticks,
+			(unsigned long long)dropped, alpha_worst, s.x, s.z, same ? "bit identical" : "DIFFERENT", run_seconds * 1000.0);
+		if (!check(same && dropped == 0 && alpha_worst < 1.0f, runs[ii].name)) failed++;
+		}
+	//a frame that hangs (a breakpoint, a hitch): SIM_MAX_TICKS at most, the rest is gone
+	sim_clock clock;
+	int due = clock.advance(2000000);
+	printf("%-22s %7d ticks, %llu dropped, %.1f ms behind afterwards\n", "2 s hitch", due, (unsigned long long)clock.dropped, clock.accumulator / 1000.0);
+	if (!check(due == SIM_MAX_TICKS && clock.accumulator < SIM_TICK_MICRO, "hitch")) failed++;
+	return failed ? 1 : 0;
+	}
+//the game's hot reload without the device: every changed model is cooked again and mapped, the time from
+//seeing the change to a usable mesh is what the game waits before the swap
+static int cmd_watch(int argc, char **argv)
+	{
+	const char *directory = argc > 0 ? argv[0] : ".";
+	double run_seconds = argc > 1 ? atof(argv[1]) : 0;
+	file_watch watch;
+	if (!watch.start(directory))
+		{
+		printf("FAILED watching %s\n", directory);
+		return 1;
+		}
+	printf("watching %s%s\n", directory, run_seconds > 0 ? "" : ", ctrl-c to stop");
+	fflush(stdout);
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	int failed = 0;
+	while (run_seconds <= 0 || seconds_since(start) < run_seconds)
+		{
+		vector<std::string> changed;
+		watch.poll(changed);
+		for (size_t ii = 0; ii < changed.size(); ii++)
+			{
+			std::string path = std::string(directory) + "/" + changed[ii];
+			if (!is_model_file(path.c_str()))
+				{
+				printf("%s: changed\n", changed[ii].c_str());
+				continue;
+				}
+			std::chrono::high_resolution_clock::time_point t = std::chrono::high_resolution_clock::now();
+			cooked_mesh mesh;
+			if (!load_mesh_cached(path.c_str(), mesh))
+				{
+				printf("%s: FAILED, the old mesh would stay\n", changed[ii].c_str());
+				failed++;
+				continue;
+				}
+			printf("%s: %u vertices, %u indices, reloaded in %.2f ms\n", changed[ii].c_str(), mesh.header->vertex_count,
+				mesh.header->index_count, seconds_since(t) * 1000.0);
+			}
+		fflush(stdout);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	return failed ? 1 : 0;
+	}
+//--------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+	{
+	if (argc >= 3 && strcmp(argv[1], "cook") == 0)		return cmd_cook(argc - 2, argv + 2);
+	if (argc >= 3 && strcmp(argv[1], "info") == 0)		return cmd_info(argc - 2, argv + 2);
+	if (argc >= 3 && strcmp(argv[1], "bench3ds") == 0)	return cmd_bench3ds(argc - 2, argv + 2);
+	if (argc >= 3 && strcmp(argv[1], "benchcmp") == 0)	return cmd_benchcmp(argc - 2, argv + 2);
+	if (argc >= 3 && strcmp(argv[1], "lods") == 0)		return cmd_lods(argc - 2, argv + 2);
+	if (argc >= 3 && strcmp(argv[1], "normals") == 0)	return cmd_normals(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "quantize") == 0)	return cmd_quantize(argc - 2, argv + 2);
+	if (argc >= 4 && strcmp(argv[1], "pack") == 0)		return cmd_pack(argc - 2, argv + 2);
+	if (argc >= 3 && strcmp(argv[1], "list") == 0)		return cmd_list(argc - 2, argv + 2);
+	if (argc >= 4 && strcmp(argv[1], "benchpack") == 0)	return cmd_benchpack(argc - 2, argv + 2);
+	if (argc >= 3 && strcmp(argv[1], "benchobj") == 0)	return cmd_benchobj(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "atlas") == 0)		return cmd_atlas(argc - 2, argv + 2);
+	if (argc >= 3 && strcmp(argv[1], "meshlets") == 0)	return cmd_meshlets(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "watch") == 0)		return cmd_watch(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "textures") == 0)	return cmd_textures(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "levelmesh") == 0)	return cmd_levelmesh(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "levels") == 0)		return cmd_levels(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "stream") == 0)		return cmd_stream(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "collide") == 0)	return cmd_collide(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "pvs") == 0)		return cmd_pvs(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "ticks") == 0)		return cmd_ticks(argc - 2, argv + 2);
+	printf("usage: assettool cook|info|bench3ds|benchcmp|lods|normals|quantize|meshlets <files...>, assettool pack|benchpack <archive> <files...>, assettool list <archive>, assettool benchobj <quads> [file], assettool atlas [images...], assettool textures [images...], assettool levelmesh|levels [level bmps...], assettool stream [level bmp] [budget MB], assettool collide, assettool pvs [level bmps...], assettool ticks [seconds], assettool watch [dir] [seconds]\n");
+	return 1;
+	}
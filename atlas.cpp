@@ -0,0 +1,151 @@
+#include "atlas.h"
+#include <stdint.h>
+#include <algorithm>
+
+//***************************************************************
+//		maxrects (jylanki): the free space is a list of maximal rectangles that may overlap each other.
+//		an image goes into the free rectangle where it leaves the smallest leftover on its short side,
+//		then every free rectangle it cuts is split into the up to 4 pieces around it.
+//***************************************************************
+struct free_rect
+	{
+	int x, y, w, h;
+	};
+static int round_up(int v, int align)
+	{
+	return align > 1 ? (v + align - 1) / align * align : v;
+	}
+static bool contains(const free_rect &a, const free_rect &b)
+	{
+	return b.x >= a.x && b.y >= a.y && b.x + b.w <= a.x + a.w && b.y + b.h <= a.y + a.h;
+	}
+static void split_free(vector<free_rect> &free, const free_rect &used)
+	{
+	size_t count = free.size();
+	for (size_t ii = 0; ii < count; ii++)
+		{
+		free_rect f = free[ii];
+		if (used.x >= f.x + f.w || used.x + used.w <= f.x || used.y >= f.y + f.h || used.y + used.h <= f.y)
+			continue;
+		if (used.x > f.x)				{ free_rect r = { f.x, f.y, used.x - f.x, f.h }; free.push_back(r); }
+		if (used.x + used.w < f.x + f.w){ free_rect r = { used.x + used.w, f.y, f.x + f.w - used.x - used.w, f.h }; free.push_back(r); }
+		if (used.y > f.y)				{ free_rect r = { f.x, f.y, f.w, used.y - f.y }; free.push_back(r); }
+		if (used.y + used.h < f.y + f.h){ free_rect r = { f.x, used.y + used.h, f.w, f.y + f.h - used.y - used.h }; free.push_back(r); }
+		free[ii].w = 0;		//cut, removed below
+		}
+	//drop the cut ones and the ones inside another
+	for (size_t ii = 0; ii < free.size(); ii++)
+		{
+		if (free[ii].w == 0) continue;
+		for (size_t jj = 0; jj < free.size(); jj++)
+			if (ii != jj && free[jj].w != 0 && contains(free[jj], free[ii]) && (!contains(free[ii], free[jj]) || jj < ii))
+				{
+				free[ii].w = 0;
+				break;
+				}
+		}
+	size_t kept = 0;
+	for (size_t ii = 0; ii < free.size(); ii++)
+		if (free[ii].w > 0 && free[ii].h > 0)
+			free[kept++] = free[ii];
+	free.resize(kept);
+	}
+static bool bigger_first(const atlas_rect *a, const atlas_rect *b)
+	{
+	int sa = std::max(a->width, a->height), sb = std::max(b->width, b->height);
+	if (sa != sb) return sa > sb;
+	return a->width * a->height > b->width * b->height;
+	}
+bool pack_atlas_fixed(vector<atlas_rect> &rects, int padding, int align, int atlas_width, int atlas_height)
+	{
+	vector<atlas_rect*> order(rects.size());
+	for (size_t ii = 0; ii < rects.size(); ii++)
+		order[ii] = &rects[ii];
+	std::stable_sort(order.begin(), order.end(), bigger_first);
+	vector<free_rect> free;
+	free_rect all = { 0, 0, atlas_width, atlas_height };
+	free.push_back(all);
+	for (size_t ii = 0; ii < order.size(); ii++)
+		{
+		atlas_rect &r = *order[ii];
+		int w = round_up(r.width + 2 * padding, align), h = round_up(r.height + 2 * padding, align);
+		int best = -1, best_short = 0, best_long = 0;
+		for (size_t f = 0; f < free.size(); f++)
+			{
+			if (w > free[f].w || h > free[f].h) continue;
+			int dw = free[f].w - w, dh = free[f].h - h;
+			int short_side = std::min(dw, dh), long_side = std::max(dw, dh);
+			if (best < 0 || short_side < best_short || (short_side == best_short && long_side < best_long))
+				{
+				best = (int)f;
+				best_short = short_side;
+				best_long = long_side;
+				}
+			}
+		if (best < 0) return false;
+		free_rect used = { free[best].x, free[best].y, w, h };
+		r.x = used.x + padding;
+		r.y = used.y + padding;
+		split_free(free, used);
+		}
+	return true;
+	}
+bool pack_atlas(vector<atlas_rect> &rects, int padding, int align, int max_size, int *atlas_width, int *atlas_height)
+	{
+	int widest = 0;
+	for (size_t ii = 0; ii < rects.size(); ii++)
+		widest = std::max(widest, round_up(rects[ii].width + 2 * padding, align));
+	if (widest == 0 || widest > max_size) return false;
+	int step = round_up(std::max(1, (max_size - widest) / 128), std::max(align, 1));
+	vector<atlas_rect> trial;
+	int64_t best_area = -1;
+	for (int w = widest; w <= max_size; w += step)
+		{
+		trial = rects;
+		if (!pack_atlas_fixed(trial, padding, align, w, max_size)) continue;
+		int h = 0;
+		for (size_t ii = 0; ii < trial.size(); ii++)
+			h = std::max(h, trial[ii].y - padding + round_up(trial[ii].height + 2 * padding, align));
+		int64_t area = (int64_t)w * h;
+		//the same area: the squarer one
+		if (best_area < 0 || area < best_area || (area == best_area && std::max(w, h) < std::max(*atlas_width, *atlas_height)))
+			{
+			best_area = area;
+			*atlas_width = w;
+			*atlas_height = h;
+			rects.swap(trial);
+			}
+		}
+	return best_area >= 0;
+	}
+float atlas_efficiency(const vector<atlas_rect> &rects, int atlas_width, int atlas_height)
+	{
+	double used = 0;
+	for (size_t ii = 0; ii < rects.size(); ii++)
+		used += (double)rects[ii].width * rects[ii].height;
+	return atlas_width > 0 && atlas_height > 0 ? (float)(used / ((double)atlas_width * atlas_height)) : 0.0f;
+	}
+bool atlas_valid(const vector<atlas_rect> &rects, int padding, int atlas_width, int atlas_height)
+	{
+	for (size_t ii = 0; ii < rects.size(); ii++)
+		{
+		const atlas_rect &a = rects[ii];
+		if (a.x - padding < 0 || a.y - padding < 0 || a.x + a.width + padding > atlas_width || a.y + a.height + padding > atlas_height)
+			return false;
+		for (size_t jj = ii + 1; jj < rects.size(); jj++)
+			{
+			const atlas_rect &b = rects[jj];
+			if (a.x - padding < b.x + b.width + padding && b.x - padding < a.x + a.width + padding &&
+				a.y - padding < b.y + b.height + padding && b.y - padding < a.y + a.height + padding)
+				return false;
+			}
+		}
+	return true;
+	}
+void atlas_uv_rect(const atlas_rect &rect, int atlas_width, int atlas_height, float result[4])
+	{
+	result[0] = rect.x / (float)atlas_width;
+	result[1] = rect.y / (float)atlas_height;
+	result[2] = rect.width / (float)atlas_width;
+	result[3] = rect.height / (float)atlas_height;
+	}
@@ -0,0 +1,43 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			texture atlas layout (maxrects, best short side fit)
+//
+//			USAGE:
+//				vector<atlas_rect> rects(3);
+//				rects[0].width = 1024; rects[0].height = 1024; ...			<- the image sizes
+//				int w, h;
+//				if (pack_atlas(rects, ATLAS_PADDING, ATLAS_PADDING, ATLAS_MAX_SIZE, &w, &h))
+//					rects[i].x, rects[i].y										<- where image i goes, the gutter is around it
+//				atlas_uv_rect(rects[i], w, h, rect);							<- uv * rect.zw + rect.xy maps into the atlas
+//
+//			every image gets padding texels of gutter on each side (texture_atlas fills them with the wrapped image,
+//			like the wrap sampler would). with align = padding the positions stay on multiples of it, so mip level k
+//			is the same layout shifted down by k as long as padding >> k is at least 1.
+//
+//			no windows.h in here, assettool builds it headless
+//
+//**********************************************************************************************************************************************
+#include <vector>
+using std::vector;
+
+#define ATLAS_PADDING		8
+#define ATLAS_MIPS			4			//mips of the atlas, the gutter is 1 texel at the smallest one
+#define ATLAS_MAX_SIZE		8192
+
+struct atlas_rect
+	{
+	int width, height;		//in
+	int x, y;				//out: top left of the image, without the gutter
+	};
+
+//tries atlas widths from the widest image up to max_size and keeps the smallest area
+bool pack_atlas(vector<atlas_rect> &rects, int padding, int align, int max_size, int *atlas_width, int *atlas_height);
+//packs into a fixed size, FALSE if something did not fit
+bool pack_atlas_fixed(vector<atlas_rect> &rects, int padding, int align, int atlas_width, int atlas_height);
+//image area / atlas area
+float atlas_efficiency(const vector<atlas_rect> &rects, int atlas_width, int atlas_height);
+//FALSE if two images (with their gutters) overlap or one sticks out
+bool atlas_valid(const vector<atlas_rect> &rects, int padding, int atlas_width, int atlas_height);
+//offset (x, y) and scale (z, w) into the atlas
+void atlas_uv_rect(const atlas_rect &rect, int atlas_width, int atlas_height, float result[4]);
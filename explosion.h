@@ -19,9 +19,11 @@
 //																			   3. argument: count of subparts of the image in y
 //																			   4. argument: lifespan in microsecond
 //
-//			STEP 5: in the render function, write this at the end BEFORE the swapchain->present() method:
+//			STEP 5: in every simulation tick, move them and let them age:
+//				explosionhandler.animate(SIM_TICK_MICRO);
+//				in the render function, write this at the end BEFORE the swapchain->present() method:
 //				g_pImmediateContext->OMSetDepthStencilState(ds_off, 1);
-//				explosionhandler.render(&view, &g_Projection, elapsed);
+//				explosionhandler.render(&view, &g_Projection);
 //				g_pImmediateContext->IASetInputLayout(g_pVertexLayout);
 //				g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
 //
@@ -54,12 +56,15 @@ class explosion_spots
 			imp = XMFLOAT3(0, 0, 0);
 			scale = 1;
 			}
-		XMMATRIX animate(long elapsed)
+		void animate(long elapsed)
 			{
 			lifespan += elapsed;
 			pos.x = pos.x + imp.x*elapsed*0.000001;
 			pos.y = pos.y + imp.y*elapsed*0.000001;
 			pos.z = pos.z + imp.z*elapsed*0.000001;
+			}
+		XMMATRIX get_matrix()
+			{
 			XMMATRIX S=XMMatrixScaling(scale, scale, scale);
 			return S*XMMatrixTranslation(pos.x, pos.y, pos.z);
 			}
@@ -75,19 +80,24 @@ class explosions_types
 			yparts = 0;
 			lifespan = 3000000;//3 seconds
 			}
-		bool get_spot(int i,long elapsed,XMMATRIX *world, int *tx, int *ty)
+		//ages the spots, the ones past their lifespan are gone
+		void animate(long elapsed)
+			{
+			for (int i = 0; i < spots.size(); i++)
+				{
+				spots[i].animate(elapsed);
+				if (spots[i].lifespan >= lifespan)
+					spots.erase(spots.begin() + i--);
+				}
+			}
+		bool get_spot(int i,XMMATRIX *world, int *tx, int *ty)
 			{
 			if (i >= spots.size())return FALSE;
 			double maxframes = (double) xparts*yparts + 0.00000001;
 			explosion_spots *ex = &spots[i];
-			*world = ex->animate(elapsed);
+			*world = ex->get_matrix();
 			long time_passed = ex->lifespan;
 			double frame = time_passed / (double)lifespan;
-			if (frame >= 1)
-				{
-				spots.erase(spots.begin() + i);
-				return TRUE;
-				}
 			double actualframe = maxframes * frame;
 			int aframe = (int)actualframe;
 			*tx = aframe % xparts;
@@ -221,15 +231,28 @@ class explosion_handler
 			}
 		HRESULT init_types(LPCWSTR file,int xparts,int yparts,long lifespan)
 			{
-			explosions_types et;
-			HRESULT hr = D3DX11CreateShaderResourceViewFromFile(Device, file, NULL, NULL, &et.texture, NULL);
+			ID3D11ShaderResourceView *texture = NULL;
+			HRESULT hr = D3DX11CreateShaderResourceViewFromFile(Device, file, NULL, NULL, &texture, NULL);
 			if (FAILED(hr))
 				return hr;
+			set_texture(add_type(xparts, yparts, lifespan), texture);
+			return S_OK;
+			}
+		//a type without texture yet, the asset_loader hands it over with set_texture when it is decoded
+		int add_type(int xparts, int yparts, long lifespan)
+			{
+			explosions_types et;
 			et.lifespan = lifespan;
 			et.xparts = xparts;
 			et.yparts = yparts;
 			exp.push_back(et);
-			return S_OK;
+			return exp.size() - 1;
+			}
+		void set_texture(int type, ID3D11ShaderResourceView *texture)
+			{
+			if (type < 0 || type >= exp.size()) return;
+			if (exp[type].texture && exp[type].texture != texture) exp[type].texture->Release();	//hot reload
+			exp[type].texture = texture;
 			}
 		void new_explosion(XMFLOAT3 position,XMFLOAT3 impulse, int type,float scale)
 			{
@@ -241,7 +264,12 @@ class explosion_handler
 			ep.scale = scale;
 			exp[type].spots.push_back(ep);
 			}
-		void render(XMMATRIX *view, XMMATRIX *projection,long elapsed)
+		void animate(long elapsed)
+			{
+			for (int ii = 0; ii < exp.size(); ii++)
+				exp[ii].animate(elapsed);
+			}
+		void render(XMMATRIX *view, XMMATRIX *projection)
 			{
 			DeviceContext->IASetInputLayout(VertexLayout);
 			UINT stride = sizeof(vertexstruct);
@@ -268,7 +296,7 @@ class explosion_handler
 					{					
 					XMMATRIX world;
 					int tx, ty;
-					if (!exp[ii].get_spot(uu, elapsed, &world, &tx, &ty)) { uu--; continue; }
+					if (!exp[ii].get_spot(uu, &world, &tx, &ty)) continue;
 					s_constantbuffer.world = XMMatrixTranspose(V*world);
 					s_constantbuffer.animation_offset.x = exp[ii].xparts;
 					s_constantbuffer.animation_offset.y = exp[ii].yparts;
@@ -0,0 +1,188 @@
+#include "file_watch.h"
+#include <chrono>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+uint64_t watch_clock_ms()
+	{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+//***************************************************************
+file_watch::file_watch()
+	{
+	settle_ms = FILE_WATCH_SETTLE_MS;
+#ifdef _WIN32
+	dir_handle = INVALID_HANDLE_VALUE;
+	overlapped = NULL;
+#else
+	fd = -1;
+#endif
+	}
+file_watch::~file_watch()
+	{
+	stop();
+	}
+void file_watch::changed(const std::string &name)
+	{
+	uint64_t now = watch_clock_ms();
+	for (size_t ii = 0; ii < pending.size(); ii++)
+		if (pending[ii].name == name)
+			{
+			pending[ii].last = now;
+			return;
+			}
+	change c;
+	c.name = name;
+	c.last = now;
+	pending.push_back(c);
+	}
+size_t file_watch::poll(vector<std::string> &result)
+	{
+	if (!is_watching()) return 0;
+	read_events();
+	uint64_t now = watch_clock_ms();
+	size_t added = 0, kept = 0;
+	for (size_t ii = 0; ii < pending.size(); ii++)
+		{
+		if (now - pending[ii].last >= (uint64_t)settle_ms)
+			{
+			result.push_back(pending[ii].name);
+			added++;
+			}
+		else
+			pending[kept++] = pending[ii];
+		}
+	pending.resize(kept);
+	return added;
+	}
+#ifdef _WIN32
+//***************************************************************
+//		one overlapped ReadDirectoryChangesW is always pending, poll picks up its result without waiting
+//***************************************************************
+bool file_watch::start(const char *directory)
+	{
+	stop();
+	dir_handle = CreateFileA(directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+		OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+	if (dir_handle == INVALID_HANDLE_VALUE) return false;
+	OVERLAPPED *ov = new OVERLAPPED;
+	ZeroMemory(ov, sizeof(OVERLAPPED));
+	ov->hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	overlapped = ov;
+	buffer.resize(16384);
+	if (!ov->hEvent || !request())
+		{
+		stop();
+		return false;
+		}
+	return true;
+	}
+bool file_watch::request()
+	{
+	OVERLAPPED *ov = (OVERLAPPED*)overlapped;
+	HANDLE event = ov->hEvent;
+	ZeroMemory(ov, sizeof(OVERLAPPED));
+	ov->hEvent = event;
+	return ReadDirectoryChangesW(dir_handle, &buffer[0], (DWORD)(buffer.size() * sizeof(uint32_t)), FALSE,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, NULL, ov, NULL) != 0;
+	}
+void file_watch::read_events()
+	{
+	DWORD bytes = 0;
+	while (GetOverlappedResult(dir_handle, (OVERLAPPED*)overlapped, &bytes, FALSE))
+		{
+		//0 bytes: the buffer overflowed, those changes are lost
+		const unsigned char *p = (const unsigned char*)&buffer[0];
+		while (bytes > 0)
+			{
+			const FILE_NOTIFY_INFORMATION *info = (const FILE_NOTIFY_INFORMATION*)p;
+			if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+				{
+				char name[MAX_PATH];
+				int len = WideCharToMultiByte(CP_ACP, 0, info->FileName, info->FileNameLength / sizeof(WCHAR), name, sizeof(name) - 1, NULL, NULL);
+				if (len > 0) changed(std::string(name, len));
+				}
+			if (!info->NextEntryOffset) break;
+			p += info->NextEntryOffset;
+			}
+		if (!request())
+			{
+			stop();
+			return;
+			}
+		}
+	}
+void file_watch::stop()
+	{
+	OVERLAPPED *ov = (OVERLAPPED*)overlapped;
+	if (dir_handle != INVALID_HANDLE_VALUE)
+		{
+		CancelIo(dir_handle);
+		if (ov && ov->hEvent)
+			{
+			DWORD bytes;
+			GetOverlappedResult(dir_handle, ov, &bytes, TRUE);	//the buffer is written until the cancel is through
+			}
+		CloseHandle(dir_handle);
+		}
+	if (ov)
+		{
+		if (ov->hEvent) CloseHandle(ov->hEvent);
+		delete ov;
+		}
+	dir_handle = INVALID_HANDLE_VALUE;
+	overlapped = NULL;
+	pending.clear();
+	}
+bool file_watch::is_watching() const
+	{
+	return dir_handle != INVALID_HANDLE_VALUE;
+	}
+#else
+//***************************************************************
+//		inotify, non blocking: poll reads what is there and returns
+//***************************************************************
+bool file_watch::start(const char *directory)
+	{
+	stop();
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0) return false;
+	//close_write: done writing, moved_to: saved over a temp file
+	if (inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+		{
+		stop();
+		return false;
+		}
+	return true;
+	}
+void file_watch::read_events()
+	{
+	alignas(inotify_event) char buffer[8192];
+	for (;;)
+		{
+		ssize_t bytes = read(fd, buffer, sizeof(buffer));
+		if (bytes <= 0) return;
+		for (char *p = buffer; p < buffer + bytes;)
+			{
+			const inotify_event *e = (const inotify_event*)p;
+			if (e->len > 0 && !(e->mask & IN_ISDIR))
+				changed(std::string(e->name));
+			p += sizeof(inotify_event) + e->len;
+			}
+		}
+	}
+void file_watch::stop()
+	{
+	if (fd >= 0) close(fd);
+	fd = -1;
+	pending.clear();
+	}
+bool file_watch::is_watching() const
+	{
+	return fd >= 0;
+	}
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			changed files in one directory (not its subdirectories), inotify on linux and ReadDirectoryChangesW on windows
+//
+//			USAGE:
+//				file_watch watch;
+//				watch.start(".");
+//				once per frame:
+//					vector<std::string> changed;
+//					watch.poll(changed);				<- names without the directory: written, created or renamed to
+//
+//			a file is reported once it had no new event for settle_ms, an editor that saves in several writes
+//			(or a copy that is still running) is one change then.
+//			no windows.h in here, so the mesh/level tools can use it headless
+//
+//**********************************************************************************************************************************************
+#include <stdint.h>
+#include <string>
+#include <vector>
+using std::vector;
+
+#define FILE_WATCH_SETTLE_MS	100
+
+class file_watch
+	{
+	private:
+		class change
+			{
+			public:
+				std::string name;
+				uint64_t last;		//ms of the latest event
+			};
+		vector<change> pending;
+#ifdef _WIN32
+		void *dir_handle;
+		void *overlapped;			//OVERLAPPED with its event
+		vector<uint32_t> buffer;	//FILE_NOTIFY_INFORMATION records, dword aligned
+		bool request();
+#else
+		int fd;
+#endif
+		void read_events();
+		void changed(const std::string &name);
+		file_watch(const file_watch&);
+		file_watch &operator=(const file_watch&);
+	public:
+		int settle_ms;
+		file_watch();
+		~file_watch();
+		bool start(const char *directory);
+		void stop();
+		bool is_watching() const;
+		size_t poll(vector<std::string> &result);		//adds to result, returns how many were added
+	};
+
+//steady milliseconds, for timing the reloads
+uint64_t watch_clock_ms();
@@ -0,0 +1,524 @@
+#include "game_sim.h"
+#include <math.h>
+#include <string.h>
+#include <chrono>
+
+//like XMMatrixRotationX / XMMatrixRotationY on a row vector
+static vec3 rotate_x(vec3 v, float angle)
+	{
+	float c = cosf(angle), s = sinf(angle);
+	return make_vec3(v.x, v.y * c - v.z * s, v.y * s + v.z * c);
+	}
+static vec3 rotate_y(vec3 v, float angle)
+	{
+	float c = cosf(angle), s = sinf(angle);
+	return make_vec3(v.x * c + v.z * s, v.y, -v.x * s + v.z * c);
+	}
+static float distance(vec3 a, vec3 b)
+	{
+	float dx = a.x - b.x;
+	float dy = a.y - b.y;
+	float dz = a.z - b.z;
+	return sqrtf((dx*dx) + (dz*dz) + (dy*dy));
+	}
+//--------------------------------------------------------------------------------------
+camera::camera()
+	{
+	w = s = a = d = q = e = 0;
+	position = previous = rotation = make_vec3(0, 0, 0);
+	impulse = impulseActual = make_vec3(0, 0, 0);
+	decayRate = .001;
+	decayDiff = 0.00001;
+	fireFoward = true;
+	}
+vec3 camera::forward() const
+	{
+	return rotate_y(rotate_x(make_vec3(0, 0, 1), -rotation.x), -rotation.y);
+	}
+void camera::animation(float elapsed_microseconds)
+	{
+	vec3 f = forward();
+	float speed = elapsed_microseconds / 100000.0;
+	//mouse click for game
+	if (w)
+		{
+		impulse.x = f.x * speed;
+		impulse.y = f.y * speed;
+		impulse.z = f.z * speed;
+		if (fireFoward)
+			{
+			impulseActual.x -= impulse.x / 4;
+			impulseActual.y -= impulse.y / 4;
+			impulseActual.z -= impulse.z / 4;
+			}
+		else
+			{
+			impulseActual.x += impulse.x / 4;
+			impulseActual.y += impulse.y / 4;
+			impulseActual.z += impulse.z / 4;
+			}
+		}
+	position.x -= impulseActual.x;
+	position.y -= impulseActual.y;
+	position.z -= impulseActual.z;
+
+	if (impulseActual.x > decayDiff)	impulseActual.x -= decayRate;
+	if (impulseActual.y > decayDiff)	impulseActual.y -= decayRate;
+	if (impulseActual.z > decayDiff)	impulseActual.z -= decayRate;
+	if (impulseActual.x < decayDiff)	impulseActual.x += decayRate;
+	if (impulseActual.y < decayDiff)	impulseActual.y += decayRate;
+	if (impulseActual.z < decayDiff)	impulseActual.z += decayRate;
+	}
+void bullet::move(float elapsed)
+	{
+	last = pos;
+	pos.x = pos.x + imp.x *(elapsed / 100000.0);
+	pos.y = pos.y + imp.y *(elapsed / 100000.0);
+	pos.z = pos.z + imp.z *(elapsed / 100000.0);
+	}
+void TrackerMine::move(float elapsed)
+	{
+	last = pos;
+	pos.x = pos.x + imp.x *(elapsed / 100000.0);
+	pos.y = pos.y + imp.y *(elapsed / 100000.0);
+	pos.z = pos.z + imp.z *(elapsed / 100000.0);
+	}
+//--------------------------------------------------------------------------------------
+game_sim::game_sim()
+	{
+	random_state = 1;
+	grid = NULL;
+	timing = false;
+	clear();
+	}
+game_sim::~game_sim()
+	{
+	clear();
+	}
+void game_sim::clear()
+	{
+	for (size_t ii = 0; ii < mines.size(); ii++)			delete mines[ii];
+	for (size_t ii = 0; ii < tracker_mines.size(); ii++)	delete tracker_mines[ii];
+	for (size_t ii = 0; ii < bullets.size(); ii++)			delete bullets[ii];
+	mines.clear();
+	tracker_mines.clear();
+	bullets.clear();
+	one_ups.clear();
+	asteroids.clear();
+	effects.clear();
+	cam = camera();
+	tracker = TrackerMine();
+	objective = make_vec3(0, 0, 0);
+	state = 0;
+	lives = 1;
+	round = 1;
+	won_round = false;
+	can_fire = true;
+	show_instructions = show_credits = false;
+	rotate_back = true;
+	reload = "";
+	cause_of_death = "";
+	fire_time = 0;
+	round_start = 0;
+	round_length = 30000;		//30 seconds
+	time_won = 0;
+	fire_delay = 200;			// in milliseconds, delay between fire(.5 seconds = 500).
+	play_field = 1000;
+	spin = 0;
+	ticks = 0;
+	memset(system_seconds, 0, sizeof(system_seconds));
+	}
+int game_sim::next_random()
+	{
+	//xorshift, the same numbers on every platform
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return (random_state >> 8) & 32767;
+	}
+float game_sim::next_frandom()
+	{
+	return next_random() / 32767.0f;
+	}
+vec3 game_sim::random_spot(int spread, int offset, float clear)
+	{
+	vec3 p;
+	p.z = next_random() % spread - offset;
+	p.x = next_random() % spread - offset;
+	p.y = next_random() % spread - offset;
+	while (p.x*p.x + p.y*p.y + p.z*p.z <= clear)
+		{
+		p.z = next_random() % 1000 - 500;
+		p.x = next_random() % 1000 - 500;
+		p.y = next_random() % 1000 - 500;
+		}
+	return p;
+	}
+void game_sim::start(uint32_t seed)
+	{
+	clear();
+	random_state = seed ? seed : 1;
+	//the asteroid field: position and size, then the rotation
+	asteroids.resize(ASTEROIDCOUNT * 2);
+	for (int ii = 0; ii < ASTEROIDCOUNT * 2; ii += 2)
+		{
+		float w = next_random() % 50 - 25;
+		vec3 p = random_spot(1000, 500, 1600);
+		sim_float4 a = { p.x, p.y, p.z, w };
+		asteroids[ii] = a;
+		}
+	for (int ii = 1; ii < ASTEROIDCOUNT * 2; ii += 2)
+		{
+		sim_float4 a;
+		a.w = (next_frandom()*2.0 - 1.0);
+		a.x = (next_frandom()*2.0 - 1.0) * 3.14159265f*2.0;
+		a.y = (next_frandom()*2.0 - 1.0) * 3.14159265f*2.0;
+		a.z = (next_frandom()*2.0 - 1.0) * 3.14159265f*2.0;
+		asteroids[ii] = a;
+		}
+	//the space station
+	objective = random_spot(1000, 500, 5000);
+	for (int ii = 0; ii < MINECOUNT; ii++)
+		mines.push_back(new Mine(random_spot(1000, 100, 1600)));
+	for (int ii = 0; ii < TRACKMINECOUNT; ii++)
+		tracker_mines.push_back(new TrackerMine(random_spot(1000, 100, 1600)));
+	for (int ii = 0; ii < ONEUPCOUNT; ii++)
+		one_ups.push_back(random_spot(1000, 100, 1600));
+	}
+//--------------------------------------------------------------------------------------
+void game_sim::sound(const char *file)
+	{
+	sim_effect e;
+	e.type = SIM_EFFECT_SOUND;
+	e.sound = file;
+	e.position = make_vec3(0, 0, 0);
+	effects.push_back(e);
+	}
+void game_sim::explosion(vec3 position)
+	{
+	sim_effect e;
+	e.type = SIM_EFFECT_EXPLOSION;
+	e.sound = NULL;
+	e.position = position;
+	effects.push_back(e);
+	}
+void game_sim::player_death(const char *cause)
+	{
+	//if player collids with mine, or astroid then -1 life. if this falls below one, the game is over
+	lives--;
+	if (lives < 1)
+		{
+		state = 3;
+		cause_of_death = cause;
+		}
+	}
+void game_sim::fire()
+	{
+	if (!can_fire || state != 2) return;
+	cam.w = 1;
+	can_fire = false;
+	fire_time = milli();	//wating before you cna fire again
+	reload = " ";			//resetting fire UI
+	bullet *b = new bullet;
+	b->pos = make_vec3(-cam.position.x, -cam.position.y - 1.2f, -cam.position.z);
+	b->last = b->pos;
+	//the camera rotation, or its inverse
+	if (cam.fireFoward)	b->imp = rotate_y(rotate_x(make_vec3(0, 0, 3), -cam.rotation.x), -cam.rotation.y);
+	else				b->imp = rotate_x(rotate_y(make_vec3(0, 0, 3), cam.rotation.y), cam.rotation.x);
+	bullets.push_back(b);
+	sound("boost.mp3");
+	}
+void game_sim::key_down(int vk)
+	{
+	switch (vk)
+		{
+		case 'Q': cam.q = 1; break;
+		case 'E': cam.e = 1; break;
+		case 'A': cam.a = 1; break;
+		case 'D': cam.d = 1; break;
+		case 'W': cam.w = 1; break;
+		case 'S': cam.s = 1; break;
+		}
+	}
+void game_sim::key_up(int vk)
+	{
+	switch (vk)
+		{
+		case 'Q': cam.q = 0; break;
+		case 'E': cam.e = 0; break;
+		case 'A': cam.a = 0; break;
+		case 'D': cam.d = 0; break;
+		case 'W': cam.w = 0; break;
+		case 'S': cam.s = 0; break;
+		case ' ':
+			if (state == 0 || state == 1 || state == 4)
+				{
+				state = 2;
+				round_start = milli();
+				}
+			if (state == 3)		//restart
+				{
+				cam.position = make_vec3(0, 0, 0);
+				cam.impulseActual = make_vec3(0, 0, 0);
+				state = 2;
+				lives = 1;
+				round_start = milli();
+				}
+			cam.fireFoward_flip();
+			break;
+		case 'I':
+			if (state == 0) state = 1;
+			break;
+		case 'C':
+			if (state == 0) state = 4;
+			break;
+		}
+	}
+void game_sim::apply(const sim_event &e)
+	{
+	switch (e.type)
+		{
+		case SIM_KEY_DOWN:	key_down(e.key); break;
+		case SIM_KEY_UP:	key_up(e.key); break;
+		case SIM_FIRE:		fire(); break;
+		case SIM_TURN:
+			cam.rotation.x += e.x;
+			cam.rotation.y += e.y;
+			break;
+		}
+	}
+//--------------------------------------------------------------------------------------
+//one SIM_TICK_MICRO of the game, the systems in the order the game always ran them
+void game_sim::tick(const vector<sim_event> &events)
+	{
+	typedef std::chrono::high_resolution_clock clock;
+	clock::time_point t0;
+	int system = SIM_SYSTEM_INPUT;
+	if (timing) t0 = clock::now();
+	//the time of what ran since the last call goes to system, what runs next is counted for next
+	auto section = [&](int next)
+		{
+		if (timing)
+			{
+			clock::time_point t1 = clock::now();
+			system_seconds[system] += std::chrono::duration<double>(t1 - t0).count();
+			t0 = t1;
+			}
+		system = next;
+		};
+
+	for (size_t ii = 0; ii < events.size(); ii++)
+		apply(events[ii]);
+	double now = milli();
+	section(SIM_SYSTEM_ROUND);
+
+	//Rotation Assist
+	spin += 0.0000003*SIM_TICK_MICRO;
+
+	//FIRE DELAY
+	if (ticks % 10 == 0 && reload.size() < 10)
+		reload += "|";
+	if (now - fire_time > fire_delay)
+		{
+		cam.w = 0;
+		can_fire = true;
+		}
+	//ROUND WON DISPLAY, for a few seconds. the round timer starts again after it
+	if (now - time_won > 7000)
+		won_round = false;
+	if (won_round)
+		round_start = now;
+	//ROUND TIMER
+	if (round_left() / 1000 < 0)
+		player_death("ran out of time");
+
+	//ANIMATION FOR INSTRUCTION SCREEN
+	if (state == 1)
+		{
+		if (cam.rotation.y < 2)	cam.rotation.y += spin / 20;
+		else					show_instructions = true;
+		}
+	if (state == 2 && rotate_back)
+		{
+		if (cam.rotation.y > 0)	cam.rotation.y -= spin / 10;
+		else					rotate_back = false;
+		}
+	if (state == 4)
+		{
+		if (cam.rotation.y < 4)	cam.rotation.y += spin / 20;
+		else					show_credits = true;
+		}
+	section(SIM_SYSTEM_SHIP);
+
+	//SHIP
+	//a sphere against the level: it stops at a wall and slides along it, the speed into the wall is gone.
+	//the camera keeps the negated world position, impulseActual is the world velocity
+	cam.previous = cam.position;
+	cam.animation(SIM_TICK_MICRO);
+	vec3 from = make_vec3(-cam.previous.x, -cam.previous.y, -cam.previous.z);
+	vec3 to = make_vec3(-cam.position.x, -cam.position.y, -cam.position.z);
+	vec3 moved, normal;
+	if (grid && grid->slide_sphere(&from.x, &to.x, CAMERA_RADIUS, &moved.x, &normal.x))
+		{
+		cam.position = make_vec3(-moved.x, -moved.y, -moved.z);
+		float into = dot(cam.impulseActual, normal);
+		if (into < 0)
+			cam.impulseActual = cam.impulseActual - normal * into;
+		}
+	section(SIM_SYSTEM_BULLETS);
+
+	for (size_t ii = 0; ii < bullets.size(); ii++)
+		bullets[ii]->move(SIM_TICK_MICRO);
+	section(SIM_SYSTEM_TRACKERS);
+
+	//the tracker mine comes in at round 2, it flies along the camera
+	if (round > 1)
+		for (size_t ii = 0; ii < tracker_mines.size(); ii++)
+			if (tracker_mines[ii]->activated)
+				{
+				tracker.imp = rotate_x(rotate_y(make_vec3(0, 0, 3), cam.rotation.y), cam.rotation.x);
+				tracker.move(SIM_TICK_MICRO);
+				}
+	section(SIM_SYSTEM_ROUND);
+
+	//Play Area
+	if (state == 2)
+		if (fabsf(cam.position.x) > play_field || fabsf(cam.position.y) > play_field || fabsf(cam.position.z) > play_field)
+			player_death("Strayed into enemy territory");
+	section(SIM_SYSTEM_MINES);
+
+	//the ship in world space
+	vec3 ship = make_vec3(-cam.position.x, -cam.position.y, -cam.position.z);
+	//mines: close by they activate and explode after MINE_FUSE_MS, running into one is death
+	for (int ii = 0; ii < (int)mines.size(); ii++)
+		{
+		float c = distance(ship, mines[ii]->pos);
+		if (mines[ii]->explode(now))
+			{
+			explosion(make_vec3((int)mines[ii]->pos.x, (int)mines[ii]->pos.y, (int)mines[ii]->pos.z));
+			sound("Rock.wav");
+			if (c < 80)
+				player_death("Was in proximity of space mine when it exploded");
+			delete mines[ii];
+			mines.erase(mines.begin() + ii--);
+			continue;
+			}
+		if (c < 80)
+			{
+			if (!mines[ii]->activated)
+				mines[ii]->activate(now);
+			if (c < 20)		//collision death
+				{
+				sound("Rock.wav");
+				explosion(mines[ii]->pos);
+				delete mines[ii];
+				mines.erase(mines.begin() + ii);
+				player_death("Ran into a mine");
+				}
+			}
+		}
+	section(SIM_SYSTEM_TRACKERS);
+
+	for (int ii = 0; ii < (int)tracker_mines.size(); ii++)
+		{
+		float c = distance(ship, tracker_mines[ii]->pos);
+		if (c < 80)
+			{
+			tracker_mines[ii]->activated = true;
+			if (c < 20)		//collision death
+				{
+				sound("Rock.wav");
+				explosion(tracker_mines[ii]->pos);
+				delete tracker_mines[ii];
+				tracker_mines.erase(tracker_mines.begin() + ii);
+				player_death("hit by a tracker mine");
+				}
+			}
+		}
+	section(SIM_SYSTEM_BULLETS);
+
+	//bullets end at the level walls: the way they moved this tick against the cells it crosses
+	if (grid)
+		for (int ii = 0; ii < (int)bullets.size(); ii++)
+			if (grid->raycast(&bullets[ii]->last.x, &bullets[ii]->pos.x, NULL))
+				{
+				delete bullets[ii];
+				bullets.erase(bullets.begin() + ii--);
+				}
+	//over 15 bullets: one goes, and every tracker mine within 100 of a bullet explodes
+	if (bullets.size() > 15)
+		{
+		delete bullets[10];
+		bullets.erase(bullets.begin() + 10);
+		for (size_t jj = 0; jj < bullets.size(); jj++)
+			for (int ii = 0; ii < (int)tracker_mines.size(); ii++)
+				if (distance(bullets[jj]->pos, tracker_mines[ii]->pos) < 100)
+					{
+					sound("Rock.wav");
+					explosion(tracker_mines[ii]->pos);
+					delete tracker_mines[ii];
+					tracker_mines.erase(tracker_mines.begin() + ii);
+					}
+		}
+	section(SIM_SYSTEM_PICKUPS);
+
+	//ONE UPS
+	for (int ii = 0; ii < (int)one_ups.size(); ii++)
+		if (distance(ship, one_ups[ii]) < 50)
+			{
+			one_ups.erase(one_ups.begin() + ii);
+			lives++;
+			}
+	section(SIM_SYSTEM_ASTEROIDS);
+
+	//ASTROIDS
+	for (int ii = 0; ii < (int)asteroids.size(); ii += 2)
+		if (distance(ship, make_vec3(asteroids[ii].x, asteroids[ii].y, asteroids[ii].z)) < 20)
+			{
+			player_death("Collided with a astroid");
+			sound("Rock.wav");
+			}
+	section(SIM_SYSTEM_ROUND);
+
+	//REACHED GOAL: a new round, the station moves
+	if (distance(ship, objective) < 50)
+		{
+		cam.impulseActual = make_vec3(0, 0, 0);
+		won_round = true;
+		round++;
+		round_length -= 100;	//every time a round is won, time limit is decreased
+		time_won = now;
+		objective = random_spot(1000, 500, 5000);
+		}
+	section(SIM_SYSTEM_INPUT);
+	ticks++;
+	}
+//--------------------------------------------------------------------------------------
+uint64_t game_sim::hash() const
+	{
+	uint64_t h = hash_bytes(&cam.position, sizeof(vec3));
+	h = hash_bytes(&cam.rotation, sizeof(vec3), h);
+	h = hash_bytes(&cam.impulseActual, sizeof(vec3), h);
+	h = hash_bytes(&tracker.pos, sizeof(vec3), h);
+	h = hash_bytes(&objective, sizeof(vec3), h);
+	for (size_t ii = 0; ii < mines.size(); ii++)
+		{
+		h = hash_bytes(&mines[ii]->pos, sizeof(vec3), h);
+		h = hash_bytes(&mines[ii]->activated, sizeof(bool), h);
+		}
+	for (size_t ii = 0; ii < tracker_mines.size(); ii++)
+		h = hash_bytes(&tracker_mines[ii]->pos, sizeof(vec3), h);
+	for (size_t ii = 0; ii < bullets.size(); ii++)
+		h = hash_bytes(&bullets[ii]->pos, sizeof(vec3), h);
+	if (one_ups.size()) h = hash_bytes(&one_ups[0], one_ups.size() * sizeof(vec3), h);
+	int numbers[4] = { state, lives, round, (int)one_ups.size() };
+	h = hash_bytes(numbers, sizeof(numbers), h);
+	h = hash_bytes(&round_length, sizeof(double), h);
+	h = hash_bytes(&ticks, sizeof(ticks), h);
+	return h;
+	}
+const char *game_sim::system_name(int system)
+	{
+	static const char *names[SIM_SYSTEMS] = { "input", "round", "ship", "bullets", "mines", "tracker mines", "one-ups", "asteroids" };
+	return system >= 0 && system < SIM_SYSTEMS ? names[system] : "?";
+	}
@@ -0,0 +1,165 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			the game without the window and the device: the ship (the camera), the mines, the tracker mines, the
+//			bullets, the one-ups, the asteroid field and the rounds, stepped in fixed ticks (sim_clock.h)
+//
+//			USAGE:
+//				game_sim game;
+//				game.start(seed);								<- asteroids, mines, one-ups and the station, placed from seed
+//				game.grid = &grid;								<- optional (level_grid.h): the ship slides along the walls, bullets end there
+//				every tick:
+//					game.tick(clock.take_events());
+//					game.effects								<- the sounds and explosions of the tick, the game plays them and clears
+//				drawing:
+//					game.cam, game.mines, game.bullets ...		<- read only
+//					lerp(game.cam.previous, game.cam.position, clock.alpha())
+//
+//			everything the game decides is in tick(), a tick is SIM_TICK_MICRO and time is counted in ticks: the same
+//			seed and the same events at the same ticks give the same game, bit for bit. it has its own random
+//			numbers, rand() is not used. timing = true adds the time of every SIM_SYSTEM_ to system_seconds.
+//
+//			no windows.h in here, simbench runs it headless
+//
+//**********************************************************************************************************************************************
+#include <string>
+#include "level_grid.h"
+#include "sim_clock.h"
+
+#define ASTEROIDCOUNT				1000
+#define MINECOUNT					50
+#define TRACKMINECOUNT				20
+#define ONEUPCOUNT					20
+#define CAMERA_RADIUS				0.4f		//the ship against the level walls
+#define MINE_FUSE_MS				10000		//simulated ms from activation to the explosion
+
+#define SIM_SYSTEM_INPUT			0
+#define SIM_SYSTEM_ROUND			1		//timers, fire delay, menu camera, play field, the goal
+#define SIM_SYSTEM_SHIP				2		//drift and the level slide
+#define SIM_SYSTEM_BULLETS			3		//moving, the level walls, the clean up
+#define SIM_SYSTEM_MINES			4
+#define SIM_SYSTEM_TRACKERS			5
+#define SIM_SYSTEM_PICKUPS			6		//one-ups
+#define SIM_SYSTEM_ASTEROIDS		7
+#define SIM_SYSTEMS					8
+
+#define SIM_EFFECT_SOUND			0
+#define SIM_EFFECT_EXPLOSION		1
+
+struct sim_effect
+	{
+	int type;				//SIM_EFFECT_
+	const char *sound;		//file name
+	vec3 position;			//of the explosion
+	};
+
+//an asteroid is two of these, like in the instance buffer: position and size, then the rotation
+struct sim_float4
+	{
+	float x, y, z, w;
+	};
+
+class camera
+	{
+	public:
+		int w, s, a, d, q, e;
+		vec3 position;		//the negated world position
+		vec3 previous;		//position before the last tick
+		vec3 rotation;
+		vec3 impulse;
+		vec3 impulseActual;	//world velocity, per tick
+		float decayRate;	// how fast impulse decays to 0.0, per tick
+		float decayDiff;	// used to tell how close to 0.0
+		bool fireFoward;	//impulse directions
+		camera();
+		void animation(float elapsed_microseconds);
+		void fireFoward_flip()	{ fireFoward = !fireFoward; }
+		vec3 getImpulse()		{ return impulseActual; }
+		vec3 forward() const;	//where it looks, in world space
+	};
+
+class bullet
+	{
+	public:
+		vec3 pos, imp;
+		vec3 last;			//pos before the last move, the segment tested against the level
+		bullet()				{ pos = imp = last = make_vec3(0, 0, 0); }
+		void move(float elapsed);
+	};
+
+class Mine
+	{
+	public:
+		vec3 pos, imp;
+		bool activated;		//flip to change textures
+		double explodedTime;	//used to determined with to explod, simulated ms
+		Mine(vec3 apos)			{ pos = apos; imp = make_vec3(0, 0, 0); activated = false; explodedTime = 0; }
+		void activate(double now_ms)	{ activated = true; explodedTime = now_ms; }
+		bool explode(double now_ms)		{ return activated && now_ms - explodedTime > MINE_FUSE_MS; }
+	};
+
+class TrackerMine
+	{
+	public:
+		vec3 pos, imp;
+		vec3 last;			//pos before the last move
+		bool activated;
+		TrackerMine()			{ pos = imp = last = make_vec3(0, 0, 0); activated = false; }
+		TrackerMine(vec3 apos)	{ pos = last = apos; imp = make_vec3(0, 0, 0); activated = false; }
+		void move(float elapsed);
+	};
+
+class game_sim
+	{
+	private:
+		uint32_t random_state;
+		int next_random();								//0..32767 like rand()
+		float next_frandom();							//0..1
+		vec3 random_spot(int spread, int offset, float clear);	//not within clear of the start
+		void apply(const sim_event &e);
+		void key_down(int vk);
+		void key_up(int vk);
+		void fire();
+		void player_death(const char *cause);
+		void sound(const char *file);
+		void explosion(vec3 position);
+		game_sim(const game_sim&);
+		game_sim &operator=(const game_sim&);
+	public:
+		camera cam;
+		vector<Mine*> mines;
+		vector<TrackerMine*> tracker_mines;
+		TrackerMine tracker;						//every activated tracker mine is drawn where this one is
+		vector<vec3> one_ups;
+		vector<bullet*> bullets;
+		vector<sim_float4> asteroids;				//ASTEROIDCOUNT * 2
+		vec3 objective;								//the space station
+		level_grid *grid;							//NULL: no level
+		int state;									//0 title screen, 1 instructions, 2 game, 3 game over, 4 credits
+		int lives;
+		int round;
+		bool won_round;
+		bool can_fire;
+		bool show_instructions, show_credits, rotate_back;
+		std::string reload;							//the fire status bar
+		std::string cause_of_death;
+		double fire_time;							//simulated ms of the last shot
+		double round_start, round_length;			//ms
+		double time_won;
+		int fire_delay;								//ms between shots
+		int play_field;								//how far the ship may go
+		float spin;									//rotation assist: menu camera, one-ups, menu ship
+		uint64_t ticks;
+		vector<sim_effect> effects;
+		bool timing;
+		double system_seconds[SIM_SYSTEMS];
+		game_sim();
+		~game_sim();
+		void start(uint32_t seed);
+		void clear();
+		void tick(const vector<sim_event> &events);
+		double milli() const			{ return sim_clock::milli(ticks); }
+		double round_left() const		{ return round_length - (milli() - round_start); }	//ms
+		uint64_t hash() const;			//of the state, runs with the same input have the same one
+		static const char *system_name(int system);
+	};
@@ -1,3 +1,4 @@
+#pragma once
 #include <windows.h>
 #include <d3d11.h>
 #include <d3dx11.h>
@@ -10,6 +11,13 @@
 #include <io.h>
 #include "resource.h"
 #include "sound.h"
+#include "mesh.h"
+#include "atlas.h"
+#include "level_mesh.h"
+#include "level_stream.h"
+#include "level_grid.h"
+#include "level_pvs.h"
+#include "game_sim.h"
 using namespace std;
 
 
@@ -27,6 +35,7 @@ class ConstantBuffer
 		ConstantBuffer()
 			{
 			info = XMFLOAT4(1, 1, 1, 1);
+			TexRect = XMFLOAT4(0, 0, 1, 1);
 			}
 	XMMATRIX World;
 	XMMATRIX View;
@@ -34,9 +43,224 @@ class ConstantBuffer
 	XMMATRIX LightView;
 	XMFLOAT4 info;
 	XMFLOAT4 CameraPos;
+	XMFLOAT4 TexRect;			//VS: uv * zw + xy, a rect of texture_atlas
 	};
 
 
+//********************************************
+//a model from Load3DS/LoadCMP: indexed, one index range per submodel
+class model
+	{
+	public:
+		ID3D11Buffer *vertexbuffer;
+		ID3D11Buffer *indexbuffer;
+		ID3D11Buffer *unpackbuffer;		//packed models only: UnpackOffset/UnpackScale for VS_packed (b1)
+		DXGI_FORMAT indexformat;
+		UINT vertex_stride;				//sizeof(SimpleVertex) or sizeof(packed_vertex)
+		int vertex_anz;
+		int index_anz;					//lod 0, the other lods sit behind it in the same index buffer
+		vector<mesh_range> ranges;
+		vector<mesh_lod> lods;
+		mesh_bounds bounds;				//model space, the whole mesh
+		vector<mesh_bounds> range_bounds;	//per range (3ds: material, else submodel)
+		vector<mesh_meshlet> meshlets;		//lod 0 in clusters, for draw_culled
+		vector<mesh_range> visible;			//draw_culled's ranges of the last call
+		vector<mesh_material> materials;	//3ds: one per range
+		vector<ID3D11ShaderResourceView*> textures;	//per material, NULL: no texture file, filled by the asset loader
+		model()
+			{
+			vertexbuffer = NULL;
+			indexbuffer = NULL;
+			unpackbuffer = NULL;
+			indexformat = DXGI_FORMAT_R16_UINT;
+			vertex_stride = sizeof(SimpleVertex);
+			vertex_anz = 0;
+			index_anz = 0;
+			ZeroMemory(&bounds, sizeof(bounds));
+			}
+		void set_buffers(ID3D11DeviceContext* ImmediateContext)
+			{
+			UINT offset = 0;
+			ImmediateContext->IASetVertexBuffers(0, 1, &vertexbuffer, &vertex_stride, &offset);
+			ImmediateContext->IASetIndexBuffer(indexbuffer, indexformat, 0);
+			if (unpackbuffer) ImmediateContext->VSSetConstantBuffers(1, 1, &unpackbuffer);
+			}
+		void draw(ID3D11DeviceContext* ImmediateContext)
+			{
+			ImmediateContext->DrawIndexed(index_anz, 0, 0);
+			}
+		//lod 0 range by range, each with its material texture (fallback where there is none), the texture is only set when it changes
+		void draw_materials(ID3D11DeviceContext* ImmediateContext, ID3D11ShaderResourceView *fallback)
+			{
+			if (ranges.empty())
+				{
+				draw(ImmediateContext);
+				return;
+				}
+			ID3D11ShaderResourceView *bound = NULL;
+			for (size_t ii = 0; ii < ranges.size(); ii++)
+				{
+				ID3D11ShaderResourceView *texture = ii < textures.size() && textures[ii] ? textures[ii] : fallback;
+				if (texture != bound || ii == 0)
+					ImmediateContext->PSSetShaderResources(0, 1, &texture);
+				bound = texture;
+				ImmediateContext->DrawIndexed(ranges[ii].index_count, ranges[ii].first_index, 0);
+				}
+			}
+		//lod 0 without the meshlets outside the frustum or facing away, in at most MESHLET_MAX_DRAWS draw calls
+		void draw_culled(ID3D11DeviceContext* ImmediateContext, const XMMATRIX &world, const XMMATRIX &view, const XMMATRIX &projection)
+			{
+			if (meshlets.empty())
+				{
+				draw(ImmediateContext);
+				return;
+				}
+			//camera and frustum into model space, the meshlets stay where they are
+			XMMATRIX worldview = world * view;
+			XMVECTOR determinant;
+			XMFLOAT4X4 inverse, m;
+			XMStoreFloat4x4(&inverse, XMMatrixInverse(&determinant, worldview));
+			XMStoreFloat4x4(&m, worldview * projection);
+			float planes[6][4], eye[3] = { inverse._41, inverse._42, inverse._43 };
+			frustum_planes(&m._11, planes);
+			visible.resize(meshlets.size());
+			//mirrored (negative scale): the winding turns around, no cone culling
+			size_t runs = cull_meshlets(&meshlets[0], meshlets.size(), eye, planes, XMVectorGetX(determinant) > 0, &visible[0]);
+			runs = merge_runs(&visible[0], runs, MESHLET_MAX_DRAWS);
+			for (size_t ii = 0; ii < runs; ii++)
+				ImmediateContext->DrawIndexed(visible[ii].index_count, visible[ii].first_index, 0);
+			}
+		//instance data for these has to start at start_instance in the instance buffer
+		void draw_lod_instanced(ID3D11DeviceContext* ImmediateContext, int lod, UINT instances, UINT start_instance)
+			{
+			if (lod < 0 || lod >= lods.size() || instances == 0) return;
+			ImmediateContext->DrawIndexedInstanced(lods[lod].index_count, instances, lods[lod].first_index, 0, start_instance);
+			}
+		void set_texture(size_t no, ID3D11ShaderResourceView *texture)
+			{
+			if (no >= textures.size()) textures.resize(no + 1, NULL);
+			if (textures[no] && textures[no] != texture) textures[no]->Release();
+			textures[no] = texture;
+			}
+		void release()
+			{
+			if (vertexbuffer)	vertexbuffer->Release();
+			if (indexbuffer)	indexbuffer->Release();
+			if (unpackbuffer)	unpackbuffer->Release();
+			vertexbuffer = indexbuffer = unpackbuffer = NULL;
+			vertex_stride = sizeof(SimpleVertex);
+			range_bounds.clear();
+			meshlets.clear();
+			for (size_t ii = 0; ii < textures.size(); ii++)
+				if (textures[ii]) textures[ii]->Release();
+			textures.clear();
+			materials.clear();
+			}
+	};
+//********************************************
+//several textures in one, put together on the gpu with the layout from pack_atlas (atlas.h).
+//the sources need the same format and at least ATLAS_MIPS mips, block compressed ones do not work (the
+//gutter is 1 texel at the last mip). the gutters get the wrapped image, the meshes' uvs have to stay in 0..1.
+class texture_atlas
+	{
+	public:
+		ID3D11Texture2D *texture;
+		ID3D11ShaderResourceView *view;
+		int width, height;
+		vector<XMFLOAT4> uv;			//per source, for ConstantBuffer::TexRect
+		texture_atlas()
+			{
+			texture = NULL;
+			view = NULL;
+			width = height = 0;
+			}
+		bool build(ID3D11Device *device, ID3D11DeviceContext *context, ID3D11ShaderResourceView **sources, int count)
+			{
+			release();
+			vector<ID3D11Texture2D*> textures(count, (ID3D11Texture2D*)NULL);
+			vector<atlas_rect> rects(count);
+			D3D11_TEXTURE2D_DESC desc, first;
+			bool ok = count > 0;
+			for (int ii = 0; ii < count && ok; ii++)
+				{
+				ID3D11Resource *resource = NULL;
+				if (sources[ii]) sources[ii]->GetResource(&resource);
+				if (!resource) { ok = false; break; }
+				ok = SUCCEEDED(resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&textures[ii]));
+				resource->Release();
+				if (!ok) break;
+				textures[ii]->GetDesc(&desc);
+				if (ii == 0) first = desc;
+				int mip_align = 1 << (ATLAS_MIPS - 1);
+				bool compressed = (desc.Format >= DXGI_FORMAT_BC1_TYPELESS && desc.Format <= DXGI_FORMAT_BC5_SNORM) ||
+					(desc.Format >= DXGI_FORMAT_BC6H_TYPELESS && desc.Format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+				ok = desc.Format == first.Format && desc.ArraySize == 1 && desc.MipLevels >= ATLAS_MIPS && !compressed &&
+					desc.Width % mip_align == 0 && desc.Height % mip_align == 0;
+				rects[ii].width = desc.Width;
+				rects[ii].height = desc.Height;
+				}
+			if (ok) ok = pack_atlas(rects, ATLAS_PADDING, ATLAS_PADDING, ATLAS_MAX_SIZE, &width, &height);
+			if (ok)
+				{
+				desc = first;
+				desc.Width = width;
+				desc.Height = height;
+				desc.MipLevels = ATLAS_MIPS;
+				desc.Usage = D3D11_USAGE_DEFAULT;
+				desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+				desc.CPUAccessFlags = 0;
+				desc.MiscFlags = 0;
+				ok = SUCCEEDED(device->CreateTexture2D(&desc, NULL, &texture)) &&
+					SUCCEEDED(device->CreateShaderResourceView(texture, NULL, &view));
+				}
+			for (int ii = 0; ii < count && ok; ii++)
+				{
+				D3D11_TEXTURE2D_DESC source_desc;
+				textures[ii]->GetDesc(&source_desc);
+				for (int mip = 0; mip < ATLAS_MIPS; mip++)
+					{
+					//the image and its 8 wrapped neighbours cut down to the gutter
+					int w = rects[ii].width >> mip, h = rects[ii].height >> mip, pad = ATLAS_PADDING >> mip;
+					int x = rects[ii].x >> mip, y = rects[ii].y >> mip;
+					for (int dy = -1; dy <= 1; dy++)
+						for (int dx = -1; dx <= 1; dx++)
+							{
+							D3D11_BOX box;
+							box.left = dx < 0 ? w - pad : 0;
+							box.right = dx > 0 ? pad : w;
+							box.top = dy < 0 ? h - pad : 0;
+							box.bottom = dy > 0 ? pad : h;
+							box.front = 0;
+							box.back = 1;
+							UINT tx = dx < 0 ? x - pad : (dx > 0 ? x + w : x);
+							UINT ty = dy < 0 ? y - pad : (dy > 0 ? y + h : y);
+							context->CopySubresourceRegion(texture, mip, tx, ty, 0, textures[ii], D3D11CalcSubresource(mip, 0, source_desc.MipLevels), &box);
+							}
+					}
+				float rect[4];
+				atlas_uv_rect(rects[ii], width, height, rect);
+				uv.push_back(XMFLOAT4(rect[0], rect[1], rect[2], rect[3]));
+				}
+			for (int ii = 0; ii < count; ii++)
+				if (textures[ii]) textures[ii]->Release();
+			if (!ok) release();
+			return ok;
+			}
+		//one bind for all the sources, then only TexRect changes
+		void set(ID3D11DeviceContext *context)
+			{
+			if (view) context->PSSetShaderResources(0, 1, &view);
+			}
+		void release()
+			{
+			if (view)		view->Release();
+			if (texture)	texture->Release();
+			view = NULL;
+			texture = NULL;
+			width = height = 0;
+			uv.clear();
+			}
+	};
 //********************************************
 //********************************************
 class StopWatchMicro_
@@ -101,68 +325,6 @@ class billboard
 			}
 	};
 
-//*****************************************
-class bitmap
-	{
-
-	public:
-		BYTE *image;
-		int array_size;
-		BITMAPFILEHEADER bmfh;
-		BITMAPINFOHEADER bmih;
-		bitmap()
-			{
-			image = NULL;
-			}
-		~bitmap()
-			{
-			if(image)
-				delete[] image;
-			array_size = 0;
-			}
-		bool read_image(char *filename)
-			{
-			ifstream bmpfile(filename, ios::in | ios::binary);
-			if (!bmpfile.is_open()) return FALSE;	// Error opening file
-			bmpfile.read((char*)&bmfh, sizeof(BITMAPFILEHEADER));
-			bmpfile.read((char*)&bmih, sizeof(BITMAPINFOHEADER));
-			bmpfile.seekg(bmfh.bfOffBits, ios::beg);
-			//make the array
-			if (image)delete[] image;
-			int size = bmih.biWidth*bmih.biHeight * 3;
-			image = new BYTE[size];//3 because red, green and blue, each one byte
-			bmpfile.read((char*)image,size);
-			array_size = size;
-			bmpfile.close();
-			check_save();
-			return TRUE;
-			}
-		BYTE get_pixel(int x, int y,int color_offset) //color_offset = 0,1 or 2 for red, green and blue
-			{
-			int array_position = x*3 + y* bmih.biWidth*3+ color_offset;
-			if (array_position >= array_size) return 0;
-			if (array_position < 0) return 0;
-			return image[array_position];
-			}
-		void check_save()
-			{
-			ofstream nbmpfile("newpic.bmp", ios::out | ios::binary);
-			if (!nbmpfile.is_open()) return;
-			nbmpfile.write((char*)&bmfh, sizeof(BITMAPFILEHEADER));
-			nbmpfile.write((char*)&bmih, sizeof(BITMAPINFOHEADER));
-			//offset:
-			int rest = bmfh.bfOffBits - sizeof(BITMAPFILEHEADER) - sizeof(BITMAPINFOHEADER);
-			if (rest > 0)
-				{
-				BYTE *r = new BYTE[rest];
-				memset(r, 0, rest);
-				nbmpfile.write((char*)&r, rest);
-				}
-			nbmpfile.write((char*)image, array_size);
-			nbmpfile.close();
-
-			}
-	};
 ////////////////////////////////////////////////////////////////////////////////
 //lets assume a wall is 10/10 big!
 #define FULLWALL 2
@@ -173,16 +335,23 @@ class wall
 		XMFLOAT3 position;
 			int texture_no;
 			int rotation; //0,1,2,3,4,5 ... facing to z, x, -z, -x, y, -y
+			int size_u, size_v;	//cells covered (merged walls), the quad is scaled and the texture repeats that often
 			wall()
 				{
 				texture_no = 0;
 				rotation = 0;
+				size_u = size_v = 1;
 				position = XMFLOAT3(0,0,0);
 				}
+			XMFLOAT4 get_texrect()
+				{
+				return XMFLOAT4(0, 0, (float)size_u, (float)size_v);
+				}
 			XMMATRIX get_matrix()
 				{
-				XMMATRIX R, T, T_offset;				
+				XMMATRIX R, T, T_offset, S;
 				R = XMMatrixIdentity();
+				S = XMMatrixScaling((float)size_u, (float)size_v, 1);
 				T_offset = XMMatrixTranslation(0, 0, -HALFWALL);
 				T = XMMatrixTranslation(position.x, position.y, position.z);
 				switch (rotation)//0,1,2,3,4,5 ... facing to z, x, -z, -x, y, -y
@@ -195,85 +364,157 @@ class wall
 						case 4: R = XMMatrixRotationX(XM_PIDIV2);	T_offset = XMMatrixTranslation(0, 0, -HALFWALL); break;
 						case 5: R = XMMatrixRotationX(-XM_PIDIV2);	T_offset = XMMatrixTranslation(0, 0, -HALFWALL); break;
 					}
-				return T_offset * R * T;
+				return S * T_offset * R * T;
 				}
 	};
 //********************************************************************************************
 class level
 	{
 	private:
-		bitmap leveldata;
 		vector<wall*> walls;						//all wall positions
 		vector<ID3D11ShaderResourceView*> textures;	//all wall textures
-		void process_level()
+		void process_level(const cooked_level &cooked)
 			{
-			//we have to get the level to the middle:
-			int x_offset = (leveldata.bmih.biWidth/2)*FULLWALL;
-
-			//lets go over each pixel without the borders!, only the inner ones
-			for (int yy = 1; yy < (leveldata.bmih.biHeight - 1);yy++)
-				for (int xx = 1; xx < (leveldata.bmih.biWidth - 1); xx++)
-					{
-					//wall information is the interface between pixels:
-					//blue to something not blue: wall. texture number = 255 - blue
-					//green only: floor. texture number = 255 - green
-					//red only: ceiling. texture number = 255 - red
-					//green and red: floor and ceiling ............
-					BYTE red, green, blue;
-
-					blue = leveldata.get_pixel(xx, yy, 0);
-					green = leveldata.get_pixel(xx, yy, 1);
-					red = leveldata.get_pixel(xx, yy, 2);
-					
-					if (blue > 0)//wall possible
-						{
-						int texno = 255 - blue;
-						BYTE left_red = leveldata.get_pixel(xx - 1, yy, 2);
-						BYTE left_green = leveldata.get_pixel(xx - 1, yy, 1);
-						BYTE right_red = leveldata.get_pixel(xx + 1, yy, 2);
-						BYTE right_green = leveldata.get_pixel(xx + 1, yy, 1);
-						BYTE top_red = leveldata.get_pixel(xx, yy+1, 2);
-						BYTE top_green = leveldata.get_pixel(xx, yy+1, 1);
-						BYTE bottom_red = leveldata.get_pixel(xx, yy-1, 2);
-						BYTE bottom_green = leveldata.get_pixel(xx, yy-1, 1);
+			//the level compiler (level_cook.cpp) did the bitmap: one face per cell side (see level_mesh.h for what the colors
+			//mean), merged with the neighbours of the same texture and rotation. a corridor is a few long quads, not hundreds
+			vector<level_face> merged(cooked.faces, cooked.faces + cooked.header->face_count);
+			cell_faces = (int)cooked.header->cell_face_count;
 
-						if (left_red>0 || left_green > 0)//to the left
-							init_wall(XMFLOAT3(xx*FULLWALL - x_offset, 0, yy*FULLWALL), 3, texno);
-						if (right_red>0 || right_green > 0)//to the right
-							init_wall(XMFLOAT3(xx*FULLWALL - x_offset, 0, yy*FULLWALL), 1, texno);
-						if (top_red>0 || top_green > 0)//to the top
-							init_wall(XMFLOAT3(xx*FULLWALL - x_offset, 0, yy*FULLWALL), 2, texno);
-						if (bottom_red>0 || bottom_green > 0)//to the bottom
-							init_wall(XMFLOAT3(xx*FULLWALL - x_offset, 0, yy*FULLWALL), 0, texno);
-						}
-					if (red > 0)//ceiling
-						{
-						int texno = 255 - red;
-						init_wall(XMFLOAT3(xx*FULLWALL - x_offset, 0,yy*FULLWALL), 5, texno);
-						}
-					if (green > 0)//floor
-						{
-						int texno = 255 - green;
-						init_wall(XMFLOAT3(xx*FULLWALL - x_offset, 0,yy*FULLWALL), 4, texno);
-						}
-					}
+			//we have to get the level to the middle:
+			int x_offset = (cooked.header->width/2)*FULLWALL;
+			for (size_t ii = 0; ii < merged.size(); ii++)
+				{
+				const level_face &f = merged[ii];
+				//the middle of the first and the last cell
+				XMFLOAT3 pos((f.x + (f.size_x - 1) * 0.5f)*FULLWALL - x_offset, 0, (f.y + (f.size_y - 1) * 0.5f)*FULLWALL);
+				wall *w = init_wall(pos, f.rotation, f.texture_no);
+				level_face_uv_size(f, &w->size_u, &w->size_v);
+				}
+			build_grid(cooked);
+			//what can be seen from each cell, in blocks. the same quads in world space, by texture and block, the buffer
+			//is made by create_batches on the device thread
+			pvs.build(grid);
+			bake_level_blocks(merged, pvs.get_blocks_x(), pvs.get_block_size(), FULLWALL, (float)x_offset, batch_vertices, batches);
+			}
+		//the cells for collision, the same placement as the faces
+		void build_grid(const cooked_level &cooked)
+			{
+			grid.cell_size = FULLWALL;
+			grid.half_height = HALFWALL;
+			grid.x_offset = (float)((cooked.header->width/2)*FULLWALL);
+			grid.build(cooked);
 			}
-		void init_wall(XMFLOAT3 pos, int rotation, int texture_no)
+		wall *init_wall(XMFLOAT3 pos, int rotation, int texture_no)
 			{
 			wall *w = new wall;
 			walls.push_back(w);
 			w->position = pos;
 			w->rotation = rotation;
 			w->texture_no = texture_no;
+			return w;
+			}
+		int cell_faces;								//walls before merging
+		vector<mesh_vertex> batch_vertices;			//from process_level, until create_batches uploads them
+		vector<level_block_batch> batches;			//one range per texture and block, by texture
+		ID3D11Buffer *batchbuffer;
+		level_stream *streamer;						//big levels: only the tiles around the camera, no walls (level_stream.h)
+		level_grid grid;							//what the camera and the bullets collide with, streamed levels too
+		level_pvs pvs;								//the blocks seen from each cell
+		vector<uint8_t> seen_blocks;				//of the camera's cell, this frame
+		//baked vertices into an immutable buffer, the cpu copy goes
+		static ID3D11Buffer *create_static_vertices(ID3D11Device *device, vector<mesh_vertex> &vertices)
+			{
+			if (vertices.empty()) return NULL;
+			D3D11_BUFFER_DESC bd;
+			ZeroMemory(&bd, sizeof(bd));
+			bd.Usage = D3D11_USAGE_IMMUTABLE;
+			bd.ByteWidth = (UINT)(vertices.size() * sizeof(SimpleVertex));
+			bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			D3D11_SUBRESOURCE_DATA InitData;
+			ZeroMemory(&InitData, sizeof(InitData));
+			InitData.pSysMem = &vertices[0];
+			ID3D11Buffer *buffer = NULL;
+			if (FAILED(device->CreateBuffer(&bd, &InitData, &buffer)))
+				return NULL;
+			vector<mesh_vertex>().swap(vertices);
+			return buffer;
 			}
 	public:
+		bool show;									//FALSE: loaded but neither drawn nor collided with, the game as it was
+		bool use_batches;							//FALSE: the old draw per wall, to compare
+		bool use_pvs;								//FALSE: every block, to compare
+		int draws;									//of the last render_level
+		double submit_ms;							//cpu time of the last render_level
+		float view_distance;						//streamed levels: tiles this far from the camera are drawn
 		level()
 			{
+			cell_faces = 0;
+			batchbuffer = NULL;
+			streamer = NULL;
+			show = FALSE;
+			use_batches = TRUE;
+			use_pvs = TRUE;
+			draws = 0;
+			submit_ms = 0;
+			view_distance = 128 * FULLWALL;
+			}
+		bool create_batches(ID3D11Device *device)
+			{
+			if (batchbuffer) batchbuffer->Release();
+			batchbuffer = create_static_vertices(device, batch_vertices);
+			return batchbuffer != NULL;
+			}
+		int get_batch_count()
+			{
+			return (int)batches.size();
+			}
+		void init(char *level_bitmap)//cooks level_bitmap.level first if it is missing or old
+			{
+			cooked_level cooked;
+			if (!load_level_cached(level_bitmap, cooked))return;
+			process_level(cooked);
+			}
+		void init(const unsigned char *cooked_data, size_t size)//a cooked .level in memory (asset pack, load_file)
+			{
+			cooked_level cooked;
+			if (!cooked.open(cooked_data, size))return;
+			process_level(cooked);
+			}
+		//instead of init: a level too big to build at once (level_streamed) is mapped, update bakes and uploads
+		//the tiles around the camera and drops the far ones. it maps the loose .level, not the pack
+		bool stream(const char *level_bitmap)
+			{
+			level_stream *s = new level_stream;
+			if (!s->open(level_bitmap))
+				{
+				delete s;
+				return FALSE;
+				}
+			s->cell_size = FULLWALL;
+			s->x_offset = (float)((s->get_width()/2)*FULLWALL);
+			s->on_evict = [](level_tile *t)
+				{
+				if (t->user) ((ID3D11Buffer*)t->user)->Release();
+				t->user = NULL;
+				};
+			s->start();
+			streamer = s;
+			build_grid(s->get_level());
+			return TRUE;
+			}
+		bool is_streamed()
+			{
+			return streamer != NULL;
 			}
-		void init(char *level_bitmap)
+		//once a frame, drawn or not: a streamed level asks for the tiles around the camera (world x, z), a tile
+		//more than view_distance so it is there before it shows, the ones that came in get their vertex buffers
+		void update(ID3D11Device *device, float x, float z)
 			{
-			if(!leveldata.read_image(level_bitmap))return;
-			process_level();
+			if (!streamer) return;
+			vector<level_tile*> ready;
+			streamer->update(x, z, view_distance + LEVEL_TILE_SIZE * FULLWALL, &ready);
+			for (size_t ii = 0; ii < ready.size(); ii++)
+				ready[ii]->user = create_static_vertices(device, ready[ii]->vertices);
 			}
 		bool init_texture(ID3D11Device* pd3dDevice,LPCWSTR filename)
 			{
@@ -285,6 +526,45 @@ class level
 			textures.push_back(texture);
 			return TRUE;
 			}
+		void set_texture(int no, ID3D11ShaderResourceView *texture)//for textures that arrive later from the asset_loader
+			{
+			if (no < 0) return;
+			if (no >= textures.size()) textures.resize(no + 1, NULL);
+			if (textures[no] && textures[no] != texture) textures[no]->Release();	//hot reload
+			textures[no] = texture;
+			}
+		void clear()
+			{
+			for (int ii = 0; ii < walls.size(); ii++)
+				delete walls[ii];
+			walls.clear();
+			cell_faces = 0;
+			batch_vertices.clear();
+			batches.clear();
+			if (batchbuffer) batchbuffer->Release();
+			batchbuffer = NULL;
+			delete streamer;
+			streamer = NULL;
+			grid.clear();
+			pvs.clear();
+			}
+		//the walls of a level read somewhere else (hot reload), the textures stay
+		void swap_walls(level &other)
+			{
+			walls.swap(other.walls);
+			std::swap(cell_faces, other.cell_faces);
+			batch_vertices.swap(other.batch_vertices);
+			batches.swap(other.batches);
+			std::swap(batchbuffer, other.batchbuffer);
+			std::swap(streamer, other.streamer);
+			grid.swap(other.grid);
+			std::swap(pvs, other.pvs);
+			}
+		//what the camera and the bullets collide with (game_sim::grid), the same object after a reload
+		level_grid *get_grid()
+			{
+			return &grid;
+			}
 		ID3D11ShaderResourceView *get_texture(int no)
 			{
 			if (no < 0 || no >= textures.size()) return NULL;
@@ -299,15 +579,88 @@ class level
 			{
 			return walls.size();
 			}
+		int get_cell_face_count()
+			{
+			return cell_faces;
+			}
+		const level_pvs &get_pvs()
+			{
+			return pvs;
+			}
 		void render_level(ID3D11DeviceContext* ImmediateContext,ID3D11Buffer *vertexbuffer_wall,XMMATRIX *view, XMMATRIX *projection, ID3D11Buffer* dx_cbuffer)
 			{
-			//set up everything for the waqlls/floors/ceilings:
+			if (!show) return;
+			StopWatchMicro_ submit;
 			UINT stride = sizeof(SimpleVertex);
 			UINT offset = 0;			
-			ImmediateContext->IASetVertexBuffers(0, 1, &vertexbuffer_wall, &stride, &offset);
 			ConstantBuffer constantbuffer;			
 			constantbuffer.View = XMMatrixTranspose(*view);
 			constantbuffer.Projection = XMMatrixTranspose(*projection);			
+			if (streamer)
+				{
+				//the tiles update() made resident
+				constantbuffer.World = XMMatrixIdentity();
+				ImmediateContext->UpdateSubresource(dx_cbuffer, 0, NULL, &constantbuffer, 0, 0);
+				ImmediateContext->VSSetConstantBuffers(0, 1, &dx_cbuffer);
+				ImmediateContext->PSSetConstantBuffers(0, 1, &dx_cbuffer);
+				const std::list<level_tile*> &tiles = streamer->get_resident();
+				for (std::list<level_tile*>::const_iterator it = tiles.begin(); it != tiles.end(); ++it)
+					{
+					ID3D11Buffer *buffer = (ID3D11Buffer*)(*it)->user;
+					if (!buffer) continue;
+					ImmediateContext->IASetVertexBuffers(0, 1, &buffer, &stride, &offset);
+					for (size_t ii = 0; ii < (*it)->batches.size(); ii++)
+						{
+						const level_batch &b = (*it)->batches[ii];
+						ID3D11ShaderResourceView* tex = get_texture(b.texture_no < textures.size() ? b.texture_no : 0);
+						ImmediateContext->PSSetShaderResources(0, 1, &tex);
+						ImmediateContext->Draw(b.vertex_count, b.first_vertex);
+						}
+					}
+				submit_ms = (double)submit.elapse_milli();
+				return;
+				}
+			if (batchbuffer && use_batches)
+				{
+				//baked in world space: one constant buffer update, then the blocks the camera's cell can see (all of them
+				//when it is outside the level or above it), a texture's visible blocks next to each other are one draw
+				constantbuffer.World = XMMatrixIdentity();
+				ImmediateContext->UpdateSubresource(dx_cbuffer, 0, NULL, &constantbuffer, 0, 0);
+				ImmediateContext->VSSetConstantBuffers(0, 1, &dx_cbuffer);
+				ImmediateContext->PSSetConstantBuffers(0, 1, &dx_cbuffer);
+				ImmediateContext->IASetVertexBuffers(0, 1, &batchbuffer, &stride, &offset);
+				bool culled = false;
+				if (use_pvs)
+					{
+					XMVECTOR det;
+					XMMATRIX inverse = XMMatrixInverse(&det, *view);
+					XMFLOAT3 eye(XMVectorGetX(inverse.r[3]), XMVectorGetY(inverse.r[3]), XMVectorGetZ(inverse.r[3]));
+					int cell_x, cell_y;
+					grid.cell_of(&eye.x, &cell_x, &cell_y);
+					culled = fabs(eye.y) <= HALFWALL && pvs.get_visible(cell_x, cell_y, seen_blocks);
+					}
+				draws = 0;
+				for (size_t ii = 0; ii < batches.size(); )
+					{
+					if (culled && !level_pvs::is_set(seen_blocks, batches[ii].block))
+						{
+						ii++;
+						continue;
+						}
+					int texture_no = batches[ii].texture_no, first = batches[ii].first_vertex, count = 0;
+					for (; ii < batches.size() && batches[ii].texture_no == texture_no && batches[ii].first_vertex == first + count &&
+						(!culled || level_pvs::is_set(seen_blocks, batches[ii].block)); ii++)
+						count += batches[ii].vertex_count;
+					ID3D11ShaderResourceView* tex = get_texture(texture_no < textures.size() ? texture_no : 0);
+					ImmediateContext->PSSetShaderResources(0, 1, &tex);
+					ImmediateContext->Draw(count, first);
+					draws++;
+					}
+				submit_ms = (double)submit.elapse_milli();
+				return;
+				}
+			//set up everything for the waqlls/floors/ceilings:
+			ImmediateContext->IASetVertexBuffers(0, 1, &vertexbuffer_wall, &stride, &offset);
 			XMMATRIX wall_matrix,S;
 			ID3D11ShaderResourceView* tex;
 			//S = XMMatrixScaling(FULLWALL, FULLWALL, FULLWALL);
@@ -316,12 +669,11 @@ class level
 				{
 				wall_matrix = walls[ii]->get_matrix();
 				int texno = walls[ii]->texture_no;
-				if (texno >= textures.size())
-					texno = 0;
-				tex = textures[texno];
+				tex = get_texture(texno < textures.size() ? texno : 0);
 				wall_matrix = wall_matrix;// *S;
 
 				constantbuffer.World = XMMatrixTranspose(wall_matrix);
+				constantbuffer.TexRect = walls[ii]->get_texrect();		//the wrap sampler tiles it once per cell
 				
 				ImmediateContext->UpdateSubresource(dx_cbuffer, 0, NULL, &constantbuffer, 0, 0);
 				ImmediateContext->VSSetConstantBuffers(0, 1, &dx_cbuffer);
@@ -329,279 +681,37 @@ class level
 				ImmediateContext->PSSetShaderResources(0, 1, &tex);
 				ImmediateContext->Draw(6, 0);
 				}
+			submit_ms = (double)submit.elapse_milli();
 			}
 	};
 
-
-
-	class camera
-		{
-		private:
-
-		public:
-			int w, s, a, d,q,e;
-			XMFLOAT3 position;
-			XMFLOAT3 rotation;
-			XMFLOAT3 impulse;
-			XMFLOAT3 impulseActual;
-			XMMATRIX Ry, Rx, T;
-
-			float decayRate; // how fast impulse decays to 0.0
-			float decayDiff; // used to tell how close to 0.0
-
-			bool fireFoward; //impulse directions
-			camera()
-				{
-				w = s = a = d = 0;
-				position = position = XMFLOAT3(0, 0, 0);
-				impulse = impulse = XMFLOAT3(0, 0, 0);
-				impulseActual = impulseActual = XMFLOAT3(0, 0, 0);
-
-				decayRate = .001;
-				decayDiff = 0.00001;
-
-				fireFoward = true;
-				}
-			void animation(float elapsed_microseconds)
-				{
-				XMMATRIX Ry,Rx, T;
-				Ry = XMMatrixRotationY(-rotation.y);
-				Rx = XMMatrixRotationX(-rotation.x);
-
-				XMFLOAT3 forward = XMFLOAT3(0, 0, 1);
-				XMVECTOR f = XMLoadFloat3(&forward);
-				f = XMVector3TransformCoord(f, Rx*Ry);
-				XMStoreFloat3(&forward, f);
-				XMFLOAT3 side = XMFLOAT3(1, 0, 0);
-				XMVECTOR si = XMLoadFloat3(&side);
-				si = XMVector3TransformCoord(si, Rx*Ry);
-				XMStoreFloat3(&side, si);
-
-				float speed = elapsed_microseconds / 100000.0;
-				//wasd method for debug
-				/*if (w)
-					{
-					position.x -= forward.x * speed;
-					position.y -= forward.y * speed;
-					position.z -= forward.z * speed;
-					}
-				if (s)
-					{
-					position.x += forward.x * speed;
-					position.y += forward.y * speed;
-					position.z += forward.z * speed;
-					}
-				if (d)
-					{
-					position.x -= side.x * 0.01;
-					position.y -= side.y * 0.01;
-					position.z -= side.z * 0.01;
-					}
-				if (a)
-					{
-					position.x += side.x * 0.01;
-					position.y += side.y * 0.01;
-					position.z += side.z * 0.01;
-					}
-					}*/
-				//mouse click for game
-				if (w) {
-					impulse.x = forward.x * speed;
-					impulse.y = forward.y * speed;
-					impulse.z = forward.z * speed;
-					if (fireFoward) {
-						impulseActual.x -= impulse.x / 4;
-						impulseActual.y -= impulse.y / 4;
-						impulseActual.z -= impulse.z / 4;
-					}
-					else {
-						impulseActual.x += impulse.x / 4;
-						impulseActual.y += impulse.y / 4;
-						impulseActual.z += impulse.z / 4;
-					}
-					//applying to current impulse
-				}
-					position.x -= impulseActual.x;
-					position.y -= impulseActual.y;
-					position.z -= impulseActual.z;
-					
-
-					if (impulseActual.x > decayDiff) {
-						impulseActual.x -= decayRate;
-					}
-
-					if (impulseActual.y >decayDiff) {
-						impulseActual.y -= decayRate;
-					}
-					if (impulseActual.z > decayDiff) {
-						impulseActual.z -= decayRate;
-					}
-
-					if (impulseActual.x <decayDiff) {
-						impulseActual.x += decayRate;
-					}
-
-					if (impulseActual.y <decayDiff) {
-						impulseActual.y += decayRate;
-					}
-					if (impulseActual.z < decayDiff) {
-						impulseActual.z += decayRate;
-					}
-
-
-
-					//TODO make impulse always decay to 0.0f (if below or below or above.
-				
-				}
-			XMMATRIX get_matrix(XMMATRIX *view)
-				{
-				XMMATRIX Rx,Ry, T;
-				Rx = XMMatrixRotationX(rotation.x);
-				Ry = XMMatrixRotationY(rotation.y);
-				T = XMMatrixTranslation(position.x, position.y, position.z);
-				return T*(*view)*Ry*Rx;
-				}
-			void fireFoward_flip() {
-				fireFoward = !fireFoward; //reserve directions
-			}
-			//used to UI impulse
-			XMFLOAT3 getImpulse() {
-				return impulseActual;
-
-			}
-		};
-
-
-
-
-	class bullet
-		{
-		public:
-			XMFLOAT3 pos, imp;
-			bullet()
-				{
-				pos = imp = XMFLOAT3(0, 0, 0);
-				}
-			XMMATRIX getmatrix(float elapsed, XMMATRIX &view)
-				{
-
-				pos.x = pos.x + imp.x *(elapsed / 100000.0);
-				pos.y = pos.y + imp.y *(elapsed / 100000.0);
-				pos.z = pos.z + imp.z *(elapsed / 100000.0);
-
-				XMMATRIX R, T;
-				R = view;
-				R._41 = R._42 = R._43 = 0.0;
-				XMVECTOR det;
-				R = XMMatrixInverse(&det, R);
-				T = XMMatrixTranslation(pos.x, pos.y, pos.z);
-
-				return R * T;
-				}
-		};
-
-
-	class Mine
-	{
-	public:
-		XMFLOAT3 pos, imp;
-		bool activated; //flip to change textures
-		float explodedTime;//used to determined with to explod.
-		Mine()
-		{
-			pos = imp = XMFLOAT3(0, 0, 0);
-			activated = false;
-			explodedTime = .0f;
-		}
-		Mine(XMFLOAT3 apos) {
-			pos = apos;
-			activated = false;
-			explodedTime = .0f;
-
-		}
-
-		XMMATRIX getmatrix(float elapsed, XMMATRIX &view)
-		{
-
-			pos.x = pos.x + imp.x *(elapsed / 100000.0);
-			pos.y = pos.y + imp.y *(elapsed / 100000.0);
-			pos.z = pos.z + imp.z *(elapsed / 100000.0);
-
-			XMMATRIX R, T;
-			R = view;
-			R._41 = R._42 = R._43 = 0.0;
-			XMVECTOR det;
-			R = XMMatrixInverse(&det, R);
-			T = XMMatrixTranslation(pos.x, pos.y, pos.z);
-
-			return R * T;
-		}
-		void activate(float elapsed) {
-			activated = true;
-			explodedTime = elapsed;
-		}
-		bool explode(float elapsed) {
-		//takes differences between activatioTime if more then 2 seconds, explods.
-			if (elapsed - explodedTime > 10000 && activated)
-				return true;
-			else
-				return false;
-		
-		}
-
-
-	};
-
-
-	class TrackerMine
-	{
-	public:
-		XMFLOAT3 pos, imp, rot;
-		bool activated;
-		TrackerMine()
+	//drawing the game_sim.h types: the view from the camera, a billboard between the last tick (alpha 0) and this one (1)
+	inline XMMATRIX camera_matrix(const camera &cam, XMMATRIX *view)
 		{
-			pos = imp = XMFLOAT3(0, 0, 0);
-			activated = false;
+		XMMATRIX Rx, Ry, T;
+		Rx = XMMatrixRotationX(cam.rotation.x);
+		Ry = XMMatrixRotationY(cam.rotation.y);
+		T = XMMatrixTranslation(cam.position.x, cam.position.y, cam.position.z);
+		return T*(*view)*Ry*Rx;
 		}
-		TrackerMine(XMFLOAT3 apos) {
-			pos = apos;
-			activated = false;
-			
-
-		}
-		XMMATRIX getmatrix(float elapsed, XMMATRIX &view)
+	inline XMMATRIX billboard_matrix(const vec3 &last, const vec3 &pos, float alpha, XMMATRIX &view)
 		{
-		
-			pos.x = pos.x + imp.x *(elapsed / 100000.0);
-			pos.y = pos.y + imp.y *(elapsed / 100000.0);
-			pos.z = pos.z + imp.z *(elapsed / 100000.0);
-
-			XMMATRIX R, T;
-			R = view;
-			R._41 = R._42 = R._43 = 0.0;
-			XMVECTOR det;
-			R = XMMatrixInverse(&det, R);
-			T = XMMatrixTranslation(pos.x, pos.y, pos.z);
-
-			return R * T;
-		}
-		void animate(XMFLOAT3 g, float elapsed_microseconds) {
-			XMMATRIX Ry, Rx, T;
-			
-			pos.x -= imp.x / 1000;
-			pos.y -= imp.y / 1000;
-			pos.z -= imp.z / 1000;
-
+		XMMATRIX R, T;
+		R = view;
+		R._41 = R._42 = R._43 = 0.0;
+		XMVECTOR det;
+		R = XMMatrixInverse(&det, R);
+		T = XMMatrixTranslation(last.x + (pos.x - last.x) * alpha, last.y + (pos.y - last.y) * alpha, last.z + (pos.z - last.z) * alpha);
+		return R * T;
 		}
 
-
-	};
-
 	float Vec3Length(const XMFLOAT3 &v);
 	float Vec3Dot(XMFLOAT3 a, XMFLOAT3 b);
 	XMFLOAT3 Vec3Cross(XMFLOAT3 a, XMFLOAT3 b);
 	XMFLOAT3 Vec3Normalize(const  XMFLOAT3 &a);
 	XMFLOAT3 operator+(const XMFLOAT3 lhs, const XMFLOAT3 rhs);
 	XMFLOAT3 operator-(const XMFLOAT3 lhs, const XMFLOAT3 rhs);
-	bool Load3DS(char *filename, ID3D11Device* g_pd3dDevice, ID3D11Buffer **ppVertexBuffer, int *vertex_count);
-	bool LoadCMP(LPCTSTR filename, ID3D11Device* g_pd3dDevice, ID3D11Buffer **ppVertexBuffer, int *vertex_count);
\ No newline at end of file
+	bool Load3DS(char *filename, ID3D11Device* g_pd3dDevice, model *m);
+	bool LoadCMP(LPCTSTR filename, ID3D11Device* g_pd3dDevice, model *m);
+	bool LoadOBJ(char *filename, ID3D11Device* g_pd3dDevice, model *m);
+	bool CreateModel(ID3D11Device* g_pd3dDevice, const cooked_mesh &mesh, model *m, bool packed = FALSE);	//the device side of Load3DS/LoadCMP
\ No newline at end of file
@@ -10,6 +10,7 @@
 //--------------------------------------------------------------------------------------
 #include "render_to_texture.h"
 #include "Font.h"
+#include "asset_loader.h"
 
 
 CXBOXController *gamepad = NULL;
@@ -44,6 +45,8 @@ ID3D11PixelShader*                  g_pPixelShader_screen = NULL;
 ID3D11PixelShader*                  PSdepth = NULL;
 
 ID3D11InputLayout*                  g_pVertexLayout = NULL;
+ID3D11VertexShader*                 g_pVertexShader_packed = NULL;
+ID3D11InputLayout*                  g_pVertexLayout_packed = NULL;
 ID3D11Buffer*                       g_pVertexBuffer = NULL;
 ID3D11Buffer*                       g_pVertexBuffer_screen = NULL;
 ID3D11Buffer*                       g_pVertexBuffer_sky = NULL;
@@ -55,11 +58,10 @@ int									model_vertex_anz = 0;
 //-----------------------------------------------------------------------------------
 
 //astroid
-ID3D11Buffer*                       g_pVertexBuffer_3ds_asteroids = NULL;
-int									model_vertex_anz_asteroids = 0;
+model								model_asteroids;
 ID3D11ShaderResourceView*           g_pTexture_asteroid = NULL;
-#define ASTEROIDCOUNT				1000
-XMFLOAT4 asteroid_pos[2000];
+XMFLOAT4 asteroid_pos[ASTEROIDCOUNT * 2];	//game.asteroids, for the instance buffer and the LOD buckets
+#define ASTEROID_LOD_PIXELS			1.0f	//how far (in pixels) a LOD may be off before the finer one is used
 
 //instance Rendering
 ID3D11VertexShader*                 g_pInstanceShader = NULL;
@@ -68,28 +70,23 @@ ID3D11Buffer*                       g_pInstancebuffer = NULL;
 
 
 //navigation arrow
-ID3D11Buffer*                       g_pVertexBuffer_3ds_nav = NULL;
-int									model_vertex_anz_nav = 0;
+model								model_nav;
 
 //space mine
-ID3D11Buffer*                       g_pVertexBuffer_3ds_mine = NULL;
-int									model_vertex_anz_mine = 0;
+model								model_mine;
 
 // Sky Sphere
-ID3D11Buffer*						g_pVertexBuffer_cmp;
-int									model_vertex_anz_sky;
+model								model_sky;
 ID3D11ShaderResourceView*           g_pTexture_sky = NULL;
 
 //small ship
-ID3D11Buffer*                       g_pVertexBuffer_3ds_ship = NULL;
-int									model_vertex_anz_ship = 0;
+model								model_ship;
 ID3D11ShaderResourceView*           g_pTexture_small_ship = NULL;
 ID3D11ShaderResourceView*           g_pTexture_small_ship_oneup = NULL;
 
 
 //Space Station
-ID3D11Buffer*						g_pVertexBuffer_ss;
-int									model_vertex_anz_ss;
+model								model_ss;
 ID3D11ShaderResourceView*           g_pTexture_ss = NULL;
 
 
@@ -113,6 +110,12 @@ ID3D11ShaderResourceView*           g_pTextureNav = NULL; //nav arrow
 ID3D11ShaderResourceView*           g_pTextureMine = NULL; 
 ID3D11ShaderResourceView*           g_pTextureMineActivated = NULL;
 ID3D11ShaderResourceView*           g_pTextureTrackerMine = NULL;
+//mines and one-ups draw from one atlas of these, in this order
+#define ATLAS_MINE							0
+#define ATLAS_MINE_ACTIVATED				1
+#define ATLAS_TRACKERMINE					2
+#define ATLAS_ONEUP							3
+texture_atlas						entity_atlas;
 
 ID3D11ShaderResourceView*           g_pTextureBGMars = NULL; //background planet
 
@@ -129,69 +132,35 @@ XMMATRIX                            g_View;
 XMMATRIX                            g_Projection;
 XMFLOAT4                            g_vMeshColor( 0.7f, 0.7f, 0.7f, 1.0f );
 
-camera								cam;
 level								level1;
+level								level_loading;		//level.bmp is read into this one first
 vector<billboard*>					smokeray;
 XMFLOAT3							rocket_position;
 
 
-//Mines
-#define MINECOUNT					50
-vector<Mine*>						StationaryMines;
-
-//Mines
-#define TRACKMINECOUNT					20
-vector<TrackerMine*>				trackerMines;
-
-//One Ups
-vector<XMFLOAT3*>					oneUps;
-//rail gun
-vector<bullet*>						bullets;
-XMFLOAT3							bullet_position;
-
-
-//movment variables
-
-static StopWatchMicro_				fireTimer;
-bool								fireFoward = true; //used to switch movment dictions, true = shoot forward, fly backwards, false, = reverse 
-bool								canFire = true;
-
-//round timer
-
-static StopWatchMicro_				roundTimer;
-float								roundLength = 30000.0f;//30 seconds
-
-
-
-// globals for game balance
-XMFLOAT3							objectivePos;//used to nav arrow to point to object cords
-
-int									fireDelay = 200; // in milliseconds, delay between fire(.5 seconds = 500).
-int									fireReserveDelay = 200; // in milliseconds, delay between switching fire directions(.5 seconds = 500).
-int									playerLives;
-int									playField = 1000;//used to determine how far the player can go. 
-int									roundNumber = 1;
-bool								wonRound = false;
-float								timeWon;
-
+//The game: everything that moves or decides, SIM_TICK_HZ fixed ticks (game_sim.h). the Render_ functions only draw it
+game_sim							game;
 
 //Font
 Font								font;
-string								reload = "";
 
 //Sound
 music_								sound;
 
-//lazy UI
-bool displayInstruct = false;
-bool displayCredots = false;
-bool rotateback = true;
-string causeOfDeath;
+explosion_handler  explosionhandler;
+
+//the window messages become events for the next tick
+sim_clock							sim;
 
-//GAME STATE 
-int									gamestate; //used to swtich game states 0 == title screen, 1 == instructions, 2 == game, 3 == game over, 4 == instructions
+//Loading: models and textures come in on worker threads, the title screen only waits for the sky and the font
+#define PARALLEL_LOADING					TRUE
+#define HOT_RELOAD							TRUE		//changed models, textures and the level in the working directory are loaded again while running
+#define ASSET_PACK							"assets.pak"		//assettool pack assets.pak <files...>, models and textures come from there if it exists
+asset_loader						loader;
+static StopWatchMicro_				startupTimer;
 
-explosion_handler  explosionhandler;
+//Packed vertices: sky and asteroids as packed_vertex (16 instead of 32 bytes), asteroid instances as packed_instance (12 instead of 32)
+#define PACKED_VERTICES						TRUE
 
 
 
@@ -204,30 +173,7 @@ HRESULT InitDevice();
 void CleanupDevice();
 LRESULT CALLBACK    WndProc( HWND, UINT, WPARAM, LPARAM );
 void Render();
-
-//--------------------------------------------------------------------------------------
-// Extras
-//--------------------------------------------------------------------------------------
-float frand()
-{
-	int r = rand();
-	float res = (float)r / (float)RAND_MAX;
-	return res;
-}
-void playerDeath(string cause) {
-	//if player collids with mine, or astroid then -1 life. functions checks if this fall below zero, if so ends game. TODO change to change game state.
-	playerLives--;
-	if (playerLives < 1) {
-		gamestate = 3;
-		causeOfDeath = cause;
-	}
-	return;
-}
-void increaseDiffulty(){
-	//every time a round is won, time limit is decreased, 
-	roundLength -= 100;
-
-}
+void entity_texture(ConstantBuffer &constantbuffer, int atlas_index, ID3D11ShaderResourceView *texture);
 
 //--------------------------------------------------------------------------------------
 // Entry point to the program. Initializes everything and goes into a message processing 
@@ -237,6 +183,7 @@ int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdL
 {
     UNREFERENCED_PARAMETER( hPrevInstance );
     UNREFERENCED_PARAMETER( lpCmdLine );
+	startupTimer.start();
 
     if( FAILED( InitWindow( hInstance, nCmdShow ) ) )
         return 0;
@@ -530,8 +477,35 @@ HRESULT InitDevice()
     // Set the input layout
     g_pImmediateContext->IASetInputLayout( g_pVertexLayout );
 
+	//packed models
+	pVSBlob = NULL;
+	hr = CompileShaderFromFile(L"shader.fx", "VS_packed", "vs_4_0", &pVSBlob);
+	if (FAILED(hr))
+		{
+		MessageBox(NULL,
+				   L"The FX file cannot be compiled.  Please run this executable from the directory that contains the FX file.", L"Error", MB_OK);
+		return hr;
+		}
+	hr = g_pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), NULL, &g_pVertexShader_packed);
+	if (FAILED(hr))
+		{
+		pVSBlob->Release();
+		return hr;
+		}
+	D3D11_INPUT_ELEMENT_DESC layoutPacked[] =
+		{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		};
+	hr = g_pd3dDevice->CreateInputLayout(layoutPacked, ARRAYSIZE(layoutPacked), pVSBlob->GetBufferPointer(),
+		pVSBlob->GetBufferSize(), &g_pVertexLayout_packed);
+	pVSBlob->Release();
+	if (FAILED(hr))
+		return hr;
+
 	pVSBlob = NULL;
-	hr = CompileShaderFromFile(L"shader.fx", "VS_instance", "vs_4_0", &pVSBlob);
+	hr = CompileShaderFromFile(L"shader.fx", PACKED_VERTICES ? "VS_instance_packed" : "VS_instance", "vs_4_0", &pVSBlob);
 	if (FAILED(hr))
 	{
 		MessageBox(NULL,
@@ -559,10 +533,22 @@ HRESULT InitDevice()
 
 	};
 	numElements = ARRAYSIZE(layoutInstance);
+	D3D11_INPUT_ELEMENT_DESC layoutInstancePacked[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "INSTANCEVEC", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "ROTATEINST", 0, DXGI_FORMAT_R8G8B8A8_SNORM, 1, 8, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
 
 	// Create the input layout
-	hr = g_pd3dDevice->CreateInputLayout(layoutInstance, numElements, pVSBlob->GetBufferPointer(),
-		pVSBlob->GetBufferSize(), &g_pInstanceLayout);
+	if (PACKED_VERTICES)
+		hr = g_pd3dDevice->CreateInputLayout(layoutInstancePacked, ARRAYSIZE(layoutInstancePacked), pVSBlob->GetBufferPointer(),
+			pVSBlob->GetBufferSize(), &g_pInstanceLayout);
+	else
+		hr = g_pd3dDevice->CreateInputLayout(layoutInstance, numElements, pVSBlob->GetBufferPointer(),
+			pVSBlob->GetBufferSize(), &g_pInstanceLayout);
 	pVSBlob->Release();
 	if (FAILED(hr))
 		return hr;
@@ -572,124 +558,21 @@ HRESULT InitDevice()
 
 	
 
-	for (int ii = 0; ii < ASTEROIDCOUNT * 2; ii += 2)
-	{
-		float x, y, z, w;
-		w = rand() % 50 - 25;
-		z = rand() % 1000 - 500;
-		x = rand() % 1000 - 500;
-		y = rand() % 1000 - 500;
-		while (x*x+y*y+z*z <= 1600)
-		{
-			z = rand() % 1000 - 500;
-			x = rand() % 1000 - 500;
-			y = rand() % 1000 - 500;
-		}
-		asteroid_pos[ii] = XMFLOAT4(x, y, z, w);
-	}
-	for (int ii = 1; ii < ASTEROIDCOUNT * 2; ii += 2)
-	{
-		float x, y, z, w;
-		w = (frand()*2.0 - 1.0);
-		x = (frand()*2.0 - 1.0) * XM_PI*2.0;
-		y = (frand()*2.0 - 1.0) * XM_PI*2.0;
-		z = (frand()*2.0 - 1.0) * XM_PI*2.0;
-		asteroid_pos[ii] = XMFLOAT4(x, y, z, w);
-	}
-
-	//setting Space Station
-	float px, py, pz;
-	px = rand() % 1000 - 500;
-	py = rand() % 1000 - 500;
-	pz = rand() % 1000 - 500;
-
-	while (px*px + py*py + pz*pz <= 5000)
-	{
-		pz = rand() % 1000 - 500;
-		px = rand() % 1000 - 500;
-		py = rand() % 1000 - 500;
-		//TODO add to objectivePos
-		while (px*px + py*py + pz*pz <= 1600)
-		{
-			pz = rand() % 1000 - 500;
-			px = rand() % 1000 - 500;
-			py = rand() % 1000 - 500;
-		}
-
-	}
-	
-	objectivePos = XMFLOAT3(px, py, pz);
-
-	//randomizing the mine position
-	Mine * tm;
-	for (int ii = 0; ii < MINECOUNT; ii++) {
-		float x, y, z, w;
-		z = rand() % 1000 - 100;
-		x = rand() % 1000 - 100;
-		y = rand() % 1000 - 100;
-
-		while (x*x + y*y + z*z <= 1600)
-		{
-			z = rand() % 1000 - 500;
-			x = rand() % 1000 - 500;
-			y = rand() % 1000 - 500;
-		}
-
-		tm = new Mine(XMFLOAT3(x, y, z));
-
-		StationaryMines.push_back(tm);
-
-	}
-	//randomizing the tracker mine position
-	TrackerMine * tm2;
-	for (int ii = 0; ii < TRACKMINECOUNT; ii++) {
-		float x, y, z, w;
-		z = rand() % 1000 - 100;
-		x = rand() % 1000 - 100;
-		y = rand() % 1000 - 100;
-
-		while (x*x + y*y + z*z <= 1600)
-		{
-			z = rand() % 1000 - 500;
-			x = rand() % 1000 - 500;
-			y = rand() % 1000 - 500;
-		}
-
-		tm2 = new TrackerMine(XMFLOAT3(x, y, z));
-
-		trackerMines.push_back(tm2);
-
-	}
-
-	//randomizing the one ups
-	XMFLOAT3* ps;
-	for (int i = 0; i < 20; i++) {
-		float x, y, z;
-		z = rand() % 1000 - 100;
-		x = rand() % 1000 - 100;
-		y = rand() % 1000 - 100;
-
-		while (x*x + y*y + z*z <= 1600)
-		{
-			z = rand() % 1000 - 500;
-			x = rand() % 1000 - 500;
-			y = rand() % 1000 - 500;
-		}
-
-		ps = new XMFLOAT3(x, y, z);
-		oneUps.push_back(ps);
-
-	}
+	//the asteroids, the station, the mines and the one-ups: placed by the game, the asteroids copied once for the drawing
+	game.start((uint32_t)time(0));
+	memcpy(asteroid_pos, &game.asteroids[0], sizeof(asteroid_pos));
 
 	D3D11_BUFFER_DESC bd;
 	D3D11_SUBRESOURCE_DATA InitData;
+	static packed_instance asteroid_packed[ASTEROIDCOUNT];
+	pack_instances(&asteroid_pos[0].x, ASTEROIDCOUNT, PACKED_INSTANCE_RANGE, asteroid_packed);
 	ZeroMemory(&bd, sizeof(bd));
 	bd.Usage = D3D11_USAGE_DYNAMIC;
-	bd.ByteWidth = sizeof(XMFLOAT4)* ASTEROIDCOUNT * 2;
+	bd.ByteWidth = PACKED_VERTICES ? sizeof(packed_instance) * ASTEROIDCOUNT : sizeof(XMFLOAT4)* ASTEROIDCOUNT * 2;
 	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = (BYTE*)asteroid_pos;
+	InitData.pSysMem = PACKED_VERTICES ? (BYTE*)asteroid_packed : (BYTE*)asteroid_pos;
 	hr = g_pd3dDevice->CreateBuffer(&bd, &InitData, &g_pInstancebuffer);
 	if (FAILED(hr))
 		return hr;
@@ -777,24 +660,38 @@ HRESULT InitDevice()
 	
     ZeroMemory( &bd, sizeof(bd) );
    
-	//load model 3ds file
+	//load models and textures, the sky sphere first: the title screen waits for it
+	loader.pack.open(ASSET_PACK);				//no archive: loose files
+	loader.start(g_pd3dDevice, PARALLEL_LOADING);
+	if (HOT_RELOAD) loader.watch(".");
+	asset_handle sky = loader.load_model("ccsphere.cmp", &model_sky, PACKED_VERTICES);
+	asset_handle sky_texture = loader.load_texture(L"space.png", &g_pTexture_sky);
 
-	Load3DS("asteroid.3ds", g_pd3dDevice, &g_pVertexBuffer_3ds_asteroids, &model_vertex_anz_asteroids);
+	//load model 3ds file
+	loader.load_model("asteroid.3ds", &model_asteroids, PACKED_VERTICES);
 	
 	//loading nav arrow
-	Load3DS("nav_arrow.3ds", g_pd3dDevice, &g_pVertexBuffer_3ds_nav, &model_vertex_anz_nav);
+	loader.load_model("nav_arrow.3ds", &model_nav);
 
 	//Load Small ship for Ones and Title screen
-	Load3DS("SpaceCraft.3ds", g_pd3dDevice, &g_pVertexBuffer_3ds_ship, &model_vertex_anz_ship);
+	loader.load_model("SpaceCraft.3ds", &model_ship);
 
 	//Loa space mines
-	Load3DS("mine.3ds", g_pd3dDevice, &g_pVertexBuffer_3ds_mine, &model_vertex_anz_mine);
-
-	//Load Sky Sphere
-	LoadCMP(L"ccsphere.cmp", g_pd3dDevice, &g_pVertexBuffer_cmp, &model_vertex_anz_sky);
+	loader.load_model("mine.3ds", &model_mine);
 
 	//Load space station
-	LoadCMP(L"planet.cmp", g_pd3dDevice, &g_pVertexBuffer_ss, &model_vertex_anz_ss);
+	loader.load_model("planet.cmp", &model_ss);
+
+	// Load the Textures
+	loader.load_texture(L"asteroid_1.png", &g_pTexture_asteroid);
+	loader.load_texture(L"nav_arrow_tex.png", &g_pTextureNav);	// nav arrow
+	loader.load_texture(L"ds.png", &g_pTexture_ss);					// ds
+	loader.load_texture(L"color_0.jpg", &g_pTexture_small_ship);	// small ship
+	loader.load_texture(L"oneUp_tex.png", &g_pTexture_small_ship_oneup);	// small ship one ups
+	loader.load_texture(L"minetex.png", &g_pTextureMine);			// mine
+	loader.load_texture(L"minetexactive.png", &g_pTextureMineActivated);	// mine activated
+	loader.load_texture(L"trackerminetex.png", &g_pTextureTrackerMine);	// trackermine
+	loader.load_texture(L"mars.jpg", &g_pTextureBGMars);			// background planet 1
 
 	
 	 
@@ -817,50 +714,6 @@ HRESULT InitDevice()
         return hr;
     
 
-    // Load the Texture
-    hr = D3DX11CreateShaderResourceViewFromFile( g_pd3dDevice, L"asteroid_1.png", NULL, NULL, &g_pTexture_asteroid, NULL );
-    if( FAILED( hr ) )
-        return hr;
-
-	// Load the Texture
-	hr = D3DX11CreateShaderResourceViewFromFile(g_pd3dDevice, L"space.png", NULL, NULL, &g_pTexture_sky, NULL);
-	if (FAILED(hr))
-		return hr;
-
-	// Load the nav arrow
-	hr = D3DX11CreateShaderResourceViewFromFile(g_pd3dDevice, L"nav_arrow_tex.png", NULL, NULL, &g_pTextureNav, NULL);
-	if (FAILED(hr))
-		return hr;
-
-	// Textureing for ds
-	hr = D3DX11CreateShaderResourceViewFromFile(g_pd3dDevice, L"ds.png", NULL, NULL, &g_pTexture_ss, NULL);
-	if (FAILED(hr))
-		return hr;
-	// Textureing for small ship
-	hr = D3DX11CreateShaderResourceViewFromFile(g_pd3dDevice, L"color_0.jpg", NULL, NULL, &g_pTexture_small_ship, NULL); 
-	if (FAILED(hr))
-		return hr;
-	// Textureing for small ship one ups
-	hr = D3DX11CreateShaderResourceViewFromFile(g_pd3dDevice, L"oneUp_tex.png", NULL, NULL, &g_pTexture_small_ship_oneup, NULL); 
-		if (FAILED(hr))
-			return hr;
-	// Textureing for mine
-	hr = D3DX11CreateShaderResourceViewFromFile(g_pd3dDevice, L"minetex.png", NULL, NULL, &g_pTextureMine, NULL);
-		if (FAILED(hr))
-			return hr;
-	// Textureing for mine activated
-	hr = D3DX11CreateShaderResourceViewFromFile(g_pd3dDevice, L"minetexactive.png", NULL, NULL, &g_pTextureMineActivated, NULL);
-	if (FAILED(hr))
-		return hr;
-	// Textureing for trackermine
-	hr = D3DX11CreateShaderResourceViewFromFile(g_pd3dDevice, L"trackerminetex.png", NULL, NULL, &g_pTextureTrackerMine, NULL);
-	if (FAILED(hr))
-		return hr;
-	// Texture for background planet 1
-	hr = D3DX11CreateShaderResourceViewFromFile(g_pd3dDevice, L"mars.jpg", NULL, NULL, &g_pTextureBGMars, NULL);
-	if (FAILED(hr))
-		return hr;
-
 
     // Create the sample state
     D3D11_SAMPLER_DESC sampDesc;
@@ -955,17 +808,40 @@ HRESULT InitDevice()
 	g_pd3dDevice->CreateDepthStencilState(&DS_ON, &ds_on);
 	g_pd3dDevice->CreateDepthStencilState(&DS_OFF, &ds_off);
 
-	level1.init("level.bmp");
-	level1.init_texture(g_pd3dDevice, L"wall1.jpg");
-	level1.init_texture(g_pd3dDevice, L"wall2.jpg");
-	level1.init_texture(g_pd3dDevice, L"floor.jpg");
-	level1.init_texture(g_pd3dDevice, L"ceiling.jpg");
+	//read into level_loading on a worker, swapped in on the main thread: the same for the hot reload.
+	//the bitmap is compiled to level.bmp.level once (again when it changes), the worker only maps that
+	loader.load_file("level.bmp", [](const asset_span &cooked)
+		{
+		level_loading.clear();
+		//a huge level is streamed in tiles from the loose .level, built at once when that is not there
+		if (level_streamed(cooked.data, cooked.size) && level_loading.stream("level.bmp"))
+			return true;
+		level_loading.init(cooked.data, cooked.size);
+		return level_loading.get_wall_count() > 0;
+		},
+		[]()
+		{
+		level1.swap_walls(level_loading);
+		level_loading.clear();
+		level1.create_batches(g_pd3dDevice);
+		//the ship and the bullets collide with the level only while it is drawn (level::show, the l key)
+		game.grid = level1.show ? level1.get_grid() : NULL;
+		char report[192];
+		const level_pvs &pvs = level1.get_pvs();
+		sprintf_s(report, "level: %d cell faces merged into %d quads, %d block ranges, pvs %.1f ms, %.1f of %d blocks seen on average\n",
+			level1.get_cell_face_count(), level1.get_wall_count(), level1.get_batch_count(), pvs.build_seconds * 1000.0, pvs.visible_blocks,
+			pvs.get_blocks_x() * pvs.get_blocks_y());
+		if (level1.is_streamed())
+			sprintf_s(report, "level: streamed in tiles of %dx%d cells\n", LEVEL_TILE_SIZE, LEVEL_TILE_SIZE);
+		OutputDebugStringA(report);
+		}, cooked_level_name, level_cached);
+	loader.load_texture(L"wall1.jpg", [](ID3D11ShaderResourceView *t) { level1.set_texture(0, t); });
+	loader.load_texture(L"wall2.jpg", [](ID3D11ShaderResourceView *t) { level1.set_texture(1, t); });
+	loader.load_texture(L"floor.jpg", [](ID3D11ShaderResourceView *t) { level1.set_texture(2, t); });
+	loader.load_texture(L"ceiling.jpg", [](ID3D11ShaderResourceView *t) { level1.set_texture(3, t); });
 	
 	rocket_position = XMFLOAT3(0, 0, ROCKETRADIUS);
 
-	// fire limiter
-	fireTimer.start();//starting timer
-	
 	//font stuff
 	font.init(g_pd3dDevice, g_pImmediateContext, font.defaultFontMapDesc);
 
@@ -990,24 +866,25 @@ HRESULT InitDevice()
 	g_pd3dDevice->CreateRasterizerState(&RS_CW, &rs_CW);
 
 	//rendertarget texture
-	RenderToTexture.Initialize(g_pd3dDevice, g_hWnd, -1, -1, FALSE, DXGI_FORMAT_R8G8B8A8_UNORM, TRUE);
+	RenderToTexture.Initialize(g_pd3dDevice, g_hWnd, -1, -1, FALSE, DXGI_FORMAT_R8G8B8A8_UNORM, FALSE);	//both are read at mip 0 only, no GenerateMips per frame
 
-	DepthLight.Initialize(g_pd3dDevice, g_hWnd, -2, -1, FALSE, DXGI_FORMAT_R32G32B32A32_FLOAT, TRUE);
+	DepthLight.Initialize(g_pd3dDevice, g_hWnd, -2, -1, FALSE, DXGI_FORMAT_R32G32B32A32_FLOAT, FALSE);
 
 
 	hr=explosionhandler.init(g_pd3dDevice, g_pImmediateContext);
 	if (FAILED(hr))
 		return hr;
-	hr = explosionhandler.init_types(L"exp1.dds", 8, 8,1000000);
-	if (FAILED(hr))
-		return hr;
-	hr = explosionhandler.init_types(L"exp2.dds", 9, 9,1500000);
-	if (FAILED(hr))
-		return hr;
-
-	//global vars for gameplay
-	gamestate = 0;
-	playerLives = 1;
+	int exp1 = explosionhandler.add_type(8, 8, 1000000);
+	int exp2 = explosionhandler.add_type(9, 9, 1500000);
+	loader.load_texture(L"exp1.dds", [exp1](ID3D11ShaderResourceView *t) { explosionhandler.set_texture(exp1, t); });
+	loader.load_texture(L"exp2.dds", [exp2](ID3D11ShaderResourceView *t) { explosionhandler.set_texture(exp2, t); });
+
+	//title screen: sky sphere and font, the rest keeps loading while it is shown (Render -> loader.update())
+	if (!loader.wait(sky) || !loader.wait(sky_texture))
+		return E_FAIL;
+	char report[128];
+	sprintf_s(report, "startup: title screen after %.1f ms (%s loading)\n", (double)startupTimer.elapse_milli(), PARALLEL_LOADING ? "parallel" : "serial");
+	OutputDebugStringA(report);
 
     return S_OK;
 }
@@ -1018,14 +895,24 @@ HRESULT InitDevice()
 //--------------------------------------------------------------------------------------
 void CleanupDevice()
 {
+    loader.stop();
     if( g_pImmediateContext ) g_pImmediateContext->ClearState();
 
     if( g_pSamplerLinear ) g_pSamplerLinear->Release();
     if( g_pTextureRV ) g_pTextureRV->Release();
     if(g_pCBuffer) g_pCBuffer->Release();
     if( g_pVertexBuffer ) g_pVertexBuffer->Release();
+    model_asteroids.release();
+    model_nav.release();
+    model_mine.release();
+    model_sky.release();
+    model_ship.release();
+    model_ss.release();
+    entity_atlas.release();
     if( g_pVertexLayout ) g_pVertexLayout->Release();
     if( g_pVertexShader ) g_pVertexShader->Release();
+    if( g_pVertexLayout_packed ) g_pVertexLayout_packed->Release();
+    if( g_pVertexShader_packed ) g_pVertexShader_packed->Release();
     if( g_pPixelShader ) g_pPixelShader->Release();
     if( g_pDepthStencil ) g_pDepthStencil->Release();
     if( g_pDepthStencilView ) g_pDepthStencilView->Release();
@@ -1037,7 +924,6 @@ void CleanupDevice()
 ///////////////////////////////////
 //		This Function is called every time the Left Mouse Button is down
 ///////////////////////////////////
-bullet *bull = NULL;
 void OnLBD(HWND hwnd, BOOL fDoubleClick, int x, int y, UINT keyFlags)
 	{
 	
@@ -1063,39 +949,8 @@ void OnChar(HWND hwnd, UINT ch, int cRepeat)
 ///////////////////////////////////
 void OnLBU(HWND hwnd, int x, int y, UINT keyFlags)
 	{
-		if (canFire && gamestate == 2) {
-			cam.w = 1;
-			canFire = false;
-			fireTimer.start();//wating .5 secs before you cna fire again
-			reload = " ";//resetting fire UI
-
-			bull = new bullet;
-			bull->pos.x = -cam.position.x;
-			bull->pos.y = -cam.position.y - 1.2;
-			bull->pos.z = -cam.position.z;
-			XMMATRIX CR = cam.get_matrix(&g_View);
-			CR._41 = 0;
-			CR._42 = 0;
-			CR._43 = 0;
-			XMVECTOR det;
-			XMMATRIX ICR = XMMatrixInverse(&det, CR);
-			XMFLOAT3 forward = XMFLOAT3(0, 0, 3);
-			XMVECTOR f = XMLoadFloat3(&forward);
-
-			if (fireFoward) {
-				f = XMVector3TransformCoord(f, ICR);
-			}
-			else {
-				f = XMVector3TransformCoord(f, CR);
-			}
-
-			XMStoreFloat3(&forward, f);
-			bull->imp = forward;
-			bullets.push_back(bull);
-			sound.play_fx("boost.mp3");
-		}
-
-}
+	sim.push(sim_event(SIM_FIRE, 0));
+	}
 ///////////////////////////////////
 //		This Function is called every time the Right Mouse Button is up
 ///////////////////////////////////
@@ -1109,7 +964,7 @@ void OnRBU(HWND hwnd, int x, int y, UINT keyFlags)
 ///////////////////////////////////
 void OnMM(HWND hwnd, int x, int y, UINT keyFlags)
 	{
-		if (gamestate == 2) {
+		if (game.state == 2) {
 			static int holdx = x, holdy = y;
 			static int reset_cursor = 0;
 
@@ -1142,8 +997,7 @@ void OnMM(HWND hwnd, int x, int y, UINT keyFlags)
 			int diffy = holdy - y;
 			float angle_y = (float)diffx / 300.0;
 			float angle_x = (float)diffy / 300.0;
-			cam.rotation.y += angle_y;
-			cam.rotation.x += angle_x;
+			sim.push(sim_event(SIM_TURN, 0, angle_x, angle_y));
 
 			int midx = (rc.left + rc.right) / 2;
 			int midy = (rc.top + rc.bottom) / 2;
@@ -1178,113 +1032,71 @@ BOOL OnCreate(HWND hwnd, CREATESTRUCT FAR* lpCreateStruct)
 //---------------------------------------
 void OnTimer(HWND hwnd, UINT id)
 	{
+	//the buttons as w and s, when they change
+	static bool held_y = false, held_a = false;
 	if (gamepad->IsConnected())
 		{
-		if (gamepad->GetState().Gamepad.wButtons & XINPUT_GAMEPAD_Y)
-			cam.w = 1;
-		else
-			cam.w = 0;
-		if (gamepad->GetState().Gamepad.wButtons & XINPUT_GAMEPAD_A)
-			{
-			
-			cam.s = 1;
-			}
-		else
-			cam.s = 0;
-
+		bool y = (gamepad->GetState().Gamepad.wButtons & XINPUT_GAMEPAD_Y) != 0;
+		bool a = (gamepad->GetState().Gamepad.wButtons & XINPUT_GAMEPAD_A) != 0;
+		if (y != held_y)
+			sim.push(sim_event(y ? SIM_KEY_DOWN : SIM_KEY_UP, 87));
+		if (a != held_a)
+			sim.push(sim_event(a ? SIM_KEY_DOWN : SIM_KEY_UP, 83));
+		held_y = y;
+		held_a = a;
 		}
 	SHORT lx = gamepad->GetState().Gamepad.sThumbLX;
 	SHORT ly = gamepad->GetState().Gamepad.sThumbLY;
 
+	float angle_x = 0, angle_y = 0;
 	if (abs(ly) > 3000)
 		{
-		float angle_x = (float)ly / 32000.0;
+		angle_x = (float)ly / 32000.0;
 		angle_x *= 0.05;
-		cam.rotation.x -= angle_x;
 		}
 	if (abs(lx) > 3000)
 		{
-		float angle_y = (float)lx / 32000.0;
+		angle_y = (float)lx / 32000.0;
 		angle_y *= 0.05;
-		cam.rotation.y -= angle_y;
 		}
-	
+	if (angle_x != 0 || angle_y != 0)
+		sim.push(sim_event(SIM_TURN, 0, -angle_x, -angle_y));
 	}
 //*************************************************************************
 void OnKeyUp(HWND hwnd, UINT vk, BOOL fDown, int cRepeat, UINT flags)
 	{
 	switch (vk)
 		{
-			case 81://q
-			cam.q = 0; break;
-			case 69://e
-			cam.e = 0; break;
-			case 65:cam.a = 0;//a
-				break;
-			case 68: cam.d = 0;//d
-				break;
-			case 32: //space
-				if (gamestate == 0 || gamestate == 1 |gamestate == 4 ) {
-					gamestate = 2;
-					roundTimer.start();
-					
-				}
-				if (gamestate == 3) {//restart
-					cam.position = XMFLOAT3(0.0, 0.0, 0.0f);
-					cam.impulseActual = XMFLOAT3(0.0, 0.0, 0.0f);
-					gamestate = 2;
-					playerLives = 1;
-					roundTimer.start();
-					
-				}
-
-				cam.fireFoward_flip();
-				fireFoward = !fireFoward;
-				break;
-			case 87: cam.w = 0; //w
-				break;
-			case 83:cam.s = 0; //s
-				break;
-			case 73:
-				if (gamestate == 0) {
-					gamestate = 1;
-					}
-				break;
-			case 67:
-				if (gamestate == 0) {
-					gamestate = 4;
-				}
-				break;
-
-			default:break;
-
+			case 70: sim.speed = 1; break;//f
+			case 32://space: the game does not start before the assets are there
+				if ((game.state == 0 || game.state == 1 || game.state == 4) && !loader.done()) break;
+			default: sim.push(sim_event(SIM_KEY_UP, vk)); break;
 		}
-
 	}
-
 void OnKeyDown(HWND hwnd, UINT vk, BOOL fDown, int cRepeat, UINT flags)
 	{
 
 	switch (vk)
 		{
-			default:break;
-			case 81://q
-			cam.q = 1; break;
-			case 69://e
-			cam.e = 1; break;
-			case 65:cam.a = 1;//a
-				break;
-			case 68: cam.d = 1;//d
-				break;
-			case 32: //space
-			break;
-			case 87: cam.w = 1; //w
-				break;
-			case 83:cam.s = 1; //s
-				break;
+			default: sim.push(sim_event(SIM_KEY_DOWN, vk)); break;
+			case 70: sim.speed = SIM_FAST_FORWARD; break;//f: fast-forward while held
 			case 27: PostQuitMessage(0);//escape
 				break;
 
+			case 80://p: the level with and without the visible blocks of the camera's cell, the last frame's draws to compare
+			{
+			char report[128];
+			sprintf_s(report, "level: pvs %s, last frame %d draws, %.3f ms submit\n", level1.use_pvs ? "on" : "off", level1.draws, level1.submit_ms);
+			OutputDebugStringA(report);
+			level1.use_pvs = !level1.use_pvs;
+			}
+			break;
+
+			case 76://l: the level (level.bmp) drawn and collided with, off by default
+			level1.show = !level1.show;
+			game.grid = level1.show ? level1.get_grid() : NULL;
+			break;
+
 			case 84://t
 			{
 			static int laststate = 0;
@@ -1382,8 +1194,6 @@ sprites mario;
 //--------------------------------------------------------------------------------------
 // Render a frame
 //--------------------------------------------------------------------------------------
-TrackerMine a; // FOR TESTING ONLY
-
 //############################################################################################################
 void Render_from_light_source(long elapsed)
 	{
@@ -1409,7 +1219,7 @@ void Render_from_light_source(long elapsed)
 	g_pImmediateContext->RSSetViewports(1, &vp);
 
 
-	XMMATRIX view = cam.get_matrix(&g_View);
+	XMMATRIX view = camera_matrix(game.cam, &g_View);
 
 	UINT stride = sizeof(SimpleVertex);
 	UINT offset = 0;
@@ -1424,7 +1234,7 @@ void Render_from_light_source(long elapsed)
 	constantbuffer.LightView = XMMatrixIdentity();
 	constantbuffer.View = XMMatrixTranspose(LightView);
 	constantbuffer.Projection = XMMatrixTranspose(g_Projection);
-	constantbuffer.CameraPos = XMFLOAT4(cam.position.x, cam.position.y, cam.position.z, 1);
+	constantbuffer.CameraPos = XMFLOAT4(game.cam.position.x, game.cam.position.y, game.cam.position.z, 1);
 
 	//render model:
 	XMMATRIX S = XMMatrixScaling(1, 1, 1);
@@ -1479,41 +1289,29 @@ void Render_from_light_source(long elapsed)
 
 //############################################################################################################
 
-void Render_to_texture(long elapsed)
+//a packed model with VS_packed, then back to the SimpleVertex layout and VS the other draws expect
+void draw_packed(model &m)
+	{
+	if (m.unpackbuffer == NULL)
+		{
+		m.draw(g_pImmediateContext);
+		return;
+		}
+	g_pImmediateContext->IASetInputLayout(g_pVertexLayout_packed);
+	g_pImmediateContext->VSSetShader(g_pVertexShader_packed, NULL, 0);
+	m.draw(g_pImmediateContext);
+	g_pImmediateContext->IASetInputLayout(g_pVertexLayout);
+	g_pImmediateContext->VSSetShader(g_pVertexShader, NULL, 0);
+	}
+//############################################################################################################
+//alpha: how far the drawing is from the last tick to the next (sim.alpha())
+void Render_to_texture(long elapsed, float alpha)
 {
 	float ClearColor[4] = { 0.0f, 0.125f, 0.3f, 1.0f }; // red, green, blue, alpha
 	ID3D11RenderTargetView*			RenderTarget;
 
 	//Rotation Assist
-	static float rotation = 0;
-	rotation += 0.0000003*elapsed;
-
-	//-----------------------------------------------------------------------------------
-	//FIRE DELAY
-	//-----------------------------------------------------------------------------------
-	long double curtime = fireTimer.elapse_milli();//if code isn't working, check StopWatchMicro .elapse_milli...
-	if (elapsed % 10 == 0 && reload.size() < 10) {
-		reload += "|";
-	}
-	if (curtime > fireDelay) {
-		cam.w = 0;
-		canFire = true;
-	}
-	//-----------------------------------------------------------------------------------
-	//ROUND WON DISPLAY
-	//-----------------------------------------------------------------------------------
-	if (elapsed - timeWon > 7000) { //display for a few seconds before disapearing
-		wonRound = false;
-		
-	}
-	//-----------------------------------------------------------------------------------
-	//ROUND WON DISPLAY
-	//-----------------------------------------------------------------------------------
-	if ((roundLength - roundTimer.elapse_milli()) / 1000 < 0) {
-
-		playerDeath("ran out of time");
-	}
-
+	float rotation = game.spin;
 
 	//-----------------------------------------------------------------------------------
 	//RENDERING MODELS
@@ -1522,7 +1320,7 @@ void Render_to_texture(long elapsed)
 	g_pImmediateContext->ClearRenderTargetView(RenderTarget, ClearColor);
 	g_pImmediateContext->ClearDepthStencilView(g_pDepthStencilView, D3D11_CLEAR_DEPTH, 1.0, 0);
 	g_pImmediateContext->OMSetRenderTargets(1, &RenderTarget, g_pDepthStencilView);
-	XMMATRIX view = cam.get_matrix(&g_View);
+	XMMATRIX view = camera_matrix(game.cam, &g_View);
 
 	UINT stride = sizeof(SimpleVertex);
 	UINT offset = 0;
@@ -1537,7 +1335,7 @@ void Render_to_texture(long elapsed)
 	constantbuffer.LightView = XMMatrixTranspose(LightView);
 	constantbuffer.View = XMMatrixTranspose(view);
 	constantbuffer.Projection = XMMatrixTranspose(g_Projection);
-	constantbuffer.CameraPos = XMFLOAT4(cam.position.x, cam.position.y, cam.position.z, 1);
+	constantbuffer.CameraPos = XMFLOAT4(game.cam.position.x, game.cam.position.y, game.cam.position.z, 1);
 
 	//render model:
 	XMMATRIX S = XMMatrixScaling(1, 1, 1);
@@ -1555,14 +1353,13 @@ void Render_to_texture(long elapsed)
 
 	// Render terrain
 	ID3D11ShaderResourceView*          DepthTexture = DepthLight.GetShaderResourceView();
-	g_pImmediateContext->GenerateMips(DepthTexture);
 	g_pImmediateContext->VSSetShader(g_pVertexShader, NULL, 0);
 	g_pImmediateContext->PSSetShader(g_pPixelShader, NULL, 0);
 	g_pImmediateContext->VSSetConstantBuffers(0, 1, &g_pCBuffer);
 	g_pImmediateContext->PSSetConstantBuffers(0, 1, &g_pCBuffer);
 	g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTextureRV);
 	g_pImmediateContext->PSSetShaderResources(1, 1, &DepthTexture);
-	g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer_cmp, &stride, &offset);
+	model_sky.set_buffers(g_pImmediateContext);
 	g_pImmediateContext->PSSetSamplers(0, 1, &g_pSamplerLinear);
 	g_pImmediateContext->VSSetSamplers(0, 1, &g_pSamplerLinear);
 
@@ -1574,7 +1371,7 @@ void Render_to_texture(long elapsed)
 	//-----------------------------------------------------------------------------------
 	//Sky Sphere
 	//-----------------------------------------------------------------------------------
-		constantbuffer.World = XMMatrixTranspose(XMMatrixTranslation(-cam.position.x, -cam.position.y, -cam.position.z));
+		constantbuffer.World = XMMatrixTranspose(XMMatrixTranslation(-game.cam.position.x, -game.cam.position.y, -game.cam.position.z));
 		g_pImmediateContext->UpdateSubresource(g_pCBuffer, 0, NULL, &constantbuffer, 0, 0);
 		g_pImmediateContext->VSSetShader(g_pVertexShader, NULL, 0);
 		g_pImmediateContext->PSSetShader(g_pPixelShader_screen, NULL, 0);
@@ -1582,63 +1379,36 @@ void Render_to_texture(long elapsed)
 		g_pImmediateContext->PSSetConstantBuffers(0, 1, &g_pCBuffer);
 		g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTexture_sky);
 		g_pImmediateContext->VSSetShaderResources(0, 1, &g_pTexture_sky);
-		g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer_cmp, &stride, &offset);
+		model_sky.set_buffers(g_pImmediateContext);
 		g_pImmediateContext->PSSetSamplers(0, 1, &g_pSamplerLinear);
 		g_pImmediateContext->VSSetSamplers(0, 1, &g_pSamplerLinear);
 
 		g_pImmediateContext->OMSetDepthStencilState(ds_off, 1);
-		g_pImmediateContext->Draw(model_vertex_anz_sky, 0);
+		draw_packed(model_sky);
 		g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
 
 
 
-	//-----------------------------------------------------------------------------------
-	//ANIMATION FOR INSTRUCTION SCREEn
-	//-----------------------------------------------------------------------------------
-	if (gamestate == 1) {
-		if(cam.rotation.y < 2)
-		cam.rotation.y += rotation/20;
-		else
-			displayInstruct = true;
-		
-	}
-
-	if (gamestate == 2 && rotateback) {
-		if (cam.rotation.y > 0)
-			cam.rotation.y -= rotation / 10;
-				else
-			rotateback = false;
-	
-	}
-
-	if (gamestate == 4 ) {
-		if (cam.rotation.y < 4)
-			cam.rotation.y += rotation / 20;
-		else
-			displayCredots = true;
-
-	}
-
 	//-----------------------------------------------------------------------------------
 	//NAV ARROW
 	//-----------------------------------------------------------------------------------
 
-	if (gamestate == 2 ){
+	if (game.state == 2 ){
 	XMMATRIX R0, R1, M1, M2, T1, T2, Rx1, Ry1, T3, Rx3, Ry3;
-	XMVECTOR cur = XMVector4Normalize(XMVectorSet(cam.position.x, cam.position.y-1, cam.position.z + 5, 0.0f));//current position
-	XMVECTOR goal = XMVector4Normalize(XMVectorSet(objectivePos.x, objectivePos.y, objectivePos.z, 1.0f)); //look at i.e. objective location
+	XMVECTOR cur = XMVector4Normalize(XMVectorSet(game.cam.position.x, game.cam.position.y-1, game.cam.position.z + 5, 0.0f));//current position
+	XMVECTOR goal = XMVector4Normalize(XMVectorSet(game.objective.x, game.objective.y, game.objective.z, 1.0f)); //look at i.e. objective location
 
-	//XMVECTOR cur = XMVectorSet(cam.position.x, cam.position.y, cam.position.z, 0.0f);//current position
+	//XMVECTOR cur = XMVectorSet(game.cam.position.x, game.cam.position.y, game.cam.position.z, 0.0f);//current position
 	//XMVECTOR goal = XMVectorSet(1.0f,1.0f,1.0f, 1.0f); //look at i.e. objective location
 	T = XMMatrixLookAtLH(cur, goal, Up);//used to set where nav arrow points
 	R0 = XMMatrixRotationX(XM_PI);
 	T2 = XMMatrixTranslation(0.0f, -2, 10);
-	Rx1 = XMMatrixRotationX(-cam.rotation.y);
-	Ry1 = XMMatrixRotationY(-cam.rotation.x);
-	Rx3 = XMMatrixRotationX(cam.rotation.x);
-	Ry3 = XMMatrixRotationY(cam.rotation.y);
+	Rx1 = XMMatrixRotationX(-game.cam.rotation.y);
+	Ry1 = XMMatrixRotationY(-game.cam.rotation.x);
+	Rx3 = XMMatrixRotationX(game.cam.rotation.x);
+	Ry3 = XMMatrixRotationY(game.cam.rotation.y);
 
-	XMMATRIX CR = cam.get_matrix(&g_View);
+	XMMATRIX CR = camera_matrix(game.cam, &g_View);
 	CR._41 = 0;
 	CR._42 = 0;
 	CR._43 = 0;
@@ -1648,7 +1418,7 @@ void Render_to_texture(long elapsed)
 	ICR._42 = 0;
 	ICR._43 = 0;
 	T1 = XMMatrixTranslation(0.0f, -1.0f, 5.0f);
-	T3 = XMMatrixTranslation(-cam.position.x, -cam.position.y, -cam.position.z);
+	T3 = XMMatrixTranslation(-game.cam.position.x, -game.cam.position.y, -game.cam.position.z);
 
 	R1 = Rx1 * Ry1;
 
@@ -1656,31 +1426,30 @@ void Render_to_texture(long elapsed)
 	constantbuffer.World = XMMatrixTranspose(M2);
 	g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTextureNav);
 	g_pImmediateContext->UpdateSubresource(g_pCBuffer, 0, NULL, &constantbuffer, 0, 0);
-	g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer_3ds_nav, &stride, &offset);
+	model_nav.set_buffers(g_pImmediateContext);
 	g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
-	g_pImmediateContext->Draw(model_vertex_anz_nav, 0);
+	model_nav.draw(g_pImmediateContext);
 	g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
 	}
 
 	//-----------------------------------------------------------------------------------
 	//Bullets
 	//-----------------------------------------------------------------------------------
-	for (int ii = 0; ii < bullets.size(); ii++)
+	for (int ii = 0; ii < game.bullets.size(); ii++)
 	{
-		if (bull != NULL)
 		{
 			ConstantBuffer constantbuffer;
-			XMMATRIX worldmatrix = bull->getmatrix(elapsed, view);
+			XMMATRIX worldmatrix = billboard_matrix(game.bullets[ii]->last, game.bullets[ii]->pos, alpha, view);
 
 			g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTextureNav);
 			constantbuffer.World = XMMatrixTranspose(worldmatrix);
 			constantbuffer.View = XMMatrixTranspose(view);
 			constantbuffer.Projection = XMMatrixTranspose(g_Projection);
 			constantbuffer.Projection = XMMatrixTranspose(g_Projection);
-			g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer_3ds_nav, &stride, &offset);
+			model_nav.set_buffers(g_pImmediateContext);
 			g_pImmediateContext->UpdateSubresource(g_pCBuffer, 0, NULL, &constantbuffer, 0, 0);
 			g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
-			g_pImmediateContext->Draw(model_vertex_anz_nav, 0);
+			model_nav.draw(g_pImmediateContext);
 
 		}
 	}
@@ -1690,24 +1459,25 @@ void Render_to_texture(long elapsed)
 	//-----------------------------------------------------------------------------------
 	static float ms = 1.0f;
 	ms += .01;
-	for (int ii = 0; ii < StationaryMines.size(); ii++)
+	entity_atlas.set(g_pImmediateContext);
+	for (int ii = 0; ii < game.mines.size(); ii++)
 	{
 		//display 
 		ConstantBuffer constantbuffer;
-		XMMATRIX T = XMMatrixTranslation(StationaryMines[ii]->pos.x, StationaryMines[ii]->pos.y, StationaryMines[ii]->pos.z);
+		XMMATRIX T = XMMatrixTranslation(game.mines[ii]->pos.x, game.mines[ii]->pos.y, game.mines[ii]->pos.z);
 		XMMATRIX S = XMMatrixScaling(10, 10, 10);
 		constantbuffer.World = XMMatrixTranspose(S*T);
 		constantbuffer.View = XMMatrixTranspose(view);
 		constantbuffer.Projection = XMMatrixTranspose(g_Projection);
-		g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer_3ds_mine, &stride, &offset);
-		if (StationaryMines[ii]->activated)
-			g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTextureMineActivated); //TODO CHANGE TO RED
+		model_mine.set_buffers(g_pImmediateContext);
+		if (game.mines[ii]->activated)
+			entity_texture(constantbuffer, ATLAS_MINE_ACTIVATED, g_pTextureMineActivated); //TODO CHANGE TO RED
 		else
-			g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTextureMine);
+			entity_texture(constantbuffer, ATLAS_MINE, g_pTextureMine);
 
 		g_pImmediateContext->UpdateSubresource(g_pCBuffer, 0, NULL, &constantbuffer, 0, 0);
 		g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
-		g_pImmediateContext->Draw(model_vertex_anz_mine, 0);
+		model_mine.draw_culled(g_pImmediateContext, S*T, view, g_Projection);
 
 	}
 
@@ -1717,7 +1487,7 @@ void Render_to_texture(long elapsed)
 
 	S = XMMatrixScaling(1, 1, 1);
 	R = XMMatrixRotationX(XM_PIDIV2);
-	T = XMMatrixTranslation(objectivePos.x, objectivePos.y, objectivePos.z);
+	T = XMMatrixTranslation(game.objective.x, game.objective.y, game.objective.z);
 	M = S*R*T;
 	constantbuffer.World = XMMatrixTranspose(M);
 	g_pImmediateContext->UpdateSubresource(g_pCBuffer, 0, NULL, &constantbuffer, 0, 0);
@@ -1727,20 +1497,29 @@ void Render_to_texture(long elapsed)
 	g_pImmediateContext->PSSetConstantBuffers(0, 1, &g_pCBuffer);
 	g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTexture_ss);
 	g_pImmediateContext->VSSetShaderResources(0, 1, &g_pTexture_ss);
-	g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer_ss, &stride, &offset);
+	model_ss.set_buffers(g_pImmediateContext);
 	g_pImmediateContext->PSSetSamplers(0, 1, &g_pSamplerLinear);
 	g_pImmediateContext->VSSetSamplers(0, 1, &g_pSamplerLinear);
 
 	g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
 
-	g_pImmediateContext->Draw(model_vertex_anz_ss, 0);
+	model_ss.draw(g_pImmediateContext);
 	g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
 
+	//-----------------------------------------------------------------------------------
+	//Level: the baked batches of level.bmp, the visible blocks of the camera's cell (level::render_level)
+	//-----------------------------------------------------------------------------------
+	g_pImmediateContext->VSSetShader(g_pVertexShader, NULL, 0);
+	g_pImmediateContext->PSSetShader(g_pPixelShader_screen, NULL, 0);
+	g_pImmediateContext->PSSetSamplers(0, 1, &g_pSamplerLinear);
+	g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
+	level1.render_level(g_pImmediateContext, g_pVertexBuffer_screen, &view, &g_Projection, g_pCBuffer);
+
 	//-----------------------------------------------------------------------------------
 	//One up render
 	//-----------------------------------------------------------------------------------
-	
-	for (int ii = 0; ii < oneUps.size(); ii++)
+	entity_atlas.set(g_pImmediateContext);
+	for (int ii = 0; ii < game.one_ups.size(); ii++)
 	{
 		//display
 		ConstantBuffer constantbuffer;
@@ -1748,21 +1527,21 @@ void Render_to_texture(long elapsed)
 		XMMATRIX R = XMMatrixRotationX(XM_PIDIV2);
 		XMMATRIX Ry = XMMatrixRotationY(rotation);
 
-		XMMATRIX T = XMMatrixTranslation(oneUps[ii]->x, oneUps[ii]->y, oneUps[ii]->z);
+		XMMATRIX T = XMMatrixTranslation(game.one_ups[ii].x, game.one_ups[ii].y, game.one_ups[ii].z);
 		constantbuffer.World = XMMatrixTranspose(S *R* Ry* T);
 		constantbuffer.View = XMMatrixTranspose(view);
 		constantbuffer.Projection = XMMatrixTranspose(g_Projection);
-		g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer_3ds_ship, &stride, &offset);
-		g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTexture_small_ship_oneup);
+		model_ship.set_buffers(g_pImmediateContext);
+		entity_texture(constantbuffer, ATLAS_ONEUP, g_pTexture_small_ship_oneup);
 		g_pImmediateContext->UpdateSubresource(g_pCBuffer, 0, NULL, &constantbuffer, 0, 0);
 		g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
-		g_pImmediateContext->Draw(model_vertex_anz_ship, 0);
+		model_ship.draw(g_pImmediateContext);
 
 	}
 	//-----------------------------------------------------------------------------------
 	//menu ship rindering
 	//---------------
-	if (gamestate == 0) {
+	if (game.state == 0) {
 		S = XMMatrixScaling(-1, -1, -1);
 		R = XMMatrixRotationX(1.5708);
 		XMMATRIX R1 = XMMatrixRotationY(-0.872665);
@@ -1773,52 +1552,42 @@ void Render_to_texture(long elapsed)
 		constantbuffer.World = XMMatrixTranspose(S *R1 * R* R2*T);
 		constantbuffer.View = XMMatrixTranspose(view);
 		constantbuffer.Projection = XMMatrixTranspose(g_Projection);
-		g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer_3ds_ship, &stride, &offset);
+		model_ship.set_buffers(g_pImmediateContext);
 		g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTexture_small_ship);
 		g_pImmediateContext->UpdateSubresource(g_pCBuffer, 0, NULL, &constantbuffer, 0, 0);
 		g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
-		g_pImmediateContext->Draw(model_vertex_anz_ship, 0);
+		model_ship.draw(g_pImmediateContext);
 	}
 	//-----------------------------------------------------------------------------------
 	//tracker Mine rendering
 	//-----------------------------------------------------------------------------------
-	if (roundNumber > 1) { // tracker mine come in at level 2. 
-		for (int ii = 0; ii < trackerMines.size(); ii++)
+	if (game.round > 1) { // tracker mine come in at level 2. 
+		entity_atlas.set(g_pImmediateContext);
+		for (int ii = 0; ii < game.tracker_mines.size(); ii++)
 		{
 			//display 
 			ConstantBuffer constantbuffer;
-			XMMATRIX T = XMMatrixTranslation(trackerMines[ii]->pos.x, trackerMines[ii]->pos.y, trackerMines[ii]->pos.z);
+			XMMATRIX T = XMMatrixTranslation(game.tracker_mines[ii]->pos.x, game.tracker_mines[ii]->pos.y, game.tracker_mines[ii]->pos.z);
 			XMMATRIX S = XMMatrixScaling(10, 10, 10);
-			constantbuffer.World = XMMatrixTranspose(S*T);
+			XMMATRIX world = S*T;
+			constantbuffer.World = XMMatrixTranspose(world);
 			constantbuffer.View = XMMatrixTranspose(view);
 			constantbuffer.Projection = XMMatrixTranspose(g_Projection);
-			g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer_3ds_mine, &stride, &offset);
-
-			if (trackerMines[ii]->activated) {
-				XMMATRIX CR = cam.get_matrix(&g_View);
-				CR._41 = 0;
-				CR._42 = 0;
-				CR._43 = 0;
-				XMVECTOR det;
-				XMMATRIX ICR = XMMatrixInverse(&det, CR);
-				XMFLOAT3 forward = XMFLOAT3(0, 0, 3);
-				XMVECTOR f = XMLoadFloat3(&forward);
-				f = XMVector3TransformCoord(f, CR);
-				XMStoreFloat3(&forward, f);
-
-				a.imp = forward;
-				T = a.getmatrix(elapsed, view);
-				constantbuffer.World = XMMatrixTranspose(T);
+			model_mine.set_buffers(g_pImmediateContext);
+
+			if (game.tracker_mines[ii]->activated) {
+				world = billboard_matrix(game.tracker.last, game.tracker.pos, alpha, view);
+				constantbuffer.World = XMMatrixTranspose(world);
 			}
 
-			if (trackerMines[ii]->activated)
-				g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTextureMineActivated); //TODO CHANGE TO RED
+			if (game.tracker_mines[ii]->activated)
+				entity_texture(constantbuffer, ATLAS_MINE_ACTIVATED, g_pTextureMineActivated); //TODO CHANGE TO RED
 			else
-				g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTextureTrackerMine);
+				entity_texture(constantbuffer, ATLAS_TRACKERMINE, g_pTextureTrackerMine);
 
 			g_pImmediateContext->UpdateSubresource(g_pCBuffer, 0, NULL, &constantbuffer, 0, 0);
 			g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
-			g_pImmediateContext->Draw(model_vertex_anz_mine, 0);
+			model_mine.draw_culled(g_pImmediateContext, world, view, g_Projection);
 
 		}
 	}
@@ -1847,12 +1616,12 @@ void Render_to_texture(long elapsed)
 	g_pImmediateContext->PSSetConstantBuffers(0, 1, &g_pCBuffer);
 	g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTextureBGMars);
 	g_pImmediateContext->VSSetShaderResources(0, 1, &g_pTextureBGMars);
-	g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer_cmp, &stride, &offset);
+	model_sky.set_buffers(g_pImmediateContext);
 	g_pImmediateContext->PSSetSamplers(0, 1, &g_pSamplerLinear);
 	g_pImmediateContext->VSSetSamplers(0, 1, &g_pSamplerLinear);
 
 	g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
-	g_pImmediateContext->Draw(model_vertex_anz_sky, 0);
+	draw_packed(model_sky);
 	
 
 
@@ -1878,19 +1647,51 @@ void Render_to_texture(long elapsed)
 	g_pImmediateContext->IASetInputLayout(g_pInstanceLayout);
 	g_pImmediateContext->PSSetShaderResources(0, 1, &g_pTexture_asteroid);
 	g_pImmediateContext->VSSetShaderResources(0, 1, &g_pTexture_asteroid);
-	ID3D11Buffer* vertInstBuffer[2] = { g_pVertexBuffer_3ds_asteroids, NULL };
-	UINT strides[2] = { stride, sizeof(XMFLOAT4) * 2 };
+	ID3D11Buffer* vertInstBuffer[2] = { model_asteroids.vertexbuffer, NULL };
+	UINT strides[2] = { model_asteroids.vertex_stride, PACKED_VERTICES ? sizeof(packed_instance) : sizeof(XMFLOAT4) * 2 };
 	UINT offsets[2] = { 0, 0 };
 	vertInstBuffer[1] = g_pInstancebuffer;
 	g_pImmediateContext->IASetVertexBuffers(0, 2, vertInstBuffer, strides, offsets);
-	g_pImmediateContext->DrawInstanced(model_vertex_anz_asteroids, 1000, 0, 0);
+	g_pImmediateContext->IASetIndexBuffer(model_asteroids.indexbuffer, model_asteroids.indexformat, 0);
+	if (model_asteroids.unpackbuffer) g_pImmediateContext->VSSetConstantBuffers(1, 1, &model_asteroids.unpackbuffer);
+
+	//LOD per asteroid by distance, the instance buffer gets sorted by LOD so each LOD is one instanced draw
+	if (model_asteroids.lods.size() > 0)
+		{
+		static uint32_t lod_order[ASTEROIDCOUNT];
+		uint32_t lod_first[MESH_LOD_MAX], lod_instances[MESH_LOD_MAX];
+		float campos[3] = { -game.cam.position.x, -game.cam.position.y, -game.cam.position.z };
+		RECT rc;
+		GetClientRect(g_hWnd, &rc);
+		float pixel_error = ASTEROID_LOD_PIXELS * XM_PIDIV4 / max(rc.bottom - rc.top, 1);
+		int lod_count = model_asteroids.lods.size();
+		bucket_instances_by_lod(&asteroid_pos[0].x, sizeof(XMFLOAT4) * 2, ASTEROIDCOUNT, campos, 1.0f,
+			&model_asteroids.lods[0], lod_count, pixel_error, lod_order, lod_first, lod_instances);
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (SUCCEEDED(g_pImmediateContext->Map(g_pInstancebuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+			{
+			XMFLOAT4 *instances = (XMFLOAT4*)mapped.pData;
+			packed_instance *packed = (packed_instance*)mapped.pData;
+			for (int ii = 0; ii < ASTEROIDCOUNT; ii++)
+				if (PACKED_VERTICES)
+					pack_instances(&asteroid_pos[lod_order[ii] * 2].x, 1, PACKED_INSTANCE_RANGE, packed + ii);
+				else
+					{
+					instances[ii * 2] = asteroid_pos[lod_order[ii] * 2];
+					instances[ii * 2 + 1] = asteroid_pos[lod_order[ii] * 2 + 1];
+					}
+			g_pImmediateContext->Unmap(g_pInstancebuffer, 0);
+			}
+		for (int lod = 0; lod < lod_count; lod++)
+			model_asteroids.draw_lod_instanced(g_pImmediateContext, lod, lod_instances[lod], lod_first[lod]);
+		}
 
 		
 
 	//-----------------------------------------------------------------------------------
 	//UI FOR START UP 
 	//-----------------------------------------------------------------------------------
-	if (gamestate == 0) {
+	if (game.state == 0) {
 		font.setScaling(XMFLOAT3(2.5,2.5,2.5));
 		font.setColor(XMFLOAT3(21.0, 106.0, 242.0));
 		font.setPosition(XMFLOAT3(-.75f, 0.25f, 0.0f));
@@ -1917,7 +1718,7 @@ void Render_to_texture(long elapsed)
 	//-----------------------------------------------------------------------------------
 	//UI FOR END GAME
 	//-----------------------------------------------------------------------------------
-	if (gamestate == 3) {
+	if (game.state == 3) {
 		font.setScaling(XMFLOAT3(2.5, 2.5, 2.5));
 		font.setColor(XMFLOAT3(21.0, 106.0, 242.0));
 		font.setPosition(XMFLOAT3(-.27f, 0.0f, 0.0f));
@@ -1925,7 +1726,7 @@ void Render_to_texture(long elapsed)
 
 		font.setScaling(XMFLOAT3(1.3, 1.3, 1.3));
 		font.setPosition(XMFLOAT3(-0.27f, -0.2f, 0.0f));
-		font << causeOfDeath;
+		font << game.cause_of_death;
 
 		font.setScaling(XMFLOAT3(1, 1, 1));
 		font.setColor(XMFLOAT3(21.0, 106.0, 242.0));
@@ -1938,7 +1739,7 @@ void Render_to_texture(long elapsed)
 	//-----------------------------------------------------------------------------------
 	//UI FOR Credits
 	//-----------------------------------------------------------------------------------
-	if (gamestate == 4 & displayCredots) {
+	if (game.state == 4 & game.show_credits) {
 		font.setScaling(XMFLOAT3(2.5, 2.5, 2.5));
 		font.setColor(XMFLOAT3(21.0, 106.0, 242.0));
 		font.setPosition(XMFLOAT3(-.75f, 0.25f, 0.0f));
@@ -1965,7 +1766,7 @@ void Render_to_texture(long elapsed)
 	//-----------------------------------------------------------------------------------
 	//UI FOR INSTRUCTIONS
 	//-----------------------------------------------------------------------------------
-	if (gamestate == 1 & displayInstruct) {
+	if (game.state == 1 & game.show_instructions) {
 		font.setScaling(XMFLOAT3(2.5, 2.5, 2.5));
 		font.setColor(XMFLOAT3(21.0, 106.0, 242.0));
 		font.setPosition(XMFLOAT3(-.75f, 0.25f, 0.0f));
@@ -2007,11 +1808,8 @@ void Render_to_texture(long elapsed)
 	//-----------------------------------------------------------------------------------
 	//NEW ROUND DISPLAY
 	//-----------------------------------------------------------------------------------
-	if (wonRound) {
+	if (game.won_round) {
 		
-		increaseDiffulty();
-		roundTimer.start(); //restarting round timer
-
 		font.setScaling(XMFLOAT3(2.5, 2.5, 2.5));
 		font.setColor(XMFLOAT3(21.0, 106.0, 242.0));
 		font.setPosition(XMFLOAT3(-.45f, 0.0f, 0.0f));
@@ -2022,7 +1820,7 @@ void Render_to_texture(long elapsed)
 		font.setPosition(XMFLOAT3(-0.2f, -0.2f, 0.0f));
 		font << "Current Round: ";
 		font.setPosition(XMFLOAT3(0.05f, -0.2f, 0.0f));
-		font << std::to_string(roundNumber);
+		font << std::to_string(game.round);
 	
 	}
 
@@ -2032,7 +1830,7 @@ void Render_to_texture(long elapsed)
 	//HEADS UP DISPLAY
 	//-----------------------------------------------------------------------------------
 
-	if (gamestate == 2) {
+	if (game.state == 2) {
 
 		font.setScaling(XMFLOAT3(1.5, 1.5, 1.5));
 		font.setColor(XMFLOAT3(21.0, 106.0, 242.0));
@@ -2041,9 +1839,9 @@ void Render_to_texture(long elapsed)
 
 		font.setColor(XMFLOAT3(1, .61, 1.58));
 		font.setPosition(XMFLOAT3(-.6f, -0.8f, 0.0f));
-		if (canFire) { font.setColor(XMFLOAT3(0, 1, .6)); }
+		if (game.can_fire) { font.setColor(XMFLOAT3(0, 1, .6)); }
 		else { font.setColor(XMFLOAT3(1, 0, 0)); }
-		font << reload;
+		font << game.reload;
 
 
 		font.setScaling(XMFLOAT3(1.5, 1.5, 1.5));
@@ -2055,7 +1853,7 @@ void Render_to_texture(long elapsed)
 		font.setScaling(XMFLOAT3(1.5, 1.5, 1.5));
 
 		font.setPosition(XMFLOAT3(-.5, -.7, 0));
-		if (fireFoward) {
+		if (game.cam.fireFoward) {
 			font.setColor(XMFLOAT3(0, 1, .6));
 			font << "FORWARD";
 		}
@@ -2064,7 +1862,7 @@ void Render_to_texture(long elapsed)
 			font << "BACKWARD";
 		}
 
-		XMFLOAT3 impulseUI = cam.getImpulse();
+		vec3 impulseUI = game.cam.getImpulse();
 
 		font.setScaling(XMFLOAT3(1, 1, 1));
 		font.setColor(XMFLOAT3(21.0, 106.0, 242.0));
@@ -2106,7 +1904,7 @@ void Render_to_texture(long elapsed)
 		font.setScaling(XMFLOAT3(1, 1, 1));
 		font.setColor(XMFLOAT3(0, 1, .6));
 		font.setPosition(XMFLOAT3(-0.8, .99, 0));
-		font << std::to_string(playerLives);
+		font << std::to_string(game.lives);
 
 		//-----------------------------------------------------------------------------------
 		//ROUND TIMER
@@ -2120,13 +1918,13 @@ void Render_to_texture(long elapsed)
 		font.setScaling(XMFLOAT3(1, 1, 1));
 		font.setColor(XMFLOAT3(0, 1, .6));
 		font.setPosition(XMFLOAT3(0.8, .99, 0));
-		font << std::to_string((roundLength - roundTimer.elapse_milli()) / 1000);
+		font << std::to_string(game.round_left() / 1000);
 
 
 		//-----------------------------------------------------------------------------------
 		//Play Area Warning
 		//-----------------------------------------------------------------------------------
-		if (abs(cam.position.x) > playField - 200 || abs(cam.position.y) > playField - 200 || abs(cam.position.z) > playField - 200) {//checking if a player has gone too far from boundrys
+		if (abs(game.cam.position.x) > game.play_field - 200 || abs(game.cam.position.y) > game.play_field - 200 || abs(game.cam.position.z) > game.play_field - 200) {//checking if a player has gone too far from boundrys
 			font.setScaling(XMFLOAT3(1.3, 1.3, 0.0));
 			font.setColor(XMFLOAT3(1, 0, 0));
 			font.setPosition(XMFLOAT3(-.5, -.5, 0.0));
@@ -2136,15 +1934,13 @@ void Render_to_texture(long elapsed)
 			font << "DNC line in: ";
 			font.setPosition(XMFLOAT3(0, -.6, 0.0));
 
-			font << std::to_string(abs(cam.position.x / 100));
+			font << std::to_string(abs(game.cam.position.x / 100));
 			font.setPosition(XMFLOAT3(0, -.65, 0.0));
 
-			font << std::to_string(abs(cam.position.y / 100));
+			font << std::to_string(abs(game.cam.position.y / 100));
 			font.setPosition(XMFLOAT3(0, -.7, 0.0));
 
-			font << std::to_string(abs(cam.position.z / 100));
-			if (abs(cam.position.x) > playField || abs(cam.position.y) > playField || abs(cam.position.z) > playField)
-				playerDeath("Strayed into enemy territory");
+			font << std::to_string(abs(game.cam.position.z / 100));
 			sound.play_fx("Rock.wav");
 
 			
@@ -2152,158 +1948,12 @@ void Render_to_texture(long elapsed)
 	}
 	
 	
-	//-----------------------------------------------------------------------------------
-	//Collision detection
-	//-----------------------------------------------------------------------------------
-	
-	//mines 
-	for (int ii = 0; ii < StationaryMines.size(); ii++) {
-		float dx = -cam.position.x - StationaryMines[ii]->pos.x;
-		float dy = -cam.position.y - StationaryMines[ii]->pos.y;
-		float dz = -cam.position.z - StationaryMines[ii]->pos.z;
-		float c = sqrt((dx*dx) + (dz*dz) + (dy*dy));
-
-		if (StationaryMines[ii]->explode(elapsed)) { //in death}
-					
-					int x = StationaryMines[ii]->pos.x;
-					int y = StationaryMines[ii]->pos.y;
-					int z = StationaryMines[ii]->pos.z;
-					explosionhandler.new_explosion(XMFLOAT3(x,y,z), XMFLOAT3(0, 0, 5), 1, 40.0);
-					sound.play_fx("Rock.wav");
-					if (c < 80) {
-						playerDeath("Was in proximity of space mine when it exploded");
-
-					}
-					StationaryMines.erase(StationaryMines.begin() + ii);
-			}
-
-		if (c < 80) {
-			//change color
-			
-			if(!StationaryMines[ii]->activated) //if it isn't activated activate it
-				StationaryMines[ii]->activate(elapsed);
-
-			
-			if (c < 20) //collision death
-			{
-				sound.play_fx("Rock.wav");
-				explosionhandler.new_explosion(StationaryMines[ii]->pos, XMFLOAT3(0, 0, 5), 1, 40.0); //end game
-				StationaryMines.erase(StationaryMines.begin() + ii);
-				playerDeath("Ran into a mine");
-			}
-		}
-
-	}
-	//Tracker Mines
-	for (int ii = 0; ii < trackerMines.size(); ii++) {
-		float dx = -cam.position.x - trackerMines[ii]->pos.x;
-		float dy = -cam.position.y - trackerMines[ii]->pos.y;
-		float dz = -cam.position.z - trackerMines[ii]->pos.z;
-		float c = sqrt((dx*dx) + (dz*dz) + (dy*dy));
-		if (c < 80) {
-			trackerMines[ii]->activated = true;
-			if (c < 20) { //collision death
-				sound.play_fx("Rock.wav");
-				explosionhandler.new_explosion(trackerMines[ii]->pos, XMFLOAT3(0, 0, 5), 1, 40.0); //end game
-				trackerMines.erase(trackerMines.begin() + ii);
-				playerDeath("hit by a tracker mine");
-			}
-			
-		}
-	
-	
-	
-	}
-
-
-	//BULLLETS CLEAN UP
-	//Temp solution check for distance later
-	if (bullets.size() > 15) {
-		bullets.erase(bullets.begin() + 10);
-		for (int jj = 0; jj < bullets.size(); jj++) { // YIKES DOUBLE FOR LOOP WOOP WOOP
-					
-			for (int ii = 0; ii < trackerMines.size(); ii++) {
-				float dx = bullets[jj]->pos.x - trackerMines[ii]->pos.x;
-				float dy = bullets[jj]->pos.y - trackerMines[ii]->pos.y;
-				float dz = bullets[jj]->pos.z - trackerMines[ii]->pos.z;
-				float c = sqrt((dx*dx) + (dz*dz) + (dy*dy));
-				if (c < 100) {
-					sound.play_fx("Rock.wav");
-					explosionhandler.new_explosion(trackerMines[ii]->pos, XMFLOAT3(0, 0, 5), 1, 40.0); //end game
-					trackerMines.erase(trackerMines.begin() + ii);
-				
-				}
-
-		}
-		
-		
-		
-		}
-
-	}
-
-	//ONE UPS
-	for (int ii = 0; ii < oneUps.size(); ii++) {
-		float dx = -cam.position.x - oneUps[ii]->x;
-		float dy = -cam.position.y - oneUps[ii]->y;
-		float dz = -cam.position.z - oneUps[ii]->z;
-		float c = sqrt((dx*dx) + (dz*dz) + (dy*dy));
-		if (c < 50) {
-			oneUps.erase(oneUps.begin() + ii);
-			playerLives++;
-			}
-		}
-
-	//ASTROIDS
-	for (int i = 0; i < ASTEROIDCOUNT * 2; i += 2) {
-		float dx = -cam.position.x - asteroid_pos[i].x;
-		float dy = -cam.position.y - asteroid_pos[i].y;
-		float dz = -cam.position.z - asteroid_pos[i].z;
-		float c = sqrt((dx*dx) + (dz*dz) + (dy*dy));
-		if (c < 20) {
-			playerDeath("Collided with a astroid");
-			sound.play_fx("Rock.wav");
-		}
-	}
-	//REached goal
-	float gx = -cam.position.x - objectivePos.x;
-	float gy = -cam.position.y - objectivePos.y;
-	float gz = -cam.position.z - objectivePos.z;
-
-	float c = sqrt((gx*gx) + (gz*gz) + (gy*gy));
-	if (c < 50) {
-		//reseting for new ground
-		cam.impulseActual = XMFLOAT3(0, 0, 0);
-		wonRound = true;
-		roundNumber++;
-		
-		timeWon = elapsed;
-
-		//moveing objective
-		float px, py, pz;
-		px = rand() % 1000 - 500;
-		py = rand() % 1000 - 500;
-		pz = rand() % 1000 - 500;
-
-		while (px*px + py*py + pz*pz <= 5000)
-		{
-			pz = rand() % 1000 - 500;
-			px = rand() % 1000 - 500;
-			py = rand() % 1000 - 500;
-			//TODO add to objectivePos
-
-		}
-
-		objectivePos = XMFLOAT3(px, py, pz);
-
-
-	}
 	///-----------------------------------------------------------------------------------
 	//Explosions
 	//-----------------------------------------------------------------------------------
-	view = cam.get_matrix(&g_View);
+	view = camera_matrix(game.cam, &g_View);
 	g_pImmediateContext->OMSetDepthStencilState(ds_off, 1);
-	explosionhandler.render(&view, &g_Projection, elapsed);
+	explosionhandler.render(&view, &g_Projection);
 	g_pImmediateContext->IASetInputLayout(g_pVertexLayout);
 	g_pImmediateContext->OMSetDepthStencilState(ds_on, 1);
 
@@ -2320,13 +1970,13 @@ void Render_to_screen(long elapsed)
 	{
 	//and now render it on the screen:
 	ConstantBuffer constantbuffer;
-	XMMATRIX view = cam.get_matrix(&g_View);
+	XMMATRIX view = camera_matrix(game.cam, &g_View);
 	UINT stride = sizeof(SimpleVertex);
 	UINT offset = 0;
 	constantbuffer.LightView= view;
 	constantbuffer.View = XMMatrixTranspose(view);
 	constantbuffer.Projection = XMMatrixTranspose(g_Projection);
-	constantbuffer.CameraPos = XMFLOAT4(cam.position.x, cam.position.y, cam.position.z, 1);
+	constantbuffer.CameraPos = XMFLOAT4(game.cam.position.x, game.cam.position.y, game.cam.position.z, 1);
 
 	g_pImmediateContext->OMSetRenderTargets(1, &g_pRenderTargetView, g_pDepthStencilView);
 	// Clear the back buffer
@@ -2355,7 +2005,6 @@ void Render_to_screen(long elapsed)
 	//texture = DepthLight.GetShaderResourceView();// THE MAGIC
 
 
-	g_pImmediateContext->GenerateMips(texture);
 	//texture = g_pTextureRV;
 	g_pImmediateContext->PSSetShaderResources(0, 1, &texture);
 	g_pImmediateContext->VSSetShaderResources(0, 1, &texture);
@@ -2371,15 +2020,76 @@ void Render_to_screen(long elapsed)
 
 
 //############################################################################################################
+//--------------------------------------------------------------------------------------
+//mines and one-ups: their rect of the atlas (bound once before the loop), their own texture if there is no atlas
+//--------------------------------------------------------------------------------------
+void entity_texture(ConstantBuffer &constantbuffer, int atlas_index, ID3D11ShaderResourceView *texture)
+{
+	if (entity_atlas.view)
+		constantbuffer.TexRect = entity_atlas.uv[atlas_index];
+	else
+		g_pImmediateContext->PSSetShaderResources(0, 1, &texture);
+}
+
 void Render()
 {
 static StopWatchMicro_ stopwatch;
 long elapsed = stopwatch.elapse_micro();
 stopwatch.start();//restart
 
-cam.animation(elapsed);
+//assets that finished loading (or were changed, HOT_RELOAD) get their device objects here
+static bool startup_reported = false;
+if (loader.update() == 0 && !startup_reported)
+	{
+	startup_reported = true;
+	char report[128];
+	sprintf_s(report, "startup: all assets after %.1f ms (%s loading), %d failed\n", (double)startupTimer.elapse_milli(), PARALLEL_LOADING ? "parallel" : "serial", loader.failed);
+	OutputDebugStringA(report);
+	}
+//streamed levels: the tiles around the camera come and go here, not in the drawing
+level1.update(g_pd3dDevice, -game.cam.position.x, -game.cam.position.z);
+
+//once all textures are there: mines and one-ups into one atlas, without it they keep their own textures. again after a reload
+static int atlas_reloads = -1;
+if (loader.done() && atlas_reloads != loader.reloads)
+	{
+	atlas_reloads = loader.reloads;
+	ID3D11ShaderResourceView *sources[] = { g_pTextureMine, g_pTextureMineActivated, g_pTextureTrackerMine, g_pTexture_small_ship_oneup };
+	if (entity_atlas.build(g_pd3dDevice, g_pImmediateContext, sources, 4))
+		{
+		char report[128];
+		sprintf_s(report, "texture atlas: %d x %d for mines and one-ups\n", entity_atlas.width, entity_atlas.height);
+		OutputDebugStringA(report);
+		}
+	else
+		OutputDebugStringA("texture atlas: sources do not match (format, mips), drawing with their own textures\n");
+	}
+
+//the game catches up in fixed ticks, F held: SIM_FAST_FORWARD as many
+int ticks = sim.advance(elapsed);
+for (int ii = 0; ii < ticks; ii++)
+	{
+	explosionhandler.animate(SIM_TICK_MICRO);
+	game.tick(sim.take_events());
+	sim.tick++;
+	//what the tick decided that the game can hear or see
+	for (int jj = 0; jj < game.effects.size(); jj++)
+		{
+		const sim_effect &e = game.effects[jj];
+		if (e.type == SIM_EFFECT_SOUND)
+			sound.play_fx((char*)e.sound);
+		else
+			explosionhandler.new_explosion(XMFLOAT3(e.position.x, e.position.y, e.position.z), XMFLOAT3(0, 0, 5), 1, 40.0);
+		}
+	game.effects.clear();
+	}
+//drawn between the last two ticks, the simulation keeps its own position
+float alpha = sim.alpha();
+vec3 cam_simulated = game.cam.position;
+game.cam.position = game.cam.previous + (game.cam.position - game.cam.previous) * alpha;
 Render_from_light_source(elapsed);
-Render_to_texture(elapsed);
+Render_to_texture(elapsed, alpha);
 Render_to_screen(elapsed);
+game.cam.position = cam_simulated;
 }
 
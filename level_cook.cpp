@@ -0,0 +1,239 @@
+#include "level_mesh.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <algorithm>
+
+static uint32_t read_u32(const unsigned char *p)
+	{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+	}
+static bool level_error(const char **error, const char *what)
+	{
+	if (error) *error = what;
+	return false;
+	}
+bool read_level_bitmap(const unsigned char *data, size_t size, int *width, int *height, vector<uint8_t> &cells,
+	vector<level_material> &materials, const char **error)
+	{
+	//BITMAPFILEHEADER (14 bytes) and at least a BITMAPINFOHEADER (40), the v4/v5 ones start the same
+	if (!data || size < 54 || data[0] != 'B' || data[1] != 'M') return level_error(error, "not a bmp");
+	uint32_t offset = read_u32(data + 10);
+	uint32_t info_size = read_u32(data + 14);
+	int32_t w = (int32_t)read_u32(data + 18);
+	int32_t h = (int32_t)read_u32(data + 22);
+	int planes = data[26] | data[27] << 8;
+	int bits = data[28] | data[29] << 8;
+	uint32_t compression = read_u32(data + 30);
+	if (info_size < 40) return level_error(error, "old os/2 bmp header");
+	if (planes != 1 || (bits != 24 && bits != 32)) return level_error(error, "not 24 or 32 bit (palettes are not supported)");
+	if (compression == 3 && bits == 32)
+		{
+		//BI_BITFIELDS: only the plain byte order, the masks follow the 40 byte header (or are in the v4/v5 one)
+		if (size < 66 || read_u32(data + 54) != 0x00ff0000 || read_u32(data + 58) != 0x0000ff00 || read_u32(data + 62) != 0x000000ff)
+			return level_error(error, "32 bit bmp with unusual channel masks");
+		}
+	else if (compression != 0)
+		return level_error(error, "compressed bmp");
+	//negative height: the rows are stored top down
+	bool top_down = h < 0;
+	if (top_down) h = -h;
+	if (w <= 0 || h <= 0 || w > 32768 || h > 32768) return level_error(error, "bad size");
+	size_t pixel_bytes = bits / 8;
+	size_t stride = ((size_t)w * pixel_bytes + 3) & ~(size_t)3;
+	//the last row does not need its padding
+	if (offset > size || (size - offset) < stride * (h - 1) + (size_t)w * pixel_bytes) return level_error(error, "file is cut off");
+
+	*width = w;
+	*height = h;
+	cells.resize((size_t)w * h);
+	materials.clear();
+	level_material none = { LEVEL_NONE, LEVEL_NONE, LEVEL_NONE, 0 };
+	materials.push_back(none);	//0 is solid nothing, the border of most levels
+	uint32_t last_key = 0, last_id = 0;
+	for (int y = 0; y < h; y++)
+		{
+		const unsigned char *row = data + offset + stride * (top_down ? h - 1 - y : y);
+		uint8_t *out = &cells[(size_t)y * w];
+		for (int x = 0; x < w; x++, row += pixel_bytes)
+			{
+			uint32_t key = row[0] | row[1] << 8 | row[2] << 16;
+			if (key != last_key)
+				{
+				//a level has a handful of combinations, in long runs
+				level_material m;
+				m.wall = row[0] ? (uint8_t)(255 - row[0]) : LEVEL_NONE;
+				m.floor = row[1] ? (uint8_t)(255 - row[1]) : LEVEL_NONE;
+				m.ceiling = row[2] ? (uint8_t)(255 - row[2]) : LEVEL_NONE;
+				m.pad = 0;
+				size_t id = 0;
+				while (id < materials.size() && memcmp(&materials[id], &m, sizeof(m)) != 0) id++;
+				if (id == materials.size())
+					{
+					if (id == LEVEL_MAX_MATERIALS) return level_error(error, "more than 256 wall/floor/ceiling combinations");
+					materials.push_back(m);
+					}
+				last_key = key;
+				last_id = (uint32_t)id;
+				}
+			out[x] = (uint8_t)last_id;
+			}
+		}
+	return true;
+	}
+bool is_level_source(const char *filename)
+	{
+	const char *base = filename;
+	for (const char *p = filename; *p; p++)
+		if (*p == '/' || *p == '\\') base = p + 1;
+	size_t len = strlen(base);
+	if (len < 9) return false;
+	const char *ext = base + len - 4;
+	return (base[0] | 32) == 'l' && (base[1] | 32) == 'e' && (base[2] | 32) == 'v' && (base[3] | 32) == 'e' && (base[4] | 32) == 'l' &&
+		ext[0] == '.' && (ext[1] | 32) == 'b' && (ext[2] | 32) == 'm' && (ext[3] | 32) == 'p';
+	}
+void cooked_level_name(const char *source, char *cooked, size_t cooked_size)
+	{
+	snprintf(cooked, cooked_size, "%s.level", source);
+	}
+static size_t cell_bytes(uint32_t width, uint32_t height)
+	{
+	size_t tiles_x = (width + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE, tiles_y = (height + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE;
+	return tiles_x * tiles_y * LEVEL_TILE_SIZE * LEVEL_TILE_SIZE;
+	}
+bool cook_level(const char *source, const char *cooked, const char **error)
+	{
+	cooked_level_header header;
+	memset(&header, 0, sizeof(header));
+	if (!file_stamp(source, &header.source_size, &header.source_time)) return level_error(error, "no such file");
+	mapped_file file;
+	if (!file.open(source)) return level_error(error, "can not read it");
+	header.source_hash = hash_bytes(file.data(), file.size());
+
+	int width, height;
+	vector<uint8_t> cells;
+	vector<level_material> materials;
+	if (!read_level_bitmap(file.data(), file.size(), &width, &height, cells, materials, error)) return false;
+	file.close();
+	vector<level_face> faces, merged;
+	level_faces(&cells[0], &materials[0], width, height, faces);
+	merge_level_faces(faces, merged);
+
+	header.magic = LEVELCACHE_MAGIC;
+	header.version = LEVELCACHE_VERSION;
+	header.width = width;
+	header.height = height;
+	header.material_count = (uint32_t)materials.size();
+	header.face_count = (uint32_t)merged.size();
+	header.cell_face_count = (uint32_t)faces.size();
+	//row after row of tiles, the cells of a tile row by row. the tiles past the edge are filled with nothing (0)
+	vector<uint8_t> tiled(cell_bytes(width, height), 0);
+	int tiles_x = (width + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE;
+	for (int y = 0; y < height; y++)
+		for (int x0 = 0; x0 < width; x0 += LEVEL_TILE_SIZE)
+			{
+			size_t tile = (size_t)(y / LEVEL_TILE_SIZE) * tiles_x + x0 / LEVEL_TILE_SIZE;
+			memcpy(&tiled[tile * LEVEL_TILE_SIZE * LEVEL_TILE_SIZE + (y % LEVEL_TILE_SIZE) * LEVEL_TILE_SIZE], &cells[(size_t)y * width + x0],
+				std::min(LEVEL_TILE_SIZE, width - x0));
+			}
+
+	//write next to it and swap in, a crashed cook never leaves half a file behind
+	char temp[1024];
+	snprintf(temp, sizeof(temp), "%s.tmp", cooked);
+	FILE *out = fopen(temp, "wb");
+	if (!out) return level_error(error, "can not write the cooked file");
+	bool written = fwrite(&header, sizeof(header), 1, out) == 1;
+	if (written) written = fwrite(&materials[0], materials.size() * sizeof(level_material), 1, out) == 1;
+	if (written) written = fwrite(&tiled[0], tiled.size(), 1, out) == 1;
+	if (written && !merged.empty()) written = fwrite(&merged[0], merged.size() * sizeof(level_face), 1, out) == 1;
+	written = (fclose(out) == 0) && written;
+	if (!written)
+		{
+		remove(temp);
+		return level_error(error, "can not write the cooked file");
+		}
+	remove(cooked);
+	return rename(temp, cooked) == 0 || level_error(error, "can not write the cooked file");
+	}
+//-----------------------------------------------------------------
+bool cooked_level::open(const char *cooked_filename)
+	{
+	close();
+	if (!file.open(cooked_filename)) return false;
+	if (!attach(file.data(), file.size()))
+		{
+		close();
+		return false;
+		}
+	return true;
+	}
+bool cooked_level::open(const unsigned char *data, size_t size)
+	{
+	close();
+	return attach(data, size);
+	}
+bool cooked_level::attach(const unsigned char *data, size_t size)
+	{
+	if (!data || size < sizeof(cooked_level_header)) return false;
+	const cooked_level_header *h = (const cooked_level_header*)data;
+	if (h->magic != LEVELCACHE_MAGIC || h->version != LEVELCACHE_VERSION || h->width > 32768 || h->height > 32768 ||
+		h->material_count == 0 || h->material_count > LEVEL_MAX_MATERIALS)
+		return false;
+	uint64_t material_bytes = (uint64_t)h->material_count * sizeof(level_material);
+	uint64_t face_bytes = (uint64_t)h->face_count * sizeof(level_face);
+	if (size != sizeof(cooked_level_header) + material_bytes + cell_bytes(h->width, h->height) + face_bytes)
+		return false;
+	header = h;
+	const unsigned char *p = data + sizeof(cooked_level_header);
+	materials = (const level_material*)p;		p += material_bytes;
+	cells = p;									p += cell_bytes(h->width, h->height);
+	faces = (const level_face*)p;
+	return true;
+	}
+void cooked_level::read_cells(int x0, int y0, int x1, int y1, uint8_t *result) const
+	{
+	for (int y = y0; y < y1; y++)
+		for (int x = x0; x < x1; x++)
+			*result++ = (x >= 0 && y >= 0 && x < (int)header->width && y < (int)header->height) ? cell(x, y) : 0;
+	}
+void cooked_level::close()
+	{
+	file.close();
+	header = NULL;
+	materials = NULL;
+	cells = NULL;
+	faces = NULL;
+	}
+//-----------------------------------------------------------------
+bool load_level_cached(const char *source, cooked_level &level)
+	{
+	char cooked[1024];
+	cooked_level_name(source, cooked, sizeof(cooked));
+	uint64_t size, time;
+	if (!file_stamp(source, &size, &time))
+		return level.open(cooked);//only the cooked file is shipped
+
+	if (level.open(cooked))
+		{
+		if (level.header->source_size == size && level.header->source_time == time)
+			return true;
+		//touched but maybe not changed
+		if (level.header->source_size == size && level.header->source_hash == hash_file(source))
+			{
+			//the new time into the header, the next start takes the cheap check again
+			level.close();
+			patch_file(cooked, offsetof(cooked_level_header, source_time), &time, sizeof(time));
+			if (level.open(cooked))
+				return true;
+			}
+		level.close();
+		}
+	if (!cook_level(source, cooked)) return false;
+	return level.open(cooked);
+	}
+bool level_cached(const char *source, char *cooked, size_t cooked_size)
+	{
+	cooked_level_name(source, cooked, cooked_size);
+	cooked_level level;
+	return load_level_cached(source, level);
+	}
@@ -0,0 +1,376 @@
+#include "level_grid.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+level_grid::level_grid()
+	{
+	width = height = 0;
+	cell_size = 1;
+	half_height = 0.5f;
+	x_offset = 0;
+	visited = 0;
+	}
+void level_grid::set_flags(const level_material *materials, int material_count, uint8_t material_flags[256])
+	{
+	memset(material_flags, 0, 256);
+	for (int ii = 0; ii < material_count; ii++)
+		{
+		const level_material &m = materials[ii];
+		if (m.wall != LEVEL_NONE)	material_flags[ii] = LEVEL_GRID_SOLID;		//what is inside a block does not matter
+		else
+			{
+			if (m.floor != LEVEL_NONE)		material_flags[ii] |= LEVEL_GRID_FLOOR;
+			if (m.ceiling != LEVEL_NONE)	material_flags[ii] |= LEVEL_GRID_CEILING;
+			}
+		}
+	}
+void level_grid::build(const uint8_t *cells, const level_material *materials, int w, int h)
+	{
+	uint8_t material_flags[256];
+	int material_count = 0;
+	for (size_t ii = 0; ii < (size_t)w * h; ii++)
+		material_count = std::max(material_count, cells[ii] + 1);
+	set_flags(materials, material_count, material_flags);
+	width = w;
+	height = h;
+	flags.resize((size_t)w * h);
+	for (size_t ii = 0; ii < flags.size(); ii++)
+		flags[ii] = material_flags[cells[ii]];
+	}
+void level_grid::build(const cooked_level &level)
+	{
+	uint8_t material_flags[256];
+	set_flags(level.materials, level.header->material_count, material_flags);
+	width = level.header->width;
+	height = level.header->height;
+	flags.resize((size_t)width * height);
+	int tiles_x = (width + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE;
+	//a tile row at a time, the reads stay inside a tile's pages
+	for (int y = 0; y < height; y++)
+		for (int x0 = 0; x0 < width; x0 += LEVEL_TILE_SIZE)
+			{
+			int x1 = std::min(width, x0 + LEVEL_TILE_SIZE);
+			const uint8_t *in = level.cells + ((size_t)(y / LEVEL_TILE_SIZE) * tiles_x + x0 / LEVEL_TILE_SIZE) * LEVEL_TILE_SIZE * LEVEL_TILE_SIZE +
+				(y % LEVEL_TILE_SIZE) * LEVEL_TILE_SIZE;
+			uint8_t *out = &flags[(size_t)y * width + x0];
+			for (int x = 0; x < x1 - x0; x++)
+				out[x] = material_flags[in[x]];
+			}
+	}
+void level_grid::clear()
+	{
+	vector<uint8_t>().swap(flags);
+	width = height = 0;
+	}
+void level_grid::swap(level_grid &other)
+	{
+	flags.swap(other.flags);
+	std::swap(width, other.width);
+	std::swap(height, other.height);
+	std::swap(cell_size, other.cell_size);
+	std::swap(half_height, other.half_height);
+	std::swap(x_offset, other.x_offset);
+	}
+//-----------------------------------------------------------------
+//grid space: cell (x, y) is [x, x + 1] x [y, y + 1] in x and z, one unit a cell in every axis, t stays the same
+struct grid_ray
+	{
+	float o[3], d[3];
+	};
+static void to_grid(const level_grid &grid, const float from[3], const float to[3], grid_ray *ray)
+	{
+	float s = 1.0f / grid.cell_size;
+	ray->o[0] = (from[0] + grid.x_offset) * s + 0.5f;
+	ray->o[1] = from[1] * s;
+	ray->o[2] = from[2] * s + 0.5f;
+	ray->d[0] = (to[0] - from[0]) * s;
+	ray->d[1] = (to[1] - from[1]) * s;
+	ray->d[2] = (to[2] - from[2]) * s;
+	}
+//the part of [t0, t1] where o + d t is inside [lo, hi] on the axis
+static bool clip_axis(float o, float d, float lo, float hi, float *t0, float *t1)
+	{
+	if (d == 0) return o >= lo && o <= hi;
+	float a = (lo - o) / d, b = (hi - o) / d;
+	if (a > b) std::swap(a, b);
+	*t0 = std::max(*t0, a);
+	*t1 = std::min(*t1, b);
+	return *t0 <= *t1;
+	}
+//amanatides & woo: the cells o + d t passes for t in [t0, t1], in order. visit(x, y, t_enter, t_exit, axis) gets the
+//axis the ray came in through (0 x, 2 z, -1 the first cell), TRUE from it stops the walk
+template<class visitor> static bool walk_cells(const grid_ray &ray, float t0, float t1, int *visited, visitor visit)
+	{
+	float px = ray.o[0] + ray.d[0] * t0, pz = ray.o[2] + ray.d[2] * t0;
+	int x = (int)floorf(px), y = (int)floorf(pz);
+	int step_x = ray.d[0] > 0 ? 1 : (ray.d[0] < 0 ? -1 : 0), step_y = ray.d[2] > 0 ? 1 : (ray.d[2] < 0 ? -1 : 0);
+	const float never = 1e30f;
+	float next_x = step_x ? ((float)(x + (step_x > 0)) - ray.o[0]) / ray.d[0] : never;
+	float next_y = step_y ? ((float)(y + (step_y > 0)) - ray.o[2]) / ray.d[2] : never;
+	float delta_x = step_x ? 1.0f / fabsf(ray.d[0]) : never, delta_y = step_y ? 1.0f / fabsf(ray.d[2]) : never;
+	float t = t0;
+	int axis = -1;
+	for (;;)
+		{
+		float exit = std::min(std::min(next_x, next_y), t1);
+		(*visited)++;
+		if (visit(x, y, t, exit, axis)) return true;
+		if (exit >= t1) return false;
+		if (next_x < next_y)
+			{
+			x += step_x;
+			t = next_x;
+			next_x += delta_x;
+			axis = 0;
+			}
+		else
+			{
+			y += step_y;
+			t = next_y;
+			next_y += delta_y;
+			axis = 2;
+			}
+		}
+	}
+static void set_hit(const level_grid &grid, const grid_ray &ray, float t, const float normal[3], int x, int y, level_hit *hit)
+	{
+	hit->t = t;
+	hit->position[0] = (ray.o[0] + ray.d[0] * t - 0.5f) * grid.cell_size - grid.x_offset;
+	hit->position[1] = (ray.o[1] + ray.d[1] * t) * grid.cell_size;
+	hit->position[2] = (ray.o[2] + ray.d[2] * t - 0.5f) * grid.cell_size;
+	float len = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	for (int ii = 0; ii < 3; ii++)
+		hit->normal[ii] = len > 0 ? normal[ii] / len : 0;
+	hit->cell_x = x;
+	hit->cell_y = y;
+	}
+bool level_grid::raycast(const float from[3], const float to[3], level_hit *hit)
+	{
+	visited = 0;
+	grid_ray ray;
+	to_grid(*this, from, to, &ray);
+	float h = half_height / cell_size;
+	//the level's box, past it there is nothing to hit. a ray from outside comes in through the side it was clipped at
+	float t0 = 0, t1 = 1, lo[3] = { 1, -h, 1 }, hi[3] = { (float)width - 1, h, (float)height - 1 };
+	int start_axis = -1;
+	for (int ii = 0; ii < 3; ii++)
+		{
+		float before = t0;
+		if (!clip_axis(ray.o[ii], ray.d[ii], lo[ii], hi[ii], &t0, &t1)) return false;
+		if (t0 > before) start_axis = ii;
+		}
+	float best = 2, normal[3] = { 0, 0, 0 };
+	int best_x = 0, best_y = 0;
+	float plane_floor = ray.d[1] != 0 ? (-h - ray.o[1]) / ray.d[1] : -1, plane_ceiling = ray.d[1] != 0 ? (h - ray.o[1]) / ray.d[1] : -1;
+	walk_cells(ray, t0, t1, &visited, [&](int x, int y, float enter, float exit, int axis) -> bool
+		{
+		uint8_t f = get(x, y);
+		if (!f) return false;
+		if (f & LEVEL_GRID_SOLID)
+			{
+			//the walk is inside the height of the blocks already, it enters through a side (or starts in there)
+			best = enter;
+			normal[0] = normal[1] = normal[2] = 0;
+			if (axis < 0) axis = start_axis;
+			if (axis < 0)
+				for (int ii = 0; ii < 3; ii++) normal[ii] = -ray.d[ii];
+			else
+				normal[axis] = ray.d[axis] > 0 ? -1.0f : 1.0f;
+			}
+		else
+			{
+			if ((f & LEVEL_GRID_FLOOR) && plane_floor >= enter && plane_floor <= exit)		best = plane_floor;
+			if ((f & LEVEL_GRID_CEILING) && plane_ceiling >= enter && plane_ceiling <= exit)	best = std::min(best, plane_ceiling);
+			if (best > 1) return false;
+			normal[0] = normal[2] = 0;
+			normal[1] = ray.d[1] > 0 ? -1.0f : 1.0f;
+			}
+		best_x = x;
+		best_y = y;
+		return true;
+		});
+	if (best > 1) return false;
+	if (hit) set_hit(*this, ray, best, normal, best_x, best_y, hit);
+	return true;
+	}
+//-----------------------------------------------------------------
+//ericson, real-time collision detection 5.5.7: the sphere moving against a box is the ray against the box grown by r,
+//a rounded box. where the ray meets the grown box off a face, the corner region decides: capsules along the edges
+static float dot3(const float a[3], const float b[3])
+	{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+static bool ray_sphere(const float o[3], const float d[3], const float c[3], float r, float *t)
+	{
+	float m[3] = { o[0] - c[0], o[1] - c[1], o[2] - c[2] };
+	float b = dot3(m, d), cc = dot3(m, m) - r * r;
+	if (cc <= 0)
+		{
+		*t = 0;
+		return true;
+		}
+	if (b > 0) return false;
+	float a = dot3(d, d), disc = b * b - a * cc;
+	if (disc < 0 || a == 0) return false;
+	*t = (-b - sqrtf(disc)) / a;
+	return true;
+	}
+static bool ray_capsule(const float o[3], const float d[3], const float p[3], const float q[3], float r, float *t)
+	{
+	float ba[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] }, oa[3] = { o[0] - p[0], o[1] - p[1], o[2] - p[2] };
+	float baba = dot3(ba, ba), bard = dot3(ba, d), baoa = dot3(ba, oa), rdoa = dot3(d, oa), oaoa = dot3(oa, oa), dd = dot3(d, d);
+	float best = 1e30f, s;
+	//the cylinder, then the caps
+	float a = baba * dd - bard * bard, b = baba * rdoa - baoa * bard, c = baba * oaoa - baoa * baoa - r * r * baba;
+	if (baba > 0 && c <= 0 && baoa >= 0 && baoa <= baba) best = 0;
+	else if (a > 1e-12f)
+		{
+		float h = b * b - a * c;
+		if (h >= 0)
+			{
+			s = (-b - sqrtf(h)) / a;
+			float along = baoa + s * bard;
+			if (s >= 0 && along > 0 && along < baba) best = s;
+			}
+		}
+	if (ray_sphere(o, d, p, r, &s)) best = std::min(best, s);
+	if (ray_sphere(o, d, q, r, &s)) best = std::min(best, s);
+	*t = best;
+	return best < 1e30f;
+	}
+static bool sweep_box(const float o[3], const float d[3], float r, const float lo[3], const float hi[3], float t_max, float *t_hit)
+	{
+	float t0 = 0, t1 = t_max;
+	for (int ii = 0; ii < 3; ii++)
+		if (!clip_axis(o[ii], d[ii], lo[ii] - r, hi[ii] + r, &t0, &t1)) return false;
+	//which side of the box the grown box is met on, one axis outside: a face
+	float p[3];
+	int below = 0, above = 0;
+	for (int ii = 0; ii < 3; ii++)
+		{
+		p[ii] = o[ii] + d[ii] * t0;
+		if (p[ii] < lo[ii]) below |= 1 << ii;
+		if (p[ii] > hi[ii]) above |= 1 << ii;
+		}
+	int outside = below | above;
+	if ((outside & (outside - 1)) == 0)
+		{
+		*t_hit = t0;
+		return true;
+		}
+	//an edge: the capsule along it. a corner: the three capsules of its edges
+	float corner[3];
+	for (int ii = 0; ii < 3; ii++)
+		corner[ii] = (above & (1 << ii)) ? hi[ii] : lo[ii];
+	float best = 1e30f, t;
+	for (int ii = 0; ii < 3; ii++)
+		{
+		if (outside != 7 && (outside & (1 << ii))) continue;
+		float a[3] = { corner[0], corner[1], corner[2] }, b[3] = { corner[0], corner[1], corner[2] };
+		a[ii] = lo[ii];
+		b[ii] = hi[ii];
+		if (outside == 7)
+			{
+			//the edge from the corner along this axis
+			a[ii] = corner[ii];
+			b[ii] = corner[ii] == lo[ii] ? hi[ii] : lo[ii];
+			}
+		if (ray_capsule(o, d, a, b, r, &t)) best = std::min(best, t);
+		}
+	if (best > t_max) return false;
+	*t_hit = best;
+	return true;
+	}
+bool level_grid::sweep_sphere(const float from[3], const float to[3], float radius, level_hit *hit)
+	{
+	visited = 0;
+	grid_ray ray;
+	to_grid(*this, from, to, &ray);
+	float h = half_height / cell_size, r = radius / cell_size;
+	//the cells the center passes, and the ones the radius reaches around them
+	int reach = std::max(1, (int)ceilf(r));
+	float t0 = 0, t1 = 1;
+	if (!clip_axis(ray.o[0], ray.d[0], 1 - r, (float)width - 1 + r, &t0, &t1) || !clip_axis(ray.o[1], ray.d[1], -h - r, h + r, &t0, &t1) ||
+		!clip_axis(ray.o[2], ray.d[2], 1 - r, (float)height - 1 + r, &t0, &t1))
+		return false;
+	float best = 2, lo[3], hi[3];
+	int best_x = 0, best_y = 0;
+	walk_cells(ray, t0, t1, &visited, [&](int x, int y, float enter, float exit, int) -> bool
+		{
+		for (int yy = y - reach; yy <= y + reach; yy++)
+			for (int xx = x - reach; xx <= x + reach; xx++)
+				{
+				uint8_t f = get(xx, yy);
+				if (!f) continue;
+				float box_lo[3] = { (float)xx, -h, (float)yy }, box_hi[3] = { (float)xx + 1, h, (float)yy + 1 }, t;
+				//a floor or a ceiling is a box without height
+				for (int part = LEVEL_GRID_SOLID; part <= LEVEL_GRID_CEILING; part <<= 1)
+					{
+					if (!(f & part)) continue;
+					if (part == LEVEL_GRID_FLOOR)	box_hi[1] = -h;
+					if (part == LEVEL_GRID_CEILING)	box_lo[1] = box_hi[1] = h;
+					if (sweep_box(ray.o, ray.d, r, box_lo, box_hi, std::min(best, 1.0f), &t) && t < best)
+						{
+						best = t;
+						best_x = xx;
+						best_y = yy;
+						memcpy(lo, box_lo, sizeof(lo));
+						memcpy(hi, box_hi, sizeof(hi));
+						}
+					}
+				}
+		//what the cells further on could hit, they reach at their enter time at the earliest
+		return best <= exit;
+		});
+	if (best > 1) return false;
+	if (hit)
+		{
+		//away from the nearest point of what was hit
+		float normal[3];
+		for (int ii = 0; ii < 3; ii++)
+			{
+			float c = ray.o[ii] + ray.d[ii] * best;
+			normal[ii] = c - std::min(std::max(c, lo[ii]), hi[ii]);
+			}
+		if (dot3(normal, normal) < 1e-12f)
+			for (int ii = 0; ii < 3; ii++) normal[ii] = -ray.d[ii];
+		set_hit(*this, ray, best, normal, best_x, best_y, hit);
+		}
+	return true;
+	}
+bool level_grid::slide_sphere(const float from[3], const float to[3], float radius, float result[3], float normal[3])
+	{
+	float position[3] = { from[0], from[1], from[2] }, move[3] = { to[0] - from[0], to[1] - from[1], to[2] - from[2] };
+	bool touched = false;
+	int cells = 0;
+	for (int pass = 0; pass < 3; pass++)
+		{
+		float target[3] = { position[0] + move[0], position[1] + move[1], position[2] + move[2] };
+		level_hit hit;
+		bool blocked = sweep_sphere(position, target, radius, &hit);
+		cells += visited;
+		if (!blocked)
+			{
+			memcpy(position, target, sizeof(position));
+			break;
+			}
+		touched = true;
+		if (normal) memcpy(normal, hit.normal, sizeof(hit.normal));
+		//stop a hair before the contact, the next sweep would start touching it
+		float length = sqrtf(dot3(move, move)), skin = cell_size * 0.001f;
+		float t = length > 0 ? std::max(0.0f, hit.t - skin / length) : 0;
+		for (int ii = 0; ii < 3; ii++)
+			{
+			position[ii] += move[ii] * t;
+			move[ii] *= 1 - t;
+			}
+		//what is left, without the part into the hit
+		float into = dot3(move, hit.normal);
+		if (into < 0)
+			for (int ii = 0; ii < 3; ii++) move[ii] -= hit.normal[ii] * into;
+		}
+	visited = cells;
+	memcpy(result, position, sizeof(position));
+	return touched;
+	}
@@ -0,0 +1,74 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			collision against a level without looking at its walls: an occupancy grid of the cells, walked
+//			along the path (amanatides & woo), only the cells the ray or the sphere passes are tested
+//
+//			USAGE:
+//				level_grid grid;
+//				grid.cell_size = FULLWALL;						<- placement like level::process_level
+//				grid.half_height = HALFWALL;
+//				grid.x_offset = (width / 2) * FULLWALL;
+//				grid.build(cooked);								<- cooked_level, or the cells and materials of level_faces
+//				level_hit hit;
+//				if (grid.raycast(from, to, &hit)) ...			<- bullets: first wall/floor/ceiling on the segment
+//				if (grid.sweep_sphere(from, to, r, &hit)) ...	<- hit.t: where the sphere touches first
+//				grid.slide_sphere(from, to, r, moved, normal);	<- the camera: up to the wall, then along it
+//
+//			a wall block cell is a solid box (y from -half_height to half_height), a floor or a ceiling is a
+//			square at -half_height or half_height, hit from both sides. the border of the level is never a cell,
+//			like in level_faces. a query costs the cells along its path (and the ring the sphere's radius
+//			reaches), not the size of the level. positions are world space float[3]. the grid is a byte a cell for
+//			the whole level, a streamed one too (16 MB at 4096x4096), collision does not wait for tiles.
+//
+//			no windows.h in here, assettool tests it headless
+//
+//**********************************************************************************************************************************************
+#include <math.h>
+#include "level_mesh.h"
+
+#define LEVEL_GRID_SOLID		1
+#define LEVEL_GRID_FLOOR		2
+#define LEVEL_GRID_CEILING		4
+
+struct level_hit
+	{
+	float t;				//0..1 from -> to
+	float position[3];		//the point on the ray, the sphere's center
+	float normal[3];		//away from what was hit
+	int cell_x, cell_y;
+	};
+
+class level_grid
+	{
+	private:
+		vector<uint8_t> flags;		//LEVEL_GRID_ per cell, row by row
+		int width, height;
+		void set_flags(const level_material *materials, int material_count, uint8_t material_flags[256]);
+	public:
+		float cell_size;
+		float half_height;
+		float x_offset;				//cell (x, y) is centered at (x * cell_size - x_offset, 0, y * cell_size)
+		int visited;				//cells the last query walked through
+		level_grid();
+		void build(const uint8_t *cells, const level_material *materials, int width, int height);
+		void build(const cooked_level &level);
+		void clear();
+		void swap(level_grid &other);
+		uint8_t get(int x, int y) const
+			{
+			if (x <= 0 || y <= 0 || x >= width - 1 || y >= height - 1) return 0;
+			return flags[(size_t)y * width + x];
+			}
+		void cell_of(const float p[3], int *x, int *y) const		//the cell a world position is in
+			{
+			*x = (int)floorf((p[0] + x_offset) / cell_size + 0.5f);
+			*y = (int)floorf(p[2] / cell_size + 0.5f);
+			}
+		int get_width() const		{ return width; }
+		int get_height() const		{ return height; }
+		bool raycast(const float from[3], const float to[3], level_hit *hit);
+		bool sweep_sphere(const float from[3], const float to[3], float radius, level_hit *hit);
+		//moves as far as it can, what is left slides along the hit (3 times at most). TRUE if it hit something
+		bool slide_sphere(const float from[3], const float to[3], float radius, float result[3], float normal[3] = NULL);
+	};
@@ -0,0 +1,183 @@
+#include "level_mesh.h"
+#include <string.h>
+#include <algorithm>
+
+static void add_face(vector<level_face> &faces, int x, int y, int rotation, int texture_no)
+	{
+	level_face f;
+	f.x = x;
+	f.y = y;
+	f.size_x = f.size_y = 1;
+	f.rotation = rotation;
+	f.texture_no = texture_no;
+	faces.push_back(f);
+	}
+void level_faces(const uint8_t *cells, const level_material *materials, int width, int height, vector<level_face> &faces)
+	{
+	level_faces(cells, materials, width, height, 0, 0, width, height, faces);
+	}
+void level_faces(const uint8_t *cells, const level_material *materials, int width, int height, int x0, int y0, int x1, int y1, vector<level_face> &faces)
+	{
+	faces.clear();
+	//wall information is the interface between cells, only the inner ones are cells
+	x0 = std::max(x0, 1);
+	y0 = std::max(y0, 1);
+	x1 = std::min(x1, width - 1);
+	y1 = std::min(y1, height - 1);
+	for (int yy = y0; yy < y1; yy++)
+		for (int xx = x0; xx < x1; xx++)
+			{
+			const uint8_t *cell = cells + (size_t)yy * width + xx;
+			const level_material &m = materials[*cell];
+			if (m.wall != LEVEL_NONE)
+				{
+				//a neighbour is open if it has a floor or a ceiling
+				const level_material &left = materials[cell[-1]], &right = materials[cell[1]], &top = materials[cell[width]], &bottom = materials[cell[-width]];
+				if (left.ceiling != LEVEL_NONE || left.floor != LEVEL_NONE)		add_face(faces, xx, yy, LEVEL_FACE_WEST, m.wall);
+				if (right.ceiling != LEVEL_NONE || right.floor != LEVEL_NONE)	add_face(faces, xx, yy, LEVEL_FACE_EAST, m.wall);
+				if (top.ceiling != LEVEL_NONE || top.floor != LEVEL_NONE)		add_face(faces, xx, yy, LEVEL_FACE_NORTH, m.wall);
+				if (bottom.ceiling != LEVEL_NONE || bottom.floor != LEVEL_NONE)	add_face(faces, xx, yy, LEVEL_FACE_SOUTH, m.wall);
+				}
+			if (m.ceiling != LEVEL_NONE)
+				add_face(faces, xx, yy, LEVEL_FACE_CEILING, m.ceiling);
+			if (m.floor != LEVEL_NONE)
+				add_face(faces, xx, yy, LEVEL_FACE_FLOOR, m.floor);
+			}
+	}
+void level_face_uv_size(const level_face &face, int *size_u, int *size_v)
+	{
+	if (face.rotation == LEVEL_FACE_EAST || face.rotation == LEVEL_FACE_WEST)
+		{
+		*size_u = face.size_y;
+		*size_v = 1;
+		}
+	else if (face.rotation == LEVEL_FACE_SOUTH || face.rotation == LEVEL_FACE_NORTH)
+		{
+		*size_u = face.size_x;
+		*size_v = 1;
+		}
+	else
+		{
+		*size_u = face.size_x;
+		*size_v = face.size_y;
+		}
+	}
+static bool face_key_less(const level_face &a, const level_face &b)
+	{
+	if (a.rotation != b.rotation) return a.rotation < b.rotation;
+	return a.texture_no < b.texture_no;
+	}
+void merge_level_faces(const vector<level_face> &faces, vector<level_face> &merged)
+	{
+	merged.clear();
+	if (faces.empty()) return;
+	vector<level_face> sorted(faces);
+	std::stable_sort(sorted.begin(), sorted.end(), face_key_less);
+	vector<unsigned char> grid;
+	//one grid per rotation and texture, only over the cells that group covers
+	for (size_t first = 0, last; first < sorted.size(); first = last)
+		{
+		int x0 = sorted[first].x, y0 = sorted[first].y, x1 = x0, y1 = y0;
+		for (last = first; last < sorted.size() && !face_key_less(sorted[first], sorted[last]); last++)
+			{
+			x0 = std::min(x0, sorted[last].x);
+			y0 = std::min(y0, sorted[last].y);
+			x1 = std::max(x1, sorted[last].x + sorted[last].size_x);
+			y1 = std::max(y1, sorted[last].y + sorted[last].size_y);
+			}
+		int w = x1 - x0, h = y1 - y0;
+		grid.assign((size_t)w * h, 0);
+		for (size_t ii = first; ii < last; ii++)
+			for (int y = 0; y < sorted[ii].size_y; y++)
+				memset(&grid[(size_t)(sorted[ii].y - y0 + y) * w + sorted[ii].x - x0], 1, sorted[ii].size_x);
+		int rotation = sorted[first].rotation;
+		//walls are one cell high: the ones facing y run along x, the ones facing x along y
+		bool along_x = rotation != LEVEL_FACE_EAST && rotation != LEVEL_FACE_WEST;
+		bool along_y = rotation != LEVEL_FACE_SOUTH && rotation != LEVEL_FACE_NORTH;
+		for (int y = 0; y < h; y++)
+			for (int x = 0; x < w; x++)
+				{
+				if (!grid[(size_t)y * w + x]) continue;
+				int run = 1;
+				if (along_x)
+					while (x + run < w && grid[(size_t)y * w + x + run]) run++;
+				int rows = 1;
+				if (along_y)
+					for (; y + rows < h; rows++)
+						{
+						const unsigned char *row = &grid[(size_t)(y + rows) * w + x];
+						if (memchr(row, 0, run)) break;
+						}
+				for (int r = 0; r < rows; r++)
+					memset(&grid[(size_t)(y + r) * w + x], 0, run);
+				level_face f = sorted[first];
+				f.x = x0 + x;
+				f.y = y0 + y;
+				f.size_x = run;
+				f.size_y = rows;
+				merged.push_back(f);
+				}
+		}
+	}
+//***************************************************************
+//		static batching
+//***************************************************************
+//wall::get_matrix per rotation: where the quad's own x, y and z end up, and how far it is pushed along its z
+static const float face_axes[6][3][3] =
+	{
+	{ { -1, 0, 0 }, { 0, 1, 0 }, { 0, 0, -1 } },		//RotationY(pi)
+	{ { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } },		//RotationY(pi/2)
+	{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+	{ { 0, 0, 1 }, { 0, 1, 0 }, { -1, 0, 0 } },		//RotationY(-pi/2)
+	{ { 1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } },		//RotationX(pi/2)
+	{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } },		//RotationX(-pi/2)
+	};
+static const float face_push[6] = { 1, 1, 1, 1, -1, -1 };
+static bool batch_less(const level_face &a, const level_face &b)
+	{
+	return a.texture_no < b.texture_no;
+	}
+void bake_level_faces(const vector<level_face> &faces, float cell_size, float x_offset, vector<mesh_vertex> &vertices, vector<level_batch> &batches)
+	{
+	//the wall quad: two triangles in the xy plane, facing -z
+	static const float quad[6][4] = { { -1, 1, 0, 0 }, { 1, 1, 1, 0 }, { -1, -1, 0, 1 }, { 1, 1, 1, 0 }, { 1, -1, 1, 1 }, { -1, -1, 0, 1 } };
+	vector<level_face> sorted(faces);
+	std::stable_sort(sorted.begin(), sorted.end(), batch_less);
+	vertices.resize(sorted.size() * 6);
+	batches.clear();
+	float half = cell_size * 0.5f;
+	for (size_t ii = 0; ii < sorted.size(); ii++)
+		{
+		const level_face &f = sorted[ii];
+		if (batches.empty() || batches.back().texture_no != f.texture_no)
+			{
+			level_batch b;
+			b.texture_no = f.texture_no;
+			b.first_vertex = (int)ii * 6;
+			b.vertex_count = 0;
+			batches.push_back(b);
+			}
+		batches.back().vertex_count += 6;
+		int rotation = f.rotation >= 0 && f.rotation < 6 ? f.rotation : 0;
+		const float (*axes)[3] = face_axes[rotation];
+		int size_u, size_v;
+		level_face_uv_size(f, &size_u, &size_v);
+		//the middle of the first and the last cell
+		float center[3] = { (f.x + (f.size_x - 1) * 0.5f) * cell_size - x_offset, 0, (f.y + (f.size_y - 1) * 0.5f) * cell_size };
+		for (int k = 0; k < 6; k++)
+			{
+			float local[3] = { quad[k][0] * half * size_u, quad[k][1] * half * size_v, face_push[rotation] * half };
+			mesh_vertex &v = vertices[ii * 6 + k];
+			float pos[3], norm[3];
+			for (int c = 0; c < 3; c++)
+				{
+				pos[c] = center[c] + local[0] * axes[0][c] + local[1] * axes[1][c] + local[2] * axes[2][c];
+				norm[c] = -axes[2][c];
+				}
+			v.pos = make_vec3(pos[0], pos[1], pos[2]);
+			v.norm = make_vec3(norm[0], norm[1], norm[2]);
+			v.tex.x = quad[k][2] * size_u;
+			v.tex.y = quad[k][3] * size_v;
+			}
+		}
+	}
@@ -0,0 +1,138 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			the faces of a level bitmap (level.bmp) and the greedy merge of them into bigger rectangles,
+//			the level compiler (level_cook.cpp) that turns the bitmap into a cooked .level once
+//
+//			USAGE:
+//				cooked_level cooked;
+//				load_level_cached("level.bmp", cooked);							<- cooks "level.bmp.level" if it is missing or old, then maps it
+//				cooked.faces, cooked.header->face_count							<- the merged faces, nothing left to decode at load time
+//
+//				vector<level_face> faces, merged;
+//				level_faces(cells, materials, width, height, faces);			<- one face per wall/floor/ceiling cell, as level::process_level did
+//				merge_level_faces(faces, merged);									<- same area, far fewer quads
+//				level_face_uv_size(merged[i], &u, &v);								<- the texture repeats once per cell (wrap sampler)
+//				bake_level_faces(merged, FULLWALL, x_offset, vertices, batches);	<- world space triangles, one range per texture
+//
+//			a pixel is one cell: blue > 0 a wall block (texture 255 - blue) with a wall on every side that borders
+//			a red/green cell, green > 0 a floor (255 - green), red > 0 a ceiling (255 - red). the border pixels of
+//			the bitmap are never cells. the compiler keeps a pixel as a material id, an index into the few
+//			(wall, floor, ceiling) texture combinations the level uses. walls are one cell high, so they merge in rows along their plane, floors
+//			and ceilings merge in both directions: widest run first, then as many rows down as fit.
+//
+//			no windows.h in here, assettool tests it headless
+//
+//**********************************************************************************************************************************************
+#include <vector>
+#include "mesh.h"
+#include "mapped_file.h"
+using std::vector;
+
+#define LEVEL_FACE_SOUTH		0		//wall::rotation: a wall on the -y side of its cell (the open cell is y - 1)
+#define LEVEL_FACE_EAST			1		//+x
+#define LEVEL_FACE_NORTH		2		//+y
+#define LEVEL_FACE_WEST			3		//-x
+#define LEVEL_FACE_FLOOR		4
+#define LEVEL_FACE_CEILING		5
+
+struct level_face
+	{
+	int x, y;				//first cell (lowest x and y)
+	int size_x, size_y;		//cells covered in x and y, walls have 1 across their plane
+	int rotation;			//LEVEL_FACE_
+	int texture_no;
+	};
+
+#define LEVEL_NONE				0xff	//level_material: no wall/floor/ceiling here (the color channel was 0)
+#define LEVEL_MAX_MATERIALS		256
+
+//texture numbers of a cell: 255 - blue, 255 - green, 255 - red
+struct level_material
+	{
+	uint8_t wall;
+	uint8_t floor;
+	uint8_t ceiling;
+	uint8_t pad;
+	};
+
+//cells: width * height material ids, row 0 is the bottom row of the bitmap
+void level_faces(const uint8_t *cells, const level_material *materials, int width, int height, vector<level_face> &faces);
+//only the cells in [x0, x1) x [y0, y1), one tile of a streamed level (level_stream.h)
+void level_faces(const uint8_t *cells, const level_material *materials, int width, int height, int x0, int y0, int x1, int y1, vector<level_face> &faces);
+//coplanar neighbours with the same rotation and texture become one face
+void merge_level_faces(const vector<level_face> &faces, vector<level_face> &merged);
+//cells along the quad's own x and y (the texture's u and v): walls run along x or y, floors span both
+void level_face_uv_size(const level_face &face, int *size_u, int *size_v);
+
+//static batching: the level never moves, so every face is put into world space once (what wall::get_matrix
+//does to the 2x2 wall quad) and the faces are sorted by texture, one draw per texture
+struct level_batch
+	{
+	int texture_no;
+	int first_vertex;
+	int vertex_count;		//6 a face, no index buffer like the wall quad
+	};
+//cell (x, y) is centered at (x * cell_size - x_offset, 0, y * cell_size)
+void bake_level_faces(const vector<level_face> &faces, float cell_size, float x_offset, vector<mesh_vertex> &vertices, vector<level_batch> &batches);
+
+//---------------------------------------------- level compiler ----------------------------------------------
+#define LEVELCACHE_MAGIC		0x4c56454c	//"LEVL"
+#define LEVELCACHE_VERSION		2
+#define LEVEL_TILE_SIZE			64		//the cells are stored in tiles of 64x64, one page each
+
+//file layout: header | materials | cells (1 byte each, by tile: row after row of tiles) | merged faces
+struct cooked_level_header
+	{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t material_count;
+	uint32_t face_count;
+	uint32_t cell_face_count;	//faces before merging
+	uint32_t pad;
+	uint64_t source_hash;		//fnv1a of the bitmap, like the mesh cache
+	uint64_t source_size;
+	uint64_t source_time;
+	};
+
+class cooked_level
+	{
+	private:
+		mapped_file file;
+		bool attach(const unsigned char *data, size_t size);
+	public:
+		const cooked_level_header *header;
+		const level_material *materials;	//all of these point into the mapping
+		const uint8_t *cells;				//by tile, see cell(), what a tile of a streamed level reads is one page
+		const level_face *faces;
+		cooked_level()
+			{
+			header = NULL;
+			materials = NULL;
+			cells = NULL;
+			faces = NULL;
+			}
+		bool open(const char *cooked_filename);
+		bool open(const unsigned char *data, size_t size);	//a cooked file in memory (asset pack), has to stay there until close()
+		void close();
+		uint8_t cell(int x, int y) const
+			{
+			int tiles_x = (header->width + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE;
+			size_t tile = (size_t)(y / LEVEL_TILE_SIZE) * tiles_x + x / LEVEL_TILE_SIZE;
+			return cells[tile * LEVEL_TILE_SIZE * LEVEL_TILE_SIZE + (y % LEVEL_TILE_SIZE) * LEVEL_TILE_SIZE + x % LEVEL_TILE_SIZE];
+			}
+		//[x0, x1) x [y0, y1) row by row, outside the level 0 (nothing there)
+		void read_cells(int x0, int y0, int x1, int y1, uint8_t *result) const;
+	};
+
+//the bitmap checked and turned into material ids: 24 or 32 bit uncompressed, bottom up or top down, padded rows.
+//FALSE with a reason for anything else (palettes, rle, cut off files)
+bool read_level_bitmap(const unsigned char *data, size_t size, int *width, int *height, vector<uint8_t> &cells,
+	vector<level_material> &materials, const char **error = NULL);
+bool is_level_source(const char *filename);		//level*.bmp, packed as its cooked .level and not as a texture
+void cooked_level_name(const char *source, char *cooked, size_t cooked_size);
+bool cook_level(const char *source, const char *cooked, const char **error = NULL);
+bool level_cached(const char *source, char *cooked, size_t cooked_size);	//FALSE: no usable cooked file (and none could be made)
+bool load_level_cached(const char *source, cooked_level &level);
@@ -0,0 +1,381 @@
+#include "level_pvs.h"
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <algorithm>
+
+//the lines v = m u + c (0 <= m <= 1) of an octant that are still possible, a convex polygon in (m, c)
+#define PVS_MAX_POINTS		32
+struct pvs_polygon
+	{
+	int count;
+	double m[PVS_MAX_POINTS], c[PVS_MAX_POINTS];
+	};
+//the used corners only, a polygon is mostly 3 to 6 of them
+static void polygon_copy(const pvs_polygon &in, pvs_polygon &out)
+	{
+	out.count = in.count;
+	memcpy(out.m, in.m, in.count * sizeof(double));
+	memcpy(out.c, in.c, in.count * sizeof(double));
+	}
+static double polygon_area(const pvs_polygon &p)
+	{
+	double area = 0;
+	for (int ii = 0, jj = p.count - 1; ii < p.count; jj = ii++)
+		area += p.m[jj] * p.c[ii] - p.m[ii] * p.c[jj];
+	return fabs(area) * 0.5;
+	}
+//lines through a single point (a gap between two walls that only touch at a corner) have no area, nothing to see through
+static bool polygon_empty(const pvs_polygon &p)
+	{
+	return p.count < 3 || polygon_area(p) < 1e-12;
+	}
+//what keeps a m + b c <= d
+static void polygon_clip(const pvs_polygon &in, double a, double b, double d, pvs_polygon &out)
+	{
+	out.count = 0;
+	for (int ii = 0; ii < in.count && out.count < PVS_MAX_POINTS - 1; ii++)
+		{
+		int jj = ii + 1 == in.count ? 0 : ii + 1;
+		double di = a * in.m[ii] + b * in.c[ii] - d, dj = a * in.m[jj] + b * in.c[jj] - d;
+		if (di <= 0)
+			{
+			out.m[out.count] = in.m[ii];
+			out.c[out.count++] = in.c[ii];
+			}
+		if ((di < 0 && dj > 0) || (di > 0 && dj < 0))
+			{
+			double t = di / (di - dj);
+			out.m[out.count] = in.m[ii] + (in.m[jj] - in.m[ii]) * t;
+			out.c[out.count++] = in.c[ii] + (in.c[jj] - in.c[ii]) * t;
+			}
+		}
+	}
+static bool point_less(const std::pair<double, double> &a, const std::pair<double, double> &b)
+	{
+	return a.first < b.first || (a.first == b.first && a.second < b.second);
+	}
+static double turn(const std::pair<double, double> &o, const std::pair<double, double> &a, const std::pair<double, double> &b)
+	{
+	return (a.first - o.first) * (b.second - o.second) - (a.second - o.second) * (b.first - o.first);
+	}
+//the hull of both (andrew's monotone chain): more lines than the union, never fewer
+static void polygon_hull(const pvs_polygon &a, const pvs_polygon &b, pvs_polygon &out)
+	{
+	std::pair<double, double> points[PVS_MAX_POINTS * 2], hull[PVS_MAX_POINTS * 4];
+	int n = 0, k = 0;
+	for (int ii = 0; ii < a.count; ii++) points[n++] = std::make_pair(a.m[ii], a.c[ii]);
+	for (int ii = 0; ii < b.count; ii++) points[n++] = std::make_pair(b.m[ii], b.c[ii]);
+	//a handful of points, mostly sorted already
+	for (int ii = 1; ii < n; ii++)
+		for (int jj = ii; jj > 0 && point_less(points[jj], points[jj - 1]); jj--)
+			std::swap(points[jj], points[jj - 1]);
+	for (int ii = 0; ii < n; ii++)
+		{
+		while (k >= 2 && turn(hull[k - 2], hull[k - 1], points[ii]) <= 0) k--;
+		hull[k++] = points[ii];
+		}
+	for (int ii = n - 2, lower = k + 1; ii >= 0; ii--)
+		{
+		while (k >= lower && turn(hull[k - 2], hull[k - 1], points[ii]) <= 0) k--;
+		hull[k++] = points[ii];
+		}
+	k = std::max(k - 1, 0);
+	if (k > PVS_MAX_POINTS)
+		{
+		//too many corners: the bounding box, still all of it
+		double m0 = hull[0].first, m1 = m0, c0 = hull[0].second, c1 = c0;
+		for (int ii = 1; ii < k; ii++)
+			{
+			m0 = std::min(m0, hull[ii].first);
+			m1 = std::max(m1, hull[ii].first);
+			c0 = std::min(c0, hull[ii].second);
+			c1 = std::max(c1, hull[ii].second);
+			}
+		double m[4] = { m0, m1, m1, m0 }, c[4] = { c0, c0, c1, c1 };
+		out.count = 4;
+		memcpy(out.m, m, sizeof(m));
+		memcpy(out.c, c, sizeof(c));
+		return;
+		}
+	out.count = k;
+	for (int ii = 0; ii < k; ii++)
+		{
+		out.m[ii] = hull[ii].first;
+		out.c[ii] = hull[ii].second;
+		}
+	}
+//zero bytes as 0 and the count of them, like quake's vis data
+static void compress_row(const vector<uint8_t> &row, std::string &out)
+	{
+	out.clear();
+	for (size_t ii = 0; ii < row.size(); ii++)
+		{
+		out += (char)row[ii];
+		if (row[ii]) continue;
+		size_t run = 1;
+		while (ii + 1 < row.size() && !row[ii + 1] && run < 255)
+			{
+			ii++;
+			run++;
+			}
+		out += (char)run;
+		}
+	}
+//-----------------------------------------------------------------
+level_pvs::level_pvs()
+	{
+	width = height = block = blocks_x = blocks_y = row_bytes = 0;
+	build_seconds = 0;
+	open_cells = unique_rows = 0;
+	visible_cells = visible_blocks = 0;
+	}
+void level_pvs::clear()
+	{
+	vector<int>().swap(rows);
+	vector<uint8_t>().swap(data);
+	width = height = blocks_x = blocks_y = row_bytes = 0;
+	open_cells = unique_rows = 0;
+	}
+//the open cells the lines through a kx x ky rectangle of open cells (x0, y0 its lowest corner) reach, into seen. every
+//octant: u along x or y (swapped), both counted in the octant's direction, a cell (u, v) is [u, u + 1] x [v, v + 1]
+struct pvs_sweep
+	{
+	const uint8_t *open;
+	int width, height;
+	vector<pvs_polygon> previous, current;
+	vector<int> stamp;
+	int sweeps;
+	};
+static void sweep_lines(pvs_sweep &s, int x0, int y0, int kx, int ky, vector<int> &seen)
+	{
+	s.sweeps++;
+	seen.clear();
+	for (int octant = 0; octant < 8; octant++)
+		{
+		int swapped = octant & 4, sx = (octant & 1) ? -1 : 1, sy = (octant & 2) ? -1 : 1;
+		int cx = sx > 0 ? x0 : x0 + kx - 1, cy = sy > 0 ? y0 : y0 + ky - 1, ku = swapped ? ky : kx, kv = swapped ? kx : ky;
+		//the lines through the rectangle, 0 <= m <= 1: at u = 0 below its top, at u = ku above its bottom
+		pvs_polygon start_lines;
+		double start_m[4] = { 0, 1, 1, 0 }, start_c[4] = { 0, -(double)ku, (double)kv, (double)kv };
+		start_lines.count = 4;
+		memcpy(start_lines.m, start_m, sizeof(start_m));
+		memcpy(start_lines.c, start_c, sizeof(start_c));
+		int previous_lo = 0, previous_hi = -1;
+		for (int u = 0; ; u++)
+			{
+			int lo = u < ku ? 0 : previous_lo, current_lo = -1, current_hi = -1;
+			for (int v = lo; v <= u + kv; v++)
+				{
+				pvs_polygon &lines = s.current[v];
+				lines.count = 0;
+				if (u < ku && v < kv)
+					polygon_copy(start_lines, lines);
+				else
+					{
+					pvs_polygon from_left, from_below;
+					from_left.count = from_below.count = 0;
+					//in through the left side at u: v <= m u + c <= v + 1
+					int dx = swapped ? v : u - 1, dy = swapped ? u - 1 : v, x = cx + sx * dx, y = cy + sy * dy;
+					if (u > 0 && v >= previous_lo && v <= previous_hi && s.previous[v].count && x >= 0 && y >= 0 && x < s.width && y < s.height &&
+						s.open[(size_t)y * s.width + x])
+						{
+						pvs_polygon half;
+						polygon_clip(s.previous[v], -u, -1, -v, half);
+						polygon_clip(half, u, 1, v + 1, from_left);
+						}
+					//in through the bottom at v: m u + c <= v <= m (u + 1) + c
+					dx = swapped ? v - 1 : u;
+					dy = swapped ? u : v - 1;
+					x = cx + sx * dx;
+					y = cy + sy * dy;
+					if (v > lo && s.current[v - 1].count && x >= 0 && y >= 0 && x < s.width && y < s.height && s.open[(size_t)y * s.width + x])
+						{
+						pvs_polygon half;
+						polygon_clip(s.current[v - 1], u, 1, v, half);
+						polygon_clip(half, -(u + 1), -1, -v, from_below);
+						}
+					if (polygon_empty(from_left)) from_left.count = 0;
+					if (polygon_empty(from_below)) from_below.count = 0;
+					if (from_left.count && from_below.count)	polygon_hull(from_left, from_below, lines);
+					else if (from_left.count)					polygon_copy(from_left, lines);
+					else if (from_below.count)					polygon_copy(from_below, lines);
+					}
+				if (!lines.count)
+					{
+					//nothing comes in from the left past previous_hi, and nothing from below now
+					if (v > previous_hi && v >= kv) break;
+					continue;
+					}
+				if (current_lo < 0) current_lo = v;
+				current_hi = v;
+				int dx = swapped ? v : u, dy = swapped ? u : v, x = cx + sx * dx, y = cy + sy * dy;
+				size_t cell = (size_t)y * s.width + x;
+				if (x >= 0 && y >= 0 && x < s.width && y < s.height && s.open[cell] && s.stamp[cell] != s.sweeps)
+					{
+					s.stamp[cell] = s.sweeps;
+					seen.push_back((int)cell);
+					}
+				}
+			if (current_lo < 0) break;
+			s.previous.swap(s.current);
+			previous_lo = current_lo;
+			previous_hi = current_hi;
+			}
+		}
+	}
+void level_pvs::build(const level_grid &grid, int block_size)
+	{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	clear();
+	if ((size_t)grid.get_width() * grid.get_height() > LEVEL_PVS_CELLS) return;
+	width = grid.get_width();
+	height = grid.get_height();
+	block = block_size;
+	blocks_x = (width + block - 1) / block;
+	blocks_y = (height + block - 1) / block;
+	row_bytes = (blocks_x * blocks_y + 7) / 8;
+	rows.assign((size_t)width * height, -1);
+	//a wall stops the lines, the border too (get() is 0 there, like for a cell without anything, that is seen through)
+	vector<uint8_t> open((size_t)width * height, 0);
+	for (int y = 1; y < height - 1; y++)
+		for (int x = 1; x < width - 1; x++)
+			open[(size_t)y * width + x] = !(grid.get(x, y) & LEVEL_GRID_SOLID);
+
+	pvs_sweep sweep;
+	sweep.open = &open[0];
+	sweep.width = width;
+	sweep.height = height;
+	sweep.previous.resize(std::max(width, height) + block + 2);
+	sweep.current.resize(sweep.previous.size());
+	sweep.stamp.assign((size_t)width * height, 0);
+	sweep.sweeps = 0;
+	vector<int> seen;
+	vector<uint8_t> covered(block * block);
+	vector<uint8_t> row(row_bytes);
+	std::map<std::string, int> stored;
+	std::string packed;
+	double cells_sum = 0, blocks_sum = 0;
+	for (int by = 0; by < blocks_y; by++)
+		for (int bx = 0; bx < blocks_x; bx++)
+			{
+			int x0 = bx * block, y0 = by * block, x1 = std::min(x0 + block, width), y1 = std::min(y0 + block, height);
+			//the open cells of the block in rectangles without walls (a room, a stretch of corridor), greedy: as wide as it
+			//goes, then as many rows as fit. one set for each rectangle, what the lines through it reach: a little more than
+			//each of its cells sees, far fewer sweeps
+			memset(&covered[0], 0, covered.size());
+			for (int y = y0; y < y1; y++)
+				for (int x = x0; x < x1; x++)
+					{
+					if (!open[(size_t)y * width + x] || covered[(y - y0) * block + x - x0]) continue;
+					int rx = x, ry = y + 1;
+					while (rx < x1 && open[(size_t)y * width + rx] && !covered[(y - y0) * block + rx - x0]) rx++;
+					for (bool fits = true; fits && ry < y1; ry += fits)
+						for (int xx = x; xx < rx && fits; xx++)
+							fits = open[(size_t)ry * width + xx] && !covered[(ry - y0) * block + xx - x0];
+					for (int yy = y; yy < ry; yy++)
+						memset(&covered[(yy - y0) * block + x - x0], 1, rx - x);
+					sweep_lines(sweep, x, y, rx - x, ry - y, seen);
+					//the blocks of the seen cells and of the walls around them
+					memset(&row[0], 0, row.size());
+					for (size_t ii = 0; ii < seen.size(); ii++)
+						{
+						int sx = seen[ii] % width, sy = seen[ii] / width;
+						int around[5][2] = { { sx, sy }, { sx - 1, sy }, { sx + 1, sy }, { sx, sy - 1 }, { sx, sy + 1 } };
+						for (int jj = 0; jj < 5; jj++)
+							{
+							int b = (around[jj][1] / block) * blocks_x + around[jj][0] / block;
+							row[b >> 3] |= 1 << (b & 7);
+							}
+						}
+					int set = 0;
+					for (size_t ii = 0; ii < row.size(); ii++)
+						for (uint8_t bits = row[ii]; bits; bits &= bits - 1) set++;
+					int sources = (rx - x) * (ry - y);
+					open_cells += sources;
+					cells_sum += (double)seen.size() * sources;
+					blocks_sum += (double)set * sources;
+					compress_row(row, packed);
+					std::map<std::string, int>::iterator found = stored.find(packed);
+					if (found == stored.end())
+						{
+						found = stored.insert(std::make_pair(packed, (int)data.size())).first;
+						data.insert(data.end(), packed.begin(), packed.end());
+						}
+					for (int yy = y; yy < ry; yy++)
+						for (int xx = x; xx < rx; xx++)
+							rows[(size_t)yy * width + xx] = found->second;
+					}
+			}
+	unique_rows = (int)stored.size();
+	visible_cells = open_cells ? cells_sum / open_cells : 0;
+	visible_blocks = open_cells ? blocks_sum / open_cells : 0;
+	build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+bool level_pvs::get_visible(int x, int y, vector<uint8_t> &blocks) const
+	{
+	if (x < 0 || y < 0 || x >= width || y >= height || rows[(size_t)y * width + x] < 0) return false;
+	blocks.resize(row_bytes);
+	const uint8_t *in = &data[rows[(size_t)y * width + x]];
+	for (int ii = 0; ii < row_bytes; )
+		{
+		if (*in)
+			blocks[ii++] = *in++;
+		else
+			{
+			int run = in[1];
+			memset(&blocks[ii], 0, run);
+			ii += run;
+			in += 2;
+			}
+		}
+	return true;
+	}
+//-----------------------------------------------------------------
+static bool block_less(const std::pair<int, level_face> &a, const std::pair<int, level_face> &b)
+	{
+	if (a.second.texture_no != b.second.texture_no) return a.second.texture_no < b.second.texture_no;
+	return a.first < b.first;
+	}
+void bake_level_blocks(const vector<level_face> &faces, int blocks_x, int block_size, float cell_size, float x_offset,
+	vector<mesh_vertex> &vertices, vector<level_block_batch> &batches)
+	{
+	//a face over more than one block becomes a piece in each, the texture repeats once a cell so the seams do not show
+	vector<std::pair<int, level_face> > pieces;
+	for (size_t ii = 0; ii < faces.size(); ii++)
+		{
+		const level_face &f = faces[ii];
+		for (int y = f.y; y < f.y + f.size_y; y = (y / block_size + 1) * block_size)
+			for (int x = f.x; x < f.x + f.size_x; x = (x / block_size + 1) * block_size)
+				{
+				level_face piece = f;
+				piece.x = x;
+				piece.y = y;
+				piece.size_x = std::min(f.x + f.size_x, (x / block_size + 1) * block_size) - x;
+				piece.size_y = std::min(f.y + f.size_y, (y / block_size + 1) * block_size) - y;
+				pieces.push_back(std::make_pair((y / block_size) * blocks_x + x / block_size, piece));
+				}
+		}
+	std::stable_sort(pieces.begin(), pieces.end(), block_less);
+	vector<level_face> sorted(pieces.size());
+	for (size_t ii = 0; ii < pieces.size(); ii++)
+		sorted[ii] = pieces[ii].second;
+	//bake_level_faces keeps the order of one texture, six vertices a piece
+	vector<level_batch> by_texture;
+	bake_level_faces(sorted, cell_size, x_offset, vertices, by_texture);
+	batches.clear();
+	for (size_t ii = 0; ii < pieces.size(); ii++)
+		{
+		if (batches.empty() || batches.back().block != pieces[ii].first || batches.back().texture_no != pieces[ii].second.texture_no)
+			{
+			level_block_batch b;
+			b.block = pieces[ii].first;
+			b.texture_no = pieces[ii].second.texture_no;
+			b.first_vertex = (int)ii * 6;
+			b.vertex_count = 0;
+			batches.push_back(b);
+			}
+		batches.back().vertex_count += 6;
+		}
+	}
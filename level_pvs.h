@@ -0,0 +1,70 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			potentially visible sets of a grid level: from every open cell, the blocks of cells a line of sight can
+//			reach through the portals between open cells. made at load time from the collision grid (level_grid.h)
+//
+//			USAGE:
+//				level_pvs pvs;
+//				pvs.build(grid);									<- after grid.build(), a few ms on a maze
+//				bake_level_blocks(merged, pvs.get_blocks_x(), pvs.get_block_size(), FULLWALL, x_offset, vertices, batches);
+//																	<- the faces cut at the block lines, one range per texture and block
+//				once per frame:
+//					if (pvs.get_visible(cell_x, cell_y, seen))		<- the camera's cell, FALSE: draw everything
+//						if (level_pvs::is_set(seen, batch.block)) ...
+//
+//			a block is LEVEL_PVS_BLOCK x LEVEL_PVS_BLOCK cells. the sets are conservative: a block that holds a
+//			cell a line of sight reaches from any point of the camera's cell, or a wall around such a cell, is set.
+//			the lines are swept octant by octant, a cell keeps the lines that reach it as a convex polygon in
+//			(slope, offset), the hull of what comes in from its two neighbours behind it. walls block, everything
+//			else (floors, ceilings, cells without anything) is seen through. the open cells of a block are swept
+//			in rectangles (a room, a stretch of corridor), every cell of one gets what the whole rectangle sees.
+//			a row is a bitset over the blocks, zero bytes run length coded, the same row is stored once for all
+//			the cells that have it. levels over LEVEL_PVS_CELLS get no sets, they are drawn whole.
+//
+//			no windows.h in here, assettool tests it headless
+//
+//**********************************************************************************************************************************************
+#include "level_grid.h"
+
+#define LEVEL_PVS_BLOCK			8
+#define LEVEL_PVS_CELLS			(512 * 512)		//the build takes about a second at 256x256 rooms, more with every cell
+
+class level_pvs
+	{
+	private:
+		int width, height, block, blocks_x, blocks_y, row_bytes;
+		vector<int> rows;			//per cell, into data. -1: a wall or the border, no set
+		vector<uint8_t> data;		//compressed rows
+	public:
+		//of the last build
+		double build_seconds;
+		int open_cells;
+		int unique_rows;
+		double visible_cells;		//average over the open cells, in cells
+		double visible_blocks;		//average, in blocks
+		level_pvs();
+		void build(const level_grid &grid, int block_size = LEVEL_PVS_BLOCK);
+		void clear();
+		//the blocks seen from cell (x, y), row_bytes long. FALSE: no set there (inside a wall, outside the level)
+		bool get_visible(int x, int y, vector<uint8_t> &blocks) const;
+		static bool is_set(const vector<uint8_t> &blocks, int block_no)	{ return (blocks[block_no >> 3] >> (block_no & 7)) & 1; }
+		int get_blocks_x() const		{ return blocks_x; }
+		int get_blocks_y() const		{ return blocks_y; }
+		int get_block_size() const		{ return block; }
+		size_t get_bytes() const		{ return data.size() + rows.size() * sizeof(int); }
+		size_t get_raw_bytes() const	{ return (size_t)open_cells * row_bytes; }	//one uncompressed row per open cell
+	};
+
+//a texture's faces in one block
+struct level_block_batch
+	{
+	int block;				//block_y * blocks_x + block_x
+	int texture_no;
+	int first_vertex;
+	int vertex_count;
+	};
+//the merged faces cut at the block lines (a wall belongs to the block of its wall cell), baked like bake_level_faces,
+//sorted by texture and then by block: the visible blocks next to each other of a texture are one draw
+void bake_level_blocks(const vector<level_face> &faces, int blocks_x, int block_size, float cell_size, float x_offset,
+	vector<mesh_vertex> &vertices, vector<level_block_batch> &batches);
@@ -0,0 +1,226 @@
+#include "level_stream.h"
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+
+static double stream_seconds()
+	{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+level_stream::level_stream()
+	{
+	tiles_x = tiles_y = 0;
+	quit = false;
+	baking = 0;
+	frame = 0;
+	cell_size = 1;
+	x_offset = 0;
+	budget = LEVEL_STREAM_BUDGET;
+	resident_bytes = peak_bytes = 0;
+	loads = evictions = 0;
+	latency_sum = latency_max = 0;
+	}
+level_stream::~level_stream()
+	{
+	close();
+	}
+bool level_stream::open(const char *source)
+	{
+	close();
+	if (!load_level_cached(source, level)) return false;
+	tiles_x = (level.header->width + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE;
+	tiles_y = (level.header->height + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE;
+	tiles.assign((size_t)tiles_x * tiles_y, NULL);
+	return true;
+	}
+bool level_stream::open(const unsigned char *cooked_data, size_t size)
+	{
+	close();
+	if (!level.open(cooked_data, size)) return false;
+	tiles_x = (level.header->width + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE;
+	tiles_y = (level.header->height + LEVEL_TILE_SIZE - 1) / LEVEL_TILE_SIZE;
+	tiles.assign((size_t)tiles_x * tiles_y, NULL);
+	return true;
+	}
+void level_stream::close()
+	{
+	stop();
+	while (!resident.empty())
+		evict(resident.back());
+	for (size_t ii = 0; ii < tiles.size(); ii++)
+		delete tiles[ii];		//queued or baked, nothing was made of them yet
+	tiles.clear();
+	queue.clear();
+	baked.clear();
+	tiles_x = tiles_y = 0;
+	level.close();
+	}
+void level_stream::start(int threads)
+	{
+	stop();
+	for (int ii = 0; ii < threads; ii++)
+		workers.push_back(std::thread(&level_stream::worker_loop, this));
+	}
+void level_stream::stop()
+	{
+		{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+		}
+	wake.notify_all();
+	for (size_t ii = 0; ii < workers.size(); ii++)
+		workers[ii].join();
+	workers.clear();
+	quit = false;
+	}
+void level_stream::worker_loop()
+	{
+	for (;;)
+		{
+		level_tile *tile;
+			{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this]() { return quit || !queue.empty(); });
+			if (quit) return;
+			tile = queue.back();
+			queue.pop_back();
+			tile->state = LEVEL_TILE_BAKING;
+			baking++;
+			}
+		bake(tile);
+			{
+			std::lock_guard<std::mutex> guard(lock);
+			tile->state = LEVEL_TILE_BAKED;
+			baked.push_back(tile);
+			baking--;
+			}
+		}
+	}
+//the faces of the tile's cells (the neighbours outside it decide about the walls on its edge), merged inside the tile
+void level_stream::bake(level_tile *tile)
+	{
+	//the tile with a ring of its neighbours, row by row
+	const int size = LEVEL_TILE_SIZE + 2;
+	int x0 = tile->tile_x * LEVEL_TILE_SIZE - 1, y0 = tile->tile_y * LEVEL_TILE_SIZE - 1;
+	int width = level.header->width, height = level.header->height;
+	uint8_t window[size * size];
+	level.read_cells(x0, y0, x0 + size, y0 + size, window);
+	//the border of the level is never a cell, the ring is cut off by level_faces
+	vector<level_face> faces, merged;
+	level_faces(window, level.materials, size, size, std::max(1, 1 - x0), std::max(1, 1 - y0), std::min(size - 1, width - 1 - x0),
+		std::min(size - 1, height - 1 - y0), faces);
+	for (size_t ii = 0; ii < faces.size(); ii++)
+		{
+		faces[ii].x += x0;
+		faces[ii].y += y0;
+		}
+	merge_level_faces(faces, merged);
+	bake_level_faces(merged, cell_size, x_offset, tile->vertices, tile->batches);
+	tile->face_count = (int)merged.size();
+	tile->bytes = sizeof(level_tile) + tile->vertices.size() * sizeof(mesh_vertex) + tile->batches.size() * sizeof(level_batch);
+	}
+void level_stream::evict(level_tile *tile)
+	{
+	if (on_evict) on_evict(tile);
+	resident.erase(tile->place);
+	resident_bytes -= tile->bytes;
+	tiles[(size_t)tile->tile_y * tiles_x + tile->tile_x] = NULL;
+	delete tile;
+	evictions++;
+	}
+static bool nearest_last(const std::pair<float, level_tile*> &a, const std::pair<float, level_tile*> &b)
+	{
+	return a.first > b.first;
+	}
+int level_stream::update(float x, float z, float radius, vector<level_tile*> *ready)
+	{
+	if (ready) ready->clear();
+	if (!level.header) return 0;
+	frame++;
+	double now = stream_seconds();
+	//in cells, the tiles that touch the circle
+	float cx = (x + x_offset) / cell_size + 0.5f, cy = z / cell_size + 0.5f, r = radius / cell_size;
+	int tx0 = std::max(0, (int)floorf((cx - r) / LEVEL_TILE_SIZE)), tx1 = std::min(tiles_x - 1, (int)floorf((cx + r) / LEVEL_TILE_SIZE));
+	int ty0 = std::max(0, (int)floorf((cy - r) / LEVEL_TILE_SIZE)), ty1 = std::min(tiles_y - 1, (int)floorf((cy + r) / LEVEL_TILE_SIZE));
+	vector<std::pair<float, level_tile*> > missing;
+	std::lock_guard<std::mutex> guard(lock);
+	for (int ty = ty0; ty <= ty1; ty++)
+		for (int tx = tx0; tx <= tx1; tx++)
+			{
+			float nx = std::min(std::max(cx, (float)tx * LEVEL_TILE_SIZE), (float)(tx + 1) * LEVEL_TILE_SIZE);
+			float ny = std::min(std::max(cy, (float)ty * LEVEL_TILE_SIZE), (float)(ty + 1) * LEVEL_TILE_SIZE);
+			float d2 = (nx - cx) * (nx - cx) + (ny - cy) * (ny - cy);
+			if (d2 > r * r) continue;
+			level_tile *&tile = tiles[(size_t)ty * tiles_x + tx];
+			if (!tile)
+				{
+				tile = new level_tile;
+				tile->tile_x = tx;
+				tile->tile_y = ty;
+				tile->state = LEVEL_TILE_QUEUED;
+				tile->face_count = 0;
+				tile->bytes = 0;
+				tile->requested = now;
+				tile->latency = 0;
+				tile->user = NULL;
+				}
+			tile->frame = frame;
+			if (tile->state == LEVEL_TILE_RESIDENT)
+				resident.splice(resident.begin(), resident, tile->place);
+			else if (tile->state == LEVEL_TILE_QUEUED)
+				missing.push_back(std::make_pair(d2, tile));
+			}
+	//the queue is made new every update: what went out of range is dropped before a worker spends time on it
+	for (size_t ii = 0; ii < queue.size(); ii++)
+		if (queue[ii]->frame != frame)
+			{
+			tiles[(size_t)queue[ii]->tile_y * tiles_x + queue[ii]->tile_x] = NULL;
+			delete queue[ii];
+			}
+	std::sort(missing.begin(), missing.end(), nearest_last);
+	queue.resize(missing.size());
+	for (size_t ii = 0; ii < missing.size(); ii++)
+		queue[ii] = missing[ii].second;
+	if (workers.empty())
+		while (!queue.empty())
+			{
+			bake(queue.back());
+			baked.push_back(queue.back());
+			queue.pop_back();
+			}
+	else if (!queue.empty())
+		wake.notify_all();
+
+	now = stream_seconds();
+	for (size_t ii = 0; ii < baked.size(); ii++)
+		{
+		level_tile *tile = baked[ii];
+		//room before it comes in: least recently used first, never what this update wants. a tile that went out
+		//of range while it was baking and does not fit is dropped
+		while (resident_bytes + tile->bytes > budget && !resident.empty() && resident.back()->frame != frame)
+			evict(resident.back());
+		if (tile->frame != frame && resident_bytes + tile->bytes > budget)
+			{
+			tiles[(size_t)tile->tile_y * tiles_x + tile->tile_x] = NULL;
+			delete tile;
+			continue;
+			}
+		tile->state = LEVEL_TILE_RESIDENT;
+		resident.push_front(tile);
+		tile->place = resident.begin();
+		resident_bytes += tile->bytes;
+		tile->latency = now - tile->requested;
+		latency_sum += tile->latency;
+		latency_max = std::max(latency_max, tile->latency);
+		loads++;
+		if (ready) ready->push_back(tile);
+		}
+	baked.clear();
+	peak_bytes = std::max(peak_bytes, resident_bytes);
+	return (int)queue.size() + baking;
+	}
+bool level_streamed(const unsigned char *cooked_data, size_t size)
+	{
+	cooked_level level;
+	return level.open(cooked_data, size) && (uint64_t)level.header->width * level.header->height > LEVEL_STREAM_CELLS;
+	}
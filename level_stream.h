@@ -0,0 +1,103 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			big levels in tiles: only the tiles around the camera are baked (faces, merge, world space vertices),
+//			on worker threads, and the ones not used for the longest time are dropped when over the memory budget
+//
+//			USAGE:
+//				level_stream stream;
+//				stream.open("level.bmp");						<- maps the cooked .level (load_level_cached), nothing is baked yet
+//				stream.cell_size = FULLWALL;					<- placement like level::process_level
+//				stream.x_offset = (stream.get_width() / 2) * FULLWALL;
+//				stream.on_evict = [](level_tile *t) { ... };		<- release what was made of t->vertices (t->user)
+//				stream.start();
+//				once per frame:
+//					vector<level_tile*> ready;
+//					stream.update(cam_x, cam_z, radius, &ready);	<- asks for the tiles in radius (world units), nearest first,
+//																	   hands out the finished ones and evicts. ask for a
+//																	   tile more than the view needs, they arrive before they show
+//					stream.get_resident()						<- every baked tile, most recently used first
+//
+//			a tile is LEVEL_TILE_SIZE x LEVEL_TILE_SIZE cells (level_mesh.h, the .level stores them that way), its faces are merged inside the tile only. the budget
+//			counts the baked vertices (where ever they are after upload), room is made before a tile comes in. tiles
+//			wanted in this update are never evicted, so only a radius that needs more than the budget goes over it. the cells stay in the mapping, the
+//			system pages in what the workers read: the tile and the edges of its neighbours. a streamed level keeps its .level open.
+//
+//			no windows.h in here, assettool tests it headless
+//
+//**********************************************************************************************************************************************
+#include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "level_mesh.h"
+
+#define LEVEL_STREAM_CELLS		(1024 * 1024)		//levels with more cells than this are streamed by the game
+#define LEVEL_STREAM_BUDGET		(64 << 20)
+
+#define LEVEL_TILE_QUEUED		0
+#define LEVEL_TILE_BAKING		1
+#define LEVEL_TILE_BAKED		2		//finished by a worker, not handed out by update() yet
+#define LEVEL_TILE_RESIDENT		3
+
+struct level_tile
+	{
+	int tile_x, tile_y;
+	int state;						//LEVEL_TILE_
+	vector<mesh_vertex> vertices;	//world space, the game uploads and frees them
+	vector<level_batch> batches;	//one draw per texture, first_vertex is inside this tile
+	int face_count;
+	size_t bytes;					//vertex bytes, counted against the budget
+	uint64_t frame;					//last update() that wanted it
+	double requested;				//seconds, when it was first wanted
+	double latency;					//wanted -> handed out
+	void *user;						//the game's vertex buffer
+	std::list<level_tile*>::iterator place;	//in level_stream::resident
+	};
+
+class level_stream
+	{
+	private:
+		cooked_level level;
+		int tiles_x, tiles_y;
+		vector<level_tile*> tiles;				//tiles_x * tiles_y, NULL: not wanted
+		std::list<level_tile*> resident;		//most recently used first
+		vector<level_tile*> queue;				//waiting for a worker, the nearest last
+		vector<level_tile*> baked;				//a tile that is not wanted anymore when it is done still comes in, the lru sorts it out
+		int baking;
+		vector<std::thread> workers;
+		std::mutex lock;
+		std::condition_variable wake;
+		bool quit;
+		uint64_t frame;
+		void worker_loop();
+		void bake(level_tile *tile);
+		void evict(level_tile *tile);
+		level_stream(const level_stream&);
+		level_stream &operator=(const level_stream&);
+	public:
+		float cell_size;
+		float x_offset;							//cell (x, y) is centered at (x * cell_size - x_offset, 0, y * cell_size)
+		size_t budget;							//bytes
+		size_t resident_bytes;
+		size_t peak_bytes;
+		int loads, evictions;
+		double latency_sum, latency_max;		//seconds, of the tiles handed out so far
+		std::function<void(level_tile*)> on_evict;
+		level_stream();
+		~level_stream();
+		bool open(const char *source);
+		bool open(const unsigned char *cooked_data, size_t size);	//has to stay there until close()
+		void close();
+		void start(int threads = 1);			//0: update() bakes the tiles itself
+		void stop();
+		int update(float x, float z, float radius, vector<level_tile*> *ready = NULL);		//tiles still on their way
+		const std::list<level_tile*> &get_resident() const	{ return resident; }
+		int get_width() const					{ return level.header ? (int)level.header->width : 0; }
+		int get_height() const					{ return level.header ? (int)level.header->height : 0; }
+		const cooked_level &get_level() const	{ return level; }		//the cells, for level_grid
+	};
+
+//a cooked level the game should stream rather than build at once
+bool level_streamed(const unsigned char *cooked_data, size_t size);
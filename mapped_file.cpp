@@ -0,0 +1,123 @@
+#include "mapped_file.h"
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+mapped_file::mapped_file()
+	{
+	ptr = NULL;
+	length = 0;
+	opened = false;
+#ifdef _WIN32
+	file_handle = NULL;
+	map_handle = NULL;
+#else
+	fd = -1;
+#endif
+	}
+mapped_file::~mapped_file()
+	{
+	close();
+	}
+#ifdef _WIN32
+bool mapped_file::open(const char *filename)
+	{
+	close();
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER filesize;
+	if (!GetFileSizeEx(file, &filesize))
+		{
+		CloseHandle(file);
+		return false;
+		}
+	file_handle = file;
+	opened = true;
+	length = (size_t)filesize.QuadPart;
+	if (length == 0) return true;//nothing to map
+
+	map_handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (map_handle)
+		ptr = (const unsigned char*)MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0);
+	if (!ptr)
+		{
+		close();
+		return false;
+		}
+	return true;
+	}
+void mapped_file::close()
+	{
+	if (ptr)			UnmapViewOfFile(ptr);
+	if (map_handle)		CloseHandle(map_handle);
+	if (file_handle)	CloseHandle(file_handle);
+	ptr = NULL;
+	map_handle = NULL;
+	file_handle = NULL;
+	length = 0;
+	opened = false;
+	}
+#else
+bool mapped_file::open(const char *filename)
+	{
+	close();
+	int file = ::open(filename, O_RDONLY);
+	if (file < 0) return false;
+	struct stat st;
+	if (fstat(file, &st) != 0)
+		{
+		::close(file);
+		return false;
+		}
+	fd = file;
+	opened = true;
+	length = (size_t)st.st_size;
+	if (length == 0) return true;//mmap refuses zero length
+
+	void *p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+		{
+		close();
+		return false;
+		}
+	ptr = (const unsigned char*)p;
+	return true;
+	}
+void mapped_file::close()
+	{
+	if (ptr)		munmap((void*)ptr, length);
+	if (fd >= 0)	::close(fd);
+	ptr = NULL;
+	fd = -1;
+	length = 0;
+	opened = false;
+	}
+#endif
+//-----------------------------------------------------------------
+bool file_stamp(const char *filename, uint64_t *size, uint64_t *time)
+	{
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_stat64(filename, &st) != 0) return false;
+#else
+	struct stat st;
+	if (stat(filename, &st) != 0) return false;
+#endif
+	*size = (uint64_t)st.st_size;
+	*time = (uint64_t)st.st_mtime;
+	return true;
+	}
+bool patch_file(const char *filename, uint64_t offset, const void *data, size_t size)
+	{
+	FILE *file = fopen(filename, "r+b");
+	if (!file) return false;
+	bool written = fseek(file, (long)offset, SEEK_SET) == 0 && fwrite(data, size, 1, file) == 1;
+	return (fclose(file) == 0) && written;
+	}
@@ -0,0 +1,44 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			read only file mapping, CreateFileMapping on windows and mmap everywhere else
+//
+//			USAGE:
+//				mapped_file file;
+//				if (file.open("asteroid.3ds"))
+//					use(file.data(), file.size());		<- valid until close() or the object dies
+//
+//			no windows.h in here, so the mesh/level tools can use it headless
+//
+//**********************************************************************************************************************************************
+#include <stddef.h>
+#include <stdint.h>
+
+class mapped_file
+	{
+	private:
+		const unsigned char *ptr;
+		size_t length;
+		bool opened;
+#ifdef _WIN32
+		void *file_handle;
+		void *map_handle;
+#else
+		int fd;
+#endif
+		mapped_file(const mapped_file&);
+		mapped_file &operator=(const mapped_file&);
+	public:
+		mapped_file();
+		~mapped_file();
+		bool open(const char *filename);	//an empty file opens fine, data() is NULL then
+		void close();
+		bool is_open() const		{ return opened; }
+		const unsigned char *data() const	{ return ptr; }
+		size_t size() const			{ return length; }
+	};
+
+//size and last write time of a file, FALSE if it doesnt exist
+bool file_stamp(const char *filename, uint64_t *size, uint64_t *time);
+//overwrites size bytes at offset of an existing file, a new stamp in a cooked header. not while it is mapped
+bool patch_file(const char *filename, uint64_t offset, const void *data, size_t size);
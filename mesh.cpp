@@ -0,0 +1,705 @@
+#include "mesh.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <string>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define MESH_SSE
+#include <xmmintrin.h>
+#endif
+
+vec3 make_vec3(float x, float y, float z)
+	{
+	vec3 c = { x, y, z };
+	return c;
+	}
+vec3 operator+(const vec3 &a, const vec3 &b)
+	{
+	return make_vec3(a.x + b.x, a.y + b.y, a.z + b.z);
+	}
+vec3 operator-(const vec3 &a, const vec3 &b)
+	{
+	return make_vec3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+vec3 operator*(const vec3 &a, float s)
+	{
+	return make_vec3(a.x * s, a.y * s, a.z * s);
+	}
+float dot(const vec3 &a, const vec3 &b)
+	{
+	return a.x*b.x + a.y*b.y + a.z*b.z;
+	}
+vec3 cross(const vec3 &a, const vec3 &b)
+	{
+	return make_vec3(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
+	}
+float length(const vec3 &a)
+	{
+	return sqrt(dot(a, a));
+	}
+vec3 normalize(const vec3 &a)
+	{
+	float len = length(a);
+	if (len <= 0) return a;
+	return a * (1.0f / len);
+	}
+//***************************************************************
+//ritter: start with the two extreme points of the axis with the largest spread, then grow the sphere just
+//enough for every point outside. that is within a few % of the smallest sphere, the box center sometimes does
+//better (boxy meshes), so the smaller one of both wins.
+static void bounds_of_points(const vector<vec3> &points, mesh_bounds &bounds)
+	{
+	memset(&bounds, 0, sizeof(bounds));
+	if (points.empty()) return;
+	size_t lo[3] = { 0, 0, 0 }, hi[3] = { 0, 0, 0 };
+	bounds.bbmin = bounds.bbmax = points[0];
+	for (size_t ii = 1; ii < points.size(); ii++)
+		{
+		const float *p = &points[ii].x;
+		float *mn = &bounds.bbmin.x, *mx = &bounds.bbmax.x;
+		for (int k = 0; k < 3; k++)
+			{
+			if (p[k] < mn[k]) { mn[k] = p[k]; lo[k] = ii; }
+			if (p[k] > mx[k]) { mx[k] = p[k]; hi[k] = ii; }
+			}
+		}
+	bounds.center = (bounds.bbmin + bounds.bbmax) * 0.5f;
+	int axis = 0;
+	float spread = -1;
+	for (int k = 0; k < 3; k++)
+		{
+		vec3 d = points[hi[k]] - points[lo[k]];
+		if (dot(d, d) > spread)
+			{
+			spread = dot(d, d);
+			axis = k;
+			}
+		}
+	vec3 c = (points[lo[axis]] + points[hi[axis]]) * 0.5f;
+	float r = sqrtf(spread) * 0.5f;
+	for (size_t ii = 0; ii < points.size(); ii++)
+		{
+		vec3 d = points[ii] - c;
+		float dist = length(d);
+		if (dist <= r) continue;
+		float grown = (r + dist) * 0.5f;
+		c = c + d * ((grown - r) / dist);
+		r = grown;
+		}
+	//the exact radius around both candidates
+	float ritter = 0, box = 0;
+	for (size_t ii = 0; ii < points.size(); ii++)
+		{
+		vec3 a = points[ii] - c, b = points[ii] - bounds.center;
+		ritter = fmaxf(ritter, dot(a, a));
+		box = fmaxf(box, dot(b, b));
+		}
+	bounds.sphere_center = ritter <= box ? c : bounds.center;
+	bounds.radius = sqrtf(fminf(ritter, box));
+	}
+void compute_bounds(const mesh_vertex *vertices, size_t vertex_count, const void *indices, uint32_t index_size,
+					uint32_t first_index, uint32_t index_count, mesh_bounds &bounds)
+	{
+	vector<vec3> points;
+	if (!indices)
+		{
+		points.resize(vertex_count);
+		for (size_t ii = 0; ii < vertex_count; ii++)
+			points[ii] = vertices[ii].pos;
+		}
+	else
+		{
+		points.reserve(index_count);
+		for (uint32_t ii = first_index; ii < first_index + index_count; ii++)
+			{
+			uint32_t index = index_size == 2 ? ((const uint16_t*)indices)[ii] : ((const uint32_t*)indices)[ii];
+			if (index < vertex_count) points.push_back(vertices[index].pos);
+			}
+		}
+	bounds_of_points(points, bounds);
+	}
+//***************************************************************
+//a 0x4130 chunk: the faces of a submodel that use one material
+class face_group
+	{
+	public:
+		std::string material;
+		vector<unsigned short> faces;
+	};
+class submodel
+	{
+	public:
+		vector<vec3> positions;
+		vector<vec2> texcoords;
+		vector<unsigned short> indizes;
+		vector<face_group> groups;
+	};
+class file_3ds
+	{
+	public:
+		vector<submodel> submodels;
+		vector<mesh_material> materials;
+	};
+//the 3ds file is a tree of chunks: 2 byte id, 4 byte length (header included), payload, then sub chunks.
+//every read is checked against the span of the chunk it belongs to, a broken length stops the walk
+//instead of reading past the buffer.
+struct chunk_span
+	{
+	const unsigned char *data;
+	size_t pos, end;
+	bool has(size_t bytes) const	{ return end - pos >= bytes && pos <= end; }
+	unsigned short u16() const		{ unsigned short v; memcpy(&v, data + pos, 2); return v; }
+	unsigned int u32() const		{ unsigned int v; memcpy(&v, data + pos + 2, 4); return v; }
+	};
+//a zero terminated string at the start of the chunk, cut to the buffer. FALSE without the 0
+static bool read_string(chunk_span &chunk, char *result, size_t result_size)
+	{
+	size_t length = 0;
+	while (chunk.has(length + 1) && chunk.data[chunk.pos + length] != 0) length++;
+	if (!chunk.has(length + 1)) return false;
+	if (result_size)
+		{
+		size_t copy = length < result_size - 1 ? length : result_size - 1;
+		memcpy(result, chunk.data + chunk.pos, copy);
+		result[copy] = 0;
+		}
+	chunk.pos += length + 1;
+	return true;
+	}
+static bool parse_3ds_chunks(chunk_span span, file_3ds &model, int depth)
+	{
+	vector<submodel> &submodels = model.submodels;
+	if (depth > 16) return false;//nothing sane nests that deep
+	while (span.has(6))
+		{
+		unsigned short l_chunk_id = span.u16();
+		unsigned int l_chunk_lenght = span.u32();
+		if (l_chunk_lenght < 6 || !span.has(l_chunk_lenght)) return false;
+
+		chunk_span chunk = { span.data, span.pos + 6, span.pos + l_chunk_lenght };
+		span.pos += l_chunk_lenght;
+
+		switch (l_chunk_id)
+			{
+				//MAIN3DS, EDIT3DS, OBJ_TRIMESH: nothing but sub chunks
+				case 0x4d4d:
+				case 0x3d3d:
+				case 0x4100:
+				if (!parse_3ds_chunks(chunk, model, depth + 1)) return false;
+				break;
+
+				//--------------- EDIT_OBJECT ---------------
+				// Chunk Lenght: len(object name) + sub chunks
+				//-------------------------------------------
+				case 0x4000:
+				{
+				submodels.push_back(submodel());
+				if (!read_string(chunk, NULL, 0)) return false;
+				if (!parse_3ds_chunks(chunk, model, depth + 1)) return false;
+				}
+				break;
+
+				//--------------- TRI_VERTEXL ---------------
+				// Chunk Lenght: 1 x unsigned short (number of vertices)
+				//             + 3 x float (vertex coordinates) x (number of vertices)
+				//-------------------------------------------
+				case 0x4110:
+				{
+				if (submodels.empty() || !chunk.has(2)) return false;
+				unsigned short l_qty = chunk.u16();
+				chunk.pos += 2;
+				if (!chunk.has(l_qty * sizeof(vec3))) return false;
+				vector<vec3> &positions = submodels.back().positions;
+				positions.resize(l_qty);
+				if (l_qty) memcpy(&positions[0], chunk.data + chunk.pos, l_qty * sizeof(vec3));
+				}
+				break;
+
+				//--------------- TRI_FACEL1 ----------------
+				// Chunk Lenght: 1 x unsigned short (number of polygons)
+				//             + 4 x unsigned short (3 polygon points and the face flags) x (number of polygons)
+				//             + sub chunks (material groups, smoothing groups)
+				//-------------------------------------------
+				case 0x4120:
+				{
+				if (submodels.empty() || !chunk.has(2)) return false;
+				unsigned short l_qty = chunk.u16();
+				chunk.pos += 2;
+				if (!chunk.has(l_qty * 8)) return false;
+				vector<unsigned short> &indizes = submodels.back().indizes;
+				indizes.resize(l_qty * 3);
+				const unsigned char *faces = chunk.data + chunk.pos;
+				for (int ii = 0; ii < l_qty; ii++)
+					memcpy(&indizes[ii * 3], faces + ii * 8, 6);//skip the flags
+				chunk.pos += l_qty * 8;
+				if (!parse_3ds_chunks(chunk, model, depth + 1)) return false;
+				}
+				break;
+
+				//------------- TRI_MATERIAL ---------------
+				// Chunk Lenght: material name + 1 x unsigned short (number of faces)
+				//             + 1 x unsigned short (face index) x (number of faces)
+				//-------------------------------------------
+				case 0x4130:
+				{
+				if (submodels.empty()) return false;
+				face_group group;
+				char name[MESH_MATERIAL_NAME];
+				if (!read_string(chunk, name, sizeof(name)) || !chunk.has(2)) return false;
+				group.material = name;
+				unsigned short l_qty = chunk.u16();
+				chunk.pos += 2;
+				if (!chunk.has(l_qty * 2)) return false;
+				group.faces.resize(l_qty);
+				if (l_qty) memcpy(&group.faces[0], chunk.data + chunk.pos, l_qty * 2);
+				submodels.back().groups.push_back(group);
+				}
+				break;
+
+				//--------------- MAT_ENTRY -----------------
+				// Chunk Lenght: sub chunks (name, colors, maps)
+				//-------------------------------------------
+				case 0xafff:
+				{
+				mesh_material material;
+				memset(&material, 0, sizeof(material));
+				material.diffuse[0] = material.diffuse[1] = material.diffuse[2] = 1.0f;
+				model.materials.push_back(material);
+				if (!parse_3ds_chunks(chunk, model, depth + 1)) return false;
+				}
+				break;
+
+				//MAT_NAME, MAT_MAPNAME (only the one in MAT_TEXMAP, the other maps are skipped)
+				case 0xa000:
+				case 0xa300:
+				if (model.materials.empty()) return false;
+				if (l_chunk_id == 0xa000)	{ if (!read_string(chunk, model.materials.back().name, MESH_MATERIAL_NAME)) return false; }
+				else						{ if (!read_string(chunk, model.materials.back().texture, MESH_TEXTURE_NAME)) return false; }
+				break;
+
+				//MAT_TEXMAP: sub chunks
+				case 0xa200:
+				if (!parse_3ds_chunks(chunk, model, depth + 1)) return false;
+				break;
+
+				//--------------- MAT_DIFFUSE ---------------
+				// Chunk Lenght: color sub chunks, 0x0010 3 x float or 0x0011 3 x byte (the first one wins)
+				//-------------------------------------------
+				case 0xa020:
+				{
+				if (model.materials.empty()) return false;
+				float *diffuse = model.materials.back().diffuse;
+				while (chunk.has(6))
+					{
+					unsigned short color_id = chunk.u16();
+					unsigned int color_length = chunk.u32();
+					if (color_length < 6 || !chunk.has(color_length)) return false;
+					if (color_id == 0x0010 && color_length >= 18)
+						{
+						memcpy(diffuse, chunk.data + chunk.pos + 6, 12);
+						break;
+						}
+					if (color_id == 0x0011 && color_length >= 9)
+						{
+						for (int k = 0; k < 3; k++)
+							diffuse[k] = chunk.data[chunk.pos + 6 + k] / 255.0f;
+						break;
+						}
+					chunk.pos += color_length;
+					}
+				}
+				break;
+
+				//------------- TRI_MAPPINGCOORS ------------
+				// Chunk Lenght: 1 x unsigned short (number of mapping points)
+				//             + 2 x float (mapping coordinates) x (number of mapping points)
+				//-------------------------------------------
+				case 0x4140:
+				{
+				if (submodels.empty() || !chunk.has(2)) return false;
+				unsigned short l_qty = chunk.u16();
+				chunk.pos += 2;
+				if (!chunk.has(l_qty * sizeof(vec2))) return false;
+				vector<vec2> &texcoords = submodels.back().texcoords;
+				texcoords.resize(l_qty);
+				if (l_qty) memcpy(&texcoords[0], chunk.data + chunk.pos, l_qty * sizeof(vec2));
+				}
+				break;
+
+				//everything else (materials, keyframes, lights, cameras ...) is skipped as a whole
+				default:
+				break;
+			}
+		}
+	return true;
+	}
+//the faces of all submodels sorted by material: one range per material that is used, in the order of the
+//materials in the file. faces without a group (or with an unknown material) go into a default one at the end
+bool Parse3DS(const unsigned char *data, size_t size, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges, vector<mesh_material> *materials,
+			  bool normals)
+	{
+	file_3ds model;
+	chunk_span file = { data, 0, size };
+	if (!data || !parse_3ds_chunks(file, model, 0)) return false;
+	vector<submodel> &submodels = model.submodels;
+
+	//material per face, and how many faces and groups every material gets
+	size_t material_anz = model.materials.size() + 1, vertex_anz = 0;
+	vector<size_t> faces_per_material(material_anz, 0);
+	vector<uint32_t> groups_per_material(material_anz, 0);
+	vector<vector<uint32_t> > face_material(submodels.size());
+	for (size_t uu = 0; uu < submodels.size(); uu++)
+		{
+		submodel &sm = submodels[uu];
+		size_t face_anz = sm.indizes.size() / 3;
+		vertex_anz += face_anz * 3;
+		face_material[uu].assign(face_anz, (uint32_t)(material_anz - 1));
+		for (size_t gg = 0; gg < sm.groups.size(); gg++)
+			{
+			uint32_t mm = 0;
+			while (mm < model.materials.size() && sm.groups[gg].material != model.materials[mm].name) mm++;
+			if (mm == model.materials.size()) continue;
+			groups_per_material[mm]++;
+			for (size_t ff = 0; ff < sm.groups[gg].faces.size(); ff++)
+				if (sm.groups[gg].faces[ff] < face_anz)
+					face_material[uu][sm.groups[gg].faces[ff]] = mm;
+			}
+		for (size_t ff = 0; ff < face_anz; ff++)
+			faces_per_material[face_material[uu][ff]]++;
+		}
+	mesh_material untextured;
+	memset(&untextured, 0, sizeof(untextured));
+	untextured.diffuse[0] = untextured.diffuse[1] = untextured.diffuse[2] = 1.0f;
+	model.materials.push_back(untextured);
+
+	vertices.resize(vertex_anz);
+	if (ranges) ranges->clear();
+	if (materials) materials->clear();
+	size_t vv = 0;
+	for (size_t mm = 0; mm < material_anz; mm++)
+		{
+		if (faces_per_material[mm] == 0) continue;
+		if (ranges)
+			{
+			mesh_range r = { (uint32_t)vv, (uint32_t)(faces_per_material[mm] * 3) };
+			ranges->push_back(r);
+			}
+		if (materials)
+			{
+			materials->push_back(model.materials[mm]);
+			materials->back().face_groups = groups_per_material[mm];
+			}
+		for (size_t uu = 0; uu < submodels.size(); uu++)
+			{
+			const submodel &sm = submodels[uu];
+			size_t vanz = sm.positions.size();
+			bool textured = sm.texcoords.size() >= vanz;
+			for (size_t ff = 0; ff < face_material[uu].size(); ff++)
+				{
+				if (face_material[uu][ff] != mm) continue;
+				for (int k = 0; k < 3; k++)
+					{
+					mesh_vertex &v = vertices[vv++];
+					memset(&v, 0, sizeof(v));
+					unsigned short i = sm.indizes[ff * 3 + k];
+					if (i >= vanz) continue;//broken index, degenerate corner
+					v.pos = sm.positions[i];
+					if (textured) v.tex = sm.texcoords[i];
+					}
+				}
+			}
+		}
+	if (vertex_anz && normals)
+		smooth_normals(&vertices[0], (int)vertex_anz);
+	return true;
+	}
+bool Read3DS(const char *filename, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges, vector<mesh_material> *materials)
+	{
+	mapped_file file;
+	if (!file.open(filename)) return false;
+	return Parse3DS(file.data(), file.size(), vertices, ranges, materials);
+	}
+//***************************************************************
+void flat_normals(mesh_vertex *vertices, int count)
+	{
+	//perform flat light:
+	for (int ii = 0; ii + 2 < count; ii += 3)
+		{
+		vec3 a = vertices[ii + 1].pos - vertices[ii + 0].pos;
+		vec3 b = vertices[ii + 2].pos - vertices[ii + 0].pos;
+		vec3 c = normalize(cross(a, b));
+		vertices[ii + 0].norm = c;
+		vertices[ii + 1].norm = c;
+		vertices[ii + 2].norm = c;
+		}
+	}
+//***************************************************************
+//catmull .cmp: 80 byte header, int vertex count, then pos/normal/tex per vertex (non indexed triangle list)
+struct CatmullVertex
+	{
+	vec3 pos;
+	vec3 normal;
+	vec2 tex;
+	};
+#define CMP_HEADER_SIZE		84
+void cmp_to_mesh_vertices(const void *source, mesh_vertex *vertices, size_t count)
+	{
+	const float *src = (const float*)source;
+	float *dst = (float*)vertices;
+	size_t ii = 0;
+#ifdef MESH_SSE
+	//one vertex = two registers: a = px py pz nx, b = ny nz tu tv -> px py pz tu, tv nx ny nz
+	for (; ii < count; ii++, src += 8, dst += 8)
+		{
+		__m128 a = _mm_loadu_ps(src);
+		__m128 b = _mm_loadu_ps(src + 4);
+		__m128 t = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 2, 2, 2));	//pz pz tu tu
+		__m128 u = _mm_shuffle_ps(b, a, _MM_SHUFFLE(3, 3, 3, 3));	//tv tv nx nx
+		_mm_storeu_ps(dst, _mm_shuffle_ps(a, t, _MM_SHUFFLE(2, 0, 1, 0)));
+		_mm_storeu_ps(dst + 4, _mm_shuffle_ps(u, b, _MM_SHUFFLE(1, 0, 2, 0)));
+		}
+#endif
+	for (; ii < count; ii++)
+		{
+		const CatmullVertex &c = ((const CatmullVertex*)source)[ii];
+		vertices[ii].pos = c.pos;
+		vertices[ii].tex = c.tex;
+		vertices[ii].norm = c.normal;
+		}
+	}
+bool ParseCMP(const unsigned char *data, size_t size, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges)
+	{
+	if (!data || size < CMP_HEADER_SIZE) return false;
+	int32_t vertex_count;
+	memcpy(&vertex_count, data + CMP_HEADER_SIZE - 4, 4);
+	if (vertex_count < 0 || vertex_count % 3 != 0) return false;
+	if ((uint64_t)vertex_count * sizeof(CatmullVertex) > size - CMP_HEADER_SIZE) return false;//truncated
+
+	vertices.resize(vertex_count);
+	if (vertex_count)
+		cmp_to_mesh_vertices(data + CMP_HEADER_SIZE, &vertices[0], vertex_count);
+	if (ranges)
+		{
+		mesh_range r = { 0, (uint32_t)vertex_count };
+		ranges->assign(1, r);
+		}
+	return true;
+	}
+bool ReadCMP(const char *filename, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges)
+	{
+	mapped_file file;
+	if (!file.open(filename)) return false;
+	return ParseCMP(file.data(), file.size(), vertices, ranges);
+	}
+//---------------------------------------------- cooked mesh cache ----------------------------------------------
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed)
+	{
+	const unsigned char *p = (const unsigned char*)data;
+	uint64_t h = seed;
+	for (size_t i = 0; i < size; i++)
+		{
+		h ^= p[i];
+		h *= 1099511628211ULL;
+		}
+	return h;
+	}
+uint64_t hash_file(const char *filename)
+	{
+	mapped_file file;
+	if (!file.open(filename)) return 0;
+	return hash_bytes(file.data(), file.size());
+	}
+void cooked_mesh_name(const char *source, char *cooked, size_t cooked_size)
+	{
+	snprintf(cooked, cooked_size, "%s.mesh", source);
+	}
+bool is_cmp_file(const char *filename)
+	{
+	size_t len = strlen(filename);
+	if (len < 4) return false;
+	const char *ext = filename + len - 4;
+	return ext[0] == '.' && (ext[1] | 32) == 'c' && (ext[2] | 32) == 'm' && (ext[3] | 32) == 'p';
+	}
+static bool write_all(FILE *file, const void *data, size_t size)
+	{
+	return size == 0 || fwrite(data, size, 1, file) == 1;
+	}
+bool cook_mesh(const char *source, const char *cooked, mesh_stats *stats)
+	{
+	cooked_mesh_header header;
+	memset(&header, 0, sizeof(header));
+	if (!file_stamp(source, &header.source_size, &header.source_time)) return false;
+	header.source_hash = hash_file(source);
+
+	mesh_data mesh;
+	if (!build_mesh(source, mesh, stats)) return false;
+
+	header.magic = MESHCACHE_MAGIC;
+	header.version = MESHCACHE_VERSION;
+	header.vertex_count = (uint32_t)mesh.vertices.size();
+	header.vertex_stride = sizeof(mesh_vertex);
+	header.index_count = (uint32_t)mesh.indices.size();
+	header.index_size = mesh.vertices.size() <= 65536 ? 2 : 4;
+	header.range_count = (uint32_t)mesh.ranges.size();
+	header.lod_count = (uint32_t)mesh.lods.size();
+	header.meshlet_count = (uint32_t)mesh.meshlets.size();
+	header.material_count = (uint32_t)mesh.materials.size();
+	for (int k = 0; k < 3; k++)
+		{
+		header.bbmin[k] = mesh.vertices.empty() ? 0 : 1e30f;
+		header.bbmax[k] = mesh.vertices.empty() ? 0 : -1e30f;
+		}
+	for (size_t ii = 0; ii < mesh.vertices.size(); ii++)
+		{
+		const float *p = &mesh.vertices[ii].pos.x;
+		for (int k = 0; k < 3; k++)
+			{
+			if (p[k] < header.bbmin[k]) header.bbmin[k] = p[k];
+			if (p[k] > header.bbmax[k]) header.bbmax[k] = p[k];
+			}
+		}
+	vector<unsigned short> indices16;
+	if (header.index_size == 2)
+		indices16.assign(mesh.indices.begin(), mesh.indices.end());
+
+	//write next to it and swap in, a crashed cook never leaves half a file behind
+	char temp[1024];
+	snprintf(temp, sizeof(temp), "%s.tmp", cooked);
+	FILE *file = fopen(temp, "wb");
+	if (!file) return false;
+	bool written = write_all(file, &header, sizeof(header));
+	if (written && !mesh.vertices.empty())	written = write_all(file, &mesh.vertices[0], mesh.vertices.size() * sizeof(mesh_vertex));
+	if (written && !mesh.ranges.empty())	written = write_all(file, &mesh.ranges[0], mesh.ranges.size() * sizeof(mesh_range));
+	if (written && !mesh.materials.empty())	written = write_all(file, &mesh.materials[0], mesh.materials.size() * sizeof(mesh_material));
+	if (written && !mesh.lods.empty())		written = write_all(file, &mesh.lods[0], mesh.lods.size() * sizeof(mesh_lod));
+	if (written && !mesh.meshlets.empty())	written = write_all(file, &mesh.meshlets[0], mesh.meshlets.size() * sizeof(mesh_meshlet));
+	if (written && !mesh.indices.empty())
+		{
+		if (header.index_size == 2)	written = write_all(file, &indices16[0], indices16.size() * 2);
+		else						written = write_all(file, &mesh.indices[0], mesh.indices.size() * 4);
+		}
+	written = (fclose(file) == 0) && written;
+	if (!written)
+		{
+		remove(temp);
+		return false;
+		}
+	remove(cooked);
+	return rename(temp, cooked) == 0;
+	}
+//-----------------------------------------------------------------
+bool cooked_mesh::open(const char *cooked_filename)
+	{
+	close();
+	if (!file.open(cooked_filename)) return false;
+	if (!attach(file.data(), file.size()))
+		{
+		close();
+		return false;
+		}
+	return true;
+	}
+bool cooked_mesh::open(const unsigned char *data, size_t size)
+	{
+	close();
+	return attach(data, size);
+	}
+//first and count inside the index buffer, without overflowing
+static bool index_range_ok(uint32_t first_index, uint32_t index_count, uint32_t total)
+	{
+	return first_index <= total && index_count <= total - first_index;
+	}
+//what the header says has to fit: ranges, lods and meshlets inside the indices, the indices inside the vertices.
+//a stale or broken file is rejected here and cooked again, the draws and the culling trust it after this
+static bool cooked_mesh_valid(const cooked_mesh_header *h, const mesh_range *ranges, const mesh_lod *lods,
+							  const mesh_meshlet *meshlets, const unsigned char *indices)
+	{
+	for (uint32_t ii = 0; ii < h->range_count; ii++)
+		if (!index_range_ok(ranges[ii].first_index, ranges[ii].index_count, h->index_count)) return false;
+	for (uint32_t ii = 0; ii < h->lod_count; ii++)
+		if (!index_range_ok(lods[ii].first_index, lods[ii].index_count, h->index_count)) return false;
+	for (uint32_t ii = 0; ii < h->meshlet_count; ii++)
+		if (!index_range_ok(meshlets[ii].first_index, meshlets[ii].index_count, h->index_count)) return false;
+	if (h->index_size == 2)
+		{
+		const uint16_t *p = (const uint16_t*)indices;
+		for (uint32_t ii = 0; ii < h->index_count; ii++)
+			if (p[ii] >= h->vertex_count) return false;
+		}
+	else
+		{
+		const uint32_t *p = (const uint32_t*)indices;
+		for (uint32_t ii = 0; ii < h->index_count; ii++)
+			if (p[ii] >= h->vertex_count) return false;
+		}
+	return true;
+	}
+bool cooked_mesh::attach(const unsigned char *data, size_t size)
+	{
+	if (!data || size < sizeof(cooked_mesh_header)) return false;
+	const cooked_mesh_header *h = (const cooked_mesh_header*)data;
+	uint64_t vertex_bytes = (uint64_t)h->vertex_count * sizeof(mesh_vertex);
+	uint64_t range_bytes = (uint64_t)h->range_count * sizeof(mesh_range);
+	uint64_t material_bytes = (uint64_t)h->material_count * sizeof(mesh_material);
+	uint64_t lod_bytes = (uint64_t)h->lod_count * sizeof(mesh_lod);
+	uint64_t meshlet_bytes = (uint64_t)h->meshlet_count * sizeof(mesh_meshlet);
+	uint64_t index_bytes = (uint64_t)h->index_count * h->index_size;
+	if (h->magic != MESHCACHE_MAGIC || h->version != MESHCACHE_VERSION || h->vertex_stride != sizeof(mesh_vertex) ||
+		(h->index_size != 2 && h->index_size != 4) || (h->material_count != 0 && h->material_count != h->range_count) ||
+		size != sizeof(cooked_mesh_header) + vertex_bytes + range_bytes + material_bytes + lod_bytes + meshlet_bytes + index_bytes)
+		return false;
+	const unsigned char *p = data + sizeof(cooked_mesh_header);
+	const mesh_vertex *v = (const mesh_vertex*)p;	p += vertex_bytes;
+	const mesh_range *r = (const mesh_range*)p;		p += range_bytes;
+	const mesh_material *m = (const mesh_material*)p;	p += material_bytes;
+	const mesh_lod *l = (const mesh_lod*)p;			p += lod_bytes;
+	const mesh_meshlet *ml = (const mesh_meshlet*)p;	p += meshlet_bytes;
+	if (!cooked_mesh_valid(h, r, l, ml, p)) return false;
+	header = h;
+	vertices = v;
+	ranges = r;
+	materials = m;
+	lods = l;
+	meshlets = ml;
+	indices = p;
+	return true;
+	}
+void cooked_mesh::close()
+	{
+	file.close();
+	header = NULL;
+	vertices = NULL;
+	ranges = NULL;
+	materials = NULL;
+	lods = NULL;
+	meshlets = NULL;
+	indices = NULL;
+	}
+//-----------------------------------------------------------------
+bool load_mesh_cached(const char *source, cooked_mesh &mesh)
+	{
+	char cooked[1024];
+	cooked_mesh_name(source, cooked, sizeof(cooked));
+	uint64_t size, time;
+	if (!file_stamp(source, &size, &time))
+		return mesh.open(cooked);//only the cooked file is shipped
+
+	if (mesh.open(cooked))
+		{
+		if (mesh.header->source_size == size && mesh.header->source_time == time)
+			return true;
+		//touched but maybe not changed
+		if (mesh.header->source_size == size && mesh.header->source_hash == hash_file(source))
+			{
+			mesh.close();								//not mapped while it is written
+			//the new time into the header, the next start takes the cheap check again. read only: hashed again, still right
+			patch_file(cooked, offsetof(cooked_mesh_header, source_time), &time, sizeof(time));
+			if (mesh.open(cooked))
+				return true;
+			}
+		mesh.close();
+		}
+	if (!cook_mesh(source, cooked)) return false;
+	return mesh.open(cooked);
+	}
@@ -0,0 +1,285 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			device independent side of the model loaders
+//
+//			Load3DS/LoadCMP/LoadOBJ (load3ds.cpp) only create the buffers now, everything before that lives here,
+//			so tools can load and cook meshes without a D3D device:
+//
+//				cooked_mesh mesh;
+//				if (load_mesh_cached("asteroid.3ds", mesh))
+//					CreateBuffer( mesh.vertices, mesh.header->vertex_count ), CreateBuffer( mesh.indices, ... )
+//
+//			the cooked file ("asteroid.3ds.mesh") is the final indexed mesh with a cooked_mesh_header in front.
+//			it is mapped, not parsed, and gets rebuilt when the source file changes.
+//
+//			cooking: parse (smooth normals for 3ds) -> weld identical vertices -> reorder triangles for the post transform cache (forsyth)
+//			-> reorder vertices by first use. every submodel keeps its own contiguous index range.
+//			-> meshlets (mesh_meshlet.cpp): every submodel cut into small clusters for culling, each an index range.
+//			-> LOD chain (mesh_simplify.cpp): coarser index ranges behind the full one, all on the same vertices.
+//			the cooked vertices are full floats, packed_vertex (mesh_quantize.cpp) is made from them at upload if wanted.
+//
+//**********************************************************************************************************************************************
+#include <stdint.h>
+#include <vector>
+#include "mapped_file.h"
+using std::vector;
+
+struct vec2
+	{
+	float x, y;
+	};
+struct vec3
+	{
+	float x, y, z;
+	};
+
+//same memory layout as SimpleVertex in groundwork.h
+struct mesh_vertex
+	{
+	vec3 pos;
+	vec2 tex;
+	vec3 norm;
+	};
+
+vec3 make_vec3(float x, float y, float z);
+vec3 operator+(const vec3 &a, const vec3 &b);
+vec3 operator-(const vec3 &a, const vec3 &b);
+vec3 operator*(const vec3 &a, float s);
+float dot(const vec3 &a, const vec3 &b);
+vec3 cross(const vec3 &a, const vec3 &b);
+float length(const vec3 &a);
+vec3 normalize(const vec3 &a);
+
+//a draw range: one per material for 3ds, one per submodel for cmp/obj
+struct mesh_range
+	{
+	uint32_t first_index;
+	uint32_t index_count;
+	};
+//a 3ds material (0xAFFF), range i of a 3ds model is drawn with material i
+#define MESH_MATERIAL_NAME		32
+#define MESH_TEXTURE_NAME		64
+struct mesh_material
+	{
+	char name[MESH_MATERIAL_NAME];
+	char texture[MESH_TEXTURE_NAME];	//diffuse map file, "" without one
+	float diffuse[3];
+	uint32_t face_groups;				//face material chunks (0x4130) that went into the range
+	};
+
+//parsers, both give a non indexed triangle list. ranges are in corners of that list
+bool Read3DS(const char *filename, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges = NULL, vector<mesh_material> *materials = NULL);
+bool Parse3DS(const unsigned char *data, size_t size, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges = NULL,
+			  vector<mesh_material> *materials = NULL, bool normals = true);	//normals false: zero, smooth_normals later
+bool ReadCMP(const char *filename, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges = NULL);
+bool ParseCMP(const unsigned char *data, size_t size, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges = NULL);
+void cmp_to_mesh_vertices(const void *source, mesh_vertex *vertices, size_t count);	//pos/normal/tex -> pos/tex/normal
+void flat_normals(mesh_vertex *vertices, int count);
+
+//wavefront obj (mesh_obj.cpp), parsed in line aligned chunks on several threads. threads 0: one per core from OBJ_PARALLEL_MIN bytes on
+#define OBJ_PARALLEL_MIN		(1 << 20)
+bool ReadOBJ(const char *filename, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges = NULL);
+bool ParseOBJ(const unsigned char *data, size_t size, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges = NULL, int threads = 0);
+bool is_obj_file(const char *filename);
+
+//gouraud normals for a non indexed list (mesh_normals.cpp). corners closer than the tolerance share their normal,
+//unless their faces meet at more than crease_degrees. threads 0: one per core for big meshes, single threaded otherwise
+#define SMOOTH_WELD_TOLERANCE	0.01f
+#define SMOOTH_CREASE_ANGLE		60.0f
+#define SMOOTH_NORMALS_MT_MIN	65536
+void smooth_normals(mesh_vertex *vertices, int count, float weld_tolerance = SMOOTH_WELD_TOLERANCE,
+					float crease_degrees = SMOOTH_CREASE_ANGLE, int threads = 0);
+void smooth_normals_reference(mesh_vertex *vertices, int count, float weld_tolerance = SMOOTH_WELD_TOLERANCE,
+							  float crease_degrees = SMOOTH_CREASE_ANGLE);
+
+//a level of detail: an index range over the whole mesh. error is the largest distance (in model units)
+//the surface moved away from the original, lod 0 is the full mesh with error 0
+struct mesh_lod
+	{
+	uint32_t first_index;
+	uint32_t index_count;
+	float error;
+	};
+#define MESH_LOD_MAX		4
+
+//a cluster of lod 0 (mesh_meshlet.cpp), its triangles are one index range. back facing are all of them if
+//the camera is inside the cone behind the sphere: dot(center - camera, cone_axis) >= cone_cutoff * |center - camera| + radius
+#define MESHLET_MAX_VERTICES	64
+#define MESHLET_MAX_TRIANGLES	124
+struct mesh_meshlet
+	{
+	uint32_t first_index;
+	uint32_t index_count;
+	float center[3];
+	float radius;
+	float cone_axis[3];			//average face normal
+	float cone_cutoff;			//sin of the cone's half angle, 1: too wide, never culled
+	};
+
+//bounds in model space, made at load time (CreateModel) for the whole mesh and every submodel
+struct mesh_bounds
+	{
+	vec3 bbmin, bbmax;
+	vec3 center;				//of the box
+	vec3 sphere_center;			//ritter, then the radius tightened to the farthest vertex
+	float radius;
+	};
+//the vertices an index range uses, all vertices with indices NULL. index_size 2 or 4
+void compute_bounds(const mesh_vertex *vertices, size_t vertex_count, const void *indices, uint32_t index_size,
+					uint32_t first_index, uint32_t index_count, mesh_bounds &bounds);
+
+//---------------------------------------------- indexed meshes (mesh_optimize.cpp) ----------------------------------------------
+class mesh_data
+	{
+	public:
+		vector<mesh_vertex> vertices;
+		vector<uint32_t> indices;		//lod 0 (split into the ranges), then the other lods
+		vector<mesh_range> ranges;
+		vector<mesh_material> materials;	//3ds: one per range, else empty
+		vector<mesh_lod> lods;
+		vector<mesh_meshlet> meshlets;	//lod 0, the ranges split up
+	};
+struct mesh_stats
+	{
+	uint32_t triangles;
+	uint32_t corners;				//vertices of the old non indexed buffer
+	uint32_t unique_vertices;		//after welding
+	float acmr_welded;				//average cache miss ratio, welded but in file order
+	float acmr;						//after the triangle reorder, 3.0 would be the non indexed buffer
+	uint64_t bytes_unindexed;
+	uint64_t bytes_indexed;			//vertex buffer + index buffer (lod 0)
+	uint32_t lod_count;
+	uint32_t lod_triangles[MESH_LOD_MAX];
+	float lod_error[MESH_LOD_MAX];
+	uint32_t meshlet_count;
+	};
+
+void weld_vertices(const vector<mesh_vertex> &corners, mesh_data &mesh);
+void optimize_vertex_cache(uint32_t *indices, size_t index_count, size_t vertex_count);
+void optimize_vertex_fetch(mesh_data &mesh);
+float acmr(const uint32_t *indices, size_t index_count, int cache_size = 16);
+bool build_mesh(const char *source, mesh_data &mesh, mesh_stats *stats = NULL);
+
+//---------------------------------------------- LODs (mesh_simplify.cpp) ----------------------------------------------
+//quadric edge collapse into destination (can be indices), returns the new index count
+size_t simplify_mesh(uint32_t *destination, const uint32_t *indices, size_t index_count, const mesh_vertex *vertices,
+					 size_t vertex_count, size_t target_index_count, float *result_error = NULL);
+//appends up to levels-1 coarser lods to mesh.indices, each with ratio times the triangles of the one before
+void build_lods(mesh_data &mesh, int levels = MESH_LOD_MAX, float ratio = 0.5f);
+//error_per_unit: how much error is acceptable per unit of distance (about pixel angle)
+int select_lod(const mesh_lod *lods, int lod_count, float distance, float error_per_unit);
+//instance indices sorted by lod: order[lod_first[l] .. lod_first[l] + lod_instances[l]] use lod l.
+//positions: x,y,z at the start of every stride bytes, scale: how much the instances are scaled up
+void bucket_instances_by_lod(const float *positions, size_t stride, size_t instance_count, const float camera[3], float scale,
+							 const mesh_lod *lods, int lod_count, float error_per_unit, uint32_t *order, uint32_t *lod_first, uint32_t *lod_instances);
+
+//---------------------------------------------- meshlets (mesh_meshlet.cpp) ----------------------------------------------
+//reorders lod 0 of every range into meshlets, call after optimize_vertex_cache and before the lods
+void build_meshlets(mesh_data &mesh);
+//model space planes (a, b, c, d normalized, inside: ax + by + cz + d >= 0) of world * view * projection, row major like xnamath
+void frustum_planes(const float m[16], float planes[6][4]);
+struct mesh_cull_stats
+	{
+	uint32_t meshlets;
+	uint32_t frustum_culled;
+	uint32_t backface_culled;
+	uint32_t triangles;
+	uint32_t triangles_culled;
+	uint32_t runs;
+	};
+//camera and planes in model space, cone_culling off for mirrored instances. visible gets the index ranges to draw
+//(neighbouring meshlets merged, at most count of them), returns how many. stats are added up, not reset
+size_t cull_meshlets(const mesh_meshlet *meshlets, size_t count, const float camera[3], const float planes[6][4], bool cone_culling,
+					 mesh_range *visible, mesh_cull_stats *stats = NULL);
+//draws through the smallest gaps between the ranges until there are at most max_runs, returns the new count
+#define MESHLET_MAX_DRAWS		8
+size_t merge_runs(mesh_range *runs, size_t count, size_t max_runs);
+
+//---------------------------------------------- packed vertices (mesh_quantize.cpp) ----------------------------------------------
+//16 bytes instead of 32, decoded by VS_packed in shader.fx. input layout:
+//		POSITION R16G16B16A16_UNORM (0), TEXCOORD R16G16_FLOAT (8), NORMAL R16G16_SNORM (12)
+struct packed_vertex
+	{
+	uint16_t pos[4];		//0..65535 from bbmin to bbmax, w unused
+	uint16_t tex[2];		//half float
+	int16_t norm[2];		//octahedral
+	};
+//an asteroid instance (2 x float4 -> 12 bytes), decoded by VS_instance_packed:
+//		INSTANCEVEC R16G16B16A16_SNORM (0), ROTATEINST R8G8B8A8_SNORM (8)
+#define PACKED_INSTANCE_RANGE	512.0f			//positions from -range to range, the same number is in shader.fx
+#define PACKED_INSTANCE_ANGLE	6.2831853f		//rotation angles from -2pi to 2pi, the speed (w) from -1 to 1
+struct packed_instance
+	{
+	int16_t pos[4];
+	int8_t rot[4];
+	};
+
+uint16_t float_to_half(float f);
+float half_to_float(uint16_t h);
+void oct_encode(const vec3 &n, int16_t result[2]);
+vec3 oct_decode(const int16_t e[2]);
+void pack_vertices(const mesh_vertex *vertices, size_t count, const float bbmin[3], const float bbmax[3], packed_vertex *result);
+mesh_vertex unpack_vertex(const packed_vertex &p, const float bbmin[3], const float bbmax[3]);
+//instances: 8 floats each (position, rotation) like asteroid_pos
+void pack_instances(const float *instances, size_t count, float position_range, packed_instance *result);
+void unpack_instance(const packed_instance &p, float position_range, float instance[8]);
+
+//---------------------------------------------- cooked mesh cache ----------------------------------------------
+#define MESHCACHE_MAGIC		0x4853454D	//"MESH"
+#define MESHCACHE_VERSION	6
+
+//file layout: header | vertices | ranges | materials | lods | meshlets | indices (2 or 4 byte)
+struct cooked_mesh_header
+	{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertex_count;
+	uint32_t vertex_stride;
+	uint32_t index_count;
+	uint32_t index_size;		//2 when all vertices fit into 16 bit, else 4
+	uint32_t range_count;
+	uint32_t lod_count;
+	uint32_t meshlet_count;
+	uint32_t material_count;	//0 or range_count
+	float bbmin[3];
+	float bbmax[3];
+	uint64_t source_hash;		//fnv1a of the whole source file
+	uint64_t source_size;		//size and time are the cheap check, the hash decides if they differ
+	uint64_t source_time;
+	};
+
+class cooked_mesh
+	{
+	private:
+		mapped_file file;
+		bool attach(const unsigned char *data, size_t size);
+	public:
+		const cooked_mesh_header *header;
+		const mesh_vertex *vertices;	//all of these point into the mapping
+		const mesh_range *ranges;
+		const mesh_material *materials;
+		const mesh_lod *lods;
+		const mesh_meshlet *meshlets;
+		const void *indices;
+		cooked_mesh()
+			{
+			header = NULL;
+			vertices = NULL;
+			ranges = NULL;
+			materials = NULL;
+			lods = NULL;
+			meshlets = NULL;
+			indices = NULL;
+			}
+		bool open(const char *cooked_filename);
+		bool open(const unsigned char *data, size_t size);	//a cooked file in memory (asset pack), has to stay there until close()
+		void close();
+	};
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ULL);
+uint64_t hash_file(const char *filename);
+bool is_cmp_file(const char *filename);
+void cooked_mesh_name(const char *source, char *cooked, size_t cooked_size);
+bool cook_mesh(const char *source, const char *cooked, mesh_stats *stats = NULL);
+bool load_mesh_cached(const char *source, cooked_mesh &mesh);
@@ -0,0 +1,299 @@
+#include "mesh.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+//***************************************************************
+//		meshlets: lod 0 of every submodel cut into clusters of at most MESHLET_MAX_VERTICES vertices and
+//		MESHLET_MAX_TRIANGLES triangles, each one a contiguous index range with a bounding sphere and a normal cone.
+//
+//		a cluster grows from a seed triangle (the next one in vertex cache order) by the neighbour that is close,
+//		needs few new vertices and faces the same way as the cluster (a narrow cone can be culled more often). the triangles of a
+//		finished cluster are cache optimized on their own, then the clusters of a submodel are sorted by the
+//		direction their cone points to (cone_order), so the back facing half of a model is a few long runs.
+//***************************************************************
+#define MESHLET_CONE_WEIGHT		8.0f		//how much a differently facing neighbour counts as farther away
+#define MESHLET_CONE_LIMIT		0.5f		//no neighbours more than 60 degrees off the cluster's normal
+
+struct meshlet_build
+	{
+	mesh_meshlet meshlet;
+	int bucket;
+	float key;
+	vector<uint32_t> indices;
+	};
+static bool by_direction(const meshlet_build &a, const meshlet_build &b)
+	{
+	if (a.bucket != b.bucket) return a.bucket < b.bucket;
+	return a.key < b.key;
+	}
+struct position_order
+	{
+	const vector<mesh_vertex> *vertices;
+	bool operator()(uint32_t a, uint32_t b) const
+		{
+		const vec3 &p = (*vertices)[a].pos, &q = (*vertices)[b].pos;
+		if (p.x != q.x) return p.x < q.x;
+		if (p.y != q.y) return p.y < q.y;
+		return p.z < q.z;
+		}
+	};
+//the cone axis' dominant direction in the order +x +y +z -x -y -z: any half of the sphere is 3 neighbouring ones
+//of these (seen as a ring), so the back facing meshlets are at most 2 runs. inside a direction it goes from the
+//one before to the one after
+static void cone_order(const float axis[3], int *bucket, float *key)
+	{
+	int k = 0;
+	for (int ii = 1; ii < 3; ii++)
+		if (fabsf(axis[ii]) > fabsf(axis[k])) k = ii;
+	*bucket = k + (axis[k] < 0 ? 3 : 0);
+	int next = (*bucket + 1) % 6, previous = (*bucket + 5) % 6;
+	*key = axis[next % 3] * (next < 3 ? 1.0f : -1.0f) - axis[previous % 3] * (previous < 3 ? 1.0f : -1.0f);
+	}
+static void finish_meshlet(const mesh_data &mesh, const vector<uint32_t> &triangles, const uint32_t *indices,
+						   const vector<vec3> &normals, meshlet_build &result)
+	{
+	//cache order inside the cluster, on local indices so it does not touch the whole vertex range
+	vector<uint32_t> local_vertices, local(triangles.size() * 3);
+	for (size_t t = 0; t < triangles.size(); t++)
+		for (int k = 0; k < 3; k++)
+			{
+			uint32_t v = indices[triangles[t] * 3 + k];
+			size_t slot = std::find(local_vertices.begin(), local_vertices.end(), v) - local_vertices.begin();
+			if (slot == local_vertices.size()) local_vertices.push_back(v);
+			local[t * 3 + k] = (uint32_t)slot;
+			}
+	optimize_vertex_cache(&local[0], local.size(), local_vertices.size());
+	result.indices.resize(local.size());
+	for (size_t ii = 0; ii < local.size(); ii++)
+		result.indices[ii] = local_vertices[local[ii]];
+
+	mesh_bounds bounds;
+	compute_bounds(&mesh.vertices[0], mesh.vertices.size(), &result.indices[0], 4, 0, (uint32_t)result.indices.size(), bounds);
+	mesh_meshlet &m = result.meshlet;
+	m.index_count = (uint32_t)result.indices.size();
+	m.center[0] = bounds.sphere_center.x;
+	m.center[1] = bounds.sphere_center.y;
+	m.center[2] = bounds.sphere_center.z;
+	m.radius = bounds.radius;
+	//cone: average of the face normals, the widest one decides the angle
+	vec3 sum = make_vec3(0, 0, 0);
+	for (size_t t = 0; t < triangles.size(); t++)
+		sum = sum + normals[triangles[t]];
+	vec3 axis = normalize(sum);
+	float min_dot = length(sum) > 0 ? 1.0f : -1.0f;
+	for (size_t t = 0; t < triangles.size(); t++)
+		if (dot(normals[triangles[t]], normals[triangles[t]]) > 0)
+			min_dot = std::min(min_dot, dot(normals[triangles[t]], axis));
+	m.cone_axis[0] = axis.x;
+	m.cone_axis[1] = axis.y;
+	m.cone_axis[2] = axis.z;
+	//wider than about 84 degrees can hardly ever be culled, 1 switches the test off
+	m.cone_cutoff = min_dot > 0.1f ? sqrtf(1.0f - min_dot * min_dot) : 1.0f;
+	cone_order(m.cone_axis, &result.bucket, &result.key);
+	}
+static void build_range_meshlets(mesh_data &mesh, const mesh_range &range)
+	{
+	uint32_t *indices = &mesh.indices[range.first_index];
+	size_t tri_count = range.index_count / 3;
+	size_t vertex_count = mesh.vertices.size();
+	if (tri_count == 0) return;
+
+	//face normals (the winding the rasterizer culls by) and centers
+	vector<vec3> normals(tri_count), centers(tri_count);
+	for (size_t t = 0; t < tri_count; t++)
+		{
+		const vec3 &a = mesh.vertices[indices[t * 3]].pos, &b = mesh.vertices[indices[t * 3 + 1]].pos, &c = mesh.vertices[indices[t * 3 + 2]].pos;
+		vec3 n = cross(b - a, c - a);
+		normals[t] = length(n) > 0 ? normalize(n) : make_vec3(0, 0, 0);
+		centers[t] = (a + b + c) * (1.0f / 3.0f);
+		}
+	//triangles per position: hard edges and uv seams split the vertices, the surface still goes on there
+	vector<uint32_t> position(vertex_count), sorted(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++)
+		sorted[v] = (uint32_t)v;
+	position_order order = { &mesh.vertices };
+	std::sort(sorted.begin(), sorted.end(), order);
+	for (size_t ii = 0; ii < vertex_count; ii++)
+		position[sorted[ii]] = ii > 0 && !order(sorted[ii - 1], sorted[ii]) ? position[sorted[ii - 1]] : sorted[ii];
+	vector<uint32_t> offset(vertex_count + 1, 0), adjacency(tri_count * 3);
+	for (size_t ii = 0; ii < tri_count * 3; ii++)
+		offset[position[indices[ii]] + 1]++;
+	for (size_t v = 0; v < vertex_count; v++)
+		offset[v + 1] += offset[v];
+	vector<uint32_t> fill(offset.begin(), offset.end() - 1);
+	for (size_t ii = 0; ii < tri_count * 3; ii++)
+		adjacency[fill[position[indices[ii]]]++] = (uint32_t)(ii / 3);
+
+	vector<unsigned char> emitted(tri_count, 0);
+	vector<unsigned char> in_meshlet(vertex_count, 0);
+	vector<uint32_t> vertices, triangles;
+	vector<meshlet_build> built;
+	size_t seed = 0, done = 0;
+	vec3 center_sum = make_vec3(0, 0, 0), normal_sum = make_vec3(0, 0, 0);
+	while (done < tri_count || !triangles.empty())
+		{
+		int best = -1;
+		if (triangles.empty())
+			{
+			while (emitted[seed]) seed++;
+			best = (int)seed;
+			}
+		else if (triangles.size() < MESHLET_MAX_TRIANGLES)
+			{
+			vec3 center = center_sum * (1.0f / triangles.size()), facing = normalize(normal_sum);
+			float best_score = 0;
+			for (size_t vi = 0; vi < vertices.size(); vi++)
+				for (uint32_t a = offset[position[vertices[vi]]]; a < offset[position[vertices[vi]] + 1]; a++)
+					{
+					uint32_t t = adjacency[a];
+					if (emitted[t]) continue;
+					int new_vertices = !in_meshlet[indices[t * 3]] + !in_meshlet[indices[t * 3 + 1]] + !in_meshlet[indices[t * 3 + 2]];
+					if (vertices.size() + new_vertices > MESHLET_MAX_VERTICES) continue;
+					float facing_dot = dot(normals[t], facing);
+					if (facing_dot < MESHLET_CONE_LIMIT) continue;
+					vec3 d = centers[t] - center;
+					float score = (1.0f + new_vertices) * dot(d, d) * (1.0f + MESHLET_CONE_WEIGHT * (1.0f - facing_dot));
+					if (best < 0 || score < best_score)
+						{
+						best = (int)t;
+						best_score = score;
+						}
+					}
+			}
+		if (best < 0)
+			{
+			built.push_back(meshlet_build());
+			finish_meshlet(mesh, triangles, indices, normals, built.back());
+			for (size_t vi = 0; vi < vertices.size(); vi++)
+				in_meshlet[vertices[vi]] = 0;
+			vertices.clear();
+			triangles.clear();
+			center_sum = normal_sum = make_vec3(0, 0, 0);
+			continue;
+			}
+		emitted[best] = 1;
+		done++;
+		triangles.push_back((uint32_t)best);
+		center_sum = center_sum + centers[best];
+		normal_sum = normal_sum + normals[best];
+		for (int k = 0; k < 3; k++)
+			{
+			uint32_t v = indices[best * 3 + k];
+			if (!in_meshlet[v])
+				{
+				in_meshlet[v] = 1;
+				vertices.push_back(v);
+				}
+			}
+		}
+	std::stable_sort(built.begin(), built.end(), by_direction);
+	uint32_t first = range.first_index;
+	for (size_t ii = 0; ii < built.size(); ii++)
+		{
+		memcpy(&mesh.indices[first], &built[ii].indices[0], built[ii].indices.size() * sizeof(uint32_t));
+		built[ii].meshlet.first_index = first;
+		first += built[ii].meshlet.index_count;
+		mesh.meshlets.push_back(built[ii].meshlet);
+		}
+	}
+void build_meshlets(mesh_data &mesh)
+	{
+	mesh.meshlets.clear();
+	for (size_t ii = 0; ii < mesh.ranges.size(); ii++)
+		build_range_meshlets(mesh, mesh.ranges[ii]);
+	}
+//***************************************************************
+//row vectors like xnamath: clip = p * m, inside where -w <= x, y <= w and 0 <= z <= w
+void frustum_planes(const float m[16], float planes[6][4])
+	{
+	for (int k = 0; k < 4; k++)
+		{
+		float x = m[k * 4 + 0], y = m[k * 4 + 1], z = m[k * 4 + 2], w = m[k * 4 + 3];
+		planes[0][k] = w + x;
+		planes[1][k] = w - x;
+		planes[2][k] = w + y;
+		planes[3][k] = w - y;
+		planes[4][k] = z;
+		planes[5][k] = w - z;
+		}
+	for (int p = 0; p < 6; p++)
+		{
+		float len = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		if (len > 0)
+			for (int k = 0; k < 4; k++)
+				planes[p][k] /= len;
+		}
+	}
+size_t cull_meshlets(const mesh_meshlet *meshlets, size_t count, const float camera[3], const float planes[6][4], bool cone_culling,
+					 mesh_range *visible, mesh_cull_stats *stats)
+	{
+	size_t runs = 0;
+	uint32_t frustum = 0, backface = 0, culled_indices = 0, all_indices = 0;
+	for (size_t ii = 0; ii < count; ii++)
+		{
+		const mesh_meshlet &m = meshlets[ii];
+		all_indices += m.index_count;
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++)
+			inside = planes[p][0] * m.center[0] + planes[p][1] * m.center[1] + planes[p][2] * m.center[2] + planes[p][3] >= -m.radius;
+		if (!inside)
+			{
+			frustum++;
+			culled_indices += m.index_count;
+			continue;
+			}
+		if (cone_culling)
+			{
+			//every triangle faces away if the camera is inside the cone behind the sphere
+			float d[3] = { m.center[0] - camera[0], m.center[1] - camera[1], m.center[2] - camera[2] };
+			float distance = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			if (d[0] * m.cone_axis[0] + d[1] * m.cone_axis[1] + d[2] * m.cone_axis[2] >= m.cone_cutoff * distance + m.radius)
+				{
+				backface++;
+				culled_indices += m.index_count;
+				continue;
+				}
+			}
+		if (runs > 0 && visible[runs - 1].first_index + visible[runs - 1].index_count == m.first_index)
+			visible[runs - 1].index_count += m.index_count;
+		else
+			{
+			visible[runs].first_index = m.first_index;
+			visible[runs].index_count = m.index_count;
+			runs++;
+			}
+		}
+	if (stats)
+		{
+		stats->meshlets += (uint32_t)count;
+		stats->frustum_culled += frustum;
+		stats->backface_culled += backface;
+		stats->triangles += all_indices / 3;
+		stats->triangles_culled += culled_indices / 3;
+		stats->runs += (uint32_t)runs;
+		}
+	return runs;
+	}
+//***************************************************************
+//fills the smallest gaps until there are at most max_runs, they cost a draw call each
+size_t merge_runs(mesh_range *runs, size_t count, size_t max_runs)
+	{
+	if (count <= max_runs || max_runs == 0) return count;
+	vector<std::pair<uint32_t, uint32_t> > gaps(count - 1);
+	for (size_t ii = 0; ii + 1 < count; ii++)
+		gaps[ii] = std::make_pair(runs[ii + 1].first_index - runs[ii].first_index - runs[ii].index_count, (uint32_t)ii);
+	std::nth_element(gaps.begin(), gaps.begin() + (count - max_runs), gaps.end());
+	vector<unsigned char> merge(count, 0);
+	for (size_t ii = 0; ii < count - max_runs; ii++)
+		merge[gaps[ii].second] = 1;
+	size_t result = 0;
+	for (size_t ii = 0; ii < count; ii++)
+		{
+		if (ii > 0 && merge[ii - 1])
+			runs[result - 1].index_count = runs[ii].first_index + runs[ii].index_count - runs[result - 1].first_index;
+		else
+			runs[result++] = runs[ii];
+		}
+	return result;
+	}
@@ -0,0 +1,164 @@
+#include "mesh.h"
+#include <string.h>
+#include <math.h>
+#include <thread>
+
+//***************************************************************
+//		smooth (gouraud) normals for a non indexed triangle list
+//
+//		every corner gets the average of the face normals of all corners that sit on the same spot
+//		(within weld_tolerance in x, y and z, like similar_pos) and whose face is not bent away by more
+//		than the crease angle. the neighbours come out of a hash grid with the tolerance as cell size,
+//		so only the 27 cells around a corner are looked at instead of the whole mesh.
+//***************************************************************
+static vec3 face_normal(const mesh_vertex *vertices, int tri)
+	{
+	const mesh_vertex *v = vertices + tri * 3;
+	return normalize(cross(v[1].pos - v[0].pos, v[2].pos - v[0].pos));
+	}
+static bool same_spot(const vec3 &a, const vec3 &b, float tolerance)
+	{
+	return fabs(a.x - b.x) < tolerance && fabs(a.y - b.y) < tolerance && fabs(a.z - b.z) < tolerance;
+	}
+static uint32_t cell_bucket(int x, int y, int z, uint32_t mask)
+	{
+	uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+	return h & mask;
+	}
+
+class normal_grid
+	{
+	public:
+		float cell;
+		uint32_t mask;
+		vector<uint32_t> start;		//bucket -> first entry, buckets are packed
+		vector<uint32_t> entries;	//corner indices
+		void build(const mesh_vertex *vertices, int count, float tolerance)
+			{
+			cell = tolerance;
+			uint32_t buckets = 16;
+			while (buckets < (uint32_t)count) buckets *= 2;
+			mask = buckets - 1;
+			vector<uint32_t> bucket_of(count);
+			start.assign(buckets + 1, 0);
+			for (int ii = 0; ii < count; ii++)
+				{
+				const vec3 &p = vertices[ii].pos;
+				bucket_of[ii] = cell_bucket((int)floorf(p.x / cell), (int)floorf(p.y / cell), (int)floorf(p.z / cell), mask);
+				start[bucket_of[ii] + 1]++;
+				}
+			for (uint32_t b = 0; b < buckets; b++)
+				start[b + 1] += start[b];
+			vector<uint32_t> fill(start.begin(), start.end() - 1);
+			entries.resize(count);
+			for (int ii = 0; ii < count; ii++)
+				entries[fill[bucket_of[ii]]++] = ii;
+			}
+		//the buckets of the 27 cells around p, without doubles (two cells can hash into one bucket)
+		int neighbour_buckets(const vec3 &p, uint32_t *out) const
+			{
+			int cx = (int)floorf(p.x / cell), cy = (int)floorf(p.y / cell), cz = (int)floorf(p.z / cell);
+			int n = 0;
+			for (int dz = -1; dz <= 1; dz++)
+				for (int dy = -1; dy <= 1; dy++)
+					for (int dx = -1; dx <= 1; dx++)
+						{
+						uint32_t b = cell_bucket(cx + dx, cy + dy, cz + dz, mask);
+						bool seen = false;
+						for (int k = 0; k < n && !seen; k++)
+							seen = out[k] == b;
+						if (!seen) out[n++] = b;
+						}
+			return n;
+			}
+	};
+
+static void smooth_range(mesh_vertex *vertices, const vector<vec3> &faces, const normal_grid &grid,
+						 float tolerance, float cos_crease, int first, int last, vec3 *result)
+	{
+	uint32_t buckets[27];
+	for (int ii = first; ii < last; ii++)
+		{
+		const vec3 &p = vertices[ii].pos;
+		const vec3 &fn = faces[ii / 3];
+		vec3 sum = make_vec3(0, 0, 0);
+		int n = grid.neighbour_buckets(p, buckets);
+		for (int b = 0; b < n; b++)
+			for (uint32_t e = grid.start[buckets[b]]; e < grid.start[buckets[b] + 1]; e++)
+				{
+				uint32_t other = grid.entries[e];
+				const vec3 &ofn = faces[other / 3];
+				if (other != (uint32_t)ii && (!same_spot(p, vertices[other].pos, tolerance) || dot(fn, ofn) < cos_crease))
+					continue;
+				sum = sum + ofn;
+				}
+		result[ii] = normalize(sum);
+		}
+	}
+
+void smooth_normals(mesh_vertex *vertices, int count, float weld_tolerance, float crease_degrees, int threads)
+	{
+	if (count < 3) return;
+	int tri_count = count / 3;
+	vector<vec3> faces(tri_count);
+	for (int t = 0; t < tri_count; t++)
+		faces[t] = face_normal(vertices, t);
+	normal_grid grid;
+	grid.build(vertices, tri_count * 3, weld_tolerance);
+	float cos_crease = cosf(crease_degrees * 3.14159265f / 180.0f);
+
+	vector<vec3> result(tri_count * 3);
+	if (threads <= 0)
+		{
+		threads = 1;
+		if (count >= SMOOTH_NORMALS_MT_MIN)
+			threads = (int)std::thread::hardware_concurrency();
+		if (threads < 1) threads = 1;
+		}
+	if (threads == 1)
+		smooth_range(vertices, faces, grid, weld_tolerance, cos_crease, 0, tri_count * 3, &result[0]);
+	else
+		{
+		//the grid is read only from here on, every worker writes its own slice of result
+		vector<std::thread> workers;
+		int slice = (tri_count * 3 + threads - 1) / threads;
+		for (int w = 0; w < threads; w++)
+			{
+			int first = w * slice;
+			int last = first + slice < tri_count * 3 ? first + slice : tri_count * 3;
+			if (first >= last) break;
+			workers.push_back(std::thread(smooth_range, vertices, std::cref(faces), std::cref(grid),
+										  weld_tolerance, cos_crease, first, last, &result[0]));
+			}
+		for (size_t w = 0; w < workers.size(); w++)
+			workers[w].join();
+		}
+	for (int ii = 0; ii < tri_count * 3; ii++)
+		vertices[ii].norm = result[ii];
+	}
+//***************************************************************
+//the O(n^2) version that used to be commented out in Load3DS, same rules. reference for smooth_normals
+void smooth_normals_reference(mesh_vertex *vertices, int count, float weld_tolerance, float crease_degrees)
+	{
+	int tri_count = count / 3;
+	float cos_crease = cosf(crease_degrees * 3.14159265f / 180.0f);
+	vector<vec3> faces(tri_count);
+	for (int t = 0; t < tri_count; t++)
+		faces[t] = face_normal(vertices, t);
+	vector<vec3> result(tri_count * 3);
+	for (int ii = 0; ii < tri_count * 3; ii++)
+		{
+		const vec3 &fn = faces[ii / 3];
+		vec3 sum = make_vec3(0, 0, 0);
+		for (int uu = 0; uu < tri_count * 3; uu++)
+			{
+			const vec3 &ofn = faces[uu / 3];
+			if (uu != ii && (!same_spot(vertices[ii].pos, vertices[uu].pos, weld_tolerance) || dot(fn, ofn) < cos_crease))
+				continue;
+			sum = sum + ofn;
+			}
+		result[ii] = normalize(sum);
+		}
+	for (int ii = 0; ii < tri_count * 3; ii++)
+		vertices[ii].norm = result[ii];
+	}
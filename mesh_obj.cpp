@@ -0,0 +1,316 @@
+#include "mesh.h"
+#include <string.h>
+#include <limits.h>
+#include <thread>
+
+//***************************************************************
+//		wavefront obj
+//
+//		the mapped file is cut into line aligned chunks, every chunk is parsed on its own thread into
+//		positions/texcoords/normals and face corners. indices can only be resolved once every chunk knows
+//		how many v/vt/vn came before it, so a second (also parallel) pass writes the triangles.
+//
+//		like the old LoadOBJ: z is flipped, v is flipped and the winding is reversed.
+//		faces with more than 3 corners become a fan, missing texcoords are 0, missing normals are flat.
+//***************************************************************
+#define OBJ_NONE		INT_MIN		//attribute not given in the face
+#define OBJ_RELATIVE_V	1			//negative index, counted from the end of its chunk so far
+#define OBJ_RELATIVE_T	2
+#define OBJ_RELATIVE_N	4
+
+struct obj_corner
+	{
+	int v, t, n;
+	int relative;
+	};
+class obj_chunk
+	{
+	public:
+		const char *begin, *end;
+		vector<vec3> positions, normals;
+		vector<vec2> texcoords;
+		vector<obj_corner> corners;
+		vector<uint32_t> face_sizes;
+		size_t triangles;
+		uint32_t v_base, t_base, n_base;	//v/vt/vn of all chunks before this one
+		size_t first_corner;				//where this chunk writes into the output
+		obj_chunk()
+			{
+			begin = end = NULL;
+			triangles = 0;
+			v_base = t_base = n_base = 0;
+			first_corner = 0;
+			}
+	};
+
+//no std::from_chars in vs2015, and strtod is locale dependent and slow
+static const double obj_pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+static inline const char *skip_blank(const char *p, const char *end)
+	{
+	while (p < end && (*p == ' ' || *p == '\t')) p++;
+	return p;
+	}
+static const char *parse_float(const char *p, const char *end, float *out)
+	{
+	p = skip_blank(p, end);
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+	uint64_t mantissa = 0;
+	int digits = 0, exponent = 0;
+	const char *start = p;
+	for (; p < end && (unsigned)(*p - '0') < 10; p++)
+		if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; }
+		else exponent++;
+	if (p < end && *p == '.')
+		for (p++; p < end && (unsigned)(*p - '0') < 10; p++)
+			if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); exponent--; if (mantissa) digits++; }
+	if (p == start) return NULL;
+	if (p < end && (*p == 'e' || *p == 'E'))
+		{
+		const char *q = p + 1;
+		bool eneg = false;
+		if (q < end && (*q == '-' || *q == '+')) eneg = *q++ == '-';
+		int e = 0;
+		if (q < end && (unsigned)(*q - '0') < 10)
+			{
+			for (; q < end && (unsigned)(*q - '0') < 10; q++)
+				if (e < 10000) e = e * 10 + (*q - '0');
+			exponent += eneg ? -e : e;
+			p = q;
+			}
+		}
+	double value = (double)mantissa;
+	while (exponent > 22) { value *= 1e22; exponent -= 22; }
+	while (exponent < -22) { value /= 1e22; exponent += 22; }
+	value = exponent >= 0 ? value * obj_pow10[exponent] : value / obj_pow10[-exponent];
+	*out = (float)(negative ? -value : value);
+	return p;
+	}
+static const char *parse_int(const char *p, const char *end, int *out)
+	{
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+	const char *start = p;
+	int value = 0;
+	for (; p < end && (unsigned)(*p - '0') < 10; p++)
+		if (value < 100000000) value = value * 10 + (*p - '0');
+	if (p == start) return NULL;
+	*out = negative ? -value : value;
+	return p;
+	}
+//1 based or negative obj index -> 0 based, OBJ_NONE for 0 (invalid)
+static inline int obj_index(int index, uint32_t local_count, int flag, int *relative)
+	{
+	if (index > 0) return index - 1;
+	if (index == 0) return OBJ_NONE;
+	*relative |= flag;
+	return (int)local_count + index;
+	}
+static void parse_obj_chunk(obj_chunk *chunk)
+	{
+	const char *p = chunk->begin, *end = chunk->end;
+	while (p < end)
+		{
+		p = skip_blank(p, end);
+		const char *eol = (const char*)memchr(p, '\n', end - p);
+		if (!eol) eol = end;
+		if (p + 1 < eol && p[0] == 'v')
+			{
+			vec3 v = make_vec3(0, 0, 0);
+			if (p[1] == ' ' || p[1] == '\t')
+				{
+				const char *q = p + 1;
+				if ((q = parse_float(q, eol, &v.x)) && (q = parse_float(q, eol, &v.y)) && (q = parse_float(q, eol, &v.z)))
+					{
+					v.z = -v.z;
+					chunk->positions.push_back(v);
+					}
+				else
+					chunk->positions.push_back(make_vec3(0, 0, 0));//keep the numbering
+				}
+			else if (p[1] == 't')
+				{
+				vec2 t = { 0, 0 };
+				const char *q = p + 2;
+				if ((q = parse_float(q, eol, &t.x)))
+					parse_float(q, eol, &t.y);
+				t.y = 1.0f - t.y;
+				chunk->texcoords.push_back(t);
+				}
+			else if (p[1] == 'n')
+				{
+				const char *q = p + 2;
+				if ((q = parse_float(q, eol, &v.x)) && (q = parse_float(q, eol, &v.y)))
+					parse_float(q, eol, &v.z);
+				v.z = -v.z;
+				chunk->normals.push_back(v);
+				}
+			}
+		else if (p + 1 < eol && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+			{
+			const char *q = p + 1;
+			uint32_t count = 0;
+			for (;;)
+				{
+				q = skip_blank(q, eol);
+				if (q >= eol || *q == '\r' || *q == '#') break;
+				obj_corner c = { OBJ_NONE, OBJ_NONE, OBJ_NONE, 0 };
+				int index;
+				const char *r = parse_int(q, eol, &index);
+				if (!r) break;
+				c.v = obj_index(index, (uint32_t)chunk->positions.size(), OBJ_RELATIVE_V, &c.relative);
+				if (r < eol && *r == '/')
+					{
+					r++;
+					if (r < eol && *r != '/' && (r = parse_int(r, eol, &index)))
+						c.t = obj_index(index, (uint32_t)chunk->texcoords.size(), OBJ_RELATIVE_T, &c.relative);
+					if (r && r < eol && *r == '/' && (r = parse_int(r + 1, eol, &index)))
+						c.n = obj_index(index, (uint32_t)chunk->normals.size(), OBJ_RELATIVE_N, &c.relative);
+					}
+				if (!r) break;
+				//skip whatever is left of this corner
+				while (r < eol && *r != ' ' && *r != '\t' && *r != '\r') r++;
+				q = r;
+				chunk->corners.push_back(c);
+				count++;
+				}
+			if (count < 3)
+				chunk->corners.resize(chunk->corners.size() - count);
+			else
+				{
+				chunk->face_sizes.push_back(count);
+				chunk->triangles += count - 2;
+				}
+			}
+		p = eol + 1;
+		}
+	}
+static inline int obj_resolve(int index, bool relative, uint32_t base, size_t count)
+	{
+	if (index == OBJ_NONE) return -1;
+	if (relative) index += (int)base;
+	else if (index < 0) return -1;
+	return (size_t)index < count ? index : -1;
+	}
+class obj_result
+	{
+	public:
+		vector<vec3> positions, normals;
+		vector<vec2> texcoords;
+	};
+static void write_obj_chunk(const obj_chunk *chunk, const obj_result *all, mesh_vertex *out)
+	{
+	const obj_corner *c = chunk->corners.empty() ? NULL : &chunk->corners[0];
+	mesh_vertex *v = out + chunk->first_corner;
+	for (size_t f = 0; f < chunk->face_sizes.size(); f++)
+		{
+		uint32_t count = chunk->face_sizes[f];
+		for (uint32_t k = 1; k + 1 < count; k++)
+			{
+			//fan, reversed: (k+1, k, 0)
+			const obj_corner *tri[3] = { c + k + 1, c + k, c };
+			bool has_normals = true;
+			for (int i = 0; i < 3; i++)
+				{
+				const obj_corner &oc = *tri[i];
+				mesh_vertex &mv = v[i];
+				memset(&mv, 0, sizeof(mv));
+				int pi = obj_resolve(oc.v, (oc.relative & OBJ_RELATIVE_V) != 0, chunk->v_base, all->positions.size());
+				int ti = obj_resolve(oc.t, (oc.relative & OBJ_RELATIVE_T) != 0, chunk->t_base, all->texcoords.size());
+				int ni = obj_resolve(oc.n, (oc.relative & OBJ_RELATIVE_N) != 0, chunk->n_base, all->normals.size());
+				if (pi >= 0) mv.pos = all->positions[pi];
+				if (ti >= 0) mv.tex = all->texcoords[ti];
+				if (ni >= 0) mv.norm = all->normals[ni];
+				else has_normals = false;
+				}
+			if (!has_normals)
+				flat_normals(v, 3);
+			v += 3;
+			}
+		c += count;
+		}
+	}
+//***************************************************************
+bool ParseOBJ(const unsigned char *data, size_t size, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges, int threads)
+	{
+	vertices.clear();
+	if (ranges) ranges->clear();
+	if (!data) return size == 0;
+	if (threads <= 0)
+		{
+		threads = 1;
+		if (size >= OBJ_PARALLEL_MIN)
+			threads = (int)std::thread::hardware_concurrency();
+		if (threads < 1) threads = 1;
+		}
+
+	//line aligned chunks
+	const char *text = (const char*)data, *text_end = text + size;
+	vector<obj_chunk> chunks(threads);
+	const char *p = text;
+	for (int ii = 0; ii < threads; ii++)
+		{
+		const char *e = ii == threads - 1 ? text_end : text + size * (ii + 1) / threads;
+		if (e < p) e = p;
+		const char *nl = e < text_end ? (const char*)memchr(e, '\n', text_end - e) : NULL;
+		e = nl ? nl + 1 : text_end;
+		chunks[ii].begin = p;
+		chunks[ii].end = e;
+		p = e;
+		}
+
+	vector<std::thread> workers;
+	for (int ii = 1; ii < threads; ii++)
+		workers.push_back(std::thread(parse_obj_chunk, &chunks[ii]));
+	parse_obj_chunk(&chunks[0]);
+	for (size_t ii = 0; ii < workers.size(); ii++)
+		workers[ii].join();
+	workers.clear();
+
+	//merge the attributes, the bases resolve the indices of every chunk
+	obj_result all;
+	size_t triangles = 0;
+	for (int ii = 0; ii < threads; ii++)
+		{
+		obj_chunk &c = chunks[ii];
+		c.v_base = (uint32_t)all.positions.size();
+		c.t_base = (uint32_t)all.texcoords.size();
+		c.n_base = (uint32_t)all.normals.size();
+		c.first_corner = triangles * 3;
+		triangles += c.triangles;
+		all.positions.insert(all.positions.end(), c.positions.begin(), c.positions.end());
+		all.texcoords.insert(all.texcoords.end(), c.texcoords.begin(), c.texcoords.end());
+		all.normals.insert(all.normals.end(), c.normals.begin(), c.normals.end());
+		vector<vec3>().swap(c.positions);
+		vector<vec2>().swap(c.texcoords);
+		vector<vec3>().swap(c.normals);
+		}
+	if (!triangles) return false;
+	vertices.resize(triangles * 3);
+	for (int ii = 1; ii < threads; ii++)
+		workers.push_back(std::thread(write_obj_chunk, &chunks[ii], &all, &vertices[0]));
+	write_obj_chunk(&chunks[0], &all, &vertices[0]);
+	for (size_t ii = 0; ii < workers.size(); ii++)
+		workers[ii].join();
+
+	if (ranges)
+		{
+		mesh_range r = { 0, (uint32_t)vertices.size() };
+		ranges->push_back(r);
+		}
+	return true;
+	}
+bool ReadOBJ(const char *filename, vector<mesh_vertex> &vertices, vector<mesh_range> *ranges)
+	{
+	mapped_file file;
+	if (!file.open(filename)) return false;
+	return ParseOBJ(file.data(), file.size(), vertices, ranges);
+	}
+bool is_obj_file(const char *filename)
+	{
+	size_t len = strlen(filename);
+	if (len < 4) return false;
+	const char *ext = filename + len - 4;
+	return ext[0] == '.' && (ext[1] | 32) == 'o' && (ext[2] | 32) == 'b' && (ext[3] | 32) == 'j';
+	}
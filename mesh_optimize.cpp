@@ -0,0 +1,260 @@
+#include "mesh.h"
+#include <string.h>
+#include <math.h>
+
+//***************************************************************
+//		welding: identical vertices (all 32 bytes) become one
+//***************************************************************
+void weld_vertices(const vector<mesh_vertex> &corners, mesh_data &mesh)
+	{
+	mesh.vertices.clear();
+	mesh.indices.resize(corners.size());
+	size_t table_size = 16;
+	while (table_size < corners.size() * 2) table_size *= 2;
+	vector<uint32_t> table(table_size, 0xffffffff);//open addressing, index into mesh.vertices
+	mesh.vertices.reserve(corners.size() / 2);
+
+	for (size_t ii = 0; ii < corners.size(); ii++)
+		{
+		const mesh_vertex &v = corners[ii];
+		size_t slot = (size_t)hash_bytes(&v, sizeof(v)) & (table_size - 1);
+		for (;;)
+			{
+			uint32_t found = table[slot];
+			if (found == 0xffffffff)
+				{
+				found = (uint32_t)mesh.vertices.size();
+				mesh.vertices.push_back(v);
+				table[slot] = found;
+				mesh.indices[ii] = found;
+				break;
+				}
+			if (memcmp(&mesh.vertices[found], &v, sizeof(v)) == 0)
+				{
+				mesh.indices[ii] = found;
+				break;
+				}
+			slot = (slot + 1) & (table_size - 1);
+			}
+		}
+	}
+//***************************************************************
+//		triangle order for the post transform vertex cache
+//		tom forsyth, "linear-speed vertex cache optimisation"
+//***************************************************************
+#define VCACHE_SIZE			32
+#define VCACHE_MAX_VALENCE	32
+static float vcache_position_score[VCACHE_SIZE];
+static float vcache_valence_score[VCACHE_MAX_VALENCE];
+static void vcache_init_scores()
+	{
+	static bool done = false;
+	if (done) return;
+	for (int ii = 0; ii < VCACHE_SIZE; ii++)
+		{
+		if (ii < 3)
+			vcache_position_score[ii] = 0.75f;//the last triangle, no matter which corner
+		else
+			vcache_position_score[ii] = powf(1.0f - (ii - 3) / (float)(VCACHE_SIZE - 3), 1.5f);
+		}
+	vcache_valence_score[0] = 0;
+	for (int ii = 1; ii < VCACHE_MAX_VALENCE; ii++)
+		vcache_valence_score[ii] = 2.0f * powf((float)ii, -0.5f);//few triangles left: get rid of them
+	done = true;
+	}
+static float vcache_score(int cache_pos, uint32_t remaining)
+	{
+	if (remaining == 0) return -1.0f;
+	float score = remaining < VCACHE_MAX_VALENCE ? vcache_valence_score[remaining] : 2.0f * powf((float)remaining, -0.5f);
+	if (cache_pos >= 0) score += vcache_position_score[cache_pos];
+	return score;
+	}
+void optimize_vertex_cache(uint32_t *indices, size_t index_count, size_t vertex_count)
+	{
+	size_t tri_count = index_count / 3;
+	if (tri_count < 2) return;
+	vcache_init_scores();
+
+	//triangles per vertex, packed: adjacency[offset[v] .. offset[v] + remaining[v]]
+	vector<uint32_t> remaining(vertex_count, 0);
+	for (size_t ii = 0; ii < tri_count * 3; ii++)
+		remaining[indices[ii]]++;
+	vector<uint32_t> offset(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; v++)
+		offset[v + 1] = offset[v] + remaining[v];
+	vector<uint32_t> adjacency(tri_count * 3);
+	vector<uint32_t> fill(offset.begin(), offset.end() - 1);
+	for (size_t t = 0; t < tri_count; t++)
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+
+	vector<int> cache_pos(vertex_count, -1);
+	vector<float> vertex_score(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++)
+		vertex_score[v] = vcache_score(-1, remaining[v]);
+	vector<float> tri_score(tri_count);
+	vector<char> emitted(tri_count, 0);
+	for (size_t t = 0; t < tri_count; t++)
+		tri_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+
+	vector<uint32_t> result(tri_count * 3);
+	uint32_t cache[VCACHE_SIZE + 3];
+	uint32_t new_cache[VCACHE_SIZE + 3];
+	int cache_count = 0;
+	size_t scan = 0;//dead end fallback: next triangle in file order that is still left
+	long best = 0;
+	for (size_t t = 1; t < tri_count; t++)
+		if (tri_score[t] > tri_score[best]) best = (long)t;
+
+	for (size_t out = 0; out < tri_count; out++)
+		{
+		if (best < 0)
+			{
+			while (emitted[scan]) scan++;
+			best = (long)scan;
+			}
+		const uint32_t *tri = indices + best * 3;
+		memcpy(&result[out * 3], tri, 3 * sizeof(uint32_t));
+		emitted[best] = 1;
+
+		//take the triangle out of the adjacency of its vertices
+		for (int k = 0; k < 3; k++)
+			{
+			uint32_t v = tri[k];
+			uint32_t *adj = &adjacency[offset[v]];
+			for (uint32_t a = 0; a < remaining[v]; a++)
+				if (adj[a] == (uint32_t)best)
+					{
+					adj[a] = adj[remaining[v] - 1];
+					break;
+					}
+			remaining[v]--;
+			}
+
+		//the three go to the front, the rest moves back
+		int new_count = 0;
+		for (int k = 0; k < 3; k++)
+			new_cache[new_count++] = tri[k];
+		for (int c = 0; c < cache_count; c++)
+			{
+			uint32_t v = cache[c];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				new_cache[new_count++] = v;
+			}
+		if (new_count > VCACHE_SIZE + 3) new_count = VCACHE_SIZE + 3;
+		for (int c = 0; c < new_count; c++)
+			{
+			uint32_t v = new_cache[c];
+			cache_pos[v] = c < VCACHE_SIZE ? c : -1;
+			vertex_score[v] = vcache_score(cache_pos[v], remaining[v]);
+			}
+		//everything in the cache got a new score, so did its triangles
+		best = -1;
+		float best_score = -1e30f;
+		for (int c = 0; c < new_count; c++)
+			{
+			uint32_t v = new_cache[c];
+			for (uint32_t a = 0; a < remaining[v]; a++)
+				{
+				uint32_t t = adjacency[offset[v] + a];
+				const uint32_t *ti = indices + t * 3;
+				float score = vertex_score[ti[0]] + vertex_score[ti[1]] + vertex_score[ti[2]];
+				tri_score[t] = score;
+				if (score > best_score)
+					{
+					best_score = score;
+					best = (long)t;
+					}
+				}
+			}
+		cache_count = new_count < VCACHE_SIZE ? new_count : VCACHE_SIZE;
+		memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+		}
+	memcpy(indices, &result[0], tri_count * 3 * sizeof(uint32_t));
+	}
+//***************************************************************
+//		vertices in order of first use, the fetches follow the index buffer
+//***************************************************************
+void optimize_vertex_fetch(mesh_data &mesh)
+	{
+	vector<uint32_t> remap(mesh.vertices.size(), 0xffffffff);
+	vector<mesh_vertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+	for (size_t ii = 0; ii < mesh.indices.size(); ii++)
+		{
+		uint32_t &i = mesh.indices[ii];
+		if (remap[i] == 0xffffffff)
+			{
+			remap[i] = (uint32_t)vertices.size();
+			vertices.push_back(mesh.vertices[i]);
+			}
+		i = remap[i];
+		}
+	mesh.vertices.swap(vertices);//unreferenced vertices are dropped here
+	}
+//***************************************************************
+float acmr(const uint32_t *indices, size_t index_count, int cache_size)
+	{
+	if (index_count < 3) return 0;
+	//fifo cache like most hardware
+	vector<uint32_t> fifo(cache_size, 0xffffffff);
+	int head = 0;
+	size_t misses = 0;
+	for (size_t ii = 0; ii < index_count; ii++)
+		{
+		bool hit = false;
+		for (int c = 0; c < cache_size; c++)
+			if (fifo[c] == indices[ii])
+				{
+				hit = true;
+				break;
+				}
+		if (hit) continue;
+		misses++;
+		fifo[head] = indices[ii];
+		head = (head + 1) % cache_size;
+		}
+	return misses / (float)(index_count / 3);
+	}
+//***************************************************************
+bool build_mesh(const char *source, mesh_data &mesh, mesh_stats *stats)
+	{
+	vector<mesh_vertex> corners;
+	vector<mesh_range> ranges;
+	bool ok;
+	if (is_cmp_file(source))		ok = ReadCMP(source, corners, &ranges);
+	else if (is_obj_file(source))	ok = ReadOBJ(source, corners, &ranges);
+	else							ok = Read3DS(source, corners, &ranges, &mesh.materials);
+	if (!ok || corners.empty()) return false;		//no triangles: not a model, or only half written (hot reload)
+
+	weld_vertices(corners, mesh);
+	mesh.ranges = ranges;
+	float acmr_welded = acmr(mesh.indices.empty() ? NULL : &mesh.indices[0], mesh.indices.size());
+	//every submodel is reordered on its own, so the ranges stay valid
+	for (size_t ii = 0; ii < mesh.ranges.size(); ii++)
+		optimize_vertex_cache(&mesh.indices[mesh.ranges[ii].first_index], mesh.ranges[ii].index_count, mesh.vertices.size());
+	build_meshlets(mesh);
+	size_t lod0_indices = mesh.indices.size();
+	build_lods(mesh);
+	optimize_vertex_fetch(mesh);//lod 0 uses every vertex, so the other lods dont change the order
+
+	if (stats)
+		{
+		stats->triangles = (uint32_t)(lod0_indices / 3);
+		stats->corners = (uint32_t)corners.size();
+		stats->unique_vertices = (uint32_t)mesh.vertices.size();
+		stats->acmr_welded = acmr_welded;
+		stats->acmr = acmr(mesh.indices.empty() ? NULL : &mesh.indices[0], lod0_indices);
+		stats->bytes_unindexed = (uint64_t)corners.size() * sizeof(mesh_vertex);
+		stats->bytes_indexed = (uint64_t)mesh.vertices.size() * sizeof(mesh_vertex) +
+			(uint64_t)lod0_indices * (mesh.vertices.size() <= 65536 ? 2 : 4);
+		stats->lod_count = (uint32_t)mesh.lods.size();
+		stats->meshlet_count = (uint32_t)mesh.meshlets.size();
+		for (size_t ii = 0; ii < mesh.lods.size(); ii++)
+			{
+			stats->lod_triangles[ii] = mesh.lods[ii].index_count / 3;
+			stats->lod_error[ii] = mesh.lods[ii].error;
+			}
+		}
+	return true;
+	}
@@ -0,0 +1,180 @@
+#include "mesh.h"
+#include <string.h>
+#include <math.h>
+
+//***************************************************************
+//		packed vertices and instances, encode here and decode in shader.fx (VS_packed, VS_instance_packed)
+//
+//		position: 16 bit unorm inside the mesh bounds, the shader gets bbmin and the size of the box
+//		texcoord: half floats, tiling uvs above 1 still work
+//		normal:   octahedral, the unit sphere folded onto a square, 2 x 16 bit snorm
+//***************************************************************
+static float clamp1(float v, float lo, float hi)
+	{
+	return v < lo ? lo : (v > hi ? hi : v);
+	}
+static int16_t to_snorm16(float v)
+	{
+	return (int16_t)floorf(clamp1(v, -1.0f, 1.0f) * 32767.0f + 0.5f);
+	}
+static int8_t to_snorm8(float v)
+	{
+	return (int8_t)floorf(clamp1(v, -1.0f, 1.0f) * 127.0f + 0.5f);
+	}
+//d3d: -32768 and -32767 are both -1
+static float from_snorm16(int16_t v)
+	{
+	return v <= -32767 ? -1.0f : v / 32767.0f;
+	}
+static float from_snorm8(int8_t v)
+	{
+	return v <= -127 ? -1.0f : v / 127.0f;
+	}
+//***************************************************************
+//round to nearest even like the gpu, overflow gives infinity, tiny values become denormals
+uint16_t float_to_half(float f)
+	{
+	uint32_t bits;
+	memcpy(&bits, &f, 4);
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7fffffff;
+	if (magnitude >= 0x7f800000)								//inf, nan
+		return (uint16_t)(sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0));
+	if (magnitude >= 0x477ff000)								//rounds to above 65504
+		return (uint16_t)(sign | 0x7c00);
+	if (magnitude < 0x38800000)									//below the smallest normal half
+		{
+		if (magnitude < 0x33000000) return (uint16_t)sign;	//below half of the smallest denormal
+		uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+		int shift = 113 - (int)(magnitude >> 23) + 13;
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1))) half++;
+		return (uint16_t)(sign | half);
+		}
+	uint32_t half = (magnitude - 0x38000000) >> 13;
+	uint32_t rest = magnitude & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+	return (uint16_t)(sign | half);
+	}
+float half_to_float(uint16_t h)
+	{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x3ff;
+	uint32_t bits;
+	if (exponent == 0x1f)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else if (exponent != 0)
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	else if (mantissa == 0)
+		bits = sign;
+	else
+		{
+		//denormal half, normal float
+		exponent = 113;
+		while (!(mantissa & 0x400))
+			{
+			mantissa <<= 1;
+			exponent--;
+			}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+		}
+	float f;
+	memcpy(&f, &bits, 4);
+	return f;
+	}
+//***************************************************************
+void oct_encode(const vec3 &n, int16_t result[2])
+	{
+	float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (sum <= 0)
+		{
+		result[0] = result[1] = 0;
+		return;
+		}
+	float x = n.x / sum, y = n.y / sum;
+	if (n.z < 0)
+		{
+		float fx = (1.0f - fabsf(y)) * (x >= 0 ? 1.0f : -1.0f);
+		float fy = (1.0f - fabsf(x)) * (y >= 0 ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+		}
+	//rounding x and y on their own is up to 0.03 degrees off, the best of the 4 neighbours is about 0.005
+	float fx = floorf(clamp1(x, -1.0f, 1.0f) * 32767.0f), fy = floorf(clamp1(y, -1.0f, 1.0f) * 32767.0f);
+	float best = -2.0f;
+	for (int ii = 0; ii < 4; ii++)
+		{
+		int16_t e[2] = { (int16_t)clamp1(fx + (ii & 1), -32767.0f, 32767.0f), (int16_t)clamp1(fy + (ii >> 1), -32767.0f, 32767.0f) };
+		float d = dot(oct_decode(e), n);
+		if (d > best)
+			{
+			best = d;
+			result[0] = e[0];
+			result[1] = e[1];
+			}
+		}
+	}
+vec3 oct_decode(const int16_t e[2])
+	{
+	vec3 n = make_vec3(from_snorm16(e[0]), from_snorm16(e[1]), 0);
+	n.z = 1.0f - fabsf(n.x) - fabsf(n.y);
+	float t = clamp1(-n.z, 0, 1);
+	n.x += n.x >= 0 ? -t : t;
+	n.y += n.y >= 0 ? -t : t;
+	return normalize(n);
+	}
+//***************************************************************
+void pack_vertices(const mesh_vertex *vertices, size_t count, const float bbmin[3], const float bbmax[3], packed_vertex *result)
+	{
+	float scale[3];
+	for (int k = 0; k < 3; k++)
+		scale[k] = bbmax[k] > bbmin[k] ? 65535.0f / (bbmax[k] - bbmin[k]) : 0;
+	for (size_t ii = 0; ii < count; ii++)
+		{
+		const mesh_vertex &v = vertices[ii];
+		packed_vertex &p = result[ii];
+		const float *pos = &v.pos.x;
+		for (int k = 0; k < 3; k++)
+			p.pos[k] = (uint16_t)floorf(clamp1((pos[k] - bbmin[k]) * scale[k], 0, 65535.0f) + 0.5f);
+		p.pos[3] = 0;
+		p.tex[0] = float_to_half(v.tex.x);
+		p.tex[1] = float_to_half(v.tex.y);
+		oct_encode(v.norm, p.norm);
+		}
+	}
+mesh_vertex unpack_vertex(const packed_vertex &p, const float bbmin[3], const float bbmax[3])
+	{
+	mesh_vertex v;
+	float *pos = &v.pos.x;
+	for (int k = 0; k < 3; k++)
+		pos[k] = bbmin[k] + p.pos[k] / 65535.0f * (bbmax[k] - bbmin[k]);
+	v.tex.x = half_to_float(p.tex[0]);
+	v.tex.y = half_to_float(p.tex[1]);
+	v.norm = oct_decode(p.norm);
+	return v;
+	}
+//***************************************************************
+void pack_instances(const float *instances, size_t count, float position_range, packed_instance *result)
+	{
+	for (size_t ii = 0; ii < count; ii++)
+		{
+		const float *pos = instances + ii * 8, *rot = pos + 4;
+		packed_instance &p = result[ii];
+		for (int k = 0; k < 4; k++)
+			p.pos[k] = to_snorm16(pos[k] / position_range);
+		for (int k = 0; k < 3; k++)
+			p.rot[k] = to_snorm8(rot[k] / PACKED_INSTANCE_ANGLE);
+		p.rot[3] = to_snorm8(rot[3]);
+		}
+	}
+void unpack_instance(const packed_instance &p, float position_range, float instance[8])
+	{
+	for (int k = 0; k < 4; k++)
+		instance[k] = from_snorm16(p.pos[k]) * position_range;
+	for (int k = 0; k < 3; k++)
+		instance[4 + k] = from_snorm8(p.rot[k]) * PACKED_INSTANCE_ANGLE;
+	instance[7] = from_snorm8(p.rot[3]);
+	}
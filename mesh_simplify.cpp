@@ -0,0 +1,301 @@
+#include "mesh.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+//***************************************************************
+//		quadric error edge collapse (garland/heckbert), index buffer only
+//
+//		a vertex is only ever moved onto one of its neighbours, so every LOD uses the same vertex buffer
+//		and is just another index range. vertices that share a position (uv seams, creases) and the ones
+//		on open borders stay where they are, everything else can collapse into them.
+//***************************************************************
+#define SIMPLIFY_NONE		0xffffffff
+
+class quadric
+	{
+	public:
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+		quadric()
+			{
+			memset(this, 0, sizeof(*this));
+			}
+		void add_plane(double a, double b, double c, double d, double w)
+			{
+			a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+			b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+			c2 += w * c * c; cd += w * c * d;
+			d2 += w * d * d;
+			weight += w;
+			}
+		void add(const quadric &q)
+			{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+			weight += q.weight;
+			}
+		//squared distance to the planes, averaged by area
+		double error(const vec3 &p) const
+			{
+			double x = p.x, y = p.y, z = p.z;
+			double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+				+ c2 * z * z + 2 * cd * z + d2;
+			return weight > 0 ? fabs(e) / weight : 0;
+			}
+	};
+struct edge_collapse
+	{
+	float cost;
+	uint32_t from;		//position id that goes away
+	uint32_t to;		//vertex (wedge) its corners become
+	bool operator<(const edge_collapse &o) const { return cost < o.cost; }
+	};
+
+static vec3 tri_normal(const vec3 &a, const vec3 &b, const vec3 &c)
+	{
+	return cross(b - a, c - a);
+	}
+size_t simplify_mesh(uint32_t *destination, const uint32_t *indices, size_t index_count, const mesh_vertex *vertices,
+					 size_t vertex_count, size_t target_index_count, float *result_error)
+	{
+	if (result_error) *result_error = 0;
+	if (destination != indices) memcpy(destination, indices, index_count * sizeof(uint32_t));
+	size_t count = index_count - index_count % 3;
+	if (count <= target_index_count || vertex_count == 0) return count;
+
+	//vertices at the same spot get one position id
+	vector<uint32_t> pos_id(vertex_count);
+	vector<vec3> positions;
+	vector<uint32_t> wedges;
+	size_t table_size = 16;
+	while (table_size < vertex_count * 2) table_size *= 2;
+	vector<uint32_t> table(table_size, SIMPLIFY_NONE);
+	for (size_t v = 0; v < vertex_count; v++)
+		{
+		size_t slot = (size_t)hash_bytes(&vertices[v].pos, sizeof(vec3)) & (table_size - 1);
+		for (;;)
+			{
+			uint32_t found = table[slot];
+			if (found == SIMPLIFY_NONE)
+				{
+				table[slot] = pos_id[v] = (uint32_t)positions.size();
+				positions.push_back(vertices[v].pos);
+				wedges.push_back(1);
+				break;
+				}
+			if (memcmp(&positions[found], &vertices[v].pos, sizeof(vec3)) == 0)
+				{
+				pos_id[v] = found;
+				wedges[found]++;
+				break;
+				}
+			slot = (slot + 1) & (table_size - 1);
+			}
+		}
+	size_t pos_count = positions.size();
+
+	//locked: seams and open or non manifold edges. an edge used by exactly two triangles is fine
+	vector<char> locked(pos_count, 0);
+	for (size_t p = 0; p < pos_count; p++)
+		locked[p] = wedges[p] > 1;
+	vector<uint64_t> edges;
+	edges.reserve(count);
+	for (size_t ii = 0; ii < count; ii += 3)
+		for (int k = 0; k < 3; k++)
+			{
+			uint64_t a = pos_id[destination[ii + k]], b = pos_id[destination[ii + (k + 1) % 3]];
+			if (a != b) edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+			}
+	std::sort(edges.begin(), edges.end());
+	for (size_t ii = 0; ii < edges.size();)
+		{
+		size_t run = ii + 1;
+		while (run < edges.size() && edges[run] == edges[ii]) run++;
+		if (run - ii != 2)
+			locked[edges[ii] >> 32] = locked[edges[ii] & 0xffffffff] = 1;
+		ii = run;
+		}
+
+	vector<quadric> quadrics(pos_count);
+	for (size_t ii = 0; ii < count; ii += 3)
+		{
+		uint32_t p0 = pos_id[destination[ii]], p1 = pos_id[destination[ii + 1]], p2 = pos_id[destination[ii + 2]];
+		vec3 n = tri_normal(positions[p0], positions[p1], positions[p2]);
+		double area = length(n);
+		if (area <= 0) continue;
+		n = n * (float)(1.0 / area);
+		double d = -dot(n, positions[p0]);
+		for (int k = 0; k < 3; k++)
+			quadrics[pos_id[destination[ii + k]]].add_plane(n.x, n.y, n.z, d, area * 0.5);
+		}
+
+	double max_error = 0;
+	vector<edge_collapse> collapses;
+	vector<uint32_t> collapse_to(pos_count);
+	vector<char> touched(pos_count);
+	vector<uint32_t> adjacency_start(pos_count + 1), adjacency;
+	while (count > target_index_count)
+		{
+		//every edge in both directions, cheapest first
+		collapses.clear();
+		for (size_t ii = 0; ii < count; ii += 3)
+			for (int k = 0; k < 3; k++)
+				{
+				uint32_t a = destination[ii + k], b = destination[ii + (k + 1) % 3];
+				uint32_t pa = pos_id[a], pb = pos_id[b];
+				if (pa == pb) continue;
+				quadric q = quadrics[pa];
+				q.add(quadrics[pb]);
+				if (!locked[pa])
+					{
+					edge_collapse c = { (float)q.error(positions[pb]), pa, b };
+					collapses.push_back(c);
+					}
+				if (!locked[pb])
+					{
+					edge_collapse c = { (float)q.error(positions[pa]), pb, a };
+					collapses.push_back(c);
+					}
+				}
+		if (collapses.empty()) break;
+		std::sort(collapses.begin(), collapses.end());
+
+		//triangles per position id
+		std::fill(adjacency_start.begin(), adjacency_start.end(), 0);
+		for (size_t ii = 0; ii < count; ii++)
+			adjacency_start[pos_id[destination[ii]] + 1]++;
+		for (size_t p = 0; p < pos_count; p++)
+			adjacency_start[p + 1] += adjacency_start[p];
+		adjacency.resize(count);
+		vector<uint32_t> fill(adjacency_start.begin(), adjacency_start.end() - 1);
+		for (size_t ii = 0; ii < count; ii++)
+			adjacency[fill[pos_id[destination[ii]]]++] = (uint32_t)(ii / 3);
+
+		std::fill(collapse_to.begin(), collapse_to.end(), SIMPLIFY_NONE);
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t triangles_needed = (count - target_index_count + 2) / 3, triangles_removed = 0, done = 0;
+		for (size_t c = 0; c < collapses.size() && triangles_removed < triangles_needed; c++)
+			{
+			const edge_collapse &ec = collapses[c];
+			uint32_t from = ec.from, to = pos_id[ec.to];
+			if (touched[from] || touched[to]) continue;
+			//no triangle around from may flip over
+			bool flips = false;
+			size_t removes = 0;
+			for (uint32_t a = adjacency_start[from]; a < adjacency_start[from + 1] && !flips; a++)
+				{
+				const uint32_t *tri = destination + adjacency[a] * 3;
+				uint32_t p[3] = { pos_id[tri[0]], pos_id[tri[1]], pos_id[tri[2]] };
+				if (p[0] == to || p[1] == to || p[2] == to)
+					{
+					removes++;
+					continue;
+					}
+				vec3 before = tri_normal(positions[p[0]], positions[p[1]], positions[p[2]]);
+				vec3 moved[3];
+				for (int k = 0; k < 3; k++)
+					moved[k] = positions[p[k] == from ? to : p[k]];
+				vec3 after = tri_normal(moved[0], moved[1], moved[2]);
+				flips = dot(before, after) < 0.25f * length(before) * length(after);
+				}
+			if (flips) continue;
+			collapse_to[from] = ec.to;
+			//the whole fan around from is off limits for this pass, so the flip test above stays true
+			for (uint32_t a = adjacency_start[from]; a < adjacency_start[from + 1]; a++)
+				{
+				const uint32_t *tri = destination + adjacency[a] * 3;
+				for (int k = 0; k < 3; k++)
+					touched[pos_id[tri[k]]] = 1;
+				}
+			quadrics[to].add(quadrics[from]);
+			if (ec.cost > max_error) max_error = ec.cost;
+			triangles_removed += removes;
+			done++;
+			}
+		if (!done) break;
+
+		//move the corners and drop the triangles that collapsed
+		size_t write = 0;
+		for (size_t ii = 0; ii < count; ii += 3)
+			{
+			uint32_t tri[3];
+			for (int k = 0; k < 3; k++)
+				{
+				tri[k] = destination[ii + k];
+				uint32_t to = collapse_to[pos_id[tri[k]]];
+				if (to != SIMPLIFY_NONE) tri[k] = to;
+				}
+			if (pos_id[tri[0]] == pos_id[tri[1]] || pos_id[tri[1]] == pos_id[tri[2]] || pos_id[tri[0]] == pos_id[tri[2]])
+				continue;
+			memcpy(destination + write, tri, sizeof(tri));
+			write += 3;
+			}
+		count = write;
+		}
+	if (result_error) *result_error = (float)sqrt(max_error);
+	return count;
+	}
+//***************************************************************
+//		LOD chain: every level is simplified from the one before, all of them share the vertices
+//***************************************************************
+void build_lods(mesh_data &mesh, int levels, float ratio)
+	{
+	mesh.lods.clear();
+	mesh_lod lod0 = { 0, (uint32_t)mesh.indices.size(), 0 };
+	mesh.lods.push_back(lod0);
+	if (mesh.indices.empty()) return;
+	vector<uint32_t> current(mesh.indices), next(mesh.indices.size());
+	float error = 0;
+	for (int level = 1; level < levels; level++)
+		{
+		size_t target = (size_t)(current.size() / 3 * ratio) * 3;
+		float level_error;
+		size_t count = simplify_mesh(&next[0], &current[0], current.size(), &mesh.vertices[0], mesh.vertices.size(), target, &level_error);
+		//stuck on locked vertices: another level would look the same
+		if (count == 0 || count > current.size() * 0.9f) break;
+		if (level_error > error) error = level_error;
+		optimize_vertex_cache(&next[0], count, mesh.vertices.size());
+		mesh_lod lod = { (uint32_t)mesh.indices.size(), (uint32_t)count, error };
+		mesh.indices.insert(mesh.indices.end(), next.begin(), next.begin() + count);
+		mesh.lods.push_back(lod);
+		current.assign(next.begin(), next.begin() + count);
+		}
+	}
+int select_lod(const mesh_lod *lods, int lod_count, float distance, float error_per_unit)
+	{
+	//the coarsest level whose error still looks smaller than error_per_unit at that distance
+	int lod = 0;
+	for (int ii = 1; ii < lod_count; ii++)
+		if (lods[ii].error <= distance * error_per_unit)
+			lod = ii;
+	return lod;
+	}
+void bucket_instances_by_lod(const float *positions, size_t stride, size_t instance_count, const float camera[3], float scale,
+							 const mesh_lod *lods, int lod_count, float error_per_unit, uint32_t *order, uint32_t *lod_first, uint32_t *lod_instances)
+	{
+	vector<unsigned char> lod_of(instance_count);
+	for (int ii = 0; ii < lod_count; ii++)
+		lod_instances[ii] = 0;
+	for (size_t ii = 0; ii < instance_count; ii++)
+		{
+		const float *p = (const float*)((const char*)positions + ii * stride);
+		float dx = p[0] - camera[0], dy = p[1] - camera[1], dz = p[2] - camera[2];
+		//a scaled instance has a scaled error, so compare against distance / scale
+		int lod = select_lod(lods, lod_count, sqrtf(dx * dx + dy * dy + dz * dz) / scale, error_per_unit);
+		lod_of[ii] = (unsigned char)lod;
+		lod_instances[lod]++;
+		}
+	uint32_t first = 0;
+	for (int ii = 0; ii < lod_count; ii++)
+		{
+		lod_first[ii] = first;
+		first += lod_instances[ii];
+		}
+	vector<uint32_t> fill(lod_first, lod_first + lod_count);
+	for (size_t ii = 0; ii < instance_count; ii++)
+		order[fill[lod_of[ii]]++] = (uint32_t)ii;
+	}
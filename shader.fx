@@ -49,6 +49,7 @@ matrix Projection;
 matrix LightView;
 float4 info;
 float4 CameraPos;
+float4 TexRect;		//atlas rect: offset xy, scale zw, (0, 0, 1, 1) without atlas
 };
 
 
@@ -72,6 +73,32 @@ struct VS_INPUT_INSTANCE
 	float4 Scale : SCALE;
 };
 
+//packed vertices (packed_vertex/packed_instance in mesh.h), half the size, decoded by VS_packed and VS_instance_packed
+cbuffer Unpack : register( b1 )
+{
+float4 UnpackOffset;	//bbmin of the model
+float4 UnpackScale;		//bbmax - bbmin
+};
+static const float PackedInstanceRange = 512;			//PACKED_INSTANCE_RANGE
+static const float PackedInstanceAngle = 6.2831853;		//PACKED_INSTANCE_ANGLE
+
+struct VS_INPUT_PACKED
+{
+	float4 Pos : POSITION;		//unorm16 in the bounding box
+	float2 Tex : TEXCOORD0;		//half float
+	float2 Norm : NORMAL0;		//octahedral snorm16
+};
+
+struct VS_INPUT_INSTANCE_PACKED
+{
+	float4 Pos : POSITION;
+	float2 Tex : TEXCOORD0;
+	float2 Norm : NORMAL0;
+	float4 iPos : INSTANCEVEC;	//snorm16 * PackedInstanceRange
+	float4 iRot	: ROTATEINST;	//snorm8, xyz * PackedInstanceAngle
+	uint instanceID : SV_InstanceID;
+};
+
 struct PS_INPUT
 {
     float4 Pos : SV_POSITION;
@@ -99,7 +126,7 @@ PS_INPUT VS(VS_INPUT input)
 	output.OPos = mul(output.OPos, Projection);
 
 
-	output.Tex = input.Tex;
+	output.Tex = input.Tex * TexRect.zw + TexRect.xy;
 	//lighing:
 	//also turn the light normals in case of a rotation:
 	output.Norm = normalize( mul(float4(input.Norm, 0), World));
@@ -175,6 +202,44 @@ PS_INPUT VS_instance(VS_INPUT_INSTANCE input)
 	return output;
 }
 //--------------------------------------------------------------------------------------
+// Packed Vertex Shaders: decode, then the same as VS and VS_instance
+//--------------------------------------------------------------------------------------
+float3 oct_decode(float2 e)
+{
+	float3 n = float3(e.xy, 1 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0 ? -t : t;
+	return normalize(n);
+}
+
+VS_INPUT unpack_vertex(float4 pos, float2 tex, float2 norm)
+{
+	VS_INPUT v;
+	v.Pos = float4(UnpackOffset.xyz + pos.xyz * UnpackScale.xyz, 1);
+	v.Tex = tex;
+	v.Norm = oct_decode(norm);
+	return v;
+}
+
+PS_INPUT VS_packed(VS_INPUT_PACKED input)
+{
+	return VS(unpack_vertex(input.Pos, input.Tex, input.Norm));
+}
+
+PS_INPUT VS_instance_packed(VS_INPUT_INSTANCE_PACKED input)
+{
+	VS_INPUT v = unpack_vertex(input.Pos, input.Tex, input.Norm);
+	VS_INPUT_INSTANCE i;
+	i.Pos = v.Pos;
+	i.Tex = v.Tex;
+	i.Norm = v.Norm;
+	i.iPos = input.iPos * PackedInstanceRange;
+	i.iRot = float4(input.iRot.xyz * PackedInstanceAngle, input.iRot.w);
+	i.instanceID = input.instanceID;
+	i.Scale = 1;
+	return VS_instance(i);
+}
+//--------------------------------------------------------------------------------------
 // Pixel Shader
 //--------------------------------------------------------------------------------------
 float4 PSdepth(PS_INPUT input) : SV_Target
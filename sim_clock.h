@@ -0,0 +1,96 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			the game in fixed ticks: the frame time goes into an accumulator, whole ticks are taken out of it and
+//			simulated, what is left over is how far the rendering is between the last two ticks
+//
+//			USAGE:
+//				sim_clock clock;
+//				on input (window messages, gamepad):
+//					clock.push(sim_event(SIM_KEY_DOWN, 'W'));		<- applied at the start of the next tick, in order
+//				once per frame:
+//					int ticks = clock.advance(elapsed_micro);		<- the ticks that are due, speed times as many when fast-forwarding
+//					for (int ii = 0; ii < ticks; ii++)
+//						{
+//						previous = position;
+//						simulate(clock.take_events());				<- the events for this tick (the first one gets all of them)
+//						clock.tick++;
+//						}
+//					render lerp(previous, position, clock.alpha())
+//
+//			a tick is always SIM_TICK_MICRO, the simulation never sees the frame time: the same events at the same
+//			ticks give the same game, bit for bit, at any frame rate. a frame that took too long (a breakpoint, a
+//			hitch) runs max_ticks at most, the rest is dropped and counted. time is integer microseconds.
+//
+//			no windows.h in here, assettool tests it headless
+//
+//**********************************************************************************************************************************************
+#include <stdint.h>
+#include <vector>
+using std::vector;
+
+#define SIM_TICK_HZ				120
+#define SIM_TICK_MICRO			(1000000 / SIM_TICK_HZ)		//8333, a tick is 120.005 Hz then
+#define SIM_MAX_TICKS			12							//per frame at speed 1, 100 ms
+#define SIM_FAST_FORWARD		8							//ticks per tick of time while fast-forwarding
+
+#define SIM_KEY_DOWN			0
+#define SIM_KEY_UP				1
+#define SIM_TURN				2		//x, y: radians added to the camera rotation
+#define SIM_FIRE				3
+
+struct sim_event
+	{
+	int type;				//SIM_
+	int key;				//virtual key code
+	float x, y;
+	sim_event()								{ type = SIM_KEY_DOWN; key = 0; x = y = 0; }
+	sim_event(int t, int k, float ex = 0, float ey = 0)	{ type = t; key = k; x = ex; y = ey; }
+	};
+
+class sim_clock
+	{
+	private:
+		vector<sim_event> events, taken;
+	public:
+		int64_t accumulator;		//microseconds not simulated yet
+		uint64_t tick;				//ticks simulated so far
+		int speed;					//1, SIM_FAST_FORWARD while fast-forwarding
+		int max_ticks;
+		uint64_t dropped;			//ticks skipped because a frame took too long
+		sim_clock()
+			{
+			accumulator = 0;
+			tick = 0;
+			speed = 1;
+			max_ticks = SIM_MAX_TICKS;
+			dropped = 0;
+			}
+		int advance(int64_t elapsed_micro)
+			{
+			if (elapsed_micro < 0) elapsed_micro = 0;
+			accumulator += elapsed_micro * speed;
+			int64_t due = accumulator / SIM_TICK_MICRO;
+			int64_t most = (int64_t)max_ticks * speed;
+			if (due > most)
+				{
+				dropped += due - most;
+				accumulator -= (due - most) * SIM_TICK_MICRO;
+				due = most;
+				}
+			accumulator -= due * SIM_TICK_MICRO;
+			return (int)due;
+			}
+		float alpha() const				{ return (float)accumulator / SIM_TICK_MICRO; }		//0..1 from the last tick to the next
+		void push(const sim_event &e)	{ events.push_back(e); }
+		const vector<sim_event> &take_events()
+			{
+			taken.swap(events);
+			events.clear();
+			return taken;
+			}
+		//simulated time
+		uint64_t micro() const			{ return tick * SIM_TICK_MICRO; }
+		double milli() const			{ return micro() / 1000.0; }
+		static double milli(uint64_t ticks)	{ return ticks * (double)SIM_TICK_MICRO / 1000.0; }
+	};
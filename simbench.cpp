@@ -0,0 +1,211 @@
+//--------------------------------------------------------------------------------------
+// File: simbench.cpp
+//
+// The game's simulation (game_sim.h) without a window or a device: steps it for a number of ticks with
+// scripted input and prints what every system cost. It is not part of the game project, build it next to it:
+//
+//		cl /O2 /EHsc simbench.cpp game_sim.cpp level_grid.cpp level_mesh.cpp level_cook.cpp mapped_file.cpp mesh.cpp mesh_normals.cpp
+//			mesh_optimize.cpp mesh_obj.cpp mesh_simplify.cpp mesh_meshlet.cpp
+//		g++ -O2 -std=c++11 simbench.cpp game_sim.cpp level_grid.cpp level_mesh.cpp level_cook.cpp mapped_file.cpp mesh.cpp mesh_normals.cpp
+//			mesh_optimize.cpp mesh_obj.cpp mesh_simplify.cpp mesh_meshlet.cpp -pthread -o simbench
+//
+// Usage:
+//		simbench [ticks] [seed] [script|-] [level bmp]
+//
+//		ticks		how long, default 72000 (10 minutes of game)
+//		seed		the placement of the asteroids, mines and one-ups, default 1
+//		script		the input, one event a line: <tick> down|up <key>, <tick> turn <x> <y>, <tick> fire.
+//					keys are characters (space is ' ', "32" works too), # starts a comment. without one (or -)
+//					a pilot starts the game, turns a bit every half second and fires every 300 ms
+//		level bmp	the ship and the bullets collide with this level, like level.bmp in the game
+//
+// The run is done twice, timed and untimed, both have to end in the same state. The state hash
+// at the end is what a regression test compares.
+//--------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include "game_sim.h"
+
+struct script_event
+	{
+	uint64_t tick;
+	sim_event e;
+	};
+
+static int parse_key(const char *s)
+	{
+	if (s[0] >= '0' && s[0] <= '9' && s[1]) return atoi(s);
+	if (s[0] >= 'a' && s[0] <= 'z') return s[0] - 'a' + 'A';
+	return s[0];
+	}
+static bool read_script(const char *path, vector<script_event> &script)
+	{
+	FILE *f = fopen(path, "r");
+	if (!f) return false;
+	char line[256];
+	int number = 0;
+	while (fgets(line, sizeof(line), f))
+		{
+		number++;
+		char *hash = strchr(line, '#');
+		if (hash) *hash = 0;
+		unsigned long long tick;
+		char what[32], a[32] = "", b[32] = "";
+		int n = sscanf(line, "%llu %31s %31s %31s", &tick, what, a, b);
+		if (n <= 0) continue;
+		script_event s;
+		s.tick = tick;
+		if (n >= 3 && strcmp(what, "down") == 0)		s.e = sim_event(SIM_KEY_DOWN, parse_key(a));
+		else if (n >= 3 && strcmp(what, "up") == 0)	s.e = sim_event(SIM_KEY_UP, parse_key(a));
+		else if (n >= 4 && strcmp(what, "turn") == 0)	s.e = sim_event(SIM_TURN, 0, (float)atof(a), (float)atof(b));
+		else if (n >= 2 && strcmp(what, "fire") == 0)	s.e = sim_event(SIM_FIRE, 0);
+		else
+			{
+			printf("%s:%d: not an event\n", path, number);
+			fclose(f);
+			return false;
+			}
+		script.push_back(s);
+		}
+	fclose(f);
+	std::stable_sort(script.begin(), script.end(), [](const script_event &x, const script_event &y) { return x.tick < y.tick; });
+	return true;
+	}
+//the default input: space to start (and every 20 s, a restart after a game over or the rail gun reversed),
+//a small turn every half second, a shot every 300 ms
+static void pilot_script(uint64_t ticks, vector<script_event> &script)
+	{
+	uint32_t r = 12345;
+	for (uint64_t t = 0; t < ticks; t++)
+		{
+		script_event s;
+		s.tick = t;
+		if (t % (SIM_TICK_HZ * 20) == 1)
+			{
+			s.e = sim_event(SIM_KEY_UP, ' ');
+			script.push_back(s);
+			}
+		if (t % (SIM_TICK_HZ / 2) == 0)
+			{
+			r = r * 1664525 + 1013904223;
+			s.e = sim_event(SIM_TURN, 0, ((r >> 8) % 200 - 100) * 0.0005f, ((r >> 16) % 200 - 100) * 0.002f);
+			script.push_back(s);
+			}
+		if (t % (SIM_TICK_HZ * 3 / 10) == 7)
+			{
+			s.e = sim_event(SIM_FIRE, 0);
+			script.push_back(s);
+			}
+		}
+	}
+//steps the game through the script, the tick times in tick_seconds (when timing)
+static void run(game_sim &game, uint32_t seed, uint64_t ticks, const vector<script_event> &script, vector<double> *tick_seconds,
+	int *sounds, int *explosions)
+	{
+	game.start(seed);
+	*sounds = *explosions = 0;
+	size_t next = 0;
+	vector<sim_event> events;
+	for (uint64_t t = 0; t < ticks; t++)
+		{
+		events.clear();
+		while (next < script.size() && script[next].tick <= t)
+			events.push_back(script[next++].e);
+		std::chrono::high_resolution_clock::time_point start;
+		if (tick_seconds) start = std::chrono::high_resolution_clock::now();
+		game.tick(events);
+		if (tick_seconds) (*tick_seconds)[t] = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		for (size_t ii = 0; ii < game.effects.size(); ii++)
+			if (game.effects[ii].type == SIM_EFFECT_SOUND)	(*sounds)++;
+			else											(*explosions)++;
+		game.effects.clear();
+		}
+	}
+//--------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+	{
+	uint64_t ticks = argc > 1 ? strtoull(argv[1], NULL, 10) : SIM_TICK_HZ * 600;
+	uint32_t seed = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+	const char *script_path = argc > 3 && strcmp(argv[3], "-") != 0 ? argv[3] : NULL;
+	const char *level_path = argc > 4 ? argv[4] : NULL;
+	if (ticks == 0)
+		{
+		printf("usage: simbench [ticks] [seed] [script|-] [level bmp]\n");
+		return 1;
+		}
+
+	vector<script_event> script;
+	if (script_path)
+		{
+		if (!read_script(script_path, script))
+			{
+			printf("FAILED reading %s\n", script_path);
+			return 1;
+			}
+		}
+	else
+		pilot_script(ticks, script);
+
+	//the level like the game places it (level::build_grid)
+	level_grid grid;
+	if (level_path)
+		{
+		mapped_file file;
+		vector<uint8_t> cells;
+		vector<level_material> materials;
+		int width, height;
+		if (!file.open(level_path) || !read_level_bitmap(file.data(), file.size(), &width, &height, cells, materials))
+			{
+			printf("FAILED reading %s\n", level_path);
+			return 1;
+			}
+		grid.cell_size = 2;
+		grid.half_height = 1;
+		grid.x_offset = (float)(width / 2) * 2;
+		grid.build(&cells[0], &materials[0], width, height);
+		}
+
+	printf("%llu ticks (%.1f s of game at %d Hz), seed %u, %d scripted events%s%s\n", (unsigned long long)ticks,
+		sim_clock::milli(ticks) / 1000.0, SIM_TICK_HZ, seed, (int)script.size(), level_path ? ", level " : "", level_path ? level_path : "");
+
+	game_sim game;
+	game.grid = level_path ? &grid : NULL;
+	game.timing = true;
+	vector<double> tick_seconds((size_t)ticks);
+	int sounds, explosions;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	run(game, seed, ticks, script, &tick_seconds, &sounds, &explosions);
+	double total = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	double systems = 0;
+	for (int ii = 0; ii < SIM_SYSTEMS; ii++)
+		systems += game.system_seconds[ii];
+	printf("%-16s %10s %10s %7s\n", "system", "ms", "us/tick", "share");
+	for (int ii = 0; ii < SIM_SYSTEMS; ii++)
+		printf("%-16s %10.2f %10.3f %6.1f%%\n", game_sim::system_name(ii), game.system_seconds[ii] * 1000.0,
+			game.system_seconds[ii] * 1e6 / ticks, systems > 0 ? game.system_seconds[ii] * 100.0 / systems : 0.0);
+	std::sort(tick_seconds.begin(), tick_seconds.end());
+	double tick_sum = 0;
+	for (size_t ii = 0; ii < tick_seconds.size(); ii++)
+		tick_sum += tick_seconds[ii];
+	printf("%-16s %10.2f %10.3f, median %.3f us, 99%% %.3f us, slowest %.3f us\n", "tick", tick_sum * 1000.0, tick_sum * 1e6 / ticks,
+		tick_seconds[tick_seconds.size() / 2] * 1e6, tick_seconds[tick_seconds.size() * 99 / 100] * 1e6, tick_seconds.back() * 1e6);
+	printf("%.1f ms for the run, %.0f ticks/s, %.0fx real time\n", total * 1000.0, ticks / total, sim_clock::milli(ticks) / 1000.0 / total);
+
+	printf("end: state %d, round %d, lives %d, %d mines, %d tracker mines, %d one-ups, %d bullets, %d sounds, %d explosions\n",
+		game.state, game.round, game.lives, (int)game.mines.size(), (int)game.tracker_mines.size(), (int)game.one_ups.size(),
+		(int)game.bullets.size(), sounds, explosions);
+	if (game.state == 3) printf("     %s\n", game.cause_of_death.c_str());
+	uint64_t hash = game.hash();
+
+	//the same input again without the timers: the same game
+	game_sim again;
+	again.grid = game.grid;
+	run(again, seed, ticks, script, NULL, &sounds, &explosions);
+	bool same = again.hash() == hash;
+	printf("state hash %016llx, untimed run %s\n", (unsigned long long)hash, same ? "identical" : "DIFFERENT");
+	return same ? 0 : 1;
+	}
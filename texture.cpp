@@ -0,0 +1,255 @@
+#include "texture.h"
+#include "mesh.h"
+#include "mapped_file.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+bool decode_image(const unsigned char *data, size_t size, texture_image &image)
+	{
+	if (size >= 8 && data[0] == 137 && data[1] == 'P' && data[2] == 'N' && data[3] == 'G')	return decode_png(data, size, image);
+	if (size >= 4 && data[0] == 0xff && data[1] == 0xd8)									return decode_jpeg(data, size, image);
+	if (size >= 2 && data[0] == 'B' && data[1] == 'M')										return decode_bmp(data, size, image);
+	return decode_tga(data, size, image);		//tga has no magic
+	}
+bool read_image(const char *filename, texture_image &image)
+	{
+	mapped_file file;
+	if (!file.open(filename) || !file.size()) return false;
+	return decode_image(file.data(), file.size(), image);
+	}
+//***************************************************************
+//		dds: "DDS " + the 124 byte header, then the levels top down. rgba as the legacy 32 bit masks, bc1/bc3
+//		as the DXT1/DXT5 fourcc, bc5 has no legacy code d3dx reads, it gets the DX10 header after the first one
+//***************************************************************
+#define DDSD_CAPS				0x1
+#define DDSD_HEIGHT				0x2
+#define DDSD_WIDTH				0x4
+#define DDSD_PITCH				0x8
+#define DDSD_PIXELFORMAT		0x1000
+#define DDSD_MIPMAPCOUNT		0x20000
+#define DDSD_LINEARSIZE			0x80000
+#define DDPF_ALPHAPIXELS		0x1
+#define DDPF_FOURCC				0x4
+#define DDPF_RGB				0x40
+#define DDSCAPS_COMPLEX			0x8
+#define DDSCAPS_TEXTURE			0x1000
+#define DDSCAPS_MIPMAP			0x400000
+#define DDS_FOURCC(a, b, c, d)	((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 | (uint32_t)(d) << 24)
+#define DXGI_BC5_UNORM			83
+#define DDS_DIMENSION_TEXTURE2D	3
+struct dds_header
+	{
+	uint32_t magic;				//"DDS "
+	uint32_t size;				//124
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitch;
+	uint32_t depth;
+	uint32_t mip_count;
+	uint32_t reserved1[11];		//[0] TEXTURECACHE_MAGIC, [1] version, [2] filter, [3..8] source size, time, hash, [9] format, [10] quality
+	uint32_t pf_size;			//32
+	uint32_t pf_flags;
+	uint32_t pf_fourcc;
+	uint32_t pf_bits;
+	uint32_t pf_mask[4];		//r g b a
+	uint32_t caps[4];
+	uint32_t reserved2;
+	};
+struct dds_header_dx10
+	{
+	uint32_t format;			//DXGI_FORMAT
+	uint32_t dimension;
+	uint32_t misc;
+	uint32_t array_size;
+	uint32_t misc2;
+	};
+bool write_dds(const char *filename, const vector<texture_image> &levels, const texture_stamp *stamp, int format, int quality)
+	{
+	if (levels.empty() || levels[0].width <= 0 || levels[0].height <= 0) return false;
+	if (format != TEXTURE_FORMAT_RGBA && !bc_block_bytes(format)) return false;
+	dds_header h;
+	memset(&h, 0, sizeof(h));
+	h.magic = 0x20534444;
+	h.size = 124;
+	h.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+	h.width = levels[0].width;
+	h.height = levels[0].height;
+	h.mip_count = (uint32_t)levels.size();
+	if (stamp)
+		{
+		h.reserved1[0] = TEXTURECACHE_MAGIC;
+		h.reserved1[1] = TEXTURECACHE_VERSION;
+		h.reserved1[2] = stamp->filter;
+		memcpy(&h.reserved1[3], &stamp->source_size, 8);
+		memcpy(&h.reserved1[5], &stamp->source_time, 8);
+		memcpy(&h.reserved1[7], &stamp->source_hash, 8);
+		h.reserved1[9] = format;
+		h.reserved1[10] = quality;
+		}
+	h.pf_size = 32;
+	dds_header_dx10 dx10;
+	memset(&dx10, 0, sizeof(dx10));
+	if (format == TEXTURE_FORMAT_RGBA)
+		{
+		h.flags |= DDSD_PITCH;
+		h.pitch = levels[0].width * 4;
+		h.pf_flags = DDPF_RGB | DDPF_ALPHAPIXELS;
+		h.pf_bits = 32;
+		h.pf_mask[0] = 0x000000ff;
+		h.pf_mask[1] = 0x0000ff00;
+		h.pf_mask[2] = 0x00ff0000;
+		h.pf_mask[3] = 0xff000000;
+		}
+	else
+		{
+		h.flags |= DDSD_LINEARSIZE;
+		h.pitch = (uint32_t)texture_level_bytes(format, levels[0].width, levels[0].height);
+		h.pf_flags = DDPF_FOURCC;
+		h.pf_fourcc = format == TEXTURE_FORMAT_BC1 ? DDS_FOURCC('D', 'X', 'T', '1') : format == TEXTURE_FORMAT_BC3 ? DDS_FOURCC('D', 'X', 'T', '5') : DDS_FOURCC('D', 'X', '1', '0');
+		dx10.format = DXGI_BC5_UNORM;
+		dx10.dimension = DDS_DIMENSION_TEXTURE2D;
+		dx10.array_size = 1;
+		}
+	h.caps[0] = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+	FILE *file = fopen(filename, "wb");
+	if (!file) return false;
+	bool written = fwrite(&h, sizeof(h), 1, file) == 1;
+	if (format == TEXTURE_FORMAT_BC5 && written)
+		written = fwrite(&dx10, sizeof(dx10), 1, file) == 1;
+	vector<unsigned char> blocks;
+	for (size_t ii = 0; ii < levels.size() && written; ii++)
+		if (format == TEXTURE_FORMAT_RGBA)
+			written = fwrite(&levels[ii].rgba[0], levels[ii].rgba.size(), 1, file) == 1;
+		else
+			written = compress_level(levels[ii], format, quality, blocks) && fwrite(&blocks[0], blocks.size(), 1, file) == 1;
+	return (fclose(file) == 0) && written;
+	}
+bool read_dds(const unsigned char *data, size_t size, vector<texture_image> &levels, texture_stamp *stamp)
+	{
+	dds_header h;
+	if (size < sizeof(h)) return false;
+	memcpy(&h, data, sizeof(h));
+	if (h.magic != 0x20534444 || h.size != 124)
+		return false;
+	size_t pos = sizeof(h);
+	int format = -1;
+	if (!(h.pf_flags & DDPF_FOURCC) && h.pf_bits == 32 && h.pf_mask[0] == 0xff && h.pf_mask[3] == 0xff000000)
+		format = TEXTURE_FORMAT_RGBA;
+	else if ((h.pf_flags & DDPF_FOURCC) && h.pf_fourcc == DDS_FOURCC('D', 'X', 'T', '1'))
+		format = TEXTURE_FORMAT_BC1;
+	else if ((h.pf_flags & DDPF_FOURCC) && h.pf_fourcc == DDS_FOURCC('D', 'X', 'T', '5'))
+		format = TEXTURE_FORMAT_BC3;
+	else if ((h.pf_flags & DDPF_FOURCC) && h.pf_fourcc == DDS_FOURCC('D', 'X', '1', '0') && size >= pos + sizeof(dds_header_dx10))
+		{
+		dds_header_dx10 dx10;
+		memcpy(&dx10, data + pos, sizeof(dx10));
+		pos += sizeof(dx10);
+		if (dx10.format == DXGI_BC5_UNORM) format = TEXTURE_FORMAT_BC5;
+		}
+	if (format < 0) return false;
+	if (stamp)
+		{
+		memset(stamp, 0, sizeof(*stamp));
+		if (h.reserved1[0] == TEXTURECACHE_MAGIC && h.reserved1[1] == TEXTURECACHE_VERSION)
+			{
+			stamp->filter = h.reserved1[2];
+			memcpy(&stamp->source_size, &h.reserved1[3], 8);
+			memcpy(&stamp->source_time, &h.reserved1[5], 8);
+			memcpy(&stamp->source_hash, &h.reserved1[7], 8);
+			stamp->format = h.reserved1[9];
+			stamp->quality = h.reserved1[10];
+			}
+		}
+	levels.clear();
+	int w = h.width, hh = h.height;
+	for (uint32_t ii = 0; ii < (h.mip_count ? h.mip_count : 1); ii++)
+		{
+		texture_image level;
+		level.width = w;
+		level.height = hh;
+		size_t bytes = texture_level_bytes(format, w, hh);
+		if (pos + bytes > size) return false;
+		if (format == TEXTURE_FORMAT_RGBA)
+			level.rgba.assign(data + pos, data + pos + bytes);
+		else if (!decompress_level(data + pos, bytes, format, w, hh, level))
+			return false;
+		levels.push_back(level);
+		pos += bytes;
+		w = w > 1 ? w / 2 : 1;
+		hh = hh > 1 ? hh / 2 : 1;
+		}
+	return true;
+	}
+//***************************************************************
+//		the cache next to the source, like the cooked meshes
+//***************************************************************
+bool is_texture_source(const char *filename)
+	{
+	const char *dot = strrchr(filename, '.');
+	if (!dot) return false;
+	char ext[8];
+	size_t len = strlen(dot + 1);
+	if (len == 0 || len >= sizeof(ext)) return false;
+	for (size_t ii = 0; ii <= len; ii++)
+		ext[ii] = (char)(dot[1 + ii] | (dot[1 + ii] ? 32 : 0));
+	return strcmp(ext, "png") == 0 || strcmp(ext, "jpg") == 0 || strcmp(ext, "jpeg") == 0 || strcmp(ext, "bmp") == 0 || strcmp(ext, "tga") == 0;
+	}
+void cooked_texture_name(const char *source, char *cooked, size_t cooked_size)
+	{
+	snprintf(cooked, cooked_size, "%s.dds", source);
+	}
+bool cook_texture(const char *source, const char *cooked, int filter, int quality)
+	{
+	texture_stamp stamp;
+	memset(&stamp, 0, sizeof(stamp));
+	if (!file_stamp(source, &stamp.source_size, &stamp.source_time)) return false;
+	stamp.source_hash = hash_file(source);
+	stamp.filter = filter;
+	texture_image image;
+	if (!read_image(source, image)) return false;
+	//normal maps are vectors, not light: no srgb curve for them
+	int role = texture_role(source, image);
+	int format = texture_role_format(role, image.width, image.height);
+	vector<texture_image> levels;
+	build_mips(image, filter, role != TEXTURE_ROLE_NORMAL, levels);
+	//write next to it and swap in, a crashed cook never leaves half a file behind
+	char temp[1024];
+	snprintf(temp, sizeof(temp), "%s.tmp", cooked);
+	if (!write_dds(temp, levels, &stamp, format, quality))
+		{
+		remove(temp);
+		return false;
+		}
+	remove(cooked);
+	return rename(temp, cooked) == 0;
+	}
+bool texture_cached(const char *source, char *cooked, size_t cooked_size)
+	{
+	cooked_texture_name(source, cooked, cooked_size);
+	uint64_t size, time;
+	mapped_file file;
+	if (!file_stamp(source, &size, &time))
+		return file.open(cooked);//only the cooked file is shipped
+	if (file.open(cooked))
+		{
+		vector<texture_image> none;
+		texture_stamp stamp;
+		memset(&stamp, 0, sizeof(stamp));
+		size_t header = sizeof(dds_header) + sizeof(dds_header_dx10);
+		read_dds(file.data(), file.size() < header ? file.size() : header, none, &stamp);	//the headers are enough for the stamp
+		if (stamp.source_size == size && stamp.source_time == time)
+			return true;
+		//touched but maybe not changed
+		if (stamp.source_size == size && stamp.source_hash == hash_file(source))
+			{
+			//the new time into the stamp (write_dds), the next start takes the cheap check again
+			file.close();
+			patch_file(cooked, offsetof(dds_header, reserved1) + 5 * sizeof(uint32_t), &time, sizeof(time));
+			return true;
+			}
+		file.close();
+		}
+	return cook_texture(source, cooked);
+	}
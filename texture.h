@@ -0,0 +1,103 @@
+#pragma once
+//**********************************************************************************************************************************************
+//
+//			offline texture cooking: the source image (png, jpg, bmp, tga) is decoded here, the full mip chain is
+//			filtered in linear light and the result is written as a .dds with every level in it. the runtime
+//			uploads those levels as they are, nothing is generated on the gpu or by d3dx at load time anymore.
+//
+//			USAGE:
+//				char cooked[1024];
+//				if (texture_cached("space.png", cooked, sizeof(cooked)))		<- cooks "space.png.dds" if it is missing or old
+//					D3DX11CreateShaderResourceViewFromFile( cooked )			<- all mips from the file
+//
+//				texture_image image;
+//				read_image("mars.jpg", image);									<- rgba8, rows top down
+//				vector<texture_image> levels;
+//				build_mips(image, TEXTURE_FILTER_KAISER, true, levels);		<- levels[0] is the image itself
+//
+//			the decoders cover what the game has: png (8/16 bit, all color types, interlaced too), baseline jpeg
+//			(any sampling, restart markers), bmp 24/32 bit and tga (raw or rle). progressive jpeg is not read.
+//			the .dds is block compressed by what the texture is for: opaque color BC1, with alpha BC3, a normal
+//			map (by name: "normal", "_n.", "_nrm.") BC5 with x and y, the shader makes z. sizes that are not
+//			whole blocks stay R8G8B8A8. all UNORM: the texels stay srgb encoded like the d3dx loaded ones were,
+//			only the averaging of the mips happens in linear space. the source stamp sits in the reserved words.
+//
+//			no windows.h in here, so the mesh/level tools can use it headless
+//
+//**********************************************************************************************************************************************
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+using std::vector;
+
+#define TEXTURE_FILTER_BOX			0		//2x2 average (odd sizes: 3 taps), sharp but aliases a bit
+#define TEXTURE_FILTER_KAISER		1		//windowed sinc over 6 taps, the default
+#define TEXTURE_KAISER_ALPHA		4.0f
+#define TEXTURE_KAISER_WIDTH		3.0f	//filter radius in pixels of the smaller level
+#define TEXTURECACHE_MAGIC			0x4b4f4f43	//"COOK" in dwReserved1[0] of the dds header
+#define TEXTURECACHE_VERSION		2
+#define TEXTURE_FORMAT_RGBA			0
+#define TEXTURE_FORMAT_BC1			1		//8 bytes per 4x4 block: two 565 colors and 2 bit indices
+#define TEXTURE_FORMAT_BC3			2		//16: bc4 alpha + bc1 color
+#define TEXTURE_FORMAT_BC5			3		//16: two bc4 channels (red, green)
+#define TEXTURE_ROLE_COLOR			0
+#define TEXTURE_ROLE_ALPHA			1
+#define TEXTURE_ROLE_NORMAL			2
+#define TEXTURE_QUALITY_FAST		0		//bounding box endpoints, fitted once to the indices
+#define TEXTURE_QUALITY_NORMAL		1		//the better of that and the principal axis, fitted twice
+#define TEXTURE_QUALITY_HIGH		2		//fitted until it stops improving, bc1 also tries 3 colors, bc4 the 0/255 mode
+
+class texture_image
+	{
+	public:
+		int width;
+		int height;
+		vector<unsigned char> rgba;		//4 bytes per texel, straight alpha
+		texture_image()
+			{
+			width = height = 0;
+			}
+	};
+
+//decoders, by content not by name. FALSE: broken or not supported
+bool decode_png(const unsigned char *data, size_t size, texture_image &image);
+bool decode_jpeg(const unsigned char *data, size_t size, texture_image &image);
+bool decode_bmp(const unsigned char *data, size_t size, texture_image &image);
+bool decode_tga(const unsigned char *data, size_t size, texture_image &image);
+bool decode_image(const unsigned char *data, size_t size, texture_image &image);
+bool read_image(const char *filename, texture_image &image);
+
+//zlib stream (png IDAT), expected_size is only a hint for the output buffer
+bool inflate_zlib(const unsigned char *data, size_t size, vector<unsigned char> &result, size_t expected_size = 0);
+
+//mips: srgb TRUE converts to linear before filtering and back after, alpha is always linear
+int mip_count(int width, int height);
+void build_mips(const texture_image &top, int filter, bool srgb, vector<texture_image> &levels);
+
+//block compression (texture_bc.cpp). threads 0: all cores for big levels
+int bc_block_bytes(int format);
+size_t texture_level_bytes(int format, int width, int height);
+bool compress_level(const texture_image &level, int format, int quality, vector<unsigned char> &blocks, int threads = 0);
+bool decompress_level(const unsigned char *blocks, size_t size, int format, int width, int height, texture_image &level);
+int texture_role(const char *filename, const texture_image &image);
+int texture_role_format(int role, int width, int height);
+double texture_psnr(const texture_image &a, const texture_image &b, int first_channel, int channels);		//dB, 99: identical
+
+//the .dds container
+class texture_stamp
+	{
+	public:
+		uint64_t source_size;
+		uint64_t source_time;
+		uint64_t source_hash;
+		uint32_t filter;
+		uint32_t format;
+		uint32_t quality;
+	};
+bool write_dds(const char *filename, const vector<texture_image> &levels, const texture_stamp *stamp = NULL, int format = TEXTURE_FORMAT_RGBA, int quality = TEXTURE_QUALITY_NORMAL);
+bool read_dds(const unsigned char *data, size_t size, vector<texture_image> &levels, texture_stamp *stamp = NULL);	//only what write_dds makes, bc levels come back decoded
+
+bool is_texture_source(const char *filename);		//png, jpg/jpeg, bmp, tga
+void cooked_texture_name(const char *source, char *cooked, size_t cooked_size);
+bool cook_texture(const char *source, const char *cooked, int filter = TEXTURE_FILTER_KAISER, int quality = TEXTURE_QUALITY_NORMAL);
+bool texture_cached(const char *source, char *cooked, size_t cooked_size);	//FALSE: no usable cooked file (and none could be made)
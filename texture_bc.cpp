@@ -0,0 +1,516 @@
+#include "texture.h"
+#include <math.h>
+#include <string.h>
+#include <thread>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define TEXTURE_SSE
+#include <emmintrin.h>
+#endif
+
+//***************************************************************
+//		block compression: every 4x4 texels become 8 bytes (bc1) or 16 (bc3: bc1 color + bc4 alpha, bc5: two bc4).
+//		the endpoints come from the spread of the block (bounding box, or the principal axis), the indices are
+//		the nearest palette entry, then the endpoints are solved again for those indices (least squares).
+//***************************************************************
+#define BC_MT_MIN_BLOCKS		4096		//a 256x256 level, smaller ones are not worth the threads
+
+class bc_pixels
+	{
+	public:
+		float c[4][16];			//r g b a of the 16 texels, as 0..255
+	};
+//the block at bx,by, texels past the edge repeat the last row/column (levels smaller than 4)
+static void fetch_block(const texture_image &level, int bx, int by, bc_pixels &p)
+	{
+	for (int y = 0; y < 4; y++)
+		for (int x = 0; x < 4; x++)
+			{
+			int sx = bx * 4 + x, sy = by * 4 + y;
+			if (sx >= level.width) sx = level.width - 1;
+			if (sy >= level.height) sy = level.height - 1;
+			const unsigned char *t = &level.rgba[((size_t)sy * level.width + sx) * 4];
+			for (int c = 0; c < 4; c++)
+				p.c[c][y * 4 + x] = t[c];
+			}
+	}
+//***************************************************************
+//		nearest palette entry for all 16 texels, returns the summed squared error
+//***************************************************************
+static float pick_indices(const bc_pixels &p, int first_channel, int channels, const float palette[][4], int entries, unsigned char *indices)
+	{
+	float total = 0;
+#ifdef TEXTURE_SSE
+	for (int ii = 0; ii < 16; ii += 4)
+		{
+		__m128 best = _mm_set1_ps(1e30f), best_index = _mm_setzero_ps();
+		for (int k = 0; k < entries; k++)
+			{
+			__m128 d = _mm_setzero_ps();
+			for (int c = 0; c < channels; c++)
+				{
+				__m128 diff = _mm_sub_ps(_mm_loadu_ps(&p.c[first_channel + c][ii]), _mm_set1_ps(palette[k][c]));
+				d = _mm_add_ps(d, _mm_mul_ps(diff, diff));
+				}
+			__m128 closer = _mm_cmplt_ps(d, best);
+			best = _mm_min_ps(d, best);
+			best_index = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)k)), _mm_andnot_ps(closer, best_index));
+			}
+		float error[4], index[4];
+		_mm_storeu_ps(error, best);
+		_mm_storeu_ps(index, best_index);
+		for (int j = 0; j < 4; j++)
+			{
+			indices[ii + j] = (unsigned char)index[j];
+			total += error[j];
+			}
+		}
+#else
+	for (int ii = 0; ii < 16; ii++)
+		{
+		float best = 1e30f;
+		for (int k = 0; k < entries; k++)
+			{
+			float d = 0;
+			for (int c = 0; c < channels; c++)
+				d += (p.c[first_channel + c][ii] - palette[k][c]) * (p.c[first_channel + c][ii] - palette[k][c]);
+			if (d < best)
+				{
+				best = d;
+				indices[ii] = (unsigned char)k;
+				}
+			}
+		total += best;
+		}
+#endif
+	return total;
+	}
+//***************************************************************
+//		bc1 color
+//***************************************************************
+static int clamp_byte(float v)
+	{
+	return v <= 0 ? 0 : v >= 255 ? 255 : (int)(v + 0.5f);
+	}
+static uint16_t to_565(const float *rgb)
+	{
+	return (uint16_t)(((clamp_byte(rgb[0]) * 31 + 127) / 255) << 11 | ((clamp_byte(rgb[1]) * 63 + 127) / 255) << 5 | ((clamp_byte(rgb[2]) * 31 + 127) / 255));
+	}
+static void from_565(uint16_t c, int *rgb)
+	{
+	int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+	}
+//the same palette the decoder builds: 4 entries if c0 > c1, else 3 and a transparent black
+static int bc1_palette(uint16_t c0, uint16_t c1, bool force_four, int palette[4][4])
+	{
+	from_565(c0, palette[0]);
+	from_565(c1, palette[1]);
+	palette[0][3] = palette[1][3] = 255;
+	if (c0 > c1 || force_four)
+		{
+		for (int c = 0; c < 3; c++)
+			{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+		palette[2][3] = palette[3][3] = 255;
+		return 4;
+		}
+	for (int c = 0; c < 3; c++)
+		{
+		palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+		palette[3][c] = 0;
+		}
+	palette[2][3] = 255;
+	palette[3][3] = 0;
+	return 3;
+	}
+class bc1_block
+	{
+	public:
+		uint16_t c0, c1;
+		unsigned char indices[16];
+		float error;
+	};
+//endpoints as they come, ordered for the mode: four colors need c0 > c1, three c0 <= c1 (the black is never used)
+static void bc1_try(const bc_pixels &p, uint16_t c0, uint16_t c1, bool three, bc1_block &best)
+	{
+	if (three ? c0 > c1 : c0 < c1)
+		{
+		uint16_t t = c0;
+		c0 = c1;
+		c1 = t;
+		}
+	int ipalette[4][4];
+	int entries = bc1_palette(c0, c1, false, ipalette);
+	if (c0 == c1) entries = 1;		//decoded as three colors, index 0 only keeps it the same either way
+	else if (entries == 3 && !three) return;
+	float palette[4][4];
+	for (int k = 0; k < 4; k++)
+		for (int c = 0; c < 4; c++)
+			palette[k][c] = (float)ipalette[k][c];
+	bc1_block block;
+	block.c0 = c0;
+	block.c1 = c1;
+	block.error = pick_indices(p, 0, 3, palette, entries, block.indices);
+	if (block.error < best.error)
+		best = block;
+	}
+//the endpoints that fit the indices best, weights of c0/c1 per index
+static bool bc1_refine(const bc_pixels &p, const bc1_block &block, float *e0, float *e1)
+	{
+	bool three = block.c0 <= block.c1 && block.c0 != block.c1;
+	static const float four_w[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	static const float three_w[3] = { 1.0f, 0.0f, 0.5f };
+	float aa = 0, bb = 0, ab = 0, ax[3] = { 0, 0, 0 }, bx[3] = { 0, 0, 0 };
+	for (int ii = 0; ii < 16; ii++)
+		{
+		float wa = three ? three_w[block.indices[ii]] : four_w[block.indices[ii]], wb = 1.0f - wa;
+		aa += wa * wa;
+		bb += wb * wb;
+		ab += wa * wb;
+		for (int c = 0; c < 3; c++)
+			{
+			ax[c] += wa * p.c[c][ii];
+			bx[c] += wb * p.c[c][ii];
+			}
+		}
+	float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-6f) return false;
+	for (int c = 0; c < 3; c++)
+		{
+		e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+		e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+		}
+	return true;
+	}
+static void encode_bc1(const bc_pixels &p, int quality, bool allow_three, unsigned char *out)
+	{
+	float mean[3] = { 0, 0, 0 }, lo[3], hi[3];
+	for (int c = 0; c < 3; c++)
+		{
+		lo[c] = hi[c] = p.c[c][0];
+		for (int ii = 0; ii < 16; ii++)
+			{
+			mean[c] += p.c[c][ii] / 16.0f;
+			lo[c] = p.c[c][ii] < lo[c] ? p.c[c][ii] : lo[c];
+			hi[c] = p.c[c][ii] > hi[c] ? p.c[c][ii] : hi[c];
+			}
+		}
+	float cov[6] = { 0, 0, 0, 0, 0, 0 };	//rr rg rb gg gb bb
+	for (int ii = 0; ii < 16; ii++)
+		{
+		float r = p.c[0][ii] - mean[0], g = p.c[1][ii] - mean[1], b = p.c[2][ii] - mean[2];
+		cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+		cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+		}
+	//seed 0: the bounding box, diagonal by the sign of the covariance, pulled in by 1/16 so the ends are not wasted on outliers
+	float seeds[2][2][3];
+	for (int c = 0; c < 3; c++)
+		{
+		float inset = (hi[c] - lo[c]) / 16.0f;
+		seeds[0][0][c] = hi[c] - inset;
+		seeds[0][1][c] = lo[c] + inset;
+		}
+	if (cov[1] < 0) { float t = seeds[0][0][1]; seeds[0][0][1] = seeds[0][1][1]; seeds[0][1][1] = t; }
+	if (cov[2] < 0) { float t = seeds[0][0][2]; seeds[0][0][2] = seeds[0][1][2]; seeds[0][1][2] = t; }
+	int seed_count = 1;
+	if (quality != TEXTURE_QUALITY_FAST)
+		{
+		//seed 1: principal axis by power iteration, the endpoints are the texels furthest along it
+		float axis[3] = { hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] };
+		if (cov[1] < 0) axis[1] = -axis[1];
+		if (cov[2] < 0) axis[2] = -axis[2];
+		for (int it = 0; it < 4; it++)
+			{
+			float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+			float len = fabsf(x) > fabsf(y) ? fabsf(x) : fabsf(y);
+			len = fabsf(z) > len ? fabsf(z) : len;
+			if (len < 1e-6f) break;
+			axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+			}
+		float dmin = 1e30f, dmax = -1e30f;
+		int imin = 0, imax = 0;
+		for (int ii = 0; ii < 16; ii++)
+			{
+			float d = p.c[0][ii] * axis[0] + p.c[1][ii] * axis[1] + p.c[2][ii] * axis[2];
+			if (d < dmin) { dmin = d; imin = ii; }
+			if (d > dmax) { dmax = d; imax = ii; }
+			}
+		for (int c = 0; c < 3; c++)
+			{
+			seeds[1][0][c] = p.c[c][imax];
+			seeds[1][1][c] = p.c[c][imin];
+			}
+		seed_count = 2;
+		}
+	bc1_block best;
+	best.error = 1e30f;
+	float e0[3], e1[3];
+	int refines = quality == TEXTURE_QUALITY_FAST ? 1 : quality == TEXTURE_QUALITY_NORMAL ? 2 : 8;
+	for (int seed = 0; seed < seed_count && best.error > 0; seed++)
+		{
+		bc1_block fit;
+		fit.error = 1e30f;
+		bc1_try(p, to_565(seeds[seed][0]), to_565(seeds[seed][1]), false, fit);
+		for (int it = 0; it < refines && fit.error > 0; it++)
+			{
+			float before = fit.error;
+			if (!bc1_refine(p, fit, e0, e1)) break;
+			bc1_try(p, to_565(e0), to_565(e1), false, fit);
+			if (fit.error >= before) break;
+			}
+		if (fit.error < best.error)
+			best = fit;
+		}
+	if (allow_three && quality == TEXTURE_QUALITY_HIGH && best.error > 0)
+		{
+		//three colors and a midpoint fit blocks with one outlier better
+		bc1_try(p, best.c0, best.c1, true, best);
+		bc1_block three;
+		three.error = 1e30f;
+		bc1_try(p, best.c0, best.c1, true, three);
+		for (int it = 0; it < 2 && three.error < 1e30f; it++)
+			if (bc1_refine(p, three, e0, e1))
+				bc1_try(p, to_565(e0), to_565(e1), true, three);
+		if (three.error < best.error)
+			best = three;
+		}
+	out[0] = (unsigned char)(best.c0 & 255);
+	out[1] = (unsigned char)(best.c0 >> 8);
+	out[2] = (unsigned char)(best.c1 & 255);
+	out[3] = (unsigned char)(best.c1 >> 8);
+	for (int row = 0; row < 4; row++)
+		out[4 + row] = (unsigned char)(best.indices[row * 4] | best.indices[row * 4 + 1] << 2 | best.indices[row * 4 + 2] << 4 | best.indices[row * 4 + 3] << 6);
+	}
+//***************************************************************
+//		bc4: one channel, 8 bit endpoints and 3 bit indices
+//***************************************************************
+//a0 > a1: 6 steps between them, else 4 steps and 0 and 255
+static void bc4_palette(int a0, int a1, int palette[8])
+	{
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1)
+		for (int k = 1; k < 7; k++)
+			palette[k + 1] = ((7 - k) * a0 + k * a1 + 3) / 7;
+	else
+		{
+		for (int k = 1; k < 5; k++)
+			palette[k + 1] = ((5 - k) * a0 + k * a1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+		}
+	}
+static float bc4_try(const bc_pixels &p, int channel, int a0, int a1, unsigned char *indices)
+	{
+	int ipalette[8];
+	bc4_palette(a0, a1, ipalette);
+	float palette[8][4];
+	for (int k = 0; k < 8; k++)
+		palette[k][0] = (float)ipalette[k];
+	return pick_indices(p, channel, 1, palette, 8, indices);
+	}
+static void encode_bc4(const bc_pixels &p, int channel, int quality, unsigned char *out)
+	{
+	float lo = 255, hi = 0, lo_inner = 255, hi_inner = 0;
+	for (int ii = 0; ii < 16; ii++)
+		{
+		float v = p.c[channel][ii];
+		lo = v < lo ? v : lo;
+		hi = v > hi ? v : hi;
+		if (v > 0 && v < lo_inner) lo_inner = v;
+		if (v < 255 && v > hi_inner) hi_inner = v;
+		}
+	int a0 = clamp_byte(hi), a1 = clamp_byte(lo);
+	unsigned char indices[16];
+	float error = bc4_try(p, channel, a0, a1, indices);
+	if (quality != TEXTURE_QUALITY_FAST && error > 0 && a0 != a1)
+		{
+		//endpoints moved one step in, the palette is rounded so the extremes are not always the best ends
+		int b0 = a0 - 1 > a1 + 1 ? a0 - 1 : a0, b1 = a0 - 1 > a1 + 1 ? a1 + 1 : a1;
+		unsigned char other[16];
+		float e = bc4_try(p, channel, b0, b1, other);
+		if (e < error)
+			{
+			error = e;
+			a0 = b0;
+			a1 = b1;
+			memcpy(indices, other, 16);
+			}
+		}
+	if (quality == TEXTURE_QUALITY_HIGH && error > 0 && lo_inner <= hi_inner && (lo == 0 || hi == 255))
+		{
+		//the 4 step mode has exact 0 and 255, the steps only span what is in between
+		int b0 = clamp_byte(lo_inner), b1 = clamp_byte(hi_inner);
+		unsigned char other[16];
+		float e = bc4_try(p, channel, b0, b1, other);
+		if (e < error)
+			{
+			error = e;
+			a0 = b0;
+			a1 = b1;
+			memcpy(indices, other, 16);
+			}
+		}
+	out[0] = (unsigned char)a0;
+	out[1] = (unsigned char)a1;
+	uint64_t bits = 0;
+	for (int ii = 0; ii < 16; ii++)
+		bits |= (uint64_t)indices[ii] << (3 * ii);
+	for (int ii = 0; ii < 6; ii++)
+		out[2 + ii] = (unsigned char)(bits >> (8 * ii));
+	}
+//***************************************************************
+//		levels
+//***************************************************************
+int bc_block_bytes(int format)
+	{
+	return format == TEXTURE_FORMAT_BC1 ? 8 : format == TEXTURE_FORMAT_BC3 || format == TEXTURE_FORMAT_BC5 ? 16 : 0;
+	}
+size_t texture_level_bytes(int format, int width, int height)
+	{
+	if (format == TEXTURE_FORMAT_RGBA) return (size_t)width * height * 4;
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * bc_block_bytes(format);
+	}
+static void compress_rows(const texture_image *level, int format, int quality, int first_row, int last_row, unsigned char *out)
+	{
+	int bw = (level->width + 3) / 4, bytes = bc_block_bytes(format);
+	bc_pixels p;
+	for (int by = first_row; by < last_row; by++)
+		for (int bx = 0; bx < bw; bx++)
+			{
+			unsigned char *block = out + ((size_t)by * bw + bx) * bytes;
+			fetch_block(*level, bx, by, p);
+			if (format == TEXTURE_FORMAT_BC1)
+				encode_bc1(p, quality, true, block);
+			else if (format == TEXTURE_FORMAT_BC3)
+				{
+				encode_bc4(p, 3, quality, block);
+				encode_bc1(p, quality, false, block + 8);
+				}
+			else
+				{
+				encode_bc4(p, 0, quality, block);
+				encode_bc4(p, 1, quality, block + 8);
+				}
+			}
+	}
+bool compress_level(const texture_image &level, int format, int quality, vector<unsigned char> &blocks, int threads)
+	{
+	if (!bc_block_bytes(format) || level.width <= 0 || level.height <= 0) return false;
+	blocks.resize(texture_level_bytes(format, level.width, level.height));
+	int bh = (level.height + 3) / 4;
+	int count = ((level.width + 3) / 4) * bh;
+	if (threads <= 0)
+		{
+		threads = 1;
+		if (count >= BC_MT_MIN_BLOCKS)
+			threads = (int)std::thread::hardware_concurrency();
+		if (threads < 1) threads = 1;
+		}
+	if (threads == 1)
+		compress_rows(&level, format, quality, 0, bh, &blocks[0]);
+	else
+		{
+		//blocks are independent, every worker writes its own rows
+		vector<std::thread> workers;
+		int slice = (bh + threads - 1) / threads;
+		for (int w = 0; w < threads; w++)
+			{
+			int first = w * slice;
+			int last = first + slice < bh ? first + slice : bh;
+			if (first >= last) break;
+			workers.push_back(std::thread(compress_rows, &level, format, quality, first, last, &blocks[0]));
+			}
+		for (size_t w = 0; w < workers.size(); w++)
+			workers[w].join();
+		}
+	return true;
+	}
+bool decompress_level(const unsigned char *blocks, size_t size, int format, int width, int height, texture_image &level)
+	{
+	int bytes = bc_block_bytes(format);
+	if (!bytes || width <= 0 || height <= 0 || size < texture_level_bytes(format, width, height)) return false;
+	level.width = width;
+	level.height = height;
+	level.rgba.assign((size_t)width * height * 4, 255);
+	int bw = (width + 3) / 4, bh = (height + 3) / 4;
+	for (int by = 0; by < bh; by++)
+		for (int bx = 0; bx < bw; bx++)
+			{
+			const unsigned char *block = blocks + ((size_t)by * bw + bx) * bytes;
+			unsigned char texels[16][4];
+			memset(texels, 255, sizeof(texels));
+			const unsigned char *color = format == TEXTURE_FORMAT_BC3 ? block + 8 : block;
+			if (format != TEXTURE_FORMAT_BC5)
+				{
+				int palette[4][4];
+				bc1_palette((uint16_t)(color[0] | color[1] << 8), (uint16_t)(color[2] | color[3] << 8), format == TEXTURE_FORMAT_BC3, palette);
+				for (int ii = 0; ii < 16; ii++)
+					for (int c = 0; c < 4; c++)
+						texels[ii][c] = (unsigned char)palette[(color[4 + ii / 4] >> ((ii & 3) * 2)) & 3][c];
+				}
+			for (int channel = 0; channel < 2; channel++)
+				{
+				if (format == TEXTURE_FORMAT_BC1 || (format == TEXTURE_FORMAT_BC3 && channel == 1)) break;
+				const unsigned char *b4 = block + channel * 8;
+				int palette[8];
+				bc4_palette(b4[0], b4[1], palette);
+				uint64_t bits = 0;
+				for (int ii = 0; ii < 6; ii++)
+					bits |= (uint64_t)b4[2 + ii] << (8 * ii);
+				int target = format == TEXTURE_FORMAT_BC3 ? 3 : channel;
+				for (int ii = 0; ii < 16; ii++)
+					texels[ii][target] = (unsigned char)palette[(bits >> (3 * ii)) & 7];
+				}
+			if (format == TEXTURE_FORMAT_BC5)
+				for (int ii = 0; ii < 16; ii++)
+					texels[ii][2] = 0;
+			for (int y = 0; y < 4 && by * 4 + y < height; y++)
+				for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+					memcpy(&level.rgba[((size_t)(by * 4 + y) * width + bx * 4 + x) * 4], texels[y * 4 + x], 4);
+			}
+	return true;
+	}
+//***************************************************************
+//		which format a texture gets
+//***************************************************************
+int texture_role(const char *filename, const texture_image &image)
+	{
+	char lower[1024];
+	size_t len = strlen(filename);
+	if (len >= sizeof(lower)) len = sizeof(lower) - 1;
+	for (size_t ii = 0; ii < len; ii++)
+		lower[ii] = (char)(filename[ii] >= 'A' && filename[ii] <= 'Z' ? filename[ii] + 32 : filename[ii]);
+	lower[len] = 0;
+	if (strstr(lower, "normal") || strstr(lower, "_n.") || strstr(lower, "_nrm."))
+		return TEXTURE_ROLE_NORMAL;
+	for (size_t ii = 3; ii < image.rgba.size(); ii += 4)
+		if (image.rgba[ii] != 255)
+			return TEXTURE_ROLE_ALPHA;
+	return TEXTURE_ROLE_COLOR;
+	}
+int texture_role_format(int role, int width, int height)
+	{
+	//d3d wants the top of a block compressed texture in whole blocks
+	if (width % 4 || height % 4) return TEXTURE_FORMAT_RGBA;
+	return role == TEXTURE_ROLE_NORMAL ? TEXTURE_FORMAT_BC5 : role == TEXTURE_ROLE_ALPHA ? TEXTURE_FORMAT_BC3 : TEXTURE_FORMAT_BC1;
+	}
+double texture_psnr(const texture_image &a, const texture_image &b, int first_channel, int channels)
+	{
+	if (a.width != b.width || a.height != b.height || a.rgba.size() != b.rgba.size()) return 0;
+	double sum = 0;
+	for (size_t ii = 0; ii < a.rgba.size(); ii += 4)
+		for (int c = first_channel; c < first_channel + channels; c++)
+			{
+			double d = (double)a.rgba[ii + c] - b.rgba[ii + c];
+			sum += d * d;
+			}
+	double mse = sum / ((double)a.width * a.height * channels);
+	return mse <= 0 ? 99.0 : 10.0 * log10(255.0 * 255.0 / mse);
+	}
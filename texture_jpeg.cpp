@@ -0,0 +1,405 @@
+#include "texture.h"
+#include <string.h>
+#include <math.h>
+
+//***************************************************************
+//		baseline jpeg (SOF0/SOF1, huffman, 8 bit): every mcu is decoded into component planes at their own
+//		resolution, the chroma planes are scaled up linearly when the planes are turned into rgb.
+//***************************************************************
+class jpeg_huffman
+	{
+	public:
+		unsigned char lookup_bits[256];	//first 8 bits -> code length, 0: longer
+		unsigned char lookup_value[256];
+		int maxcode[18];
+		int valptr[17];
+		int mincode[17];
+		unsigned char values[256];
+		bool present;
+		jpeg_huffman()
+			{
+			present = false;
+			}
+		void build(const unsigned char *counts, const unsigned char *symbols)
+			{
+			int code = 0, k = 0;
+			memset(lookup_bits, 0, sizeof(lookup_bits));
+			for (int len = 1; len <= 16; len++)
+				{
+				valptr[len] = k;
+				mincode[len] = code;
+				for (int ii = 0; ii < counts[len - 1]; ii++, k++, code++)
+					{
+					values[k] = symbols[k];
+					if (len <= 8)
+						for (int fill = 0; fill < (1 << (8 - len)); fill++)
+							{
+							lookup_bits[(code << (8 - len)) | fill] = (unsigned char)len;
+							lookup_value[(code << (8 - len)) | fill] = symbols[k];
+							}
+					}
+				maxcode[len] = counts[len - 1] ? code - 1 : -1;
+				code <<= 1;
+				}
+			maxcode[17] = 0x7fffffff;
+			present = true;
+			}
+	};
+class jpeg_component
+	{
+	public:
+		int id, h, v, quant;
+		int dc_table, ac_table;
+		int dc_pred;
+		int plane_width, plane_height;	//whole mcus
+		vector<unsigned char> plane;
+	};
+class jpeg_decoder
+	{
+	public:
+		const unsigned char *data;
+		size_t size, pos;
+		uint32_t bits;
+		int count;
+		bool marker_hit;			//a marker stopped the entropy data, zeros from here
+		uint16_t quant[4][64];
+		jpeg_huffman dc[4], ac[4];
+		jpeg_component comp[3];
+		int comp_count;
+		int width, height, hmax, vmax;
+		int restart_interval;
+
+		void fill()
+			{
+			while (count <= 24)
+				{
+				int byte = 0;
+				if (!marker_hit && pos < size)
+					{
+					byte = data[pos];
+					if (byte == 0xff)
+						{
+						int next = pos + 1 < size ? data[pos + 1] : 0;
+						if (next == 0x00)
+							pos += 2;
+						else
+							{
+							marker_hit = true;
+							byte = 0;
+							}
+						}
+					else
+						pos++;
+					}
+				bits |= (uint32_t)byte << (24 - count);
+				count += 8;
+				}
+			}
+		int get_bits(int n)
+			{
+			if (n == 0) return 0;
+			fill();
+			int result = (int)(bits >> (32 - n));
+			bits <<= n;
+			count -= n;
+			return result;
+			}
+		//n bits as the signed value of jpeg's magnitude coding
+		int receive_extend(int n)
+			{
+			if (n == 0) return 0;
+			int v = get_bits(n);
+			return v < (1 << (n - 1)) ? v - (1 << n) + 1 : v;
+			}
+		int decode(const jpeg_huffman &h)
+			{
+			fill();
+			int peek = (int)(bits >> 24);
+			int len = h.lookup_bits[peek];
+			if (len)
+				{
+				bits <<= len;
+				count -= len;
+				return h.lookup_value[peek];
+				}
+			int code = get_bits(9), l = 9;
+			while (l <= 16 && code > h.maxcode[l])
+				{
+				code = (code << 1) | get_bits(1);
+				l++;
+				}
+			if (l > 16) return -1;
+			return h.values[h.valptr[l] + code - h.mincode[l]];
+			}
+		void reset_bits()
+			{
+			bits = 0;
+			count = 0;
+			marker_hit = false;
+			}
+	};
+
+static const unsigned char zigzag[64] = {
+	0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+
+//separable float idct with a cosine table, rows then columns
+static void idct_block(const int *coef, unsigned char *out, int stride)
+	{
+	static float table[8][8];
+	static bool made = false;
+	if (!made)
+		{
+		for (int x = 0; x < 8; x++)
+			for (int u = 0; u < 8; u++)
+				table[x][u] = (u == 0 ? 0.70710678f : 1.0f) * cosf((2 * x + 1) * u * 3.14159265f / 16.0f) * 0.5f;
+		made = true;
+		}
+	float temp[64];
+	for (int y = 0; y < 8; y++)
+		for (int x = 0; x < 8; x++)
+			{
+			float sum = 0;
+			for (int u = 0; u < 8; u++)
+				sum += table[x][u] * coef[y * 8 + u];
+			temp[y * 8 + x] = sum;
+			}
+	for (int x = 0; x < 8; x++)
+		for (int y = 0; y < 8; y++)
+			{
+			float sum = 0;
+			for (int v = 0; v < 8; v++)
+				sum += table[y][v] * temp[v * 8 + x];
+			int value = (int)floorf(sum + 128.5f);
+			out[y * stride + x] = (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value);
+			}
+	}
+static bool decode_block(jpeg_decoder &j, jpeg_component &c, unsigned char *out, int stride)
+	{
+	int coef[64];
+	memset(coef, 0, sizeof(coef));
+	int t = j.decode(j.dc[c.dc_table]);
+	if (t < 0 || t > 11) return false;
+	c.dc_pred += j.receive_extend(t);
+	const uint16_t *q = j.quant[c.quant];
+	coef[0] = c.dc_pred * q[0];
+	for (int k = 1; k < 64;)
+		{
+		int rs = j.decode(j.ac[c.ac_table]);
+		if (rs < 0) return false;
+		int r = rs >> 4, s = rs & 15;
+		if (s == 0)
+			{
+			if (r != 15) break;		//end of block
+			k += 16;
+			continue;
+			}
+		k += r;
+		if (k > 63) return false;
+		coef[zigzag[k]] = j.receive_extend(s) * q[k];
+		k++;
+		}
+	idct_block(coef, out, stride);
+	return true;
+	}
+static int be16(const unsigned char *p)
+	{
+	return (p[0] << 8) | p[1];
+	}
+static bool decode_scan(jpeg_decoder &j, const int *scan_comp, int scan_count)
+	{
+	int mcu_w = 8 * j.hmax, mcu_h = 8 * j.vmax;
+	int mcus_x = (j.width + mcu_w - 1) / mcu_w, mcus_y = (j.height + mcu_h - 1) / mcu_h;
+	if (scan_count == 1)
+		{
+		//one component alone: its blocks in plain order, no mcu grouping
+		jpeg_component &c = j.comp[scan_comp[0]];
+		mcus_x = (j.width * c.h / j.hmax + 7) / 8;
+		mcus_y = (j.height * c.v / j.vmax + 7) / 8;
+		}
+	j.reset_bits();
+	int todo = j.restart_interval;
+	for (int my = 0; my < mcus_y; my++)
+		for (int mx = 0; mx < mcus_x; mx++)
+			{
+			if (j.restart_interval && todo-- == 0)
+				{
+				//RSTn: the bits so far are thrown away, the dc predictions start over
+				j.reset_bits();
+				while (j.pos + 1 < j.size && !(j.data[j.pos] == 0xff && j.data[j.pos + 1] >= 0xd0 && j.data[j.pos + 1] <= 0xd7))
+					j.pos++;
+				j.pos += 2;
+				for (int c = 0; c < j.comp_count; c++)
+					j.comp[c].dc_pred = 0;
+				todo = j.restart_interval - 1;
+				}
+			for (int s = 0; s < scan_count; s++)
+				{
+				jpeg_component &c = j.comp[scan_comp[s]];
+				int bw = scan_count == 1 ? 1 : c.h, bh = scan_count == 1 ? 1 : c.v;
+				for (int by = 0; by < bh; by++)
+					for (int bx = 0; bx < bw; bx++)
+						{
+						int px = (mx * bw + bx) * 8, py = (my * bh + by) * 8;
+						if (px >= c.plane_width || py >= c.plane_height) continue;
+						if (!decode_block(j, c, &c.plane[(size_t)py * c.plane_width + px], c.plane_width))
+							return false;
+						}
+				}
+			}
+	//to the next marker
+	while (j.pos + 1 < j.size && !(j.data[j.pos] == 0xff && j.data[j.pos + 1] != 0 && !(j.data[j.pos + 1] >= 0xd0 && j.data[j.pos + 1] <= 0xd7)))
+		j.pos++;
+	return true;
+	}
+//a chroma plane at full resolution, sampled between its texels
+static unsigned char sample_plane(const jpeg_component &c, int x, int y, int hmax, int vmax)
+	{
+	if (c.h == hmax && c.v == vmax)
+		return c.plane[(size_t)y * c.plane_width + x];
+	float fx = (x + 0.5f) * c.h / hmax - 0.5f, fy = (y + 0.5f) * c.v / vmax - 0.5f;
+	int x0 = (int)floorf(fx), y0 = (int)floorf(fy);
+	float ax = fx - x0, ay = fy - y0;
+	int maxx = c.plane_width - 1, maxy = c.plane_height - 1;
+	int xa = x0 < 0 ? 0 : x0 > maxx ? maxx : x0, xb = x0 + 1 > maxx ? maxx : x0 + 1 < 0 ? 0 : x0 + 1;
+	int ya = y0 < 0 ? 0 : y0 > maxy ? maxy : y0, yb = y0 + 1 > maxy ? maxy : y0 + 1 < 0 ? 0 : y0 + 1;
+	const unsigned char *p = &c.plane[0];
+	size_t w = c.plane_width;
+	float top = p[ya * w + xa] * (1 - ax) + p[ya * w + xb] * ax;
+	float bottom = p[yb * w + xa] * (1 - ax) + p[yb * w + xb] * ax;
+	return (unsigned char)(top * (1 - ay) + bottom * ay + 0.5f);
+	}
+bool decode_jpeg(const unsigned char *data, size_t size, texture_image &image)
+	{
+	if (size < 4 || data[0] != 0xff || data[1] != 0xd8) return false;
+	jpeg_decoder *jp = new jpeg_decoder;		//the tables are a few KB
+	jpeg_decoder &j = *jp;
+	j.data = data;
+	j.size = size;
+	j.pos = 2;
+	j.comp_count = 0;
+	j.width = j.height = 0;
+	j.restart_interval = 0;
+	memset(j.quant, 0, sizeof(j.quant));
+	bool ok = false, frame = false;
+	while (j.pos + 4 <= size)
+		{
+		if (data[j.pos] != 0xff) { j.pos++; continue; }
+		int marker = data[j.pos + 1];
+		if (marker == 0xff) { j.pos++; continue; }
+		if (marker == 0xd9) break;									//EOI
+		if (marker == 0xd8 || (marker >= 0xd0 && marker <= 0xd7)) { j.pos += 2; continue; }
+		int len = be16(data + j.pos + 2);
+		const unsigned char *seg = data + j.pos + 4;
+		if (len < 2 || j.pos + 2 + len > size) break;
+		size_t next = j.pos + 2 + len;
+		if (marker == 0xdb)											//DQT
+			{
+			for (const unsigned char *p = seg; p < seg + len - 2;)
+				{
+				int precision = p[0] >> 4, id = p[0] & 3;
+				p++;
+				for (int k = 0; k < 64; k++)
+					{
+					j.quant[id][k] = precision ? (uint16_t)be16(p + k * 2) : p[k];
+					}
+				p += precision ? 128 : 64;
+				}
+			}
+		else if (marker == 0xc4)									//DHT
+			{
+			for (const unsigned char *p = seg; p + 17 <= seg + len - 2;)
+				{
+				int cls = p[0] >> 4, id = p[0] & 3, total = 0;
+				for (int k = 0; k < 16; k++)
+					total += p[1 + k];
+				if (total > 256 || p + 17 + total > seg + len - 2) break;
+				(cls ? j.ac[id] : j.dc[id]).build(p + 1, p + 17);
+				p += 17 + total;
+				}
+			}
+		else if (marker == 0xdd)									//DRI
+			j.restart_interval = be16(seg);
+		else if (marker == 0xc0 || marker == 0xc1)					//SOF baseline / extended huffman
+			{
+			if (seg[0] != 8) break;
+			j.height = be16(seg + 1);
+			j.width = be16(seg + 3);
+			j.comp_count = seg[5];
+			if (j.comp_count != 1 && j.comp_count != 3) break;
+			if (j.width <= 0 || j.height <= 0 || j.width > 16384 || j.height > 16384) break;
+			j.hmax = j.vmax = 1;
+			for (int c = 0; c < j.comp_count; c++)
+				{
+				j.comp[c].id = seg[6 + c * 3];
+				j.comp[c].h = seg[7 + c * 3] >> 4;
+				j.comp[c].v = seg[7 + c * 3] & 15;
+				j.comp[c].quant = seg[8 + c * 3] & 3;
+				if (j.comp[c].h < 1 || j.comp[c].h > 4 || j.comp[c].v < 1 || j.comp[c].v > 4) { j.comp_count = 0; break; }
+				if (j.comp[c].h > j.hmax) j.hmax = j.comp[c].h;
+				if (j.comp[c].v > j.vmax) j.vmax = j.comp[c].v;
+				}
+			if (!j.comp_count) break;
+			int mcus_x = (j.width + 8 * j.hmax - 1) / (8 * j.hmax), mcus_y = (j.height + 8 * j.vmax - 1) / (8 * j.vmax);
+			for (int c = 0; c < j.comp_count; c++)
+				{
+				j.comp[c].plane_width = mcus_x * j.comp[c].h * 8;
+				j.comp[c].plane_height = mcus_y * j.comp[c].v * 8;
+				j.comp[c].plane.assign((size_t)j.comp[c].plane_width * j.comp[c].plane_height, 0);
+				}
+			frame = true;
+			}
+		else if (marker >= 0xc2 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+			break;													//progressive, lossless, arithmetic: not here
+		else if (marker == 0xda)									//SOS
+			{
+			if (!frame) break;
+			int scan_count = seg[0], scan_comp[3];
+			if (scan_count < 1 || scan_count > j.comp_count) break;
+			bool tables = true;
+			for (int s = 0; s < scan_count; s++)
+				{
+				int id = seg[1 + s * 2], c = 0;
+				while (c < j.comp_count && j.comp[c].id != id) c++;
+				if (c == j.comp_count) { tables = false; break; }
+				scan_comp[s] = c;
+				j.comp[c].dc_table = seg[2 + s * 2] >> 4 & 3;
+				j.comp[c].ac_table = seg[2 + s * 2] & 3;
+				j.comp[c].dc_pred = 0;
+				tables = tables && j.dc[j.comp[c].dc_table].present && j.ac[j.comp[c].ac_table].present;
+				}
+			if (!tables) break;
+			j.pos = next;
+			if (!decode_scan(j, scan_comp, scan_count)) break;
+			ok = true;
+			continue;
+			}
+		j.pos = next;
+		}
+	if (ok)
+		{
+		image.width = j.width;
+		image.height = j.height;
+		image.rgba.resize((size_t)j.width * j.height * 4);
+		for (int y = 0; y < j.height; y++)
+			for (int x = 0; x < j.width; x++)
+				{
+				unsigned char *out = &image.rgba[((size_t)y * j.width + x) * 4];
+				float luma = sample_plane(j.comp[0], x, y, j.hmax, j.vmax);
+				if (j.comp_count == 1)
+					out[0] = out[1] = out[2] = (unsigned char)luma;
+				else
+					{
+					//jfif ycbcr
+					float cb = sample_plane(j.comp[1], x, y, j.hmax, j.vmax) - 128.0f;
+					float cr = sample_plane(j.comp[2], x, y, j.hmax, j.vmax) - 128.0f;
+					float rgb[3] = { luma + 1.402f * cr, luma - 0.344136f * cb - 0.714136f * cr, luma + 1.772f * cb };
+					for (int k = 0; k < 3; k++)
+						out[k] = (unsigned char)(rgb[k] < 0 ? 0 : rgb[k] > 255 ? 255 : rgb[k] + 0.5f);
+					}
+				out[3] = 255;
+				}
+		}
+	delete jp;
+	return ok;
+	}
@@ -0,0 +1,172 @@
+#include "texture.h"
+#include <math.h>
+#include <string.h>
+
+//***************************************************************
+//		mip levels: every level is the one before it scaled down to half (rounded down, at least 1) with a
+//		separable filter. srgb texels go to linear float first, so a black and white checker turns into
+//		the 50% grey of the light and not the darker 50% of the encoded values.
+//***************************************************************
+int mip_count(int width, int height)
+	{
+	int levels = 1;
+	while (width > 1 || height > 1)
+		{
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		levels++;
+		}
+	return levels;
+	}
+static float srgb_to_linear(float c)
+	{
+	return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+static unsigned char linear_to_srgb(float c)
+	{
+	c = c <= 0 ? 0 : c >= 1 ? 1 : c;
+	float s = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+	return (unsigned char)(s * 255.0f + 0.5f);
+	}
+static float bessel_i0(float x)
+	{
+	//power series, converges fast enough for the alpha used here
+	float sum = 1, term = 1, half = x * 0.5f;
+	for (int k = 1; k < 20; k++)
+		{
+		term *= (half / k) * (half / k);
+		sum += term;
+		}
+	return sum;
+	}
+//x in pixels of the smaller level
+static float filter_weight(int filter, float x)
+	{
+	x = fabsf(x);
+	if (filter == TEXTURE_FILTER_BOX)
+		return x < 0.5f ? 1.0f : 0.0f;
+	if (x >= TEXTURE_KAISER_WIDTH) return 0;
+	float sinc = x < 1e-5f ? 1.0f : sinf(3.14159265f * x) / (3.14159265f * x);
+	float t = x / TEXTURE_KAISER_WIDTH;
+	return sinc * bessel_i0(TEXTURE_KAISER_ALPHA * sqrtf(1 - t * t)) / bessel_i0(TEXTURE_KAISER_ALPHA);
+	}
+class filter_taps
+	{
+	public:
+		vector<int> first, count;	//per destination texel
+		vector<float> weights;		//count[ii] of them per texel, back to back
+		vector<int> offset;
+		void build(int filter, int source, int dest)
+			{
+			float scale = (float)source / dest;
+			float radius = (filter == TEXTURE_FILTER_BOX ? 0.5f : TEXTURE_KAISER_WIDTH) * scale;
+			first.resize(dest);
+			count.resize(dest);
+			offset.resize(dest);
+			weights.clear();
+			for (int ii = 0; ii < dest; ii++)
+				{
+				float center = (ii + 0.5f) * scale;
+				int lo = (int)floorf(center - radius), hi = (int)ceilf(center + radius);
+				float sum = 0;
+				offset[ii] = (int)weights.size();
+				first[ii] = lo;
+				for (int s = lo; s < hi; s++)
+					{
+					//box: the share of texel s inside the footprint, the others: the filter at its center
+					float w;
+					if (filter == TEXTURE_FILTER_BOX)
+						{
+						float a = s > center - radius ? (float)s : center - radius, b = s + 1 < center + radius ? s + 1.0f : center + radius;
+						w = b > a ? b - a : 0;
+						}
+					else
+						w = filter_weight(filter, (s + 0.5f - center) / scale);
+					weights.push_back(w);
+					sum += w;
+					}
+				count[ii] = hi - lo;
+				for (int k = 0; k < count[ii]; k++)
+					weights[offset[ii] + k] /= sum;
+				}
+			}
+	};
+static int clamp_index(int ii, int size)
+	{
+	return ii < 0 ? 0 : ii >= size ? size - 1 : ii;
+	}
+//one level down, in and out linear float rgba
+static void downsample(const vector<float> &source, int sw, int sh, int filter, vector<float> &dest, int dw, int dh)
+	{
+	filter_taps tx, ty;
+	tx.build(filter, sw, dw);
+	ty.build(filter, sh, dh);
+	//horizontal into sw -> dw, then vertical
+	vector<float> temp((size_t)dw * sh * 4);
+	for (int y = 0; y < sh; y++)
+		for (int x = 0; x < dw; x++)
+			{
+			float sum[4] = { 0, 0, 0, 0 };
+			for (int k = 0; k < tx.count[x]; k++)
+				{
+				const float *p = &source[((size_t)y * sw + clamp_index(tx.first[x] + k, sw)) * 4];
+				float w = tx.weights[tx.offset[x] + k];
+				for (int c = 0; c < 4; c++)
+					sum[c] += p[c] * w;
+				}
+			memcpy(&temp[((size_t)y * dw + x) * 4], sum, sizeof(sum));
+			}
+	dest.assign((size_t)dw * dh * 4, 0.0f);
+	for (int y = 0; y < dh; y++)
+		for (int k = 0; k < ty.count[y]; k++)
+			{
+			const float *row = &temp[(size_t)clamp_index(ty.first[y] + k, sh) * dw * 4];
+			float w = ty.weights[ty.offset[y] + k];
+			float *out = &dest[(size_t)y * dw * 4];
+			for (int x = 0; x < dw * 4; x++)
+				out[x] += row[x] * w;
+			}
+	}
+void build_mips(const texture_image &top, int filter, bool srgb, vector<texture_image> &levels)
+	{
+	levels.clear();
+	levels.push_back(top);
+	if (top.width <= 0 || top.height <= 0) return;
+	float to_linear[256];
+	for (int ii = 0; ii < 256; ii++)
+		to_linear[ii] = srgb ? srgb_to_linear(ii / 255.0f) : ii / 255.0f;
+	//the color is weighted with alpha while filtering, transparent texels do not bleed their color into the edges
+	vector<float> current((size_t)top.width * top.height * 4), next;
+	for (size_t ii = 0; ii < (size_t)top.width * top.height; ii++)
+		{
+		float a = top.rgba[ii * 4 + 3] / 255.0f;
+		for (int c = 0; c < 3; c++)
+			current[ii * 4 + c] = to_linear[top.rgba[ii * 4 + c]] * a;
+		current[ii * 4 + 3] = a;
+		}
+	int w = top.width, h = top.height;
+	while (w > 1 || h > 1)
+		{
+		int dw = w > 1 ? w / 2 : 1, dh = h > 1 ? h / 2 : 1;
+		downsample(current, w, h, filter, next, dw, dh);
+		current.swap(next);
+		w = dw;
+		h = dh;
+		texture_image level;
+		level.width = w;
+		level.height = h;
+		level.rgba.resize((size_t)w * h * 4);
+		for (size_t ii = 0; ii < (size_t)w * h; ii++)
+			{
+			float a = current[ii * 4 + 3];
+			float inv = a > 1e-6f ? 1.0f / a : 0.0f;
+			for (int c = 0; c < 3; c++)
+				{
+				float v = current[ii * 4 + c] * inv;
+				level.rgba[ii * 4 + c] = srgb ? linear_to_srgb(v) : (unsigned char)((v < 0 ? 0 : v > 1 ? 1 : v) * 255.0f + 0.5f);
+				}
+			level.rgba[ii * 4 + 3] = (unsigned char)((a < 0 ? 0 : a > 1 ? 1 : a) * 255.0f + 0.5f);
+			}
+		levels.push_back(level);
+		}
+	}
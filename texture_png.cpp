@@ -0,0 +1,435 @@
+#include "texture.h"
+#include <string.h>
+
+//***************************************************************
+//		inflate (rfc 1951) behind a zlib header (rfc 1950): stored, fixed and dynamic huffman blocks.
+//		the huffman tables are canonical, decoded with a count/symbol list per code length like puff.c
+//***************************************************************
+class bit_reader
+	{
+	public:
+		const unsigned char *data;
+		size_t size, pos;
+		uint32_t bits;
+		int count;
+		bool overrun;
+		bit_reader(const unsigned char *d, size_t s)
+			{
+			data = d;
+			size = s;
+			pos = 0;
+			bits = 0;
+			count = 0;
+			overrun = false;
+			}
+		int need(int n)
+			{
+			while (count < n)
+				{
+				if (pos >= size)
+					{
+					overrun = true;
+					return 0;
+					}
+				bits |= (uint32_t)data[pos++] << count;
+				count += 8;
+				}
+			int result = (int)(bits & ((1u << n) - 1));
+			bits >>= n;
+			count -= n;
+			return result;
+			}
+	};
+class huffman
+	{
+	public:
+		short count[16];
+		short symbol[288];
+		bool build(const unsigned char *lengths, int n)
+			{
+			memset(count, 0, sizeof(count));
+			for (int ii = 0; ii < n; ii++)
+				count[lengths[ii]]++;
+			count[0] = 0;
+			short offset[16];
+			offset[1] = 0;
+			for (int len = 1; len < 15; len++)
+				offset[len + 1] = offset[len] + count[len];
+			for (int ii = 0; ii < n; ii++)
+				if (lengths[ii])
+					symbol[offset[lengths[ii]]++] = (short)ii;
+			return true;
+			}
+		int decode(bit_reader &in) const
+			{
+			int code = 0, first = 0, index = 0;
+			for (int len = 1; len < 16; len++)
+				{
+				code |= in.need(1);
+				int n = count[len];
+				if (code - n < first)
+					return symbol[index + (code - first)];
+				index += n;
+				first = (first + n) << 1;
+				code <<= 1;
+				if (in.overrun) return -1;
+				}
+			return -1;
+			}
+	};
+static const short length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const short length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const short dist_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+									 4097, 6145, 8193, 12289, 16385, 24577 };
+static const short dist_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static bool inflate_codes(bit_reader &in, const huffman &lencode, const huffman &distcode, vector<unsigned char> &out)
+	{
+	for (;;)
+		{
+		int sym = lencode.decode(in);
+		if (sym < 0 || in.overrun) return false;
+		if (sym < 256)
+			out.push_back((unsigned char)sym);
+		else if (sym == 256)
+			return true;
+		else
+			{
+			sym -= 257;
+			if (sym >= 29) return false;
+			int len = length_base[sym] + in.need(length_extra[sym]);
+			int dsym = distcode.decode(in);
+			if (dsym < 0 || dsym >= 30) return false;
+			size_t dist = (size_t)(dist_base[dsym] + in.need(dist_extra[dsym]));
+			if (in.overrun || dist > out.size()) return false;
+			size_t from = out.size() - dist;
+			for (int ii = 0; ii < len; ii++)
+				out.push_back(out[from + ii]);		//may overlap what is written here
+			}
+		}
+	}
+bool inflate_zlib(const unsigned char *data, size_t size, vector<unsigned char> &out, size_t expected_size)
+	{
+	out.clear();
+	if (size < 2 || (data[0] & 15) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 32)) return false;
+	out.reserve(expected_size);
+	bit_reader in(data + 2, size - 2);
+	int last;
+	do
+		{
+		last = in.need(1);
+		int type = in.need(2);
+		if (type == 0)
+			{
+			//stored: byte aligned, len and ~len
+			in.bits = 0;
+			in.count = 0;
+			if (in.pos + 4 > in.size) return false;
+			unsigned len = in.data[in.pos] | (in.data[in.pos + 1] << 8);
+			unsigned nlen = in.data[in.pos + 2] | (in.data[in.pos + 3] << 8);
+			in.pos += 4;
+			if (len != (~nlen & 0xffff) || in.pos + len > in.size) return false;
+			out.insert(out.end(), in.data + in.pos, in.data + in.pos + len);
+			in.pos += len;
+			}
+		else if (type == 1)
+			{
+			static huffman fixed_len, fixed_dist;
+			static bool fixed_made = false;
+			if (!fixed_made)
+				{
+				unsigned char lengths[288];
+				int ii = 0;
+				for (; ii < 144; ii++) lengths[ii] = 8;
+				for (; ii < 256; ii++) lengths[ii] = 9;
+				for (; ii < 280; ii++) lengths[ii] = 7;
+				for (; ii < 288; ii++) lengths[ii] = 8;
+				fixed_len.build(lengths, 288);
+				for (ii = 0; ii < 30; ii++) lengths[ii] = 5;
+				fixed_dist.build(lengths, 30);
+				fixed_made = true;
+				}
+			if (!inflate_codes(in, fixed_len, fixed_dist, out)) return false;
+			}
+		else if (type == 2)
+			{
+			static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+			int nlen = in.need(5) + 257, ndist = in.need(5) + 1, ncode = in.need(4) + 4;
+			if (nlen > 286 || ndist > 30) return false;
+			unsigned char lengths[320];
+			memset(lengths, 0, sizeof(lengths));
+			for (int ii = 0; ii < ncode; ii++)
+				lengths[order[ii]] = (unsigned char)in.need(3);
+			huffman lencode, distcode;
+			lencode.build(lengths, 19);
+			int index = 0;
+			while (index < nlen + ndist)
+				{
+				int sym = lencode.decode(in);
+				if (sym < 0 || in.overrun) return false;
+				if (sym < 16)
+					lengths[index++] = (unsigned char)sym;
+				else
+					{
+					unsigned char value = 0;
+					int repeat;
+					if (sym == 16)
+						{
+						if (index == 0) return false;
+						value = lengths[index - 1];
+						repeat = 3 + in.need(2);
+						}
+					else if (sym == 17)	repeat = 3 + in.need(3);
+					else				repeat = 11 + in.need(7);
+					if (index + repeat > nlen + ndist) return false;
+					while (repeat--) lengths[index++] = value;
+					}
+				}
+			lencode.build(lengths, nlen);
+			distcode.build(lengths + nlen, ndist);
+			if (!inflate_codes(in, lencode, distcode, out)) return false;
+			}
+		else
+			return false;
+		if (in.overrun) return false;
+		}
+	while (!last);
+	return true;
+	}
+//***************************************************************
+//		png: IHDR, PLTE/tRNS, the IDATs in one zlib stream, scanline filters, adam7 passes
+//***************************************************************
+static uint32_t be32(const unsigned char *p)
+	{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	}
+static unsigned char paeth(int a, int b, int c)
+	{
+	int p = a + b - c, pa = p > a ? p - a : a - p, pb = p > b ? p - b : b - p, pc = p > c ? p - c : c - p;
+	if (pa <= pb && pa <= pc) return (unsigned char)a;
+	return (unsigned char)(pb <= pc ? b : c);
+	}
+//undoes the filters of one (sub)image in place, rows of stride bytes after their filter byte
+static bool unfilter(unsigned char *rows, int height, size_t stride, int bpp)
+	{
+	unsigned char *prev = NULL;
+	for (int y = 0; y < height; y++)
+		{
+		unsigned char *row = rows + y * (stride + 1);
+		int type = row[0];
+		unsigned char *p = row + 1;
+		for (size_t x = 0; x < stride; x++)
+			{
+			int a = x >= (size_t)bpp ? p[x - bpp] : 0;
+			int b = prev ? prev[x] : 0;
+			int c = prev && x >= (size_t)bpp ? prev[x - bpp] : 0;
+			switch (type)
+				{
+				case 0: break;
+				case 1: p[x] = (unsigned char)(p[x] + a); break;
+				case 2: p[x] = (unsigned char)(p[x] + b); break;
+				case 3: p[x] = (unsigned char)(p[x] + ((a + b) >> 1)); break;
+				case 4: p[x] = (unsigned char)(p[x] + paeth(a, b, c)); break;
+				default: return false;
+				}
+			}
+		prev = p;
+		}
+	return true;
+	}
+class png_info
+	{
+	public:
+		int width, height, depth, color, channels;
+		unsigned char palette[256][4];
+		int trns[3];			//gray or rgb key color, -1: none
+	};
+//one texel of a filtered row to rgba8
+static void png_texel(const png_info &png, const unsigned char *row, int x, unsigned char *out)
+	{
+	int sample[4] = { 0, 0, 0, 0 };
+	if (png.depth < 8)
+		{
+		int per_byte = 8 / png.depth, shift = (per_byte - 1 - x % per_byte) * png.depth;
+		sample[0] = (row[x / per_byte] >> shift) & ((1 << png.depth) - 1);
+		}
+	else
+		for (int c = 0; c < png.channels; c++)
+			sample[c] = png.depth == 16 ? (row[(x * png.channels + c) * 2] << 8) | row[(x * png.channels + c) * 2 + 1] : row[x * png.channels + c];
+	int max = (1 << png.depth) - 1;
+	switch (png.color)
+		{
+		case 3:
+			memcpy(out, png.palette[sample[0]], 4);
+			return;
+		case 0:
+		case 4:
+			out[0] = out[1] = out[2] = (unsigned char)(sample[0] * 255 / max);
+			out[3] = png.color == 4 ? (unsigned char)(sample[1] * 255 / max) : (png.trns[0] == sample[0] ? 0 : 255);
+			return;
+		default:
+			for (int c = 0; c < 3; c++)
+				out[c] = (unsigned char)(sample[c] * 255 / max);
+			out[3] = png.color == 6 ? (unsigned char)(sample[3] * 255 / max) :
+				(png.trns[0] == sample[0] && png.trns[1] == sample[1] && png.trns[2] == sample[2] ? 0 : 255);
+		}
+	}
+bool decode_png(const unsigned char *data, size_t size, texture_image &image)
+	{
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	if (size < 8 || memcmp(data, signature, 8) != 0) return false;
+	png_info png;
+	memset(&png, 0, sizeof(png));
+	png.trns[0] = png.trns[1] = png.trns[2] = -1;
+	for (int ii = 0; ii < 256; ii++)
+		png.palette[ii][3] = 255;
+	int interlace = 0;
+	vector<unsigned char> compressed;
+	bool header = false;
+	for (size_t pos = 8; pos + 12 <= size;)
+		{
+		uint32_t len = be32(data + pos);
+		const unsigned char *type = data + pos + 4, *chunk = data + pos + 8;
+		if (len > size - pos - 12) return false;
+		if (memcmp(type, "IHDR", 4) == 0 && len >= 13)
+			{
+			png.width = (int)be32(chunk);
+			png.height = (int)be32(chunk + 4);
+			png.depth = chunk[8];
+			png.color = chunk[9];
+			interlace = chunk[12];
+			static const int channels[7] = { 1, 0, 3, 1, 2, 0, 4 };
+			if (png.color > 6 || !channels[png.color] || chunk[10] || chunk[11] || interlace > 1) return false;
+			if (png.depth != 1 && png.depth != 2 && png.depth != 4 && png.depth != 8 && png.depth != 16) return false;
+			if (png.depth < 8 && png.color != 0 && png.color != 3) return false;
+			if (png.width <= 0 || png.height <= 0 || png.width > 16384 || png.height > 16384) return false;
+			png.channels = channels[png.color];
+			header = true;
+			}
+		else if (memcmp(type, "PLTE", 4) == 0)
+			for (uint32_t ii = 0; ii < len / 3 && ii < 256; ii++)
+				memcpy(png.palette[ii], chunk + ii * 3, 3);
+		else if (memcmp(type, "tRNS", 4) == 0)
+			{
+			if (png.color == 3)
+				for (uint32_t ii = 0; ii < len && ii < 256; ii++)
+					png.palette[ii][3] = chunk[ii];
+			else
+				for (uint32_t c = 0; c < 3 && c * 2 + 1 < len; c++)
+					png.trns[c] = (chunk[c * 2] << 8) | chunk[c * 2 + 1];
+			if (png.color == 0) png.trns[1] = png.trns[2] = png.trns[0];
+			}
+		else if (memcmp(type, "IDAT", 4) == 0)
+			compressed.insert(compressed.end(), chunk, chunk + len);
+		else if (memcmp(type, "IEND", 4) == 0)
+			break;
+		pos += 12 + len;
+		}
+	if (!header || compressed.empty()) return false;
+
+	int bits = png.depth * png.channels, bpp = (bits + 7) / 8;
+	size_t full_stride = ((size_t)png.width * bits + 7) / 8;
+	vector<unsigned char> raw;
+	if (!inflate_zlib(&compressed[0], compressed.size(), raw, (full_stride + 1) * png.height)) return false;
+
+	image.width = png.width;
+	image.height = png.height;
+	image.rgba.assign((size_t)png.width * png.height * 4, 0);
+	//adam7: 7 smaller images, each filtered on its own. not interlaced: one pass over everything
+	static const int start_x[7] = { 0, 4, 0, 2, 0, 1, 0 }, start_y[7] = { 0, 0, 4, 0, 2, 0, 1 };
+	static const int step_x[7] = { 8, 8, 4, 4, 2, 2, 1 }, step_y[7] = { 8, 8, 8, 4, 4, 2, 2 };
+	size_t pos = 0;
+	for (int pass = interlace ? 0 : 6; pass < 7; pass++)
+		{
+		int sx = interlace ? start_x[pass] : 0, sy = interlace ? start_y[pass] : 0;
+		int dx = interlace ? step_x[pass] : 1, dy = interlace ? step_y[pass] : 1;
+		int w = (png.width - sx + dx - 1) / dx, h = (png.height - sy + dy - 1) / dy;
+		if (w <= 0 || h <= 0) continue;
+		size_t stride = ((size_t)w * bits + 7) / 8;
+		if (pos + (stride + 1) * h > raw.size()) return false;
+		if (!unfilter(&raw[pos], h, stride, bpp)) return false;
+		for (int y = 0; y < h; y++)
+			{
+			const unsigned char *row = &raw[pos + y * (stride + 1) + 1];
+			for (int x = 0; x < w; x++)
+				png_texel(png, row, x, &image.rgba[((size_t)(sy + y * dy) * png.width + sx + x * dx) * 4]);
+			}
+		pos += (stride + 1) * h;
+		}
+	return true;
+	}
+//***************************************************************
+//		bmp (24/32 bit, no compression) and tga (true color, raw or rle)
+//***************************************************************
+static uint32_t le32(const unsigned char *p)
+	{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+bool decode_bmp(const unsigned char *data, size_t size, texture_image &image)
+	{
+	if (size < 54 || data[0] != 'B' || data[1] != 'M') return false;
+	uint32_t offset = le32(data + 10);
+	int width = (int)le32(data + 18), height = (int)le32(data + 22);
+	int bits = data[28] | (data[29] << 8);
+	uint32_t compression = le32(data + 30);
+	bool top_down = height < 0;
+	if (top_down) height = -height;
+	if ((bits != 24 && bits != 32) || (compression != 0 && compression != 3) || width <= 0 || height <= 0) return false;
+	size_t stride = ((size_t)width * bits / 8 + 3) & ~(size_t)3;
+	if (offset > size || stride * height > size - offset) return false;
+	image.width = width;
+	image.height = height;
+	image.rgba.resize((size_t)width * height * 4);
+	for (int y = 0; y < height; y++)
+		{
+		const unsigned char *row = data + offset + stride * (top_down ? y : height - 1 - y);
+		unsigned char *out = &image.rgba[(size_t)y * width * 4];
+		for (int x = 0; x < width; x++, out += 4, row += bits / 8)
+			{
+			out[0] = row[2];
+			out[1] = row[1];
+			out[2] = row[0];
+			out[3] = bits == 32 ? row[3] : 255;
+			}
+		}
+	return true;
+	}
+bool decode_tga(const unsigned char *data, size_t size, texture_image &image)
+	{
+	if (size < 18) return false;
+	int id_length = data[0], colormap = data[1], type = data[2];
+	int width = data[12] | (data[13] << 8), height = data[14] | (data[15] << 8), bits = data[16];
+	bool top_down = (data[17] & 0x20) != 0;
+	if (colormap || (type != 2 && type != 10) || (bits != 24 && bits != 32) || width <= 0 || height <= 0) return false;
+	int bpp = bits / 8;
+	size_t pos = 18 + id_length, count = (size_t)width * height;
+	vector<unsigned char> texels(count * 4);
+	for (size_t ii = 0; ii < count;)
+		{
+		int run = 1;
+		bool repeat = false;
+		if (type == 10)
+			{
+			if (pos >= size) return false;
+			repeat = (data[pos] & 0x80) != 0;
+			run = (data[pos] & 0x7f) + 1;
+			pos++;
+			}
+		for (int r = 0; r < run && ii < count; r++, ii++)
+			{
+			if (pos + bpp > size) return false;
+			unsigned char *out = &texels[ii * 4];
+			out[0] = data[pos + 2];
+			out[1] = data[pos + 1];
+			out[2] = data[pos];
+			out[3] = bpp == 4 ? data[pos + 3] : 255;
+			if (!repeat || r == run - 1) pos += bpp;
+			}
+		}
+	image.width = width;
+	image.height = height;
+	image.rgba.resize(count * 4);
+	for (int y = 0; y < height; y++)
+		memcpy(&image.rgba[(size_t)y * width * 4], &texels[(size_t)(top_down ? y : height - 1 - y) * width * 4], (size_t)width * 4);
+	return true;
+	}